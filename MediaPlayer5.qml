@@ -17,6 +17,8 @@
 
 import QtQuick 2.9;
 import QtMultimedia 5.9; //5.9 is earliest version supporting 'notifyInterval'
+import QtQml.Models 2.2; //ListModel
+import com.nielsmayer.TraceLogger 1.0; //binary tracing, with console output only when --trace is off
 
 MediaPlayer {
 //  autoPlay: true;   //for compatibility with Qt6, autoPlay is off, and app-specific mechanism is used instead.
@@ -32,26 +34,22 @@ MediaPlayer {
     signal mediaPlaying(bool is_playing);
     onIs_playingChanged: mediaPlaying(is_playing);
 
-    //Desiring mediaPlayer.localMetaData to be scoped inside the mediaplayer subclass (aka this file)...
-    //but ListModel{} doesn't like being parented by MediaPlayer, so create it dynamically, and parented by 'app'
-    //doing ListModel{id:localMetadata; dynamicRoles:true} in place of this property gives error:
-    //"Cannot assign to non-existent default property"
     //Note this is currently a partial implementation for Qt5 mediaPlayer, in order to have consistent API
     //with the Qt6 mediaPlayer in MediaPlayer6.qml ... mediaPlayer.localMetadata will be empty and ignored for Qt5.
     //betweeen Qt5&Qt6 to allow relevant media metdata to be displayed in the Media Info panel.
     //See PageMediaInfo.qml for GUI populating a page with this retrieved metaData information.
     //see "localMetadata.append({ keystr:"...", value: "..." });" below for calls populating this model.
+    //Declared as a property value, rather than a child object (which gives "Cannot assign to non-existent
+    //default property"), and no longer compiled from a string by Qt.createQmlObject() at launch.
     //cleared by reset()
-    property var localMetadata: Qt.createQmlObject(
-                                    'import QtQuick 2.2; import QtQml.Models 2.2; ListModel { dynamicRoles: true; }',
-                                    app);
+    property ListModel localMetadata: ListModel { dynamicRoles: true; }
 
     //"mediaPlayer.artist" is part of the TS:MediaPlayer "API" and is referenced in Trainspodder.qml and RemoteControlLinux.qml
     readonly property string artist: ((metaData.author !== undefined) && (typeof(metaData.author) === 'string') && (metaData.author))
                                      ? metaData.author
                                      : app.mediaFolder;
     onArtistChanged:                     if (artist) {
-                                             console.log("DEBUG: mediaPlayer.artist='" + artist + "' ...");
+                                             TraceLogger.message("mediaPlayer.artist", artist);
                                              localMetadata.append({ keystr: "Artist", value: artist });
                                          }
     //"mediaPlayer.title" is part of the TS:MediaPlayer "API" and is referenced in Trainspodder.qml and RemoteControlLinux.qml
@@ -60,27 +58,27 @@ MediaPlayer {
                                     ? qsTr("%1 - %2").arg(metaData.author).arg(metaData.title)
                                     : metaData.title || metaData.author || app.mediaBaseName
     onTitleChanged:                      if (title) {
-                                             console.log("DEBUG: mediaPlayer.title='" + title + "'");
+                                             TraceLogger.message("mediaPlayer.title", title);
                                              localMetadata.append({ keystr: "Title", value: title });
                                          }
     readonly property bool   mediaInfoVideoCodecValid:   (metaData.videoCodec !== undefined) && (typeof(metaData.videoCodec) === 'string');
     onMediaInfoVideoCodecValidChanged:   if (mediaInfoVideoCodecValid) {
-                                             console.log("videoCodec: " + metaData.videoCodec);
+                                             TraceLogger.message("videoCodec", metaData.videoCodec);
                                              localMetadata.append({ keystr: "Video Codec", value: metaData.videoCodec });
                                          }
     readonly property bool   mediaInfoVideoBitrateValid: (typeof(metaData.videoBitRate) === 'number');
     onMediaInfoVideoBitrateValidChanged: if (mediaInfoVideoBitrateValid) {
-                                             console.log("videoBitRate: " + metaData.videoBitRate);
+                                             TraceLogger.message("videoBitRate", metaData.videoBitRate);
                                              localMetadata.append({ keystr: "Video BitRate", value: metaData.videoBitRate });
                                          }
     readonly property bool   mediaInfoAudioCodecValid:   (metaData.audioCodec !== undefined) && (typeof(metaData.audioCodec)   === 'string');
     onMediaInfoAudioCodecValidChanged:   if (mediaInfoAudioCodecValid) {
-                                             console.log("audioCodec: " + metaData.audioCodec);
+                                             TraceLogger.message("audioCodec", metaData.audioCodec);
                                              localMetadata.append({ keystr: "Audio Codec", value: metaData.audioCodec });
                                          }
     readonly property bool   mediaInfoAudioBitrateValid: (typeof(metaData.audioBitRate) === 'number');
     onMediaInfoAudioBitrateValidChanged: if (mediaInfoAudioBitrateValid) {
-                                             console.log("audioBitRate: " + metaData.audioBitRate);
+                                             TraceLogger.message("audioBitRate", metaData.audioBitRate);
                                              localMetadata.append({ keystr: "Audio BitRate", value: metaData.audioBitRate });
                                          }
     readonly property string mediaInfo:
@@ -103,6 +101,9 @@ MediaPlayer {
                   ? qsTr("%L1kb/s").arg((metaData.audioBitRate/1000).toFixed(0))
                   : "";
 
+    //for API parity with MediaPlayer6.qml, where this is the "image://coverart/" url of the metadata cover art.
+    readonly property url coverArtUrl: "";
+
     //TODO: commented out because not used, and also their API is inconsistent with the new Qt6MultiMedia implementation.
     //YES-BUT: not shared by Qt6 MediaPlayer "api" and also not used by 'app' so commented out:
 //    readonly property variant coverartImage: metaData.coverartImage;
@@ -135,7 +136,7 @@ MediaPlayer {
             }
         }
         else
-	    mediaPlayer.pause();   //mediaPlayer.isPlaying is still true even after error condition stopping playback.
+	    pause();               //mediaPlayer.isPlaying is still true even after error condition stopping playback.
                                    //TODO: as special-case, should also 'grey out' the resulting "play" button if displayed.
             app.message("MediaPlayer internal error: " + errorString);
 
@@ -151,6 +152,7 @@ MediaPlayer {
     signal mediaInvalid();
 
     onStatusChanged: {
+        TraceLogger.instant("mediaStatus", status);
         switch (status) {
         case MediaPlayer.NoMedia: // - no media has been set.
             mediaCleared();
@@ -0,0 +1,24 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+//Qt5 VideoOutput, loaded by main.qml's 'videoLoader'. Unlike Qt6, the VideoOutput
+//names its MediaPlayer5.qml 'source', rather than the MediaPlayer naming its output.
+
+import QtQuick 2.9;
+import QtMultimedia 5.9;
+
+VideoOutput {
+    source: app.mediaPlayer;
+}
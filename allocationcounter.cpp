@@ -0,0 +1,47 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "allocationcounter.h"
+#include <atomic>
+#include <cstddef>
+
+#ifdef __GLIBC__
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+}
+
+static std::atomic<quint64> s_allocations{0};
+
+extern "C" void *malloc(size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return (__libc_malloc(size));
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return (__libc_calloc(count, size));
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return (__libc_realloc(pointer, size));
+}
+
+qint64 allocationCount() { return (qint64(s_allocations.load(std::memory_order_relaxed))); }
+#else
+qint64 allocationCount() { return (-1); }
+#endif /* __GLIBC__ */
@@ -0,0 +1,30 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+///
+/// \brief allocationCount -- heap allocations so far, counted by interposing malloc()/calloc()/realloc()
+/// (which is what QString's storage uses, not operator new); -1 where that isn't possible (not glibc).
+///
+/// Linked only into the 'qmlvideobug_utilsbench' target (see qmlvideobug_utilsbench.pro), as counting every
+/// allocation of every thread would skew the playback measurements of 'qmlvideobug_bench'.
+///
+qint64 allocationCount();
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,464 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "audioanalysis.h"
+#include "videoframesource.h"   //for VideoFrameSource::mediaPlayerFor()
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const int    FRAME_SIZE              = 1024;       // samples per analysis frame (FFT size)
+static const int    HOP_SIZE                = 512;        // samples between frames
+static const int    RING_CAPACITY           = 64 * 1024;  // mono samples, ~1.5s at 44.1kHz
+static const int    PUSH_CHUNK              = 256;        // downmixed on the stack, then written to the ring
+static const int    THRESHOLD_FRAMES        = 10;         // preceding frames averaged for the threshold function
+static const float  THRESHOLD_MULTIPLIER    = 1.5f;
+static const float  POWER_SMOOTHING         = 0.2f;       // exponential smoothing of frame power
+static const float  BEAT_DECAY_SECONDS      = 0.15f;
+static const int    BANDS                   = 32;         // of 'spectrum', log-spaced
+static const float  MIN_BAND_HZ             = 40.0f;
+static const float  SPECTRUM_FLOOR_DB       = -80.0f;
+static const int    MAX_HISTORY             = 1024;       // frames, ~12s at 44.1kHz
+static const int    PUBLISH_INTERVAL_MS     = 33;
+static const int    BUSY_SLEEP_MS           = 5;          // worker, waiting for the rest of a hop
+static const int    IDLE_SLEEP_MS           = 20;         // worker, with nothing in the ring while tapped
+static const double PI                      = 3.14159265358979323846;
+
+Fft::Fft(const int size)
+    : m_size(size),
+      m_reversed(size_t(size))
+{
+    int bits = 0;
+    while ((1 << bits) < size)
+        bits++;
+    for (int i = 0; i < size; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++)
+            if (i & (1 << b))
+                reversed |= 1 << (bits - 1 - b);
+        m_reversed[size_t(i)] = reversed;
+    }
+    for (int half = 1; half < size; half <<= 1)              // each stage's twiddles, in order
+        for (int k = 0; k < half; k++) {
+            const double angle = -PI * k / half;
+            m_cos.push_back(float(std::cos(angle)));
+            m_sin.push_back(float(std::sin(angle)));
+        }
+}
+
+void Fft::forward(float *re, float *im) const {
+    for (int i = 0; i < m_size; i++) {
+        const int j = m_reversed[size_t(i)];
+        if (j > i) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    const float *wr = m_cos.data();
+    const float *wi = m_sin.data();
+    for (int half = 1; half < m_size; half <<= 1) {
+        for (int start = 0; start < m_size; start += 2 * half) {
+            float *ar = re + start;
+            float *ai = im + start;
+            float *br = ar + half;
+            float *bi = ai + half;
+            for (int k = 0; k < half; k++) {                 // unit stride: vectorized
+                const float tr = br[k] * wr[k] - bi[k] * wi[k];
+                const float ti = br[k] * wi[k] + bi[k] * wr[k];
+                br[k] = ar[k] - tr;
+                bi[k] = ai[k] - ti;
+                ar[k] = ar[k] + tr;
+                ai[k] = ai[k] + ti;
+            }
+        }
+        wr += half;
+        wi += half;
+    }
+}
+
+AudioAnalysis::AudioAnalysis(QObject *parent)
+    : QObject(parent),
+      m_ring(RING_CAPACITY),
+      m_history(MAX_HISTORY),
+      m_bands(BANDS, 0.0f),
+      m_fft(FRAME_SIZE),
+      m_window(FRAME_SIZE),
+      m_frame(FRAME_SIZE, 0.0f),
+      m_re(FRAME_SIZE),
+      m_im(FRAME_SIZE),
+      m_magnitude(FRAME_SIZE / 2 + 1, 0.0f),
+      m_previousMagnitude(FRAME_SIZE / 2 + 1, 0.0f),
+      m_recentFlux(THRESHOLD_FRAMES, 0.0f)
+{
+    for (int i = 0; i < FRAME_SIZE; i++)                     // Hann
+        m_window[size_t(i)] = float(0.5 * (1.0 - std::cos(2.0 * PI * i / (FRAME_SIZE - 1))));
+
+    m_publishTimer.setInterval(PUBLISH_INTERVAL_MS);
+    connect(&m_publishTimer, &QTimer::timeout, this, &AudioAnalysis::publish);
+
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    connect(&m_probe, &QAudioProbe::audioBufferProbed,
+            this,     &AudioAnalysis::push,
+            Qt::DirectConnection);
+#elif (QT_VERSION >= QT_VERSION_CHECK(6, 8, 0))  //Qt6.8
+    connect(&m_bufferOutput, &QAudioBufferOutput::audioBufferReceived,
+            this,            &AudioAnalysis::push,
+            Qt::DirectConnection);
+#endif /* QT_VERSION... */
+
+    m_worker = QThread::create([this]() { run(); });
+    m_worker->setObjectName(QStringLiteral("AudioAnalysis"));
+    m_worker->start();
+}
+
+AudioAnalysis::~AudioAnalysis() {
+    disconnectTap();
+    m_stop = true;
+    setTapped(false);                           // wakes the worker to see m_stop
+    m_worker->wait();
+    delete m_worker;
+}
+
+bool AudioAnalysis::available() const {
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0)) || (QT_VERSION >= QT_VERSION_CHECK(6, 8, 0))
+    return (true);
+#else
+    return (false);                             //no QAudioBufferOutput, and QAudioProbe is gone
+#endif /* QT_VERSION... */
+}
+
+///
+/// \brief AudioAnalysis::attach
+/// \param qmlPlayer -- main.qml's 'mediaPlayer'; follows PlayerPool's active player.
+/// \return false if 'qmlPlayer' isn't backed by a QMediaPlayer.
+///
+bool AudioAnalysis::attach(QObject *qmlPlayer) {
+    QMediaPlayer *player = VideoFrameSource::mediaPlayerFor(qmlPlayer);
+    if (player == m_player)
+        return (player != nullptr);
+    disconnectTap();
+    m_player = player;
+    m_resetRequested = true;
+    connectTap();
+    return (player != nullptr);
+}
+
+void AudioAnalysis::reset() {
+    m_resetRequested = true;
+}
+
+void AudioAnalysis::setEnabled(const bool enabled) {
+    if (m_enabled == enabled)
+        return;
+    m_enabled = enabled;
+    if (m_enabled) {
+        if (!available())
+            qWarning() << Q_FUNC_INFO << ": decoded audio can't be tapped before Qt 6.8 (QAudioBufferOutput).";
+        m_resetRequested = true;
+        connectTap();
+    }
+    else
+        disconnectTap();
+    Q_EMIT enabledChanged();
+}
+
+void AudioAnalysis::setHistoryLength(const int frames) {
+    const int length = qBound(1, frames, MAX_HISTORY);
+    if (m_historyLength == length)
+        return;
+    m_historyLength = length;
+    m_published     = 0;                        // republish at the new length
+    Q_EMIT historyLengthChanged();
+}
+
+void AudioAnalysis::setPublishInterval(const int ms) {
+    if (m_publishTimer.interval() == qMax(10, ms))
+        return;
+    m_publishTimer.setInterval(qMax(10, ms));
+    Q_EMIT publishIntervalChanged();
+}
+
+///
+/// \brief AudioAnalysis::connectTap -- only while enabled: tapping isn't free for the backend either.
+///
+void AudioAnalysis::connectTap() {
+    if (!m_enabled || !m_player)
+        return;
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    if (!m_probe.setSource(m_player.data()))
+        qWarning() << Q_FUNC_INFO << ": QAudioProbe unsupported by this media backend.";
+#elif (QT_VERSION >= QT_VERSION_CHECK(6, 8, 0))  //Qt6.8
+    m_player->setAudioBufferOutput(&m_bufferOutput);
+#endif /* QT_VERSION... */
+    m_publishTimer.start();
+    setTapped(true);
+}
+
+void AudioAnalysis::disconnectTap() {
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    m_probe.setSource(static_cast<QMediaObject *>(nullptr));
+#elif (QT_VERSION >= QT_VERSION_CHECK(6, 8, 0))  //Qt6.8
+    if (m_player && (m_player->audioBufferOutput() == &m_bufferOutput))
+        m_player->setAudioBufferOutput(nullptr);
+#endif /* QT_VERSION... */
+    m_publishTimer.stop();
+    setTapped(false);
+}
+
+void AudioAnalysis::setTapped(const bool tapped) {
+    QMutexLocker lock(&m_wakeMutex);
+    m_tapped = tapped;
+    m_wake.wakeAll();
+}
+
+static inline float toFloat(const uchar *sample, const int bytes, const bool isFloat) {
+    switch (bytes) {
+    case 1:                                     // unsigned 8 bit
+        return ((int(*sample) - 128) / 128.0f);
+    case 2: {
+        qint16 value;
+        std::memcpy(&value, sample, sizeof(value));
+        return (value / 32768.0f);
+    }
+    default:
+        if (isFloat) {
+            float value;
+            std::memcpy(&value, sample, sizeof(value));
+            return (value);
+        }
+        qint32 value;
+        std::memcpy(&value, sample, sizeof(value));
+        return (value / 2147483648.0f);
+    }
+}
+
+///
+/// \brief AudioAnalysis::push -- on the thread delivering decoded audio: downmix into the ring. Never blocks nor
+/// allocates; samples that don't fit are dropped, and counted.
+///
+void AudioAnalysis::push(const QAudioBuffer &buffer) {
+    const QAudioFormat format   = buffer.format();
+    const int          channels = format.channelCount();
+    const int          frames   = buffer.frameCount();
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    const int          bytes    = format.sampleSize() / 8;
+    const bool         isFloat  = (format.sampleType() == QAudioFormat::Float);
+    const bool         isSigned = (format.sampleType() == QAudioFormat::SignedInt);
+    const uchar       *data     = static_cast<const uchar *>(buffer.constData());
+#else                                           //Qt6
+    const int          bytes    = format.bytesPerSample();
+    const bool         isFloat  = (format.sampleFormat() == QAudioFormat::Float);
+    const bool         isSigned = (format.sampleFormat() == QAudioFormat::Int16) || (format.sampleFormat() == QAudioFormat::Int32);
+    const uchar       *data     = buffer.constData<uchar>();
+#endif /* QT_VERSION... */
+    const bool supported = (bytes == 1) ? (!isFloat && !isSigned)
+                         : (bytes == 2) ? isSigned
+                         : (bytes == 4) ? (isFloat || isSigned)
+                                        : false;
+    if (!data || !supported || (channels <= 0) || (frames <= 0))
+        return;
+    m_sampleRate.store(format.sampleRate(), std::memory_order_relaxed);
+
+    float        chunk[PUSH_CHUNK];
+    int          count  = 0;
+    const float  scale  = 1.0f / channels;
+    const uchar *sample = data;
+    for (int frame = 0; frame < frames; frame++) {
+        float sum = 0.0f;
+        for (int channel = 0; channel < channels; channel++, sample += bytes)
+            sum += toFloat(sample, bytes, isFloat);
+        chunk[count++] = sum * scale;
+        if ((count == PUSH_CHUNK) || (frame == frames - 1)) {
+            const size_t written = m_ring.write(chunk, size_t(count));
+            if (written < size_t(count))
+                m_droppedSamples.fetch_add(quint64(size_t(count) - written), std::memory_order_relaxed);
+            count = 0;
+        }
+    }
+}
+
+///
+/// \brief AudioAnalysis::run -- the worker: consume the ring a hop at a time; blocked while not tapped, e.g. disabled.
+///
+void AudioAnalysis::run() {
+    float hop[HOP_SIZE];
+    while (!m_stop.load()) {
+        {
+            QMutexLocker lock(&m_wakeMutex);
+            while (!m_tapped && !m_stop.load() && (m_ring.readAvailable() < size_t(HOP_SIZE)))
+                m_wake.wait(&m_wakeMutex);
+        }
+        const int rate = m_sampleRate.load(std::memory_order_relaxed);
+        if (m_resetRequested.exchange(false) || (rate != m_analysisRate))
+            resetAnalysis(rate);
+        const size_t available = m_ring.readAvailable();
+        if ((rate <= 0) || (available < size_t(HOP_SIZE))) {
+            QThread::msleep((available) ? BUSY_SLEEP_MS : IDLE_SLEEP_MS);
+            continue;
+        }
+
+        m_ring.read(hop, HOP_SIZE);
+        if (m_filled == FRAME_SIZE) {           // slide the frame along by a hop
+            std::memmove(m_frame.data(), m_frame.data() + HOP_SIZE, (FRAME_SIZE - HOP_SIZE) * sizeof(float));
+            m_filled -= HOP_SIZE;
+        }
+        std::memcpy(m_frame.data() + m_filled, hop, HOP_SIZE * sizeof(float));
+        m_filled += HOP_SIZE;
+        if (m_filled == FRAME_SIZE)
+            analyzeFrame();
+    }
+}
+
+///
+/// \brief AudioAnalysis::resetAnalysis -- on the worker: for a new player, source or sample rate.
+///
+void AudioAnalysis::resetAnalysis(const int sampleRate) {
+    m_ring.clear();
+    m_analysisRate = sampleRate;
+    m_filled       = 0;
+    m_frameIndex   = 0;
+    m_smoothPower  = 0.0f;
+    m_pruned1      = 0.0f;
+    m_pruned2      = 0.0f;
+    m_beatValue    = 0.0f;
+    std::fill(m_previousMagnitude.begin(), m_previousMagnitude.end(), 0.0f);
+    std::fill(m_recentFlux.begin(), m_recentFlux.end(), 0.0f);
+
+    m_bandEdges.assign(BANDS + 1, 0);
+    if (sampleRate > 0) {
+        m_beatDecay = std::exp(-(float(HOP_SIZE) / sampleRate) / BEAT_DECAY_SECONDS);
+        const float nyquist = sampleRate / 2.0f;
+        for (int b = 0; b <= BANDS; b++) {
+            const float hz  = MIN_BAND_HZ * std::pow(nyquist / MIN_BAND_HZ, float(b) / BANDS);
+            const int   bin = qBound(1, int(std::lround(hz * FRAME_SIZE / sampleRate)), FRAME_SIZE / 2);
+            m_bandEdges[size_t(b)] = (b > 0) ? qMin(FRAME_SIZE / 2, qMax(bin, m_bandEdges[size_t(b - 1)] + 1)) : bin;
+        }
+    }
+
+    QMutexLocker lock(&m_resultMutex);
+    m_historyCount = 0;
+    m_beatLevel    = 0.0f;
+    std::fill(m_bands.begin(), m_bands.end(), 0.0f);
+}
+
+///
+/// \brief AudioAnalysis::analyzeFrame -- on the worker, for the FRAME_SIZE samples in m_frame.
+///
+void AudioAnalysis::analyzeFrame() {
+    const int bins = FRAME_SIZE / 2 + 1;
+    float     energy = 0.0f;
+    for (int i = 0; i < FRAME_SIZE; i++) {
+        const float sample = m_frame[size_t(i)];
+        energy           += sample * sample;
+        m_re[size_t(i)]   = sample * m_window[size_t(i)];
+        m_im[size_t(i)]   = 0.0f;
+    }
+    m_fft.forward(m_re.data(), m_im.data());
+
+    // spectral flux: the summed increase in magnitude, per bin, since the previous frame.
+    const float norm = 2.0f / FRAME_SIZE;
+    float       flux = 0.0f;
+    for (int k = 0; k < bins; k++) {
+        const float magnitude = std::sqrt(m_re[size_t(k)] * m_re[size_t(k)] + m_im[size_t(k)] * m_im[size_t(k)]) * norm;
+        flux += std::max(0.0f, magnitude - m_previousMagnitude[size_t(k)]);
+        m_magnitude[size_t(k)] = magnitude;
+    }
+    if (m_frameIndex == 0)                      // nothing to compare with
+        flux = 0.0f;
+    m_magnitude.swap(m_previousMagnitude);
+
+    // threshold function and onsets: a peak in the flux above the preceding frames' mean.
+    float mean = 0.0f;
+    for (const float recent : m_recentFlux)
+        mean += recent;
+    const float threshold = THRESHOLD_MULTIPLIER * mean / THRESHOLD_FRAMES;
+    const float pruned    = std::max(0.0f, flux - threshold);
+    m_recentFlux[size_t(m_frameIndex % THRESHOLD_FRAMES)] = flux;
+    const bool  onset     = (m_pruned1 > pruned) && (m_pruned1 > m_pruned2);   // the previous frame was a peak
+
+    // power curve.
+    const float framesPerSecond = float(m_analysisRate) / HOP_SIZE;
+    const float powerDb         = 10.0f * std::log10(energy / FRAME_SIZE + 1e-10f);
+    const float previousSmooth  = (m_frameIndex == 0) ? powerDb : m_smoothPower;
+    m_smoothPower               = previousSmooth + POWER_SMOOTHING * (powerDb - previousSmooth);
+    const float slope           = (m_smoothPower - previousSmooth) * framesPerSecond;
+
+    m_beatValue *= m_beatDecay;
+    if (onset)
+        m_beatValue = 1.0f;
+
+    float levels[BANDS];
+    for (int b = 0; b < BANDS; b++) {
+        const int first = m_bandEdges[size_t(b)];
+        const int last  = qMax(first + 1, m_bandEdges[size_t(b + 1)]);
+        float     sum   = 0.0f;
+        for (int k = first; k < last; k++)
+            sum += m_previousMagnitude[size_t(k)];  // i.e. this frame's, after the swap
+        const float db = 20.0f * std::log10(sum / (last - first) + 1e-9f);
+        levels[b] = qBound(0.0f, (db - SPECTRUM_FLOOR_DB) / -SPECTRUM_FLOOR_DB, 1.0f);
+    }
+
+    {
+        QMutexLocker lock(&m_resultMutex);
+        const Frame frame = { flux, threshold, 0.0f, powerDb, slope, slope * pruned };
+        m_history[size_t(m_historyCount % MAX_HISTORY)] = frame;
+        if (onset && (m_historyCount > 0))
+            m_history[size_t((m_historyCount - 1) % MAX_HISTORY)].onset = m_pruned1;
+        m_historyCount++;
+        std::copy(levels, levels + BANDS, m_bands.begin());
+        m_beatLevel = m_beatValue;
+    }
+    m_pruned2 = m_pruned1;
+    m_pruned1 = pruned;
+    m_frameIndex++;
+    m_framesAnalyzed++;
+}
+
+///
+/// \brief AudioAnalysis::publish -- on the GUI thread, every 'publishInterval' while frames are being analyzed.
+///
+void AudioAnalysis::publish() {
+    const quint64 analyzed = m_framesAnalyzed.load();
+    if (analyzed == m_published)
+        return;
+    m_published = analyzed;
+    {
+        QMutexLocker lock(&m_resultMutex);
+        const int count = int(qMin(m_historyCount, quint64(qMin(m_historyLength, MAX_HISTORY))));
+        m_spectralFlux.resize(count);
+        m_threshold.resize(count);
+        m_onsets.resize(count);
+        m_power.resize(count);
+        m_smoothPowerSlope.resize(count);
+        m_powerSlopeProduct.resize(count);
+        for (int i = 0; i < count; i++) {
+            const Frame &frame = m_history[size_t((m_historyCount - quint64(count - i)) % MAX_HISTORY)];
+            m_spectralFlux[i]      = frame.flux;
+            m_threshold[i]         = frame.threshold;
+            m_onsets[i]            = frame.onset;
+            m_power[i]             = frame.power;
+            m_smoothPowerSlope[i]  = frame.slope;
+            m_powerSlopeProduct[i] = frame.product;
+        }
+        m_spectrum.resize(BANDS);
+        for (int b = 0; b < BANDS; b++)
+            m_spectrum[b] = m_bands[size_t(b)];
+        m_beat = m_beatLevel;
+    }
+    Q_EMIT framesChanged();
+}
@@ -0,0 +1,213 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef AUDIOANALYSIS_H
+#define AUDIOANALYSIS_H
+
+#include <QObject>
+#include <QAudioBuffer>
+#include <QMediaPlayer>
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <vector>
+#include <qplatformdefs.h> // defines QT_VERSION, etc
+
+#include "spscring.h"
+
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+#include <QAudioProbe>
+#elif (QT_VERSION >= QT_VERSION_CHECK(6, 8, 0))  //Qt6.8
+#include <QAudioBufferOutput>
+#endif /* QT_VERSION... */
+
+///
+/// \brief The Fft class -- in-place radix-2 complex FFT of a fixed power-of-two size.
+///
+/// Real and imaginary parts are kept in separate arrays, and twiddles are precomputed per
+/// stage, so each butterfly stage is a unit-stride loop that the compiler vectorizes
+/// (SSE/AVX, NEON) without intrinsics.
+///
+class Fft
+{
+public:
+    explicit Fft(const int size);
+    int  size() const { return (m_size); }
+    void forward(float *re, float *im) const;
+
+private:
+    int                 m_size;
+    std::vector<int>    m_reversed;     // bit-reversal permutation
+    std::vector<float>  m_cos;          // per stage, concatenated
+    std::vector<float>  m_sin;
+};
+
+///
+/// \brief The AudioAnalysis class
+///
+/// Brings back the analyses formerly behind main.qml's 'want_beat_animation',
+/// 'want_mzspectralflux_*' and 'want_mzpowercurve_*' flags. Decoded PCM is tapped with
+/// a QAudioBufferOutput (Qt >= 6.8) or a QAudioProbe (Qt5), downmixed to mono on the
+/// delivering thread -- into a stack buffer, then a preallocated SpscRing, so that
+/// thread never blocks nor allocates -- and analyzed on a worker thread, per 1024-sample
+/// Hann-windowed frame with a 512-sample hop:
+///  - spectral flux, the rectified increase in magnitude spectrum from the previous frame,
+///  - its threshold function, the mean flux of the preceding frames times a multiplier,
+///  - onsets: peaks of the flux above that threshold (one frame late, to see the peak),
+///  - frame power in dB, its exponentially smoothed slope (dB/s), and that slope times
+///    the thresholded flux, which is large on loud attacks,
+///  - 'beat', a 0..1 envelope raised on each onset, for animations,
+///  - 'spectrum', log-spaced band levels of the latest frame, 0..1.
+/// Results reach QML, at most every 'publishInterval' ms, as arrays of the last
+/// 'historyLength' frames, oldest first.
+///
+class AudioAnalysis : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool             enabled             READ enabled            WRITE setEnabled            NOTIFY enabledChanged)
+    Q_PROPERTY(bool             requested           READ requested          CONSTANT)   // --audio-analysis
+    Q_PROPERTY(bool             available           READ available          CONSTANT)   // false for Qt6 before 6.8
+    Q_PROPERTY(int              historyLength       READ historyLength      WRITE setHistoryLength      NOTIFY historyLengthChanged)
+    Q_PROPERTY(int              publishInterval     READ publishInterval    WRITE setPublishInterval    NOTIFY publishIntervalChanged)
+    Q_PROPERTY(QVector<qreal>   spectralFlux        READ spectralFlux       NOTIFY framesChanged)
+    Q_PROPERTY(QVector<qreal>   threshold           READ threshold          NOTIFY framesChanged)
+    Q_PROPERTY(QVector<qreal>   onsets              READ onsets             NOTIFY framesChanged)   // thresholded flux at peaks, else 0
+    Q_PROPERTY(QVector<qreal>   power               READ power              NOTIFY framesChanged)   // dBFS
+    Q_PROPERTY(QVector<qreal>   smoothPowerSlope    READ smoothPowerSlope   NOTIFY framesChanged)   // dB/s
+    Q_PROPERTY(QVector<qreal>   powerSlopeProduct   READ powerSlopeProduct  NOTIFY framesChanged)
+    Q_PROPERTY(QVector<qreal>   spectrum            READ spectrum           NOTIFY framesChanged)
+    Q_PROPERTY(qreal            beat                READ beat               NOTIFY framesChanged)
+    Q_PROPERTY(int              sampleRate          READ sampleRate         NOTIFY framesChanged)
+    Q_PROPERTY(quint64          framesAnalyzed      READ framesAnalyzed     NOTIFY framesChanged)
+    Q_PROPERTY(quint64          droppedSamples      READ droppedSamples     NOTIFY framesChanged)   // ring overruns
+
+public:
+    explicit AudioAnalysis(QObject *parent = nullptr);
+    ~AudioAnalysis() override;
+
+    Q_INVOKABLE bool attach(QObject *qmlPlayer);
+    Q_INVOKABLE void reset();
+
+    bool            enabled() const { return (m_enabled); }
+    void            setEnabled(const bool enabled);
+    bool            requested() const { return (m_requested); }
+    void            setRequested(const bool requested) { m_requested = requested; }
+    bool            available() const;
+    int             historyLength() const { return (m_historyLength); }
+    void            setHistoryLength(const int frames);
+    int             publishInterval() const { return (m_publishTimer.interval()); }
+    void            setPublishInterval(const int ms);
+
+    QVector<qreal>  spectralFlux() const        { return (m_spectralFlux); }
+    QVector<qreal>  threshold() const           { return (m_threshold); }
+    QVector<qreal>  onsets() const              { return (m_onsets); }
+    QVector<qreal>  power() const               { return (m_power); }
+    QVector<qreal>  smoothPowerSlope() const    { return (m_smoothPowerSlope); }
+    QVector<qreal>  powerSlopeProduct() const   { return (m_powerSlopeProduct); }
+    QVector<qreal>  spectrum() const            { return (m_spectrum); }
+    qreal           beat() const                { return (m_beat); }
+    int             sampleRate() const          { return (m_sampleRate.load()); }
+    quint64         framesAnalyzed() const      { return (m_framesAnalyzed.load()); }
+    quint64         droppedSamples() const      { return (m_droppedSamples.load()); }
+
+Q_SIGNALS:
+    void enabledChanged();
+    void historyLengthChanged();
+    void publishIntervalChanged();
+    void framesChanged();
+
+private:
+    struct Frame {
+        float flux;
+        float threshold;
+        float onset;
+        float power;
+        float slope;
+        float product;
+    };
+
+    void connectTap();
+    void disconnectTap();
+    void setTapped(const bool tapped);          // wakes the worker, or lets it sleep until woken
+    void push(const QAudioBuffer &buffer);      // on the delivering thread
+    void run();                                 // the worker
+    void resetAnalysis(const int sampleRate);
+    void analyzeFrame();
+    void publish();                             // on the GUI thread
+
+    // GUI thread
+    QPointer<QMediaPlayer>      m_player;
+    bool                        m_enabled       = false;
+    bool                        m_requested     = false;
+    int                         m_historyLength = 256;
+    QTimer                      m_publishTimer;
+    quint64                     m_published     = 0;    // m_framesAnalyzed when last published
+    QVector<qreal>              m_spectralFlux;
+    QVector<qreal>              m_threshold;
+    QVector<qreal>              m_onsets;
+    QVector<qreal>              m_power;
+    QVector<qreal>              m_smoothPowerSlope;
+    QVector<qreal>              m_powerSlopeProduct;
+    QVector<qreal>              m_spectrum;
+    qreal                       m_beat          = 0.0;
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    QAudioProbe                 m_probe;
+#elif (QT_VERSION >= QT_VERSION_CHECK(6, 8, 0))  //Qt6.8
+    QAudioBufferOutput          m_bufferOutput;
+#endif /* QT_VERSION... */
+
+    // shared
+    SpscRing<float>             m_ring;
+    std::atomic<int>            m_sampleRate{0};
+    std::atomic<quint64>        m_framesAnalyzed{0};
+    std::atomic<quint64>        m_droppedSamples{0};
+    std::atomic<bool>           m_resetRequested{false};
+    std::atomic<bool>           m_stop{false};
+    QMutex                      m_wakeMutex;
+    QWaitCondition              m_wake;                 // the worker waits on it while not tapped
+    bool                        m_tapped        = false;    // guarded by m_wakeMutex
+    QThread                    *m_worker        = nullptr;
+    QMutex                      m_resultMutex;          // guards the results below, between worker and GUI thread
+    std::vector<Frame>          m_history;              // circular, MAX_HISTORY frames
+    quint64                     m_historyCount  = 0;    // frames ever written into it
+    std::vector<float>          m_bands;
+    float                       m_beatLevel     = 0.0f;
+
+    // worker thread only
+    Fft                         m_fft;
+    int                         m_analysisRate  = 0;
+    std::vector<float>          m_window;
+    std::vector<float>          m_frame;
+    std::vector<float>          m_re;
+    std::vector<float>          m_im;
+    std::vector<float>          m_magnitude;
+    std::vector<float>          m_previousMagnitude;
+    std::vector<int>            m_bandEdges;            // BANDS + 1 bin indices
+    std::vector<float>          m_recentFlux;           // circular, THRESHOLD_FRAMES
+    int                         m_filled        = 0;    // samples in m_frame
+    quint64                     m_frameIndex    = 0;
+    float                       m_smoothPower   = 0.0f;
+    float                       m_pruned1       = 0.0f; // thresholded flux, 1 and 2 frames ago
+    float                       m_pruned2       = 0.0f;
+    float                       m_beatDecay     = 0.0f;
+    float                       m_beatValue     = 0.0f;
+};
+
+#endif // AUDIOANALYSIS_H
@@ -0,0 +1,205 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "benchrunner.h"
+#include <QGuiApplication>
+#include <QJsonDocument>
+#include <QFile>
+#include <QDebug>
+#include <cstdio>   //stdout
+
+static const int SAMPLE_INTERVAL_MS = 100;
+static const int LOAD_TIMEOUT_MS    = 30000; //give up on a file that doesn't start playing within 30s.
+
+BenchRunner::BenchRunner(const QList<QUrl> &files,
+                         const int seconds,
+                         const QString &outputPath,
+                         const QElapsedTimer &launchTimer,
+                         QObject *parent)
+    : QObject(parent),
+      m_files(files),
+      m_seconds(qMax(1, seconds)),
+      m_outputPath(outputPath),
+      m_launchTimer(launchTimer)
+{
+    m_sampler.setTimerType(Qt::PreciseTimer);
+    m_sampler.setInterval(SAMPLE_INTERVAL_MS);
+    connect(&m_sampler, &QTimer::timeout, this, &BenchRunner::sample);
+
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, &QTimer::timeout, this, [this]() {
+        finishCurrent(QStringLiteral("timeout"));
+    });
+
+    // runs on the frame-delivery thread: only flag the first frame and bounce to the GUI thread.
+    connect(&m_frames, &VideoFrameSource::frameArrived, this, [this](const QVideoFrame &) {
+        if (m_waitingForFrame.exchange(false)) {
+            const qint64 at = m_launchTimer.elapsed();
+            QMetaObject::invokeMethod(this, [this, at]() { onFirstFrame(at); }, Qt::QueuedConnection);
+        }
+    }, Qt::DirectConnection);
+}
+
+///
+/// \brief BenchRunner::start
+/// \param rootObject -- the main.qml ApplicationWindow, from QQmlApplicationEngine::objectCreated.
+///
+void BenchRunner::start(QObject *rootObject) {
+    m_player = (rootObject) ? qvariant_cast<QObject *>(rootObject->property("mediaPlayer")) : nullptr;
+    if (!m_player) {
+        qWarning() << Q_FUNC_INFO << ": main.qml has no 'mediaPlayer', aborting benchmark.";
+        QCoreApplication::exit(1);
+        return;
+    }
+    // these are QML-declared signals in MediaPlayer5.qml/MediaPlayer6.qml, hence string-based connect.
+    connect(m_player, SIGNAL(mediaLoading()),  this, SLOT(onMediaLoading()));
+    connect(m_player, SIGNAL(mediaBuffered()), this, SLOT(onMediaBuffered()));
+    connect(m_player, SIGNAL(mediaInvalid()),  this, SLOT(onMediaInvalid()));
+    m_frames.attach(m_player);
+
+    runNext();
+}
+
+void BenchRunner::runNext() {
+    if (++m_index >= m_files.size()) {
+        writeResults();
+        QCoreApplication::exit(0);
+        return;
+    }
+
+    const QUrl url = m_files.at(m_index);
+    m_current = QJsonObject{ { QStringLiteral("url"), url.toString() } };
+    m_loadingAt = m_bufferedAt = m_firstFrameAt = m_sampleWall0 = m_samplePos0 = -1;
+    m_maxAbsDriftMs = 0.0;
+    m_samples = 0;
+
+    QMetaObject::invokeMethod(m_player, "reset");
+    m_waitingForFrame = true;
+    m_player->setProperty("source", url);
+    m_playRequested = m_launchTimer.elapsed();
+    QMetaObject::invokeMethod(m_player, "play");
+    m_timeout.start(LOAD_TIMEOUT_MS);
+}
+
+void BenchRunner::onMediaLoading() {
+    if (m_loadingAt < 0)
+        m_loadingAt = m_launchTimer.elapsed();
+}
+
+void BenchRunner::onMediaBuffered() {
+    if (m_bufferedAt >= 0)
+        return;
+    m_bufferedAt = m_launchTimer.elapsed();
+    m_current.insert(QStringLiteral("loadingToBufferedMs"),
+                     (m_loadingAt >= 0) ? QJsonValue(m_bufferedAt - m_loadingAt) : QJsonValue());
+    maybeStartSampling();
+}
+
+void BenchRunner::onMediaInvalid() {
+    finishCurrent(QStringLiteral("invalid media"));
+}
+
+void BenchRunner::onFirstFrame(const qint64 launchMs) {
+    if (m_index < 0 || m_firstFrameAt >= 0)
+        return;
+    m_firstFrameAt = launchMs;
+    if (m_index == 0)
+        m_current.insert(QStringLiteral("launchToFirstFrameMs"), launchMs);
+    m_current.insert(QStringLiteral("playToFirstFrameMs"), launchMs - m_playRequested);
+    maybeStartSampling();
+}
+
+///
+/// \brief BenchRunner::maybeStartSampling -- start measuring drift once buffered, and for video, once frames flow.
+///
+void BenchRunner::maybeStartSampling() {
+    if (m_sampler.isActive() || m_bufferedAt < 0)
+        return;
+    const bool hasVideo = m_player->property("hasVideo").toBool();
+    if (hasVideo && m_firstFrameAt < 0)
+        return;
+
+    m_current.insert(QStringLiteral("hasVideo"), hasVideo);
+    m_timeout.start(m_seconds * 1000 + LOAD_TIMEOUT_MS);
+    m_sampler.start();
+}
+
+///
+/// \brief BenchRunner::sample -- compare reported position progress against wall-clock progress.
+///
+void BenchRunner::sample() {
+    if (!m_player->property("is_playing").toBool())
+        return;
+
+    const qint64 wall = m_launchTimer.elapsed();
+    const qint64 pos  = m_player->property("position").toLongLong();
+    if (m_sampleWall0 < 0) {
+        m_sampleWall0 = wall;
+        m_samplePos0  = pos;
+        return;
+    }
+
+    const qreal  rate       = m_player->property("playbackRate").toReal();
+    const qint64 wallDelta  = wall - m_sampleWall0;
+    const qint64 posDelta   = pos  - m_samplePos0;
+    const qreal  driftMs    = posDelta - (wallDelta * ((rate > 0.0) ? rate : 1.0));
+    m_maxAbsDriftMs = qMax(m_maxAbsDriftMs, qAbs(driftMs));
+    m_samples++;
+
+    if (wallDelta >= m_seconds * 1000) {
+        m_current.insert(QStringLiteral("wallMs"),         wallDelta);
+        m_current.insert(QStringLiteral("positionMs"),     posDelta);
+        m_current.insert(QStringLiteral("driftMs"),        driftMs);
+        m_current.insert(QStringLiteral("maxAbsDriftMs"),  m_maxAbsDriftMs);
+        m_current.insert(QStringLiteral("speedRatio"),     (wallDelta > 0) ? (qreal(posDelta) / wallDelta) : 0.0);
+        m_current.insert(QStringLiteral("samples"),        m_samples);
+        finishCurrent();
+    }
+}
+
+void BenchRunner::finishCurrent(const QString &error) {
+    if (m_index < 0 || m_index >= m_files.size())
+        return;
+    m_sampler.stop();
+    m_timeout.stop();
+    m_waitingForFrame = false;
+    if (!error.isEmpty()) {
+        qWarning() << Q_FUNC_INFO << ":" << m_files.at(m_index) << error;
+        m_current.insert(QStringLiteral("error"), error);
+    }
+    m_results.append(m_current);
+    QMetaObject::invokeMethod(m_player, "stop");
+    QMetaObject::invokeMethod(this, &BenchRunner::runNext, Qt::QueuedConnection);
+}
+
+void BenchRunner::writeResults() {
+    const QJsonObject root {
+        { QStringLiteral("qtVersion"),      QStringLiteral(QT_VERSION_STR) },
+        { QStringLiteral("platform"),       QGuiApplication::platformName() },
+        { QStringLiteral("sampleSeconds"),  m_seconds },
+        { QStringLiteral("results"),        m_results },
+    };
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+
+    QFile out;
+    const bool opened = (m_outputPath.isEmpty() || m_outputPath == QLatin1String("-"))
+                        ? out.open(stdout, QIODevice::WriteOnly)
+                        : (out.setFileName(m_outputPath), out.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    if (!opened) {
+        qWarning() << Q_FUNC_INFO << ": unable to write results to" << m_outputPath;
+        return;
+    }
+    out.write(json);
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BENCHRUNNER_H
+#define BENCHRUNNER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QUrl>
+#include <QList>
+#include <atomic>
+
+#include "videoframesource.h"
+
+///
+/// \brief The BenchRunner class
+///
+/// Drives the 'qmlvideobug_bench' target (main.cpp compiled with QMLVIDEOBUG_BENCH):
+/// plays each local media file given on the command line through the same main.qml
+/// 'mediaPlayer' as the app, and writes JSON results containing
+///  - launch (top of main()) to first decoded video frame, for the first file,
+///  - play() to first decoded video frame, for every file,
+///  - Loading->Buffered latency from the mediaLoading/mediaBuffered signals,
+///  - drift of the reported position versus wall-clock time over N seconds
+///    of playback, i.e. the "reported speed faster than actual time" regression.
+///
+class BenchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    BenchRunner(const QList<QUrl> &files,
+                const int seconds,
+                const QString &outputPath,
+                const QElapsedTimer &launchTimer,
+                QObject *parent = nullptr);
+
+    void start(QObject *rootObject);
+
+private Q_SLOTS:
+    void onMediaLoading();
+    void onMediaBuffered();
+    void onMediaInvalid();
+
+private:
+    void runNext();
+    void onFirstFrame(const qint64 launchMs);
+    void maybeStartSampling();
+    void sample();
+    void finishCurrent(const QString &error = QString());
+    void writeResults();
+
+    QList<QUrl>             m_files;
+    int                     m_seconds;
+    QString                 m_outputPath;
+    QElapsedTimer           m_launchTimer;      //started at top of main()
+    QPointer<QObject>       m_player;           //main.qml 'mediaPlayer'
+    VideoFrameSource        m_frames;
+    std::atomic<bool>       m_waitingForFrame{false};
+    QTimer                  m_sampler;
+    QTimer                  m_timeout;
+    QJsonArray              m_results;
+    QJsonObject             m_current;
+    int                     m_index          = -1;
+    qint64                  m_playRequested  = -1;   //ms since launch
+    qint64                  m_loadingAt      = -1;
+    qint64                  m_bufferedAt     = -1;
+    qint64                  m_firstFrameAt   = -1;
+    qint64                  m_sampleWall0    = -1;
+    qint64                  m_samplePos0     = -1;
+    qreal                   m_maxAbsDriftMs  = 0.0;
+    int                     m_samples        = 0;
+};
+
+#endif // BENCHRUNNER_H
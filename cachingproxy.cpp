@@ -0,0 +1,742 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "cachingproxy.h"
+#include "playlistresolver.h"   //for isPlaylist()
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QTcpSocket>
+#include <QDebug>
+#include <iterator>
+
+static const qint64 CHUNK_BYTES         = 256 * 1024;           // per socket write / file copy
+static const qint64 MAX_PENDING_WRITE   = 1024 * 1024;          // client socket buffer before waiting for bytesWritten()
+static const qint64 FETCH_BUFFER_BYTES  = 512 * 1024;           // upstream read buffer; when full, TCP backpressure
+static const qint64 COALESCE_BYTES      = 1024 * 1024;          // share a fetch this far behind a wanted position
+static const qint64 READ_AHEAD_BYTES    = 16 * 1024 * 1024;     // fetch no further ahead of the readers
+static const int    MAX_HEADER_BYTES    = 16 * 1024;
+static const int    MAX_FAILURES        = 3;                    // consecutive upstream errors before giving up
+static const int    NOTIFY_INTERVAL_MS  = 500;
+
+///
+/// \brief insertRange -- merge [start, end) into the disjoint interval map 'ranges'.
+/// \return the number of bytes newly covered.
+///
+static qint64 insertRange(QMap<qint64, qint64> &ranges, const qint64 first, const qint64 last) {
+    if (last <= first)
+        return (0);
+    qint64 covered = 0;   // of [first, last), already in 'ranges'
+    qint64 start   = first;
+    qint64 end     = last;
+
+    auto it = ranges.upperBound(start);
+    if (it != ranges.begin()) {
+        auto previous = std::prev(it);
+        if (previous.value() >= start) {
+            covered += qMin(previous.value(), last) - first;
+            start = previous.key();
+            end   = qMax(end, previous.value());
+            it    = ranges.erase(previous);
+        }
+    }
+    while ((it != ranges.end()) && (it.key() <= end)) {
+        covered += qMax(qint64(0), qMin(it.value(), last) - it.key());
+        end = qMax(end, it.value());
+        it  = ranges.erase(it);
+    }
+    ranges.insert(start, end);
+    return ((last - first) - covered);
+}
+
+///
+/// \brief rangeAt -- contiguous bytes present in 'ranges' from 'pos'.
+///
+static qint64 rangeAt(const QMap<qint64, qint64> &ranges, const qint64 pos) {
+    auto it = ranges.upperBound(pos);
+    if (it == ranges.begin())
+        return (0);
+    --it;
+    return ((it.value() > pos) ? (it.value() - pos) : 0);
+}
+
+ProxyResource::ProxyResource(CachingProxy *proxy, const QUrl &url, const QString &path)
+    : QObject(proxy),
+      m_proxy(proxy),
+      m_url(url),
+      m_file(path),
+      m_lastUsed(QDateTime::currentMSecsSinceEpoch())
+{
+}
+
+ProxyResource::~ProxyResource() {
+    while (!m_fetches.isEmpty())
+        stopFetch(m_fetches.first());
+    if (m_map)
+        m_file.unmap(m_map);
+    if (m_file.isOpen()) {
+        m_file.close();
+        m_file.remove();
+    }
+}
+
+qint64 ProxyResource::available(const qint64 pos) const {
+    return (rangeAt(m_ranges, pos));
+}
+
+qint64 ProxyResource::markServed(const qint64 start, const qint64 end) {
+    return ((end - start) - insertRange(m_served, start, end));
+}
+
+void ProxyResource::setState(const State state, const QString &error) {
+    m_state = state;
+    m_error = error;
+    if (state != Ready)
+        while (!m_fetches.isEmpty())
+            stopFetch(m_fetches.first());
+    Q_EMIT changed();
+}
+
+///
+/// \brief ProxyResource::owned -- whether some reader is close enough to a fetch at 'cursor' for it to keep reading.
+///
+bool ProxyResource::owned(const qint64 cursor) const {
+    for (auto it = m_readers.cbegin(); it != m_readers.cend(); ++it)
+        if (   (it.value() <= cursor + COALESCE_BYTES)
+            && (cursor - it.value() <= READ_AHEAD_BYTES))
+            return (true);
+    return (false);
+}
+
+void ProxyResource::want(QObject *reader, const qint64 pos) {
+    m_lastUsed = QDateTime::currentMSecsSinceEpoch();
+    m_readers.insert(reader, pos);
+
+    if (m_state == Probing) {
+        if (m_fetches.isEmpty())
+            startFetch(pos);
+        return;
+    }
+    if (m_state != Ready)
+        return;
+
+    // stop fetches left behind by a seek; resume the ones paused on read-ahead.
+    bool covered = (pos >= m_length) || (available(pos) > 0);
+    const QList<Fetch *> fetches = m_fetches;   // drain() may stop fetches, and signal other readers
+    for (Fetch *fetch : fetches) {
+        if (!m_fetches.contains(fetch))
+            continue;
+        if (!fetch->started)
+            covered = covered || (fetch->cursor == pos);
+        else if (!owned(fetch->cursor))
+            stopFetch(fetch);
+        else {
+            covered = covered || ((fetch->cursor <= pos) && (pos - fetch->cursor <= COALESCE_BYTES));
+            drain(fetch);
+        }
+    }
+    if (!covered && (m_state == Ready))
+        startFetch(pos);
+}
+
+void ProxyResource::release(QObject *reader) {
+    m_readers.remove(reader);
+    if (m_readers.isEmpty())
+        while (!m_fetches.isEmpty())
+            stopFetch(m_fetches.first());
+}
+
+void ProxyResource::startFetch(const qint64 start) {
+    QNetworkRequest request(m_url);
+    request.setRawHeader("Range", "bytes=" + QByteArray::number(start) + '-');
+    request.setRawHeader("Accept-Encoding", "identity");   // byte offsets must be those of the resource
+
+    Fetch *fetch  = new Fetch;
+    fetch->cursor = start;
+    fetch->reply  = m_proxy->network()->get(request);
+    fetch->reply->setReadBufferSize(FETCH_BUFFER_BYTES);
+    m_fetches.append(fetch);
+    connect(fetch->reply, &QNetworkReply::metaDataChanged, this, [this, fetch]() { onMetaData(fetch); });
+    connect(fetch->reply, &QNetworkReply::readyRead,       this, [this, fetch]() { drain(fetch); });
+    connect(fetch->reply, &QNetworkReply::finished,        this, [this, fetch]() { onFinished(fetch); });
+}
+
+void ProxyResource::stopFetch(Fetch *fetch) {
+    m_fetches.removeOne(fetch);
+    if (fetch->reply) {
+        fetch->reply->disconnect(this);
+        fetch->reply->abort();
+        fetch->reply->deleteLater();
+    }
+    delete fetch;
+}
+
+void ProxyResource::onMetaData(Fetch *fetch) {
+    const int status = fetch->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (fetch->started || (status < 200) || (status >= 300))
+        return;             // not yet the final response; errors are handled by onFinished()
+    fetch->started = true;
+
+    qint64 first = 0;
+    qint64 total = -1;
+    if (status == 206) {    // Content-Range: bytes 1000-4999/5000
+        const QByteArray range = fetch->reply->rawHeader("Content-Range");
+        const int dash  = range.indexOf('-');
+        const int slash = range.indexOf('/');
+        if ((dash > 0) && (slash > dash)) {
+            first = range.mid(range.indexOf(' ') + 1, dash - range.indexOf(' ') - 1).toLongLong();
+            bool ok = false;
+            total = range.mid(slash + 1).toLongLong(&ok);
+            if (!ok)
+                total = -1;                                                     // "*": unknown
+        }
+    }
+    else if (fetch->cursor > 0) {   // 200: the server ignored Range, and would resend everything up to 'cursor'
+        setState(Uncacheable, QStringLiteral("Range not supported upstream"));
+        return;
+    }
+    else {
+        const QVariant length = fetch->reply->header(QNetworkRequest::ContentLengthHeader);
+        total = (length.isValid()) ? length.toLongLong() : -1;
+    }
+    fetch->cursor = first;
+
+    if (m_state == Probing) {
+        m_contentType = fetch->reply->rawHeader("Content-Type");
+        const QByteArray cacheControl = fetch->reply->rawHeader("Cache-Control").toLower();
+        if (   (total <= 0)                                   // live stream, or chunked
+            || cacheControl.contains("no-store")
+            || (total > m_proxy->budgetBytes())
+            || !initialize(total)) {
+            setState(Uncacheable);
+            return;
+        }
+        setState(Ready);                // readers may now want() and drain() this very fetch
+        if (!m_fetches.contains(fetch))
+            return;
+    }
+    else if (total != m_length) {
+        setState(Uncacheable, QStringLiteral("length changed upstream"));
+        return;
+    }
+    drain(fetch);
+}
+
+bool ProxyResource::initialize(const qint64 length) {
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !m_file.resize(length)) {   // sparse
+        qWarning() << Q_FUNC_INFO << ":" << m_file.fileName() << m_file.errorString();
+        m_file.close();
+        return (false);
+    }
+    m_map = m_file.map(0, length);
+    if (!m_map) {
+        qWarning() << Q_FUNC_INFO << ": unable to map" << m_file.fileName() << m_file.errorString();
+        m_file.close();
+        m_file.remove();
+        return (false);
+    }
+    m_length = length;
+    return (true);
+}
+
+///
+/// \brief ProxyResource::drain -- copy fetched bytes into the map, until reaching bytes already present.
+///
+void ProxyResource::drain(Fetch *fetch) {
+    if (!fetch->started || (m_state != Ready) || !fetch->reply)
+        return;
+
+    qint64 wrote = 0;
+    while (   (fetch->reply->bytesAvailable() > 0)
+           && (fetch->cursor < m_length)
+           && (available(fetch->cursor) == 0)
+           && owned(fetch->cursor)) {
+        const auto   next  = m_ranges.upperBound(fetch->cursor);
+        const qint64 gap   = ((next != m_ranges.cend()) ? next.key() : m_length) - fetch->cursor;
+        const qint64 count = fetch->reply->read(reinterpret_cast<char *>(m_map) + fetch->cursor,
+                                                qMin(gap, CHUNK_BYTES));
+        if (count <= 0)
+            break;
+        m_cachedBytes += insertRange(m_ranges, fetch->cursor, fetch->cursor + count);
+        fetch->cursor += count;
+        wrote         += count;
+    }
+
+    // gap filled: the rest is either present or beyond the end.
+    if ((fetch->cursor >= m_length) || (available(fetch->cursor) > 0))
+        stopFetch(fetch);
+    if (wrote > 0) {
+        m_failures = 0;
+        m_proxy->addFetched(wrote);
+        Q_EMIT changed();
+    }
+}
+
+void ProxyResource::onFinished(Fetch *fetch) {
+    drain(fetch);
+    if (!m_fetches.contains(fetch))   // stopped by drain()
+        return;
+
+    const QNetworkReply::NetworkError error = fetch->reply->error();
+    const QString errorString               = fetch->reply->errorString();
+    stopFetch(fetch);
+
+    if ((error != QNetworkReply::NoError) && (error != QNetworkReply::OperationCanceledError)) {
+        qWarning() << Q_FUNC_INFO << ":" << m_url << errorString;
+        if ((m_state == Probing) || (++m_failures >= MAX_FAILURES)) {
+            setState(Failed, errorString);
+            return;
+        }
+    }
+    else if (m_state == Probing)       // finished without a usable response
+        setState(Uncacheable);
+    Q_EMIT changed();                  // readers still missing bytes will want() a new fetch
+}
+
+///
+/// \brief The ProxySession class -- one client (player backend) connection: HTTP/1.1 GET/HEAD, keep-alive.
+///
+class ProxySession : public QObject
+{
+public:
+    ProxySession(CachingProxy *proxy, QTcpSocket *socket);
+    ~ProxySession() override;
+
+private:
+    void onReadyRead();
+    void handleRequest(const QByteArray &header);
+    void pump();
+    void serve();
+    void startPassthrough();
+    void pumpPassthrough();
+    void respond(const QByteArray &status, const QByteArray &extraHeaders = QByteArray());
+    void endResponse(const bool close);
+
+    CachingProxy               *m_proxy;
+    QTcpSocket                 *m_socket;
+    QByteArray                  m_buffer;
+    QUrl                        m_upstream;
+    QPointer<ProxyResource>     m_resource;
+    QPointer<QNetworkReply>     m_passthrough;
+    QByteArray                  m_rangeHeader;
+    QByteArray                  m_icyMetaData;
+    qint64                      m_rangeStart  = 0;
+    qint64                      m_rangeEnd    = -1;   // inclusive, -1 for the end
+    qint64                      m_suffix      = -1;   // "bytes=-500"
+    qint64                      m_pos         = 0;
+    qint64                      m_end         = -1;
+    bool                        m_ranged      = false;
+    bool                        m_head        = false;
+    bool                        m_busy        = false;
+    bool                        m_headerSent  = false;
+    bool                        m_pumping     = false;
+    bool                        m_pumpAgain   = false;
+};
+
+ProxySession::ProxySession(CachingProxy *proxy, QTcpSocket *socket)
+    : QObject(proxy),
+      m_proxy(proxy),
+      m_socket(socket)
+{
+    socket->setParent(this);
+    connect(socket, &QTcpSocket::readyRead,    this, &ProxySession::onReadyRead);
+    connect(socket, &QTcpSocket::bytesWritten, this, &ProxySession::pump);
+    connect(socket, &QTcpSocket::disconnected, this, &QObject::deleteLater);
+}
+
+ProxySession::~ProxySession() {
+    if (m_resource)
+        m_resource->release(this);
+    if (m_passthrough) {
+        m_passthrough->disconnect(this);
+        m_passthrough->abort();
+        m_passthrough->deleteLater();
+    }
+}
+
+void ProxySession::onReadyRead() {
+    if (m_busy)                 // a pipelined request: read once this response is done
+        return;
+    m_buffer.append(m_socket->readAll());
+    const int end = m_buffer.indexOf("\r\n\r\n");
+    if (end < 0) {
+        if (m_buffer.size() > MAX_HEADER_BYTES)
+            respond("431 Request Header Fields Too Large");
+        return;
+    }
+    const QByteArray header = m_buffer.left(end);
+    m_buffer.remove(0, end + 4);
+    handleRequest(header);
+}
+
+void ProxySession::handleRequest(const QByteArray &header) {
+    const QList<QByteArray> lines   = header.split('\n');
+    const QList<QByteArray> request = lines.value(0).trimmed().split(' ');
+    const QByteArray        method  = request.value(0);
+    m_head        = (method == "HEAD");
+    m_ranged      = false;
+    m_rangeStart  = 0;
+    m_rangeEnd    = -1;
+    m_suffix      = -1;
+    m_rangeHeader.clear();
+    m_icyMetaData.clear();
+    m_headerSent  = false;
+    m_busy        = true;
+
+    if ((method != "GET") && !m_head) {
+        respond("405 Method Not Allowed");
+        return;
+    }
+    m_upstream = m_proxy->upstreamFor(request.value(1));
+    if (!m_upstream.isValid()) {
+        respond("404 Not Found");
+        return;
+    }
+
+    for (int i = 1; i < lines.size(); i++) {
+        const QByteArray line  = lines.at(i).trimmed();
+        const int        colon = line.indexOf(':');
+        const QByteArray name  = line.left(colon).trimmed().toLower();
+        const QByteArray value = line.mid(colon + 1).trimmed();
+        if (name == "range") {           // bytes=<start>-[<end>] or bytes=-<suffix>; only a single range
+            m_rangeHeader = value;
+            const QByteArray spec = value.mid(value.indexOf('=') + 1);
+            const int dash = spec.indexOf('-');
+            if (value.startsWith("bytes=") && (dash >= 0) && !spec.contains(',')) {
+                m_ranged = true;
+                if (dash == 0)
+                    m_suffix = spec.mid(1).toLongLong();
+                else {
+                    m_rangeStart = spec.left(dash).toLongLong();
+                    m_rangeEnd   = (dash + 1 < spec.size()) ? spec.mid(dash + 1).toLongLong() : -1;
+                }
+            }
+        }
+        else if (name == "icy-metadata")
+            m_icyMetaData = value;
+    }
+
+    m_resource = m_proxy->resourceFor(m_upstream);
+    connect(m_resource, &ProxyResource::changed, this, &ProxySession::pump);
+    pump();
+}
+
+void ProxySession::pump() {
+    if (!m_busy)
+        return;
+    if (m_pumping) {            // re-entered through ProxyResource::changed()
+        m_pumpAgain = true;
+        return;
+    }
+    m_pumping = true;
+    do {
+        m_pumpAgain = false;
+        if (m_passthrough)
+            pumpPassthrough();
+        else
+            serve();
+    } while (m_pumpAgain && m_busy);
+    m_pumping = false;
+}
+
+void ProxySession::serve() {
+    if (!m_resource)
+        return;
+    switch (m_resource->state()) {
+    case ProxyResource::Probing:
+        m_resource->want(this, (m_suffix >= 0) ? 0 : m_rangeStart);
+        return;
+    case ProxyResource::Failed:
+        respond("502 Bad Gateway");
+        return;
+    case ProxyResource::Uncacheable:
+        startPassthrough();
+        return;
+    case ProxyResource::Ready:
+        break;
+    }
+
+    const qint64 length = m_resource->length();
+    if (!m_headerSent) {
+        const qint64 start = (m_suffix >= 0) ? qMax(qint64(0), length - m_suffix) : m_rangeStart;
+        const qint64 end   = ((m_rangeEnd < 0) || (m_rangeEnd >= length)) ? (length - 1) : m_rangeEnd;
+        if (m_ranged && ((start >= length) || (start > end))) {
+            respond("416 Range Not Satisfiable", "Content-Range: bytes */" + QByteArray::number(length) + "\r\n");
+            return;
+        }
+        QByteArray header = (m_ranged) ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+        if (!m_resource->contentType().isEmpty())
+            header += "Content-Type: " + m_resource->contentType() + "\r\n";
+        header += "Content-Length: " + QByteArray::number(end - start + 1) + "\r\n";
+        if (m_ranged)
+            header += "Content-Range: bytes " + QByteArray::number(start) + '-' + QByteArray::number(end)
+                      + '/' + QByteArray::number(length) + "\r\n";
+        header += "Accept-Ranges: bytes\r\nConnection: keep-alive\r\n\r\n";
+        m_socket->write(header);
+        m_headerSent = true;
+        m_pos        = start;
+        m_end        = end;
+        if (m_head) {
+            endResponse(false);
+            return;
+        }
+    }
+
+    while ((m_pos <= m_end) && (m_socket->bytesToWrite() < MAX_PENDING_WRITE)) {
+        const qint64 count = qMin(qMin(m_resource->available(m_pos), m_end - m_pos + 1), CHUNK_BYTES);
+        if (count <= 0)
+            break;
+        m_socket->write(m_resource->data() + m_pos, count);
+        m_proxy->addServed(count, false);
+        m_proxy->addServed(m_resource->markServed(m_pos, m_pos + count), true);   // replayed, or seeked back to
+        m_pos += count;
+    }
+    if (m_pos > m_end)
+        endResponse(false);
+    else
+        m_resource->want(this, m_pos);
+}
+
+///
+/// \brief ProxySession::startPassthrough -- relay a resource that can't be cached (e.g. an Icecast stream) as is.
+///
+void ProxySession::startPassthrough() {
+    if (m_resource) {
+        m_resource->disconnect(this);
+        m_resource->release(this);
+        m_resource = nullptr;
+    }
+
+    QNetworkRequest request(m_upstream);
+    request.setRawHeader("Accept-Encoding", "identity");
+    if (!m_rangeHeader.isEmpty())
+        request.setRawHeader("Range", m_rangeHeader);
+    if (!m_icyMetaData.isEmpty())
+        request.setRawHeader("Icy-MetaData", m_icyMetaData);
+    m_passthrough = (m_head) ? m_proxy->network()->head(request) : m_proxy->network()->get(request);
+    m_passthrough->setReadBufferSize(FETCH_BUFFER_BYTES);
+
+    connect(m_passthrough, &QNetworkReply::metaDataChanged, this, [this]() {
+        const int status = m_passthrough->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (m_headerSent || (status < 200) || (status >= 300))
+            return;
+        QByteArray header = "HTTP/1.1 " + QByteArray::number(status) + ' '
+                            + m_passthrough->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toByteArray() + "\r\n";
+        const auto pairs = m_passthrough->rawHeaderPairs();
+        for (const auto &pair : pairs) {
+            const QByteArray name = pair.first.toLower();
+            if ((name != "connection") && (name != "transfer-encoding") && (name != "keep-alive"))
+                header += pair.first + ": " + pair.second + "\r\n";
+        }
+        header += "Connection: close\r\n\r\n";   // the body may be delimited only by closing
+        m_socket->write(header);
+        m_headerSent = true;
+    });
+    connect(m_passthrough, &QNetworkReply::readyRead, this, &ProxySession::pump);
+    connect(m_passthrough, &QNetworkReply::finished,  this, [this]() {
+        if (!m_headerSent)
+            respond("502 Bad Gateway");
+        else
+            pump();
+    });
+}
+
+void ProxySession::pumpPassthrough() {
+    if (!m_headerSent)
+        return;
+    while ((m_socket->bytesToWrite() < MAX_PENDING_WRITE) && (m_passthrough->bytesAvailable() > 0)) {
+        const QByteArray bytes = m_passthrough->read(CHUNK_BYTES);
+        m_socket->write(bytes);
+        m_proxy->addServed(bytes.size(), false);
+    }
+    if (m_passthrough->isFinished() && (m_passthrough->bytesAvailable() == 0))
+        endResponse(true);
+}
+
+void ProxySession::respond(const QByteArray &status, const QByteArray &extraHeaders) {
+    m_socket->write("HTTP/1.1 " + status + "\r\n" + extraHeaders
+                    + "Content-Length: 0\r\nConnection: close\r\n\r\n");
+    endResponse(true);
+}
+
+void ProxySession::endResponse(const bool close) {
+    m_busy = false;
+    if (m_resource) {
+        m_resource->disconnect(this);
+        m_resource->release(this);
+        m_resource = nullptr;
+    }
+    if (m_passthrough) {
+        m_passthrough->disconnect(this);
+        m_passthrough->deleteLater();
+        m_passthrough = nullptr;
+    }
+    if (close)
+        m_socket->disconnectFromHost();
+    else if (!m_buffer.isEmpty() || (m_socket->bytesAvailable() > 0))
+        QMetaObject::invokeMethod(this, [this]() { onReadyRead(); }, Qt::QueuedConnection);
+}
+
+CachingProxy::CachingProxy(QObject *parent)
+    : QObject(parent)
+{
+    // resources don't outlive the session: start with an empty directory.
+    m_directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/proxy");
+    QDir(m_directory).removeRecursively();
+    if (!QDir().mkpath(m_directory))
+        qWarning() << Q_FUNC_INFO << ": unable to create" << m_directory;
+
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))   //the default for Qt6
+    m_network.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+#endif /* QT_VERSION... */
+    m_notifyTimer.setSingleShot(true);
+    m_notifyTimer.setInterval(NOTIFY_INTERVAL_MS);
+    connect(&m_notifyTimer, &QTimer::timeout,         this, &CachingProxy::countersChanged);
+    connect(&m_server,      &QTcpServer::newConnection, this, &CachingProxy::onNewConnection);
+}
+
+CachingProxy::~CachingProxy() {
+    m_server.close();
+    // sessions and resources hold replies of 'm_network', which is destroyed before QObject's children.
+    const QObjectList sessionsAndResources = children();
+    qDeleteAll(sessionsAndResources);
+}
+
+bool CachingProxy::listen(const quint16 port) {
+    if (!m_server.listen(QHostAddress::LocalHost, port)) {
+        qWarning() << Q_FUNC_INFO << ": unable to listen on port" << port << m_server.errorString();
+        return (false);
+    }
+    Q_EMIT listeningChanged();
+    return (true);
+}
+
+void CachingProxy::setBudgetMB(const int mb) {
+    if (m_budgetMB == mb)
+        return;
+    m_budgetMB = mb;
+    enforceBudget();
+    Q_EMIT budgetMBChanged();
+}
+
+///
+/// \brief CachingProxy::proxied -- "https://host:8443/a/b.mp4?q" --> "http://127.0.0.1:<port>/https/host:8443/a/b.mp4?q"
+///
+QUrl CachingProxy::proxied(const QUrl &url) const {
+    if (   !listening()
+        || ((url.scheme() != QLatin1String("http")) && (url.scheme() != QLatin1String("https")))
+        || PlaylistResolver::isPlaylist(url))    // e.g. live HLS playlists, which must not be cached
+        return (url);
+
+    QString target = QStringLiteral("http://127.0.0.1:%1/%2/%3").arg(port()).arg(url.scheme(), url.host(QUrl::FullyEncoded));
+    if (url.port() > 0)
+        target += QLatin1Char(':') + QString::number(url.port());
+    target += url.path(QUrl::FullyEncoded);
+    if (url.hasQuery())
+        target += QLatin1Char('?') + url.query(QUrl::FullyEncoded);
+    return (QUrl(target, QUrl::StrictMode));
+}
+
+QUrl CachingProxy::upstreamFor(const QByteArray &path) const {
+    if (!path.startsWith('/'))
+        return (QUrl());
+    const int schemeEnd    = path.indexOf('/', 1);
+    const int authorityEnd = (schemeEnd > 0) ? path.indexOf('/', schemeEnd + 1) : -1;
+    if (authorityEnd < 0)
+        return (QUrl());
+    const QByteArray scheme = path.mid(1, schemeEnd - 1);
+    if ((scheme != "http") && (scheme != "https"))
+        return (QUrl());
+    const QUrl upstream(QString::fromLatin1(scheme + "://" + path.mid(schemeEnd + 1)), QUrl::StrictMode);
+    return ((upstream.isValid() && !upstream.host().isEmpty()) ? upstream : QUrl());
+}
+
+///
+/// \brief CachingProxy::resourceFor -- a resource that Failed is dropped once unread, so the next request probes upstream again.
+///
+ProxyResource *CachingProxy::resourceFor(const QUrl &upstream) {
+    ProxyResource *resource = m_resources.value(upstream);
+    if (resource && (resource->state() == ProxyResource::Failed) && (resource->readers() == 0)) {
+        m_resources.remove(upstream);
+        delete resource;        // sessions hold it by QPointer
+        resource = nullptr;
+    }
+    if (!resource) {
+        const QByteArray hash = QCryptographicHash::hash(upstream.toEncoded(), QCryptographicHash::Sha1).toHex();
+        resource = new ProxyResource(this, upstream, m_directory + QLatin1Char('/') + QString::fromLatin1(hash));
+        m_resources.insert(upstream, resource);
+    }
+    return (resource);
+}
+
+qint64 CachingProxy::cachedBytes() const {
+    qint64 total = 0;
+    for (const ProxyResource *resource : m_resources)
+        total += resource->cachedBytes();
+    return (total);
+}
+
+void CachingProxy::addServed(const qint64 bytes, const bool fromCache) {
+    if (bytes <= 0)
+        return;
+    if (fromCache)
+        m_bytesSaved  += bytes;
+    else
+        m_bytesServed += bytes;
+    if (!m_notifyTimer.isActive())
+        m_notifyTimer.start();
+}
+
+void CachingProxy::addFetched(const qint64 bytes) {
+    m_bytesFetched += bytes;
+    enforceBudget();
+    if (!m_notifyTimer.isActive())
+        m_notifyTimer.start();
+}
+
+///
+/// \brief CachingProxy::enforceBudget -- evict least recently used resources no client is reading.
+///
+void CachingProxy::enforceBudget() {
+    while (cachedBytes() > budgetBytes()) {
+        ProxyResource *oldest = nullptr;
+        for (ProxyResource *resource : qAsConst(m_resources))
+            if ((resource->readers() == 0) && (!oldest || (resource->lastUsed() < oldest->lastUsed())))
+                oldest = resource;
+        if (!oldest)
+            return;     // everything is being read: over budget until released
+        m_resources.remove(oldest->url());
+        delete oldest;
+    }
+}
+
+void CachingProxy::clear() {
+    for (auto it = m_resources.begin(); it != m_resources.end(); )
+        if (it.value()->readers() == 0) {
+            delete it.value();
+            it = m_resources.erase(it);
+        }
+        else
+            ++it;
+    Q_EMIT countersChanged();
+}
+
+void CachingProxy::onNewConnection() {
+    while (m_server.hasPendingConnections())
+        new ProxySession(this, m_server.nextPendingConnection());   // deletes itself on disconnect
+}
@@ -0,0 +1,181 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CACHINGPROXY_H
+#define CACHINGPROXY_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QNetworkAccessManager>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTimer>
+#include <QUrl>
+
+class CachingProxy;
+class QNetworkReply;
+class QTcpSocket;
+
+///
+/// \brief The ProxyResource class -- the cached bytes of one upstream URL.
+///
+/// Backed by a sparse file of the resource's full length, memory-mapped, with the
+/// byte ranges present kept as a merged interval map. Gaps are filled by upstream
+/// "Range: bytes=<start>-" fetches that stop as soon as they reach bytes already
+/// present; a fetch already under way at or shortly before a wanted position is
+/// shared rather than duplicated. Fetches only read ahead of the readers by a bounded
+/// window, beyond which TCP backpressure pauses them.
+///
+class ProxyResource : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State {
+        Probing,        // length not yet known: first fetch under way
+        Ready,          // length known, file mapped
+        Uncacheable,    // unknown length (live stream), no-store, too big, or unmappable: pass through
+        Failed
+    };
+
+    ProxyResource(CachingProxy *proxy, const QUrl &url, const QString &path);
+    ~ProxyResource() override;
+
+    QUrl        url() const { return (m_url); }
+    State       state() const { return (m_state); }
+    QString     error() const { return (m_error); }
+    qint64      length() const { return (m_length); }
+    QByteArray  contentType() const { return (m_contentType); }
+    const char *data() const { return (reinterpret_cast<const char *>(m_map)); }
+    qint64      available(const qint64 pos) const;     // contiguous bytes present from 'pos'
+    qint64      cachedBytes() const { return (m_cachedBytes); }
+
+    // 'reader' (a client connection) has read up to 'pos': fetch from there if it's missing.
+    void want(QObject *reader, const qint64 pos);
+    void release(QObject *reader);
+    // note [start, end) as served to a client; returns how many of those bytes were served before.
+    qint64 markServed(const qint64 start, const qint64 end);
+    int  readers() const { return (m_readers.size()); }
+    qint64 lastUsed() const { return (m_lastUsed); }
+
+Q_SIGNALS:
+    void changed();     // state changed, or more bytes are present
+
+private:
+    struct Fetch {
+        QPointer<QNetworkReply> reply;
+        qint64                  cursor  = 0;        // next byte to be written
+        bool                    started = false;    // response headers seen
+    };
+
+    void startFetch(const qint64 start);
+    void onMetaData(Fetch *fetch);
+    void drain(Fetch *fetch);
+    void onFinished(Fetch *fetch);
+    void stopFetch(Fetch *fetch);
+    bool owned(const qint64 cursor) const;
+    bool initialize(const qint64 length);
+    void setState(const State state, const QString &error = QString());
+
+    CachingProxy           *m_proxy;
+    QUrl                    m_url;
+    QFile                   m_file;
+    uchar                  *m_map          = nullptr;
+    State                   m_state        = Probing;
+    QString                 m_error;
+    qint64                  m_length       = -1;
+    QByteArray              m_contentType;
+    QMap<qint64, qint64>    m_ranges;                   // start -> end (exclusive), disjoint, merged
+    QMap<qint64, qint64>    m_served;                   // likewise, bytes served to clients
+    qint64                  m_cachedBytes  = 0;
+    QList<Fetch *>          m_fetches;
+    QHash<QObject *, qint64> m_readers;                 // reader -> position
+    qint64                  m_lastUsed     = 0;
+    int                     m_failures     = 0;         // consecutive upstream errors
+};
+
+///
+/// \brief The CachingProxy class
+///
+/// Optional in-process HTTP caching proxy on loopback (see --cache-proxy), so that
+/// re-selecting a source, or seeking back within it, is served from local memory-mapped
+/// files rather than downloaded again. proxied() rewrites "https://host/path?q" to
+/// "http://127.0.0.1:<port>/https/host/path?q"; the path-style rewrite keeps relative
+/// URLs within the media working. Range requests are answered from the ProxyResource
+/// cache, which is bounded by 'budgetMB', evicting least recently used resources
+/// not being read. Live streams and other resources of unknown length pass through.
+///
+class CachingProxy : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool   listening     READ listening      NOTIFY listeningChanged)
+    Q_PROPERTY(int    port          READ port           NOTIFY listeningChanged)
+    Q_PROPERTY(int    budgetMB      READ budgetMB       WRITE setBudgetMB   NOTIFY budgetMBChanged)
+    Q_PROPERTY(qint64 bytesServed   READ bytesServed    NOTIFY countersChanged)
+    Q_PROPERTY(qint64 bytesSaved    READ bytesSaved     NOTIFY countersChanged)   // served from cache, not refetched
+    Q_PROPERTY(qint64 bytesFetched  READ bytesFetched   NOTIFY countersChanged)   // from upstream, into the cache
+    Q_PROPERTY(qint64 cachedBytes   READ cachedBytes    NOTIFY countersChanged)
+    Q_PROPERTY(qreal  hitRatio      READ hitRatio       NOTIFY countersChanged)
+
+public:
+    explicit CachingProxy(QObject *parent = nullptr);
+    ~CachingProxy() override;
+
+    bool listen(const quint16 port = 0);
+    bool listening() const { return (m_server.isListening()); }
+    int  port() const { return (m_server.serverPort()); }
+
+    // the url to give the player: through the proxy when listening, else 'url' unchanged.
+    Q_INVOKABLE QUrl proxied(const QUrl &url) const;
+    Q_INVOKABLE void clear();
+    QUrl upstreamFor(const QByteArray &path) const;
+    ProxyResource *resourceFor(const QUrl &upstream);
+    QNetworkAccessManager *network() { return (&m_network); }
+
+    int    budgetMB() const { return (m_budgetMB); }
+    void   setBudgetMB(const int mb);
+    qint64 budgetBytes() const { return (qint64(m_budgetMB) * 1024 * 1024); }
+    qint64 bytesServed() const { return (m_bytesServed); }
+    qint64 bytesSaved() const { return (m_bytesSaved); }
+    qint64 bytesFetched() const { return (m_bytesFetched); }
+    qint64 cachedBytes() const;
+    qreal  hitRatio() const { return ((m_bytesServed > 0) ? qreal(m_bytesSaved) / m_bytesServed : 0.0); }
+
+    void addServed(const qint64 bytes, const bool fromCache);
+    void addFetched(const qint64 bytes);
+
+Q_SIGNALS:
+    void listeningChanged();
+    void budgetMBChanged();
+    void countersChanged();
+
+private:
+    void onNewConnection();
+    void enforceBudget();
+
+    QTcpServer                      m_server;
+    QNetworkAccessManager           m_network;
+    QString                         m_directory;
+    QHash<QUrl, ProxyResource *>    m_resources;
+    QTimer                          m_notifyTimer;     // coalesces countersChanged()
+    int                             m_budgetMB      = 512;
+    qint64                          m_bytesServed   = 0;
+    qint64                          m_bytesSaved    = 0;
+    qint64                          m_bytesFetched  = 0;
+};
+
+#endif // CACHINGPROXY_H
@@ -0,0 +1,245 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "coverartcache.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QUrl>
+#include <QDebug>
+
+static const int     MAX_SOURCES        = 8;                  // published artwork retained for re-scaling
+static const int     MEMORY_CACHE_KB    = 16 * 1024;          // scaled artwork kept in memory
+static const qint64  DISK_CACHE_BYTES   = 64 * 1024 * 1024;   // pruned oldest-first at startup
+static const int     SIZE_BUCKET        = 64;                 // round requested sizes up, so resizing the window mostly hits
+static const int     DEFAULT_DIMENSION  = 512;                // when the Image{} doesn't set sourceSize
+
+CoverArtCache *CoverArtCache::s_instance = nullptr;
+
+CoverArtCache::CoverArtCache(QObject *parent)
+    : QObject(parent),
+      m_memory(MEMORY_CACHE_KB)
+{
+    s_instance = this;
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 2));
+
+    m_diskPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                 + QStringLiteral("/coverart");
+    if (!QDir().mkpath(m_diskPath)) {
+        qWarning() << Q_FUNC_INFO << ": unable to create disk cache" << m_diskPath;
+        m_diskPath.clear();
+    }
+    else
+        m_pool.start([this]() { pruneDiskCache(); });
+}
+
+CoverArtCache::~CoverArtCache() {
+    m_pool.waitForDone();
+    s_instance = nullptr;
+}
+
+CoverArtCache *CoverArtCache::instance() {
+    return (s_instance);
+}
+
+///
+/// \brief CoverArtCache::publish
+/// \param image -- e.g. QMediaMetaData::CoverArtImage
+/// \param origin -- e.g. the url of the media it came from
+/// \return url for use as Image.source, or an empty url for a null image.
+///
+QUrl CoverArtCache::publish(const QImage &image, const QString &origin) {
+    if (image.isNull())
+        return (QUrl());
+
+    const QString id = QString::number(image.cacheKey(), 16);
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_sources.contains(id)) {
+            QString key;
+            if (!origin.isEmpty()) {      // a few bytes to hash, rather than every pixel
+                QCryptographicHash hash(QCryptographicHash::Sha1);
+                hash.addData(QStringLiteral("%1 %2x%3 %4").arg(origin).arg(image.width()).arg(image.height())
+                                 .arg(int(image.format())).toUtf8());
+                key = QString::fromLatin1(hash.result().toHex());
+            }
+            m_sources.insert(id, Source{ image, key });
+            m_sourceOrder.append(id);
+            while (m_sourceOrder.size() > MAX_SOURCES)
+                m_sources.remove(m_sourceOrder.takeFirst());
+        }
+    }
+    return (QUrl(QStringLiteral("image://%1/%2").arg(QLatin1String(providerId()), id)));
+}
+
+int CoverArtCache::memoryCostKB() const {
+    QMutexLocker lock(&m_mutex);
+    return (m_memory.totalCost());
+}
+
+void CoverArtCache::clearMemoryCache() {
+    {
+        QMutexLocker lock(&m_mutex);
+        m_memory.clear();
+    }
+    Q_EMIT countersChanged();
+}
+
+///
+/// \brief CoverArtCache::diskKey -- so the disk cache survives restarts (cacheKey() doesn't): the hash of
+/// the origin given to publish(), else of the pixels.
+///
+QString CoverArtCache::diskKey(const QString &id, QImage *image) {
+    {
+        QMutexLocker lock(&m_mutex);
+        const auto it = m_sources.constFind(id);
+        if (it == m_sources.constEnd())
+            return (QString());
+        *image = it->image;
+        if (!it->diskKey.isEmpty())
+            return (it->diskKey);
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const int header[3] = { image->width(), image->height(), int(image->format()) };
+    hash.addData(reinterpret_cast<const char *>(header), sizeof(header));
+    hash.addData(reinterpret_cast<const char *>(image->constBits()), int(image->sizeInBytes()));
+    const QString result = QString::fromLatin1(hash.result().toHex());
+
+    QMutexLocker lock(&m_mutex);
+    const auto it = m_sources.find(id);
+    if (it != m_sources.end())
+        it->diskKey = result;
+    return (result);
+}
+
+///
+/// \brief CoverArtCache::load -- memory LRU, then disk cache, then scale the published artwork. Runs on m_pool.
+///
+QImage CoverArtCache::load(const QString &id, const QSize &requestedSize, QString *error) {
+    QElapsedTimer timer;
+    timer.start();
+
+    const auto bucket = [](const int dimension) {
+        return (((qMax(1, dimension) + SIZE_BUCKET - 1) / SIZE_BUCKET) * SIZE_BUCKET);
+    };
+    const QSize size(bucket((requestedSize.width()  > 0) ? requestedSize.width()  : DEFAULT_DIMENSION),
+                     bucket((requestedSize.height() > 0) ? requestedSize.height() : DEFAULT_DIMENSION));
+    const QString memoryKey = id + QLatin1Char('@') + QString::number(size.width())
+                                 + QLatin1Char('x') + QString::number(size.height());
+    QImage result;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const QImage *cached = m_memory.object(memoryKey))
+            result = *cached;
+    }
+    if (!result.isNull()) {
+        m_memoryHits++;
+        notifyCounters();
+        return (result);
+    }
+
+    QImage source;
+    const QString hash = diskKey(id, &source);
+    if (hash.isEmpty()) {
+        *error = QStringLiteral("unknown cover art id '%1'").arg(id);
+        m_errors++;
+        notifyCounters();
+        return (result);
+    }
+
+    const char   *format   = (source.hasAlphaChannel()) ? "png" : "jpg";
+    const QString diskFile = (m_diskPath.isEmpty())
+                             ? QString()
+                             : QStringLiteral("%1/%2-%3x%4.%5").arg(m_diskPath, hash)
+                                   .arg(size.width()).arg(size.height())
+                                   .arg(QLatin1String(format));
+    if (!diskFile.isEmpty() && result.load(diskFile)) {
+        m_diskHits++;
+    }
+    else {
+        result = (   (source.width()  <= size.width())
+                  && (source.height() <= size.height()))
+                 ? source
+                 : source.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        m_misses++;
+        if (!diskFile.isEmpty()) {
+            QSaveFile out(diskFile);
+            if (!(out.open(QIODevice::WriteOnly) && result.save(&out, format, 90) && out.commit()))
+                qWarning() << Q_FUNC_INFO << ": unable to write" << diskFile;
+        }
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+        m_memory.insert(memoryKey, new QImage(result), qMax(1, int(result.sizeInBytes() / 1024)));
+    }
+    m_decodeNs += timer.nsecsElapsed();
+    notifyCounters();
+    return (result);
+}
+
+///
+/// \brief CoverArtCache::pruneDiskCache -- keep the on-disk cache within DISK_CACHE_BYTES, deleting least recently written first.
+///
+void CoverArtCache::pruneDiskCache() {
+    QFileInfoList files = QDir(m_diskPath).entryInfoList(QDir::Files, QDir::Time); //newest first
+    qint64 total = 0;
+    for (const QFileInfo &info : qAsConst(files)) {
+        total += info.size();
+        if (total > DISK_CACHE_BYTES)
+            QFile::remove(info.absoluteFilePath());
+    }
+}
+
+///
+/// \brief CoverArtCache::notifyCounters -- coalesce countersChanged() from the pool into one queued emission.
+///
+void CoverArtCache::notifyCounters() {
+    if (m_notifyPending.exchange(true))
+        return;
+    QMetaObject::invokeMethod(this, [this]() {
+        m_notifyPending = false;
+        Q_EMIT countersChanged();
+    }, Qt::QueuedConnection);
+}
+
+QQuickImageResponse *CoverArtImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize) {
+    CoverArtResponse *response = new CoverArtResponse(m_cache, id, requestedSize);
+    m_cache->pool()->start(response);
+    return (response);
+}
+
+CoverArtResponse::CoverArtResponse(CoverArtCache *cache, const QString &id, const QSize &requestedSize)
+    : m_cache(cache),
+      m_id(id),
+      m_requestedSize(requestedSize)
+{
+    setAutoDelete(false);   // owned by the QML engine, which deletes it after finished()
+}
+
+QQuickTextureFactory *CoverArtResponse::textureFactory() const {
+    return (QQuickTextureFactory::textureFactoryForImage(m_image));
+}
+
+void CoverArtResponse::run() {
+    m_image = m_cache->load(m_id, m_requestedSize, &m_error);
+    Q_EMIT finished();
+}
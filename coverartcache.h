@@ -0,0 +1,136 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef COVERARTCACHE_H
+#define COVERARTCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QRunnable>
+#include <QStringList>
+#include <QThreadPool>
+#include <QQuickAsyncImageProvider>
+#include <atomic>
+
+///
+/// \brief The CoverArtCache class
+///
+/// Scales cover-art/thumbnail QImages from media metadata (e.g. 1200x675 RGB32) down to
+/// the 'sourceSize' requested by an Image{} in QML, on a thread pool rather than the GUI
+/// thread. Artwork is published() to get an "image://coverart/<id>" URL. Scaled results
+/// are kept in a bounded in-memory LRU, and persisted to a disk cache keyed by a hash of
+/// the artwork's origin (e.g. the media url and the artwork's dimensions), or else of its
+/// contents, and the requested size, so that the next launch doesn't need to scale the
+/// same artwork again.
+///
+class CoverArtCache : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(quint64 memoryHits    READ memoryHits    NOTIFY countersChanged)
+    Q_PROPERTY(quint64 diskHits      READ diskHits      NOTIFY countersChanged)
+    Q_PROPERTY(quint64 misses        READ misses        NOTIFY countersChanged)
+    Q_PROPERTY(quint64 errors        READ errors        NOTIFY countersChanged)
+    Q_PROPERTY(qreal   decodeTimeMs  READ decodeTimeMs  NOTIFY countersChanged)   // total spent loading/scaling
+    Q_PROPERTY(int     memoryCostKB  READ memoryCostKB  NOTIFY countersChanged)
+
+public:
+    explicit CoverArtCache(QObject *parent = nullptr);
+    ~CoverArtCache() override;
+
+    static CoverArtCache *instance();                 // nullptr until constructed in main()
+    static const char    *providerId() { return ("coverart"); }
+
+    // register 'image' (implicitly shared, not copied) and return its "image://coverart/..." url.
+    // 'origin' identifies it across launches, e.g. the media's url; if empty, its pixels are hashed.
+    QUrl  publish(const QImage &image, const QString &origin = QString());
+    // called on the pool by CoverArtImageProvider.
+    QImage load(const QString &id, const QSize &requestedSize, QString *error);
+    QThreadPool *pool() { return (&m_pool); }
+
+    quint64 memoryHits() const  { return (m_memoryHits.load()); }
+    quint64 diskHits() const    { return (m_diskHits.load()); }
+    quint64 misses() const      { return (m_misses.load()); }
+    quint64 errors() const      { return (m_errors.load()); }
+    qreal   decodeTimeMs() const{ return (m_decodeNs.load() / 1.0e6); }
+    int     memoryCostKB() const;
+
+    Q_INVOKABLE void clearMemoryCache();
+
+Q_SIGNALS:
+    void countersChanged();
+
+private:
+    struct Source {
+        QImage  image;
+        QString diskKey;        // from the origin, else the contents, hashed lazily on the pool
+    };
+
+    QString diskKey(const QString &id, QImage *image);
+    void    pruneDiskCache();
+    void    notifyCounters();
+
+    static CoverArtCache        *s_instance;
+
+    QThreadPool                 m_pool;
+    mutable QMutex              m_mutex;        // guards everything below
+    QHash<QString, Source>      m_sources;      // published artwork, by id
+    QStringList                 m_sourceOrder;  // oldest first, bounded
+    QCache<QString, QImage>     m_memory;       // scaled artwork, cost in KB
+    QString                     m_diskPath;
+
+    std::atomic<quint64>        m_memoryHits{0};
+    std::atomic<quint64>        m_diskHits{0};
+    std::atomic<quint64>        m_misses{0};
+    std::atomic<quint64>        m_errors{0};
+    std::atomic<qint64>         m_decodeNs{0};
+    std::atomic<bool>           m_notifyPending{false};
+};
+
+///
+/// \brief The CoverArtImageProvider class -- "image://coverart/<id>", served asynchronously by CoverArtCache.
+///
+class CoverArtImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    explicit CoverArtImageProvider(CoverArtCache *cache) : m_cache(cache) {}
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    CoverArtCache *m_cache;
+};
+
+class CoverArtResponse : public QQuickImageResponse, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    CoverArtResponse(CoverArtCache *cache, const QString &id, const QSize &requestedSize);
+
+    QQuickTextureFactory *textureFactory() const override;
+    QString errorString() const override { return (m_error); }
+    void run() override;
+
+private:
+    CoverArtCache  *m_cache;
+    QString         m_id;
+    QSize           m_requestedSize;
+    QImage          m_image;
+    QString         m_error;
+};
+
+#endif // COVERARTCACHE_H
@@ -0,0 +1,508 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "filmstrip.h"
+#include "videoframesource.h"
+#include "cachingproxy.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QDebug>
+
+static const int     COLUMNS             = 10;
+static const int     THUMB_WIDTH         = 160;
+static const int     THUMB_HEIGHT        = 90;
+static const int     MAX_THUMBNAILS      = 120;                // so a sheet is at most 1600x1080 (6.6MB)
+static const qint64  MIN_INTERVAL_MS     = 2000;
+static const int     FRAME_TIMEOUT_MS    = 3000;               // for a seek to deliver a frame, else it's skipped
+static const int     YIELD_MS            = 100;                // between thumbnails, so the hidden player never hogs the decoder
+static const int     PUBLISH_INTERVAL_MS = 1000;               // QML reloads the whole sheet on sheetChanged()
+static const int     SAVE_EVERY          = 16;                 // thumbnails, for resuming an interrupted sheet
+static const qint64  HASH_BYTES          = 64 * 1024;          // of the head and of the tail of a file, for its key
+static const qint64  DISK_CACHE_BYTES    = 64 * 1024 * 1024;   // pruned oldest-first at startup
+static const int     FORMAT_VERSION      = 1;
+
+Filmstrip *Filmstrip::s_instance = nullptr;
+
+///
+/// \brief coarseToFine -- 0..total-1, every 16th (say) first, then the every 8th not yet taken, and so on.
+///
+static QVector<int> coarseToFine(const int total) {
+    int stride = 1;
+    while (stride * 2 < total)
+        stride *= 2;
+    QVector<int>  order;
+    QVector<bool> taken(total, false);
+    order.reserve(total);
+    for (; stride >= 1; stride /= 2)
+        for (int i = 0; i < total; i += stride)
+            if (!taken.at(i)) {
+                taken[i] = true;
+                order.append(i);
+            }
+    return (order);
+}
+
+static QRect cellRect(const int index) {
+    return (QRect((index % COLUMNS) * THUMB_WIDTH, (index / COLUMNS) * THUMB_HEIGHT, THUMB_WIDTH, THUMB_HEIGHT));
+}
+
+Filmstrip::Filmstrip(QObject *parent)
+    : QObject(parent)
+{
+    s_instance = this;
+    m_pool.setMaxThreadCount(1);
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 2, 0))
+    m_pool.setThreadPriority(QThread::LowestPriority);
+#endif /* QT_VERSION... */
+
+    m_frameTimeout.setSingleShot(true);
+    m_frameTimeout.setInterval(FRAME_TIMEOUT_MS);
+    connect(&m_frameTimeout, &QTimer::timeout, this, [this]() {
+        m_pending = -1;
+        next();
+    });
+    m_publishTimer.setSingleShot(true);
+    m_publishTimer.setInterval(PUBLISH_INTERVAL_MS);
+    connect(&m_publishTimer, &QTimer::timeout, this, [this]() {
+        m_revision++;
+        Q_EMIT sheetChanged();
+    });
+
+    m_diskPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                 + QStringLiteral("/filmstrip");
+    if (!QDir().mkpath(m_diskPath)) {
+        qWarning() << Q_FUNC_INFO << ": unable to create disk cache" << m_diskPath;
+        m_diskPath.clear();
+    }
+    else
+        m_pool.start([this]() { pruneDiskCache(); });
+}
+
+Filmstrip::~Filmstrip() {
+    m_generation++;
+    m_pool.waitForDone();
+    s_instance = nullptr;
+}
+
+Filmstrip *Filmstrip::instance() {
+    return (s_instance);
+}
+
+bool Filmstrip::available() const {
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+    return (true);
+#else                                           //Qt5
+    return (false);
+#endif /* QT_VERSION... */
+}
+
+QSize Filmstrip::thumbnailSize() const {
+    return (QSize(THUMB_WIDTH, THUMB_HEIGHT));
+}
+
+QUrl Filmstrip::sheetUrl() const {
+    if ((m_count == 0) || m_key.isEmpty())
+        return (QUrl());
+    return (QUrl(QStringLiteral("image://%1/%2/%3").arg(QLatin1String(providerId()), m_key).arg(m_revision)));
+}
+
+///
+/// \brief Filmstrip::attach
+/// \param qmlPlayer -- main.qml's 'mediaPlayer'; follows PlayerPool's active player.
+/// \return false if 'qmlPlayer' isn't backed by a QMediaPlayer.
+///
+bool Filmstrip::attach(QObject *qmlPlayer) {
+    QMediaPlayer *player = VideoFrameSource::mediaPlayerFor(qmlPlayer);
+    if (player == m_foreground)
+        return (player != nullptr);
+    if (m_foreground)
+        disconnect(m_foreground, nullptr, this, nullptr);
+    m_foreground = player;
+    if (m_foreground)
+        connect(m_foreground, &QMediaPlayer::mediaStatusChanged, this, &Filmstrip::updateYielding);
+    updateYielding();
+    return (player != nullptr);
+}
+
+///
+/// \brief Filmstrip::updateYielding -- pause between thumbnails while the foreground player waits on its media.
+///
+void Filmstrip::updateYielding() {
+    const QMediaPlayer::MediaStatus status = (m_foreground) ? m_foreground->mediaStatus() : QMediaPlayer::NoMedia;
+    const bool yielding = (   (status == QMediaPlayer::LoadingMedia)
+                           || (status == QMediaPlayer::BufferingMedia)
+                           || (status == QMediaPlayer::StalledMedia));
+    if (m_yielding == yielding)
+        return;
+    m_yielding = yielding;
+    Q_EMIT generatingChanged();
+    if (!m_yielding)
+        next();
+}
+
+void Filmstrip::setGenerating(const bool generating) {
+    if (m_generating == generating)
+        return;
+    m_generating = generating;
+    Q_EMIT generatingChanged();
+}
+
+///
+/// \brief Filmstrip::generate
+/// \param source -- e.g. main.qml's mediaPlayer.source: a file, or CachingProxy's loopback url.
+/// \return false if 'source' isn't local or cached, so it'd be streamed a second time.
+///
+bool Filmstrip::generate(const QUrl &source) {
+    const bool cached = (   m_cachingProxy && m_cachingProxy->listening()
+                         && (source.host() == QLatin1String("127.0.0.1"))     // as CachingProxy::proxied() makes them
+                         && (source.port() == m_cachingProxy->port()));
+    if (!available() || !(source.isLocalFile() || cached))
+        return (false);
+    if (source == m_source)
+        return (true);
+    cancel();
+    m_source = source;
+    Q_EMIT sourceChanged();
+    setGenerating(true);
+
+    // key and persisted sheet on the pool: hashing reads the file, and the sheet is a JPEG to decode.
+    const int generation = ++m_generation;
+    m_pool.start([this, generation, source]() {
+        const QString key    = contentKey(source);
+        const Loaded  loaded = (key.isEmpty()) ? Loaded() : load(key);
+        QMetaObject::invokeMethod(this, [this, generation, key, loaded]() {
+            onLoaded(generation, key, loaded);
+        }, Qt::QueuedConnection);
+    });
+    return (true);
+}
+
+///
+/// \brief Filmstrip::cancel -- stop generating, keeping what's been generated so far on disk to resume from.
+///
+void Filmstrip::cancel() {
+    if (m_source.isEmpty())
+        return;
+    m_generation++;
+    m_frameTimeout.stop();
+    m_publishTimer.stop();
+    if (m_sinceSaved > 0)
+        persist();
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+    if (m_player)
+        m_player->setSource(QUrl());
+#endif /* QT_VERSION... */
+    m_source     = QUrl();
+    m_duration   = 0;
+    m_interval   = 0;
+    m_total      = 0;
+    m_count      = 0;
+    m_order.clear();
+    m_nextOrder  = 0;
+    m_pending    = -1;
+    m_sinceSaved = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_key.clear();
+        m_sheet = QImage();
+        m_done.clear();
+    }
+    setGenerating(false);
+    Q_EMIT sourceChanged();
+    Q_EMIT sheetChanged();
+}
+
+///
+/// \brief Filmstrip::contentKey -- of the content, not the path, so renamed or re-downloaded files still hit. Runs on m_pool.
+///
+QString Filmstrip::contentKey(const QUrl &source) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (source.isLocalFile()) {
+        QFile file(source.toLocalFile());
+        if (!file.open(QIODevice::ReadOnly))
+            return (QString());
+        const qint64 size = file.size();
+        hash.addData(QByteArray::number(size));
+        hash.addData(file.read(HASH_BYTES));
+        if (size > 2 * HASH_BYTES) {
+            file.seek(size - HASH_BYTES);
+            hash.addData(file.read(HASH_BYTES));
+        }
+    }
+    else    // CachingProxy's url embeds the upstream's
+        hash.addData(source.toEncoded());
+    hash.addData(QByteArray::number(THUMB_WIDTH) + 'x' + QByteArray::number(THUMB_HEIGHT));
+    return (QString::fromLatin1(hash.result().toHex()));
+}
+
+///
+/// \brief Filmstrip::load -- a persisted sheet, or an empty one if there's none or it doesn't match its index. Runs on m_pool.
+///
+Filmstrip::Loaded Filmstrip::load(const QString &key) const {
+    Loaded loaded;
+    if (m_diskPath.isEmpty())
+        return (loaded);
+    QFile index(QStringLiteral("%1/%2.json").arg(m_diskPath, key));
+    if (!index.open(QIODevice::ReadOnly))
+        return (loaded);
+    const QJsonObject json = QJsonDocument::fromJson(index.readAll()).object();
+    if (json.value(QLatin1String("version")).toInt() != FORMAT_VERSION)
+        return (loaded);
+    const QByteArray done  = QByteArray::fromBase64(json.value(QLatin1String("done")).toString().toLatin1());
+    const QSize      size(qMin(done.size(), COLUMNS) * THUMB_WIDTH, ((done.size() + COLUMNS - 1) / COLUMNS) * THUMB_HEIGHT);
+    QImage           sheet(QStringLiteral("%1/%2.jpg").arg(m_diskPath, key));
+    if (done.isEmpty() || (done.size() > MAX_THUMBNAILS) || (sheet.size() != size))
+        return (loaded);
+    loaded.sheet    = sheet.convertToFormat(QImage::Format_RGB32);
+    loaded.done     = done;
+    loaded.interval = qint64(json.value(QLatin1String("interval")).toDouble());
+    loaded.duration = qint64(json.value(QLatin1String("duration")).toDouble());
+    return (loaded);
+}
+
+///
+/// \brief Filmstrip::persist -- write a copy of the sheet, and which thumbnails it has, on m_pool.
+///
+void Filmstrip::persist() {
+    m_sinceSaved = 0;
+    if (m_diskPath.isEmpty() || m_key.isEmpty() || (m_count == 0))
+        return;
+    QImage     sheet;
+    QByteArray done;
+    {
+        QMutexLocker lock(&m_mutex);
+        sheet = m_sheet;
+        done  = m_done;
+    }
+    QJsonObject json;
+    json.insert(QLatin1String("version"),  FORMAT_VERSION);
+    json.insert(QLatin1String("interval"), double(m_interval));
+    json.insert(QLatin1String("duration"), double(m_duration));
+    json.insert(QLatin1String("done"),     QString::fromLatin1(done.toBase64()));
+    const QString base = QStringLiteral("%1/%2").arg(m_diskPath, m_key);
+    m_pool.start([base, sheet, json]() {
+        QSaveFile image(base + QLatin1String(".jpg"));
+        QSaveFile index(base + QLatin1String(".json"));
+        if (   !(image.open(QIODevice::WriteOnly) && sheet.save(&image, "jpg", 85) && image.commit())
+            || !(index.open(QIODevice::WriteOnly) && (index.write(QJsonDocument(json).toJson(QJsonDocument::Compact)) > 0) && index.commit()))
+            qWarning() << Q_FUNC_INFO << ": unable to write" << base;
+    });
+}
+
+void Filmstrip::onLoaded(const int generation, const QString &key, const Loaded &loaded) {
+    if (generation != m_generation)
+        return;
+    if (key.isEmpty()) {
+        qWarning() << Q_FUNC_INFO << ": unable to read" << m_source;
+        setGenerating(false);
+        return;
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        m_key = key;
+    }
+    if (!loaded.sheet.isNull()) {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_sheet = loaded.sheet;
+            m_done  = loaded.done;
+        }
+        m_duration = loaded.duration;
+        m_interval = loaded.interval;
+        m_total    = loaded.done.size();
+        m_count    = m_total - loaded.done.count('\0');
+        m_order    = coarseToFine(m_total);
+        Q_EMIT sourceChanged();
+        m_revision++;
+        Q_EMIT sheetChanged();
+        if (m_count == m_total) {
+            setGenerating(false);
+            return;
+        }
+    }
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+    if (!m_player) {    // no QAudioOutput, so silent
+        m_player = new QMediaPlayer(this);
+        m_sink   = new QVideoSink(this);
+        m_player->setVideoSink(m_sink);
+        connect(m_player, &QMediaPlayer::mediaStatusChanged, this, &Filmstrip::onMediaStatusChanged);
+        connect(m_sink,   &QVideoSink::videoFrameChanged,    this, &Filmstrip::onVideoFrameChanged);
+    }
+    m_player->setSource(m_source);
+    m_player->pause();      // loads, and pre-rolls the first frame
+#endif /* QT_VERSION... */
+}
+
+///
+/// \brief Filmstrip::plan -- an interval for at most MAX_THUMBNAILS over 'duration', and a blank sheet for them.
+///
+void Filmstrip::plan(const qint64 duration) {
+    m_duration = duration;
+    m_interval = qMax(MIN_INTERVAL_MS, (duration + MAX_THUMBNAILS - 1) / MAX_THUMBNAILS);
+    m_total    = int(qBound(qint64(1), (duration + m_interval - 1) / m_interval, qint64(MAX_THUMBNAILS)));
+    m_count    = 0;
+    m_order    = coarseToFine(m_total);
+    {
+        QMutexLocker lock(&m_mutex);
+        m_sheet = QImage(qMin(m_total, COLUMNS) * THUMB_WIDTH, ((m_total + COLUMNS - 1) / COLUMNS) * THUMB_HEIGHT,
+                         QImage::Format_RGB32);
+        m_sheet.fill(Qt::black);
+        m_done  = QByteArray(m_total, '\0');
+    }
+    Q_EMIT sourceChanged();
+}
+
+///
+/// \brief Filmstrip::next -- seek the hidden player to the next thumbnail not yet taken, unless yielding.
+///
+void Filmstrip::next() {
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+    if (!m_generating || m_yielding || (m_pending >= 0) || (m_total == 0) || !m_player)
+        return;
+    {
+        QMutexLocker lock(&m_mutex);
+        while ((m_nextOrder < m_order.size()) && m_done.at(m_order.at(m_nextOrder)))
+            m_nextOrder++;
+    }
+    if (m_nextOrder >= m_order.size()) {
+        persist();
+        m_player->setSource(QUrl());
+        setGenerating(false);
+        return;
+    }
+    m_pending = m_order.at(m_nextOrder++);
+    m_player->setPosition(qMin(m_pending * m_interval + m_interval / 2, m_duration - 1));
+    m_frameTimeout.start();
+#endif /* QT_VERSION... */
+}
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+void Filmstrip::onMediaStatusChanged(const QMediaPlayer::MediaStatus status) {
+    if (!m_generating)
+        return;
+    if ((status == QMediaPlayer::InvalidMedia) || ((status == QMediaPlayer::LoadedMedia) && !m_player->hasVideo())) {
+        m_player->setSource(QUrl());
+        setGenerating(false);
+    }
+    else if ((status == QMediaPlayer::LoadedMedia) || (status == QMediaPlayer::BufferedMedia)) {
+        if (m_total == 0) {
+            if (m_player->duration() <= 0) {    // e.g. a live stream
+                m_player->setSource(QUrl());
+                setGenerating(false);
+                return;
+            }
+            plan(m_player->duration());
+        }
+        next();
+    }
+}
+
+///
+/// \brief Filmstrip::onVideoFrameChanged -- the frame sought by next(): converted, scaled and drawn into the sheet on m_pool.
+///
+void Filmstrip::onVideoFrameChanged(const QVideoFrame &frame) {
+    if (!m_frameTimeout.isActive() || (m_pending < 0) || !frame.isValid())
+        return;
+    const qint64 target = m_pending * m_interval + m_interval / 2;
+    if ((frame.startTime() >= 0) && (qAbs(frame.startTime() / 1000 - target) > m_interval / 2))
+        return;     // pre-rolled before the seek
+    m_frameTimeout.stop();
+
+    const int generation = m_generation;
+    const int index      = m_pending;
+    m_pool.start([this, generation, index, frame]() {
+        const QImage image = frame.toImage();
+        bool drawn = false;
+        if (!image.isNull() && (generation == m_generation)) {
+            const QImage thumbnail = image.scaled(THUMB_WIDTH, THUMB_HEIGHT, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            const QRect  cell      = cellRect(index);
+            QMutexLocker lock(&m_mutex);
+            if (generation == m_generation) {
+                QPainter painter(&m_sheet);
+                painter.fillRect(cell, Qt::black);
+                painter.drawImage(cell.x() + (THUMB_WIDTH  - thumbnail.width())  / 2,
+                                  cell.y() + (THUMB_HEIGHT - thumbnail.height()) / 2, thumbnail);
+                m_done[index] = 1;
+                drawn = true;
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, generation, drawn]() {
+            if (generation != m_generation)
+                return;
+            m_pending = -1;
+            if (drawn) {
+                m_count++;
+                if (!m_publishTimer.isActive())
+                    m_publishTimer.start();
+                if (++m_sinceSaved >= SAVE_EVERY)
+                    persist();
+            }
+            QTimer::singleShot(YIELD_MS, this, [this, generation]() {
+                if (generation == m_generation)
+                    next();
+            });
+        }, Qt::QueuedConnection);
+    });
+}
+#endif /* QT_VERSION... */
+
+QRect Filmstrip::rectFor(const qint64 position) const {
+    if ((m_interval <= 0) || (m_count == 0))
+        return (QRect());
+    QMutexLocker lock(&m_mutex);
+    const int ideal = int(qBound(qint64(0), position / m_interval, qint64(m_total - 1)));
+    for (int distance = 0; distance < m_total; distance++) {
+        if ((ideal - distance >= 0) && m_done.at(ideal - distance))
+            return (cellRect(ideal - distance));
+        if ((ideal + distance < m_total) && m_done.at(ideal + distance))
+            return (cellRect(ideal + distance));
+    }
+    return (QRect());
+}
+
+QImage Filmstrip::sheet(const QString &key) const {
+    QMutexLocker lock(&m_mutex);
+    return ((key == m_key) ? m_sheet : QImage());
+}
+
+///
+/// \brief Filmstrip::pruneDiskCache -- keep the on-disk sheets within DISK_CACHE_BYTES, deleting least recently written first.
+///
+void Filmstrip::pruneDiskCache() {
+    const QFileInfoList files = QDir(m_diskPath).entryInfoList(QDir::Files, QDir::Time); //newest first
+    qint64 total = 0;
+    for (const QFileInfo &info : files) {
+        total += info.size();
+        if (total > DISK_CACHE_BYTES)
+            QFile::remove(info.absoluteFilePath());
+    }
+}
+
+QImage FilmstripImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize) {
+    Q_UNUSED(requestedSize);    // always the whole sheet, so rectFor() applies
+    const QImage image = m_filmstrip->sheet(id.section(QLatin1Char('/'), 0, 0));
+    if (size)
+        *size = image.size();
+    return (image);
+}
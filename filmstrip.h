@@ -0,0 +1,175 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FILMSTRIP_H
+#define FILMSTRIP_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QImage>
+#include <QMediaPlayer>
+#include <QMutex>
+#include <QPointer>
+#include <QRect>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+#include <QQuickImageProvider>
+#include <atomic>
+#include <qplatformdefs.h> // defines QT_VERSION, etc
+
+class CachingProxy;
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+#include <QVideoFrame>
+#include <QVideoSink>
+#endif /* QT_VERSION... */
+
+///
+/// \brief The Filmstrip class
+///
+/// Seek-preview thumbnails of the current local (file:) or CachingProxy-cached (loopback) video,
+/// taken at fixed intervals by a hidden, silent QMediaPlayer, seeking while paused into a QVideoSink.
+/// Frames are converted, scaled and packed into a single sprite sheet -- COLUMNS thumbnails across,
+/// at most MAX_THUMBNAILS -- on a one-thread pool at the lowest priority, and served to QML as
+/// "image://filmstrip/<key>/<revision>"; rectFor() gives a position's thumbnail within it.
+///
+/// Thumbnails are taken coarse to fine (every 16th, then every 8th, ...) so a usable filmstrip
+/// exists early, and one at a time, so at most one frame is in flight. Generation yields to the
+/// foreground player while it's loading, buffering or stalled, and is cancelled by cancel() or
+/// the next generate(). Sheets, complete or not, are persisted under CacheLocation/filmstrip, keyed
+/// by a hash of the file's size, head and tail (or of the url, for cached streams), so the next
+/// open of the same content is instant, and an interrupted one resumes where it left off.
+///
+/// QVideoSink is Qt6-only: for Qt5, 'available' is false and generate() does nothing.
+///
+class Filmstrip : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool    available     READ available     CONSTANT)
+    Q_PROPERTY(QUrl    source        READ source        NOTIFY sourceChanged)
+    Q_PROPERTY(qint64  interval      READ interval      NOTIFY sourceChanged)      // ms between thumbnails
+    Q_PROPERTY(int     total         READ total         NOTIFY sourceChanged)      // thumbnails when complete
+    Q_PROPERTY(QSize   thumbnailSize READ thumbnailSize CONSTANT)
+    Q_PROPERTY(QUrl    sheetUrl      READ sheetUrl      NOTIFY sheetChanged)       // "" until the first thumbnail
+    Q_PROPERTY(int     count         READ count         NOTIFY sheetChanged)       // thumbnails in the sheet
+    Q_PROPERTY(bool    generating    READ generating    NOTIFY generatingChanged)
+    Q_PROPERTY(bool    yielding      READ yielding      NOTIFY generatingChanged)  // to the foreground player
+
+public:
+    explicit Filmstrip(QObject *parent = nullptr);
+    ~Filmstrip() override;
+
+    static Filmstrip  *instance();                 // nullptr until constructed in main()
+    static const char *providerId() { return ("filmstrip"); }
+
+    // whose loopback urls count as cached; other loopback servers (e.g. qmlvideobug_server) are streams.
+    void  setCachingProxy(const CachingProxy *proxy) { m_cachingProxy = proxy; }
+    // the foreground player (main.qml's 'mediaPlayer') to yield to.
+    Q_INVOKABLE bool  attach(QObject *qmlPlayer);
+    // generate (or load) the filmstrip of 'source'; false if it's not a local or cached source.
+    Q_INVOKABLE bool  generate(const QUrl &source);
+    Q_INVOKABLE void  cancel();
+    // the thumbnail nearest 'position' (ms) within the sheet, or an empty rect if there's none yet.
+    Q_INVOKABLE QRect rectFor(qint64 position) const;
+    // called by FilmstripImageProvider, on QML's image loader thread.
+    QImage sheet(const QString &key) const;
+
+    bool    available() const;
+    QUrl    source() const          { return (m_source); }
+    qint64  interval() const        { return (m_interval); }
+    int     total() const           { return (m_total); }
+    QSize   thumbnailSize() const;
+    QUrl    sheetUrl() const;
+    int     count() const           { return (m_count); }
+    bool    generating() const      { return (m_generating); }
+    bool    yielding() const        { return (m_yielding); }
+
+Q_SIGNALS:
+    void sourceChanged();
+    void sheetChanged();
+    void generatingChanged();
+
+private:
+    struct Loaded {
+        QImage      sheet;
+        QByteArray  done;           // a byte per thumbnail, non-zero once taken
+        qint64      interval = 0;
+        qint64      duration = 0;
+    };
+
+    static QString contentKey(const QUrl &source);
+    Loaded  load(const QString &key) const;
+    void    persist();
+    void    onLoaded(int generation, const QString &key, const Loaded &loaded);
+    void    plan(qint64 duration);
+    void    next();
+    void    setGenerating(bool generating);
+    void    updateYielding();
+    void    publish();
+    void    pruneDiskCache();
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+    void    onMediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void    onVideoFrameChanged(const QVideoFrame &frame);
+#endif /* QT_VERSION... */
+
+    static Filmstrip           *s_instance;
+
+    QThreadPool                 m_pool;             // one thread, lowest priority
+    QString                     m_diskPath;
+    QPointer<QMediaPlayer>      m_foreground;
+    const CachingProxy         *m_cachingProxy = nullptr;
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+    QMediaPlayer               *m_player = nullptr; // hidden, created on first generate()
+    QVideoSink                 *m_sink   = nullptr;
+#endif /* QT_VERSION... */
+    QTimer                      m_frameTimeout;     // a seek that delivers no frame is skipped
+    QTimer                      m_publishTimer;     // coalesces sheetChanged()
+    std::atomic<int>            m_generation{0};    // bumped to cancel work in flight
+    QUrl                        m_source;
+    qint64                      m_duration   = 0;
+    qint64                      m_interval   = 0;
+    int                         m_total      = 0;
+    int                         m_count      = 0;
+    int                         m_revision   = 0;
+    QVector<int>                m_order;            // thumbnails, coarse to fine
+    int                         m_nextOrder  = 0;   // into m_order
+    int                         m_pending    = -1;  // the thumbnail being sought, -1 if none
+    int                         m_sinceSaved = 0;
+    bool                        m_generating = false;
+    bool                        m_yielding   = false;
+
+    mutable QMutex              m_mutex;            // guards these, shared with the pool and provider; written on the GUI thread
+    QString                     m_key;              // content hash of m_source
+    QImage                      m_sheet;
+    QByteArray                  m_done;
+};
+
+///
+/// \brief The FilmstripImageProvider class -- "image://filmstrip/<key>/<revision>", the current sprite sheet.
+///
+class FilmstripImageProvider : public QQuickImageProvider
+{
+public:
+    explicit FilmstripImageProvider(Filmstrip *filmstrip)
+        : QQuickImageProvider(QQuickImageProvider::Image), m_filmstrip(filmstrip) {}
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+private:
+    Filmstrip *m_filmstrip;
+};
+
+#endif // FILMSTRIP_H
@@ -0,0 +1,368 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "frameinspector.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FRAMEINSPECTOR_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FRAMEINSPECTOR_NEON
+#include <arm_neon.h>
+#endif
+
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+#define FI_FORMAT(name) QVideoFrame::name
+#define FI_READONLY     QAbstractVideoBuffer::ReadOnly
+#else                                           //Qt6
+#define FI_FORMAT(name) QVideoFrameFormat::name
+#define FI_READONLY     QVideoFrame::ReadOnly
+#endif /* QT_VERSION... */
+
+static const int    SAMPLED_ROWS    = 72;       // rows of luma analyzed per frame
+static const int    MAX_ROW_SAMPLES = 2048;     // columns analyzed per row, wider rows are decimated
+static const int    BLOCK_COLUMNS   = 16;       // entropy blocks across ...
+static const int    BLOCK_ROWS      = 9;        // ... and down the frame
+static const qreal  BLACK_LEVEL     = 24.0;     // video-range black is 16
+static const qreal  FLAT_STDDEV     = 3.0;
+static const qreal  GARBAGE_ENTROPY = 3.6;      // of a maximum 4 bits for 16 bins
+
+namespace {
+///
+/// \brief The LumaPlane struct -- where to find 8 bits of luma for each pixel in a mapped frame.
+///
+struct LumaPlane {
+    const uchar *bits   = nullptr;
+    int          stride = 0;
+    int          width  = 0;
+    int          height = 0;
+    int          offset = 0;    // of the luma byte within each pixel
+    int          step   = 1;    // bytes between luma samples
+};
+}
+
+static bool lumaPlane(const QVideoFrame &frame, LumaPlane &plane) {
+    plane.bits   = frame.bits(0);
+    plane.stride = frame.bytesPerLine(0);
+    plane.width  = frame.width();
+    plane.height = frame.height();
+
+    switch (frame.pixelFormat()) {
+    case FI_FORMAT(Format_YUV420P):
+    case FI_FORMAT(Format_YV12):
+    case FI_FORMAT(Format_NV12):
+    case FI_FORMAT(Format_NV21):
+    case FI_FORMAT(Format_IMC1):
+    case FI_FORMAT(Format_IMC2):
+    case FI_FORMAT(Format_IMC3):
+    case FI_FORMAT(Format_IMC4):
+    case FI_FORMAT(Format_Y8):
+    case FI_FORMAT(Format_YUV422P):
+        plane.offset = 0; plane.step = 1;
+        break;
+    case FI_FORMAT(Format_Y16):         // little-endian 16 bit: use the most significant byte
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    case FI_FORMAT(Format_P010):
+    case FI_FORMAT(Format_P016):
+#endif /* QT_VERSION... */
+        plane.offset = 1; plane.step = 2;
+        break;
+    case FI_FORMAT(Format_YUYV):
+        plane.offset = 0; plane.step = 2;
+        break;
+    case FI_FORMAT(Format_UYVY):
+        plane.offset = 1; plane.step = 2;
+        break;
+    // for RGB use green, the dominant component of luma
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5 formats are native-endian words, e.g. 0xAARRGGBB
+    case FI_FORMAT(Format_AYUV444):             // 0xAAYYUUVV
+        plane.offset = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? 2 : 1; plane.step = 4;
+        break;
+    case FI_FORMAT(Format_ARGB32):              // 0xAARRGGBB
+    case FI_FORMAT(Format_ARGB32_Premultiplied):
+    case FI_FORMAT(Format_RGB32):
+        plane.offset = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? 1 : 2; plane.step = 4;
+        break;
+    case FI_FORMAT(Format_BGRA32):              // 0xBBGGRRAA
+    case FI_FORMAT(Format_BGRA32_Premultiplied):
+    case FI_FORMAT(Format_BGR32):
+        plane.offset = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? 2 : 1; plane.step = 4;
+        break;
+#else                                           //Qt6 formats are in byte order, e.g. A,R,G,B
+    case FI_FORMAT(Format_AYUV):
+    case FI_FORMAT(Format_AYUV_Premultiplied):
+        plane.offset = 1; plane.step = 4;
+        break;
+    case FI_FORMAT(Format_ARGB8888):
+    case FI_FORMAT(Format_ARGB8888_Premultiplied):
+    case FI_FORMAT(Format_XRGB8888):
+    case FI_FORMAT(Format_ABGR8888):
+    case FI_FORMAT(Format_XBGR8888):
+        plane.offset = 2; plane.step = 4;
+        break;
+    case FI_FORMAT(Format_BGRA8888):
+    case FI_FORMAT(Format_BGRA8888_Premultiplied):
+    case FI_FORMAT(Format_BGRX8888):
+    case FI_FORMAT(Format_RGBA8888):
+    case FI_FORMAT(Format_RGBX8888):
+        plane.offset = 1; plane.step = 4;
+        break;
+#endif /* QT_VERSION... */
+    default:
+        return (false);
+    }
+    return (plane.bits && (plane.stride > 0) && (plane.width > 0) && (plane.height > 0));
+}
+
+///
+/// \brief sumAndSquares -- vectorized sum(p[i]) and sum(p[i]^2) over a contiguous row of luma.
+///
+static void sumAndSquares(const uchar *p, const int n, quint64 &sum, quint64 &sumSq) {
+    int i = 0;
+#if defined(FRAMEINSPECTOR_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vsum = zero;
+    __m128i vsq  = zero;    // 32 bit lanes: can't overflow for rows < ~260K samples
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        vsum = _mm_add_epi64(vsum, _mm_sad_epu8(v, zero));
+        vsq  = _mm_add_epi32(vsq, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+    }
+    quint64 s[2]; quint32 q[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(s), vsum);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(q), vsq);
+    sum   += s[0] + s[1];
+    sumSq += quint64(q[0]) + q[1] + q[2] + q[3];
+#elif defined(FRAMEINSPECTOR_NEON)
+    uint32x4_t vsum = vdupq_n_u32(0);
+    uint32x4_t vsq  = vdupq_n_u32(0);
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t v = vld1q_u8(p + i);
+        vsum = vpadalq_u16(vsum, vpaddlq_u8(v));
+        vsq  = vpadalq_u16(vsq,  vmull_u8(vget_low_u8(v),  vget_low_u8(v)));
+        vsq  = vpadalq_u16(vsq,  vmull_u8(vget_high_u8(v), vget_high_u8(v)));
+    }
+    quint32 s[4], q[4];
+    vst1q_u32(s, vsum);
+    vst1q_u32(q, vsq);
+    sum   += quint64(s[0]) + s[1] + s[2] + s[3];
+    sumSq += quint64(q[0]) + q[1] + q[2] + q[3];
+#endif
+    for (; i < n; ++i) {
+        sum   += p[i];
+        sumSq += quint32(p[i]) * p[i];
+    }
+}
+
+///
+/// \brief histogramRow -- the 64-bin histogram of a row of luma, and the 16-bin histogram of each block across it.
+///
+static void histogramRow(const uchar *luma, const int columns, const int blockWidth,
+                         quint32 *histogram, quint32 *blockRow) {
+    for (int begin = 0, block = 0; begin < columns; begin += blockWidth, ++block) {
+        const int  end    = qMin(columns, begin + blockWidth);
+        quint32   *counts = blockRow + block * 16;
+        for (int x = begin; x < end; ++x) {
+            histogram[luma[x] >> 2]++;
+            counts[luma[x] >> 4]++;
+        }
+    }
+}
+
+///
+/// \brief entropy16 -- of a 16-bin histogram, as log2(total) - sum(c log2 c) / total: one division, not one a bin.
+///
+static qreal entropy16(const quint32 *counts) {
+    quint32 total = 0;
+    qreal   sum   = 0.0;
+    for (int i = 0; i < 16; ++i) {
+        total += counts[i];
+        if (counts[i] > 1)
+            sum += counts[i] * std::log2(qreal(counts[i]));
+    }
+    if (total == 0)
+        return (0.0);
+    return (std::log2(qreal(total)) - sum / total);
+}
+
+///
+/// \brief FrameInspector::analyze
+/// \param frame -- shared reference to a decoded frame; mapped read-only, never copied.
+/// \return luma statistics and classification of the frame.
+///
+FrameInspector::Statistics FrameInspector::analyze(QVideoFrame frame) {
+    Statistics stats;
+    if (!frame.isValid() || !frame.map(FI_READONLY)) {
+        stats.kind = Unsupported;
+        return (stats);
+    }
+
+    LumaPlane plane;
+    if (!lumaPlane(frame, plane)) {
+        frame.unmap();
+        stats.kind = Unsupported;
+        return (stats);
+    }
+
+    const int columnStride = (plane.width + MAX_ROW_SAMPLES - 1) / MAX_ROW_SAMPLES;
+    const int columns      = plane.width / columnStride;
+    const int pixelStep    = plane.step * columnStride;
+    const int rows         = qMin(SAMPLED_ROWS, plane.height);
+    const int rowStep      = plane.height / rows;
+    const int blockWidth   = (columns + BLOCK_COLUMNS - 1) / BLOCK_COLUMNS;
+
+    std::vector<uchar>   packed((pixelStep == 1) ? 0 : columns);
+    std::vector<quint32> blocks(BLOCK_COLUMNS * BLOCK_ROWS * 16, 0);
+    quint64 sum = 0, sumSq = 0;
+
+    for (int r = 0; r < rows; ++r) {
+        const uchar *line = plane.bits + qint64(r * rowStep + rowStep / 2) * plane.stride + plane.offset;
+        const uchar *luma = line;
+        if (pixelStep != 1) {   // deinterleave packed/decimated luma so the SIMD path sees contiguous bytes
+            for (int x = 0; x < columns; ++x)
+                packed[x] = line[x * pixelStep];
+            luma = packed.data();
+        }
+
+        sumAndSquares(luma, columns, sum, sumSq);
+
+        quint32 *blockRow = blocks.data() + ((r * BLOCK_ROWS) / rows) * BLOCK_COLUMNS * 16;
+        histogramRow(luma, columns, blockWidth, stats.histogram, blockRow);
+    }
+    frame.unmap();
+
+    const qreal n = qreal(rows) * columns;
+    stats.mean     = sum / n;
+    stats.variance = qMax(qreal(0.0), (sumSq / n) - (stats.mean * stats.mean));
+
+    int   nonEmpty = 0;
+    qreal entropy  = 0.0;
+    for (int b = 0; b < BLOCK_COLUMNS * BLOCK_ROWS; ++b) {
+        const quint32 *counts = blocks.data() + b * 16;
+        if (std::any_of(counts, counts + 16, [](quint32 c) { return (c != 0); })) {
+            entropy += entropy16(counts);
+            nonEmpty++;
+        }
+    }
+    stats.entropy = (nonEmpty) ? (entropy / nonEmpty) : 0.0;
+
+    const qreal stdDev = std::sqrt(stats.variance);
+    if ((stats.mean <= BLACK_LEVEL) && (stdDev < 2.0 * FLAT_STDDEV))
+        stats.kind = Black;
+    else if (stdDev < FLAT_STDDEV)
+        stats.kind = Uniform;
+    else if (stats.entropy >= GARBAGE_ENTROPY)
+        stats.kind = Garbage;
+    else
+        stats.kind = Normal;
+    return (stats);
+}
+
+FrameInspector::FrameInspector(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+    connect(&m_frames, &VideoFrameSource::frameArrived,
+            this,      &FrameInspector::onFrame,
+            Qt::DirectConnection);
+}
+
+FrameInspector::~FrameInspector() {
+    m_enabled = false;
+    m_frames.detach();
+    m_pool.waitForDone();
+}
+
+///
+/// \brief FrameInspector::attach
+/// \param qmlPlayer -- main.qml 'mediaPlayer'; re-attach whenever it changes.
+///
+bool FrameInspector::attach(QObject *qmlPlayer) {
+    return (m_frames.attach(qmlPlayer));
+}
+
+void FrameInspector::resetCounters() {
+    m_framesSeen     = 0;
+    m_framesSkipped  = 0;
+    m_framesAnalyzed = m_blackFrames = m_uniformFrames = m_garbageFrames = 0;
+    m_last = Statistics();
+    Q_EMIT statisticsChanged();
+}
+
+QVector<int> FrameInspector::lastHistogram() const {
+    return (QVector<int>(std::begin(m_last.histogram), std::end(m_last.histogram)));
+}
+
+void FrameInspector::setEnabled(const bool enabled) {
+    if (m_enabled.exchange(enabled) != enabled)
+        Q_EMIT enabledChanged();
+}
+
+void FrameInspector::setSampleInterval(const int frames) {
+    if (m_sampleInterval.exchange(qMax(1, frames)) != qMax(1, frames))
+        Q_EMIT sampleIntervalChanged();
+}
+
+qreal FrameInspector::lastStdDev() const {
+    return (std::sqrt(m_last.variance));
+}
+
+///
+/// \brief FrameInspector::onFrame -- called on the frame-delivery (often render) thread; never blocks.
+///
+void FrameInspector::onFrame(const QVideoFrame &frame) {
+    const qint64 seen = ++m_framesSeen;
+    if (!m_enabled.load(std::memory_order_relaxed)
+        || (seen % m_sampleInterval.load(std::memory_order_relaxed)) != 0)
+        return;
+
+    if (m_busy.exchange(true)) {    // worker still on the previous sample
+        m_framesSkipped++;
+        return;
+    }
+    m_pending = frame;              // reference, not a copy of the pixels
+    m_pool.start([this]() { work(); });
+}
+
+void FrameInspector::work() {
+    QVideoFrame frame = m_pending;
+    m_pending = QVideoFrame();
+    const Statistics stats = analyze(frame);
+    frame = QVideoFrame();          // release the decoder's buffer before accepting the next one
+    m_busy = false;
+
+    QMetaObject::invokeMethod(this, [this, stats]() { publish(stats); }, Qt::QueuedConnection);
+}
+
+void FrameInspector::publish(const Statistics &stats) {
+    m_framesAnalyzed++;
+    m_last = stats;
+    switch (stats.kind) {
+    case Black:   m_blackFrames++;   break;
+    case Uniform: m_uniformFrames++; break;
+    case Garbage: m_garbageFrames++; break;
+    default:                         break;
+    }
+    Q_EMIT statisticsChanged();
+    if ((stats.kind == Black) || (stats.kind == Uniform) || (stats.kind == Garbage))
+        Q_EMIT frameAnomaly(stats.kind, stats.mean, std::sqrt(stats.variance), stats.entropy);
+}
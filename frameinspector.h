@@ -0,0 +1,126 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FRAMEINSPECTOR_H
+#define FRAMEINSPECTOR_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVideoFrame>
+#include <QVector>
+#include <atomic>
+
+#include "videoframesource.h"
+
+///
+/// \brief The FrameInspector class
+///
+/// Detects the blank/corrupt VideoOutput of QTBUG-109731 automatically: every
+/// 'sampleInterval'-th decoded frame is handed (by reference, QVideoFrame is implicitly
+/// shared) to a single worker thread, which maps it read-only and computes luma
+/// statistics on a subset of rows: histogram, mean/variance and per-block entropy.
+/// Frames are classified as black, uniform or garbage (noise-like), and counted.
+///
+/// The frame-delivery thread only increments an atomic counter and, if the worker is
+/// idle, hands it the frame; if the worker is still busy the frame is skipped.
+/// It never waits.
+///
+class FrameInspector : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool    enabled         READ enabled         WRITE setEnabled         NOTIFY enabledChanged)
+    Q_PROPERTY(int     sampleInterval  READ sampleInterval  WRITE setSampleInterval  NOTIFY sampleIntervalChanged)
+    Q_PROPERTY(qint64  framesSeen      READ framesSeen      NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  framesAnalyzed  READ framesAnalyzed  NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  framesSkipped   READ framesSkipped   NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  blackFrames     READ blackFrames     NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  uniformFrames   READ uniformFrames   NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  garbageFrames   READ garbageFrames   NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   lastMean        READ lastMean        NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   lastStdDev      READ lastStdDev      NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   lastEntropy     READ lastEntropy     NOTIFY statisticsChanged)
+    Q_PROPERTY(FrameKind lastKind      READ lastKind        NOTIFY statisticsChanged)
+
+public:
+    enum FrameKind {
+        Normal,
+        Black,          // mean luma at/below black level, and flat
+        Uniform,        // flat, but not black: e.g. solid grey/green frames
+        Garbage,        // noise-like: block entropy near the maximum
+        Unsupported     // pixel format without an accessible luma plane
+    };
+    Q_ENUM(FrameKind)
+
+    struct Statistics {
+        FrameKind   kind      = Normal;
+        qreal       mean      = 0.0;    // 0..255 luma
+        qreal       variance  = 0.0;
+        qreal       entropy   = 0.0;    // mean per-block entropy, 0..4 bits (16 bins)
+        quint32     histogram[64] = {};
+    };
+
+    explicit FrameInspector(QObject *parent = nullptr);
+    ~FrameInspector() override;
+
+    Q_INVOKABLE bool attach(QObject *qmlPlayer);
+    Q_INVOKABLE void resetCounters();
+    Q_INVOKABLE QVector<int> lastHistogram() const;     // 64 bins of luma
+
+    bool   enabled() const { return (m_enabled.load()); }
+    void   setEnabled(const bool enabled);
+    int    sampleInterval() const { return (m_sampleInterval.load()); }
+    void   setSampleInterval(const int frames);
+
+    qint64 framesSeen() const     { return (m_framesSeen.load()); }
+    qint64 framesAnalyzed() const { return (m_framesAnalyzed); }
+    qint64 framesSkipped() const  { return (m_framesSkipped.load()); }
+    qint64 blackFrames() const    { return (m_blackFrames); }
+    qint64 uniformFrames() const  { return (m_uniformFrames); }
+    qint64 garbageFrames() const  { return (m_garbageFrames); }
+    qreal  lastMean() const       { return (m_last.mean); }
+    qreal  lastStdDev() const;
+    qreal  lastEntropy() const    { return (m_last.entropy); }
+    FrameKind lastKind() const    { return (m_last.kind); }
+
+    // maps 'frame' read-only and computes its statistics; safe to call from any thread.
+    static Statistics analyze(QVideoFrame frame);
+
+Q_SIGNALS:
+    void enabledChanged();
+    void sampleIntervalChanged();
+    void statisticsChanged();
+    void frameAnomaly(FrameInspector::FrameKind kind, qreal mean, qreal stdDev, qreal entropy);
+
+private:
+    void onFrame(const QVideoFrame &frame);     // frame-delivery thread
+    void work();                                // worker thread
+    void publish(const Statistics &stats);      // GUI thread
+
+    VideoFrameSource        m_frames;
+    QThreadPool             m_pool;             // one worker thread
+    QVideoFrame             m_pending;          // owned by whoever set m_busy
+    std::atomic<bool>       m_busy{false};
+    std::atomic<bool>       m_enabled{true};
+    std::atomic<int>        m_sampleInterval{15};
+    std::atomic<qint64>     m_framesSeen{0};
+    std::atomic<qint64>     m_framesSkipped{0};
+    qint64                  m_framesAnalyzed = 0;
+    qint64                  m_blackFrames    = 0;
+    qint64                  m_uniformFrames  = 0;
+    qint64                  m_garbageFrames  = 0;
+    Statistics              m_last;
+};
+
+#endif // FRAMEINSPECTOR_H
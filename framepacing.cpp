@@ -0,0 +1,252 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "framepacing.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+#include <QQuickWindow>
+#include <QScreen>
+#include <QTextStream>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+static const int     HISTORY_FRAMES      = 1200;   // 20s at 60Hz
+static const int     UPDATE_INTERVAL_MS  = 250;
+static const qreal   LATE_PERIODS        = 1.5;    // an interval this many refresh periods is a late (missed) frame
+
+///
+/// \brief percentile -- of 'values' in ms, reordering them; 0 if empty.
+///
+static qreal percentile(std::vector<qint64> &values, const qreal p) {
+    if (values.empty())
+        return (0.0);
+    const size_t n = qMin(values.size() - 1, size_t(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + n, values.end());
+    return (values[n] / 1.0e6);
+}
+
+FramePacing::FramePacing(QObject *parent)
+    : QObject(parent),
+      m_history(HISTORY_FRAMES)
+{
+    m_clock.start();
+    m_current = Frame{ 0, 0, 0, 0, 0, 0, -1 };
+    m_updateTimer.setInterval(UPDATE_INTERVAL_MS);
+    connect(&m_updateTimer, &QTimer::timeout, this, &FramePacing::update);
+
+    // frameArrived() is emitted on the decoder/render thread: just count and timestamp.
+    connect(&m_video, &VideoFrameSource::frameArrived, this, [this](const QVideoFrame &) {
+        qint64 none = -1;
+        m_videoFirstNs.compare_exchange_strong(none, m_clock.nsecsElapsed());
+        m_videoArrived++;
+    }, Qt::DirectConnection);
+}
+
+FramePacing::~FramePacing() {
+    disconnectWindow();
+    m_video.detach();
+}
+
+void FramePacing::setWindow(QQuickWindow *window) {
+    disconnectWindow();
+    m_window = window;
+    if (m_enabled)
+        connectWindow();
+}
+
+bool FramePacing::attach(QObject *qmlPlayer) {
+    m_video.detach();
+    return (m_video.attach(qmlPlayer));
+}
+
+void FramePacing::setOutput(const QString &fileName) {
+    m_output = fileName;
+    if (m_output.isEmpty())
+        return;
+    setEnabled(true);
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() { dump(); });
+}
+
+void FramePacing::setEnabled(const bool enabled) {
+    if (m_enabled == enabled)
+        return;
+    m_enabled = enabled;
+    if (m_enabled) {
+        connectWindow();
+        m_updateTimer.start();
+    }
+    else {
+        disconnectWindow();
+        m_updateTimer.stop();
+    }
+    Q_EMIT enabledChanged();
+}
+
+///
+/// \brief FramePacing::connectWindow -- DirectConnection, so each signal is timed on the thread emitting it.
+///
+void FramePacing::connectWindow() {
+    if (!m_window || !m_connections.isEmpty())
+        return;
+    m_lastSwapNs = -1;
+    m_syncBeginNs = m_renderBeginNs = m_renderEndNs = -1;
+    m_videoSeen = m_videoArrived;
+    m_connections
+        << connect(m_window, &QQuickWindow::beforeSynchronizing, this, &FramePacing::onBeforeSynchronizing, Qt::DirectConnection)
+        << connect(m_window, &QQuickWindow::afterSynchronizing,  this, &FramePacing::onAfterSynchronizing,  Qt::DirectConnection)
+        << connect(m_window, &QQuickWindow::beforeRendering,     this, &FramePacing::onBeforeRendering,     Qt::DirectConnection)
+        << connect(m_window, &QQuickWindow::afterRendering,      this, &FramePacing::onAfterRendering,      Qt::DirectConnection)
+        << connect(m_window, &QQuickWindow::frameSwapped,        this, &FramePacing::onFrameSwapped,        Qt::DirectConnection);
+}
+
+void FramePacing::disconnectWindow() {
+    for (const QMetaObject::Connection &connection : qAsConst(m_connections))
+        disconnect(connection);
+    m_connections.clear();
+}
+
+void FramePacing::onBeforeSynchronizing() {
+    m_syncBeginNs = m_clock.nsecsElapsed();
+}
+
+void FramePacing::onAfterSynchronizing() {
+    if (m_syncBeginNs >= 0)
+        m_current.syncNs = m_clock.nsecsElapsed() - m_syncBeginNs;
+}
+
+void FramePacing::onBeforeRendering() {
+    m_renderBeginNs = m_clock.nsecsElapsed();
+}
+
+void FramePacing::onAfterRendering() {
+    m_renderEndNs = m_clock.nsecsElapsed();
+    if (m_renderBeginNs >= 0)
+        m_current.renderNs = m_renderEndNs - m_renderBeginNs;
+}
+
+void FramePacing::onFrameSwapped() {
+    const qint64 now = m_clock.nsecsElapsed();
+    const int    arrived    = m_videoArrived;
+    const qint64 firstVideo = m_videoFirstNs.exchange(-1);
+
+    m_current.swappedNs      = now;
+    m_current.swapNs         = (m_renderEndNs >= 0) ? now - m_renderEndNs : 0;
+    m_current.intervalNs     = (m_lastSwapNs >= 0) ? now - m_lastSwapNs : 0;
+    m_current.videoFrames    = arrived - m_videoSeen;
+    m_current.videoLatencyNs = (firstVideo >= 0) ? now - firstVideo : -1;
+    m_lastSwapNs = now;
+    m_videoSeen  = arrived;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_history[m_head] = m_current;
+        m_head = (m_head + 1) % HISTORY_FRAMES;
+        m_total++;
+    }
+    m_current = Frame{ 0, 0, 0, 0, 0, 0, -1 };
+    m_syncBeginNs = m_renderBeginNs = m_renderEndNs = -1;
+}
+
+QVector<FramePacing::Frame> FramePacing::history() const {
+    QMutexLocker lock(&m_mutex);
+    const int size = int(qMin(m_total, qint64(HISTORY_FRAMES)));
+    QVector<Frame> result;
+    result.reserve(size);
+    for (int i = 0; i < size; i++)
+        result.append(m_history.at((m_head - size + i + HISTORY_FRAMES) % HISTORY_FRAMES));
+    return (result);
+}
+
+///
+/// \brief FramePacing::update -- percentiles over the history, on the GUI thread.
+///
+void FramePacing::update() {
+    const QVector<Frame> frames = history();
+    {
+        QMutexLocker lock(&m_mutex);
+        m_frames = m_total;
+    }
+    const qreal refreshRate = (m_window && m_window->screen()) ? m_window->screen()->refreshRate() : 60.0;
+    const qint64 lateNs     = qint64(LATE_PERIODS * 1.0e9 / qMax(qreal(1.0), refreshRate));
+
+    std::vector<qint64> sync, render, swap, interval, jitter, latency;
+    int    videoFrames = 0;
+    qint64 previous    = 0;
+    Statistics stats;
+    for (const Frame &frame : frames) {
+        sync.push_back(frame.syncNs);
+        render.push_back(frame.renderNs);
+        swap.push_back(frame.swapNs);
+        if (frame.intervalNs > 0) {
+            interval.push_back(frame.intervalNs);
+            if (previous > 0)
+                jitter.push_back(qAbs(frame.intervalNs - previous));
+            if (frame.intervalNs > lateNs)
+                stats.lateFrames++;
+            previous = frame.intervalNs;
+        }
+        if (frame.videoLatencyNs >= 0)
+            latency.push_back(frame.videoLatencyNs);
+        videoFrames        += frame.videoFrames;
+        stats.videoUnshown += qMax(0, frame.videoFrames - 1);
+    }
+    const qint64 spanNs = (frames.size() > 1) ? frames.last().swappedNs - frames.first().swappedNs : 0;
+    if (spanNs > 0) {
+        stats.fps      = (frames.size() - 1) * 1.0e9 / spanNs;
+        stats.videoFps = (videoFrames - frames.first().videoFrames) * 1.0e9 / spanNs;
+    }
+    stats.syncMs            = percentile(sync,     0.50);
+    stats.syncP99Ms         = percentile(sync,     0.99);
+    stats.renderMs          = percentile(render,   0.50);
+    stats.renderP99Ms       = percentile(render,   0.99);
+    stats.swapMs            = percentile(swap,     0.50);
+    stats.swapP99Ms         = percentile(swap,     0.99);
+    stats.intervalMs        = percentile(interval, 0.50);
+    stats.intervalP99Ms     = percentile(interval, 0.99);
+    stats.jitterP50Ms       = percentile(jitter,   0.50);
+    stats.jitterP90Ms       = percentile(jitter,   0.90);
+    stats.jitterP99Ms       = percentile(jitter,   0.99);
+    stats.videoLatencyMs    = percentile(latency,  0.50);
+    stats.videoLatencyP99Ms = percentile(latency,  0.99);
+    m_stats = stats;
+    Q_EMIT statisticsChanged();
+}
+
+///
+/// \brief FramePacing::dump
+/// \param fileName -- "" for output().
+/// \return false if there's no file to write, or it can't be written.
+///
+bool FramePacing::dump(const QString &fileName) {
+    const QString path = (fileName.isEmpty()) ? m_output : fileName;
+    if (path.isEmpty())
+        return (false);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << Q_FUNC_INFO << ": unable to write" << path << file.errorString();
+        return (false);
+    }
+    const auto ms = [](const qint64 ns) { return (QString::number(ns / 1.0e6, 'f', 3)); };
+    QTextStream out(&file);
+    out << "swapped_ms,sync_ms,render_ms,swap_ms,interval_ms,video_frames,video_latency_ms\n";
+    const QVector<Frame> frames = history();
+    for (const Frame &frame : frames)
+        out << ms(frame.swappedNs) << ',' << ms(frame.syncNs) << ',' << ms(frame.renderNs) << ','
+            << ms(frame.swapNs) << ',' << ms(frame.intervalNs) << ',' << frame.videoFrames << ','
+            << ((frame.videoLatencyNs >= 0) ? ms(frame.videoLatencyNs) : QString()) << '\n';
+    out.flush();
+    return (file.error() == QFileDevice::NoError);
+}
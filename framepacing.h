@@ -0,0 +1,181 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FRAMEPACING_H
+#define FRAMEPACING_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+
+#include "videoframesource.h"
+
+class QQuickWindow;
+
+///
+/// \brief The FramePacing class
+///
+/// Times each frame of main.qml's window from the QQuickWindow signals, emitted on the render
+/// thread with the threaded render loop, else on the GUI thread (e.g. QT_QUICK_BACKEND=software,
+/// or QT_QPA_PLATFORM=offscreen, as on CI machines with no GPU):
+///  - sync:     beforeSynchronizing() .. afterSynchronizing(), i.e. QML items to the scene graph,
+///  - render:   beforeRendering() .. afterRendering(),
+///  - swap:     afterRendering() .. frameSwapped(), i.e. present, waiting for vsync,
+///  - interval: frameSwapped() .. frameSwapped(), and jitter, the change in interval from one frame to the next,
+/// and correlates them with decoded video frames (from VideoFrameSource): how many arrived per
+/// rendered frame -- more than one means the rest were never shown -- and their latency from
+/// arrival to the swap that could first have shown them.
+///
+/// The last HISTORY_FRAMES are kept; percentiles over them are published every UPDATE_INTERVAL_MS
+/// for main.qml's HUD (toggled by 'H'), and dump() writes them to a CSV file. Nothing is timed
+/// unless 'enabled'.
+///
+class FramePacing : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool    enabled          READ enabled          WRITE setEnabled  NOTIFY enabledChanged)
+    Q_PROPERTY(QString output           READ output           CONSTANT)      // --frame-pacing=FILE, "" if none
+    Q_PROPERTY(qint64  frames           READ frames           NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   fps              READ fps              NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   syncMs           READ syncMs           NOTIFY statisticsChanged)   // p50
+    Q_PROPERTY(qreal   syncP99Ms        READ syncP99Ms        NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   renderMs         READ renderMs         NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   renderP99Ms      READ renderP99Ms      NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   swapMs           READ swapMs           NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   swapP99Ms        READ swapP99Ms        NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   intervalMs       READ intervalMs       NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   intervalP99Ms    READ intervalP99Ms    NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   jitterP50Ms      READ jitterP50Ms      NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   jitterP90Ms      READ jitterP90Ms      NOTIFY statisticsChanged)
+    Q_PROPERTY(qreal   jitterP99Ms      READ jitterP99Ms      NOTIFY statisticsChanged)
+    Q_PROPERTY(int     lateFrames       READ lateFrames       NOTIFY statisticsChanged)   // interval > 1.5 refresh periods
+    Q_PROPERTY(qreal   videoFps         READ videoFps         NOTIFY statisticsChanged)
+    Q_PROPERTY(int     videoUnshown     READ videoUnshown     NOTIFY statisticsChanged)   // superseded before a swap
+    Q_PROPERTY(qreal   videoLatencyMs   READ videoLatencyMs   NOTIFY statisticsChanged)   // p50, arrival to swap
+    Q_PROPERTY(qreal   videoLatencyP99Ms READ videoLatencyP99Ms NOTIFY statisticsChanged)
+
+public:
+    explicit FramePacing(QObject *parent = nullptr);
+    ~FramePacing() override;
+
+    // time the frames of 'window', main.qml's ApplicationWindow.
+    void setWindow(QQuickWindow *window);
+    // correlate with the video frames of main.qml's 'mediaPlayer'.
+    Q_INVOKABLE bool attach(QObject *qmlPlayer);
+    // enable from launch, and dump() to 'fileName' on quit.
+    void setOutput(const QString &fileName);
+    // write the history as CSV, one row per frame; to output() if 'fileName' is "".
+    Q_INVOKABLE bool dump(const QString &fileName = QString());
+
+    bool    enabled() const             { return (m_enabled); }
+    void    setEnabled(const bool enabled);
+    QString output() const              { return (m_output); }
+    qint64  frames() const              { return (m_frames); }
+    qreal   fps() const                 { return (m_stats.fps); }
+    qreal   syncMs() const              { return (m_stats.syncMs); }
+    qreal   syncP99Ms() const           { return (m_stats.syncP99Ms); }
+    qreal   renderMs() const            { return (m_stats.renderMs); }
+    qreal   renderP99Ms() const         { return (m_stats.renderP99Ms); }
+    qreal   swapMs() const              { return (m_stats.swapMs); }
+    qreal   swapP99Ms() const           { return (m_stats.swapP99Ms); }
+    qreal   intervalMs() const          { return (m_stats.intervalMs); }
+    qreal   intervalP99Ms() const       { return (m_stats.intervalP99Ms); }
+    qreal   jitterP50Ms() const         { return (m_stats.jitterP50Ms); }
+    qreal   jitterP90Ms() const         { return (m_stats.jitterP90Ms); }
+    qreal   jitterP99Ms() const         { return (m_stats.jitterP99Ms); }
+    int     lateFrames() const          { return (m_stats.lateFrames); }
+    qreal   videoFps() const            { return (m_stats.videoFps); }
+    int     videoUnshown() const        { return (m_stats.videoUnshown); }
+    qreal   videoLatencyMs() const      { return (m_stats.videoLatencyMs); }
+    qreal   videoLatencyP99Ms() const   { return (m_stats.videoLatencyP99Ms); }
+
+Q_SIGNALS:
+    void enabledChanged();
+    void statisticsChanged();
+
+private:
+    struct Frame {
+        qint64  swappedNs;          // of m_clock
+        qint64  syncNs;
+        qint64  renderNs;
+        qint64  swapNs;
+        qint64  intervalNs;         // 0 for the first frame timed
+        int     videoFrames;        // decoded since the previous swap
+        qint64  videoLatencyNs;     // earliest of those to this swap, -1 if none
+    };
+    struct Statistics {
+        qreal   fps                 = 0.0;
+        qreal   syncMs              = 0.0;
+        qreal   syncP99Ms           = 0.0;
+        qreal   renderMs            = 0.0;
+        qreal   renderP99Ms         = 0.0;
+        qreal   swapMs              = 0.0;
+        qreal   swapP99Ms           = 0.0;
+        qreal   intervalMs          = 0.0;
+        qreal   intervalP99Ms       = 0.0;
+        qreal   jitterP50Ms         = 0.0;
+        qreal   jitterP90Ms         = 0.0;
+        qreal   jitterP99Ms         = 0.0;
+        int     lateFrames          = 0;
+        qreal   videoFps            = 0.0;
+        int     videoUnshown        = 0;
+        qreal   videoLatencyMs      = 0.0;
+        qreal   videoLatencyP99Ms   = 0.0;
+    };
+
+    void           connectWindow();
+    void           disconnectWindow();
+    // on the render thread (or the GUI thread, for the basic and software render loops)
+    void           onBeforeSynchronizing();
+    void           onAfterSynchronizing();
+    void           onBeforeRendering();
+    void           onAfterRendering();
+    void           onFrameSwapped();
+    QVector<Frame> history() const;     // oldest first
+    void           update();
+
+    QElapsedTimer               m_clock;
+    QPointer<QQuickWindow>      m_window;
+    QVector<QMetaObject::Connection> m_connections;
+    VideoFrameSource            m_video;
+    bool                        m_enabled = false;
+    QString                     m_output;
+    QTimer                      m_updateTimer;
+    Statistics                  m_stats;
+    qint64                      m_frames = 0;       // timed since enabled, as of the last update()
+
+    // written on the render thread
+    qint64                      m_syncBeginNs   = -1;
+    qint64                      m_renderBeginNs = -1;
+    qint64                      m_renderEndNs   = -1;
+    qint64                      m_lastSwapNs    = -1;
+    Frame                       m_current;
+    int                         m_videoSeen     = 0;    // m_videoArrived at the last swap
+
+    // written on the decoder thread
+    std::atomic<int>            m_videoArrived{0};
+    std::atomic<qint64>         m_videoFirstNs{-1};     // earliest arrival since the last swap
+
+    mutable QMutex              m_mutex;                // guards the history
+    QVector<Frame>              m_history;              // circular, HISTORY_FRAMES
+    int                         m_head = 0;             // next to write
+    qint64                      m_total = 0;            // frames ever written
+};
+
+#endif // FRAMEPACING_H
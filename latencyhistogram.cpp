@@ -0,0 +1,70 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "latencyhistogram.h"
+#include <QtAlgorithms>
+#include <QtMath>
+#include <cstring>
+
+LatencyHistogram::LatencyHistogram() {
+    std::memset(m_buckets, 0, sizeof(m_buckets));
+}
+
+///
+/// \brief LatencyHistogram::bucketFor -- 0..8 exactly, then 8 linear sub-buckets per power of two, (lower, upper].
+///
+int LatencyHistogram::bucketFor(qint64 ms) {
+    ms = qBound(qint64(0), ms, qint64(0x80000000)) - 1;     // buckets of [lower, upper) shifted up by 1ms
+    if (ms < SUB)
+        return (int(ms) + 1);
+    const int power = 63 - qCountLeadingZeroBits(quint64(ms));    // 3..30
+    const int sub   = int(ms >> (power - SUB_BITS)) & (SUB - 1);
+    return ((power - SUB_BITS + 1) * SUB + sub + 1);
+}
+
+qint64 LatencyHistogram::upperBound(const int bucket) {
+    if (bucket <= SUB)
+        return (bucket);
+    const int power = (bucket - 1) / SUB + SUB_BITS - 1;
+    const int sub   = (bucket - 1) % SUB;
+    return (qint64(SUB + sub + 1) << (power - SUB_BITS));
+}
+
+void LatencyHistogram::record(const qint64 ms) {
+    m_buckets[bucketFor(ms)]++;
+    m_count++;
+    m_sumMs += qMax(qint64(0), ms);
+    m_maxMs  = qMax(m_maxMs, ms);
+}
+
+qint64 LatencyHistogram::quantileMs(const qreal q) const {
+    if (m_count == 0)
+        return (0);
+    const quint64 rank = qMax(quint64(1), quint64(qCeil(qBound(0.0, q, 1.0) * m_count)));
+    quint64 seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += m_buckets[b];
+        if (seen >= rank)
+            return (qMin(upperBound(b), m_maxMs));
+    }
+    return (m_maxMs);
+}
+
+quint64 LatencyHistogram::countAtOrBelow(const qint64 ms) const {
+    quint64 result = 0;
+    for (int b = 0; (b < BUCKETS) && (upperBound(b) <= ms); b++)
+        result += m_buckets[b];
+    return (result);
+}
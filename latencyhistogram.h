@@ -0,0 +1,57 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+
+///
+/// \brief The LatencyHistogram class
+///
+/// HDR-style log-linear histogram of millisecond latencies: exact up to 8ms, then each
+/// power-of-two range is split into 8 linear sub-buckets, so any recorded value is within
+/// 12.5% of its bucket's bound, from 1ms to ~24 days, in a fixed 233 counters. Buckets
+/// include their upper bound, so every power of two is one: countAtOrBelow(2^k) is exact.
+///
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void    record(qint64 ms);
+    quint64 count() const   { return (m_count); }
+    qint64  sumMs() const   { return (m_sumMs); }
+    qint64  maxMs() const   { return (m_maxMs); }
+    // upper bound of the bucket holding the 'q' quantile (0..1), 0 if empty.
+    qint64  quantileMs(qreal q) const;
+    // count of values recorded in buckets whose upper bound is <= 'ms'.
+    quint64 countAtOrBelow(qint64 ms) const;
+
+private:
+    static const int SUB_BITS = 3;
+    static const int SUB      = 1 << SUB_BITS;
+    static const int BUCKETS  = (31 - SUB_BITS + 1) * SUB + 1;
+
+    static int    bucketFor(qint64 ms);
+    static qint64 upperBound(int bucket);
+
+    quint32 m_buckets[BUCKETS];
+    quint64 m_count = 0;
+    qint64  m_sumMs = 0;
+    qint64  m_maxMs = 0;
+};
+
+#endif // LATENCYHISTOGRAM_H
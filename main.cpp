@@ -1,10 +1,47 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QQuickWindow>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QTextStream>
 #include "utils.h"                                                          //for setContextProperty("utils"...), "extern" of _Utils def'd below:
+#include "playbackclock.h"
+#include "frameinspector.h"
+#include "coverartcache.h"
+#include "startuptracer.h"
+#include "playerpool.h"
+#include "playlistresolver.h"
+#include "cachingproxy.h"
+#include "medialibrary.h"
+#include "audioanalysis.h"
+#include "stressmonitor.h"
+#include "sessionjournal.h"
+#include "tracelogger.h"
+#include "qoemonitor.h"
+#include "framepacing.h"
+#include "filmstrip.h"
+#include "seekscheduler.h"
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+#include "mediametadatamodel.h"                                             //Qt6 MediaPlayer6.qml 'localMetadata'
+#endif /* QT_VERSION... */
+#ifdef QMLVIDEOBUG_BENCH
+#include <QElapsedTimer>
+#include "benchrunner.h"
+#include "utilsbench.h"
+#endif /* QMLVIDEOBUG_BENCH */
 QSharedPointer<Utils>                                   _Utils{};           //global pointer to shared data
 
 int main(int argc, char *argv[])
 {
+#ifdef QMLVIDEOBUG_BENCH  //headless 'qmlvideobug_bench' target, see qmlvideobug_bench.pro
+    QElapsedTimer launchTimer;
+    launchTimer.start();
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM",  "offscreen");
+    if (qEnvironmentVariableIsEmpty("QT_QUICK_BACKEND"))
+        qputenv("QT_QUICK_BACKEND", "software");
+#endif /* QMLVIDEOBUG_BENCH */
+
 #ifdef Q_OS_WIN  //for parity with https://github.com/QUItCoding/qnanopainter/commit/e8563866718eb0cc147088b95250f9d3cd1e6d85
     // Select between OpenGL and OpenGL ES (Angle)
     //QCoreApplication::setAttribute(Qt::AA_UseOpenGLES);
@@ -16,6 +53,126 @@ int main(int argc, char *argv[])
 #endif
 
     QGuiApplication app(argc, argv);
+    StartupTracer startupTracer;
+    startupTracer.mark(QStringLiteral("QGuiApplication constructed"));
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({ QStringLiteral("standby-players"), QStringLiteral("Pre-roll up to <n> highlighted sources in standby players (default 0, disabled)."),
+                       QStringLiteral("n"), QStringLiteral("0") });
+    parser.addOption({ QStringLiteral("standby-memory"),  QStringLiteral("Memory budget for active plus standby players, in <MB> (default 256)."),
+                       QStringLiteral("MB"), QStringLiteral("256") });
+    parser.addOption({ QStringLiteral("max-connections"), QStringLiteral("Limit on active plus standby players streaming from the network (default 4)."),
+                       QStringLiteral("n"), QStringLiteral("4") });
+    parser.addOption({ QStringLiteral("standby-idle"),    QStringLiteral("Destroy standby players unused for <seconds> (default 120)."),
+                       QStringLiteral("seconds"), QStringLiteral("120") });
+    parser.addOption({ QStringLiteral("resolve"),         QStringLiteral("Print the first playable entry of the M3U/PLS/HLS playlist <url> (or local file) and exit."),
+                       QStringLiteral("url") });
+    parser.addOption({ QStringLiteral("cache-proxy"),     QStringLiteral("Play http(s) sources through a local range-caching proxy of <MB> (default 0, disabled)."),
+                       QStringLiteral("MB"), QStringLiteral("0") });
+    parser.addOption({ QStringLiteral("cache-proxy-port"),QStringLiteral("Loopback port for --cache-proxy (default any)."),
+                       QStringLiteral("port"), QStringLiteral("0") });
+    parser.addOption({ QStringLiteral("library"),         QStringLiteral("Index the media under <dir> into the media library, and keep it up to date (repeatable)."),
+                       QStringLiteral("dir") });
+    parser.addOption({ QStringLiteral("audio-analysis"),  QStringLiteral("Analyze the decoded audio: spectral flux, onsets and power slope (default off, see AudioAnalysis in main.qml).") });
+    parser.addOption({ QStringLiteral("trace"),           QStringLiteral("Record a binary trace, including Qt and QML messages, to <file>."),
+                       QStringLiteral("file") });
+    parser.addOption({ QStringLiteral("convert-trace"),   QStringLiteral("Print the --trace <file> as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) and exit."),
+                       QStringLiteral("file") });
+    parser.addOption({ QStringLiteral("qoe-port"),        QStringLiteral("Serve playback QoE metrics (Prometheus text) at http://127.0.0.1:<port>/metrics (default 0, disabled)."),
+                       QStringLiteral("port"), QStringLiteral("0") });
+    parser.addOption({ QStringLiteral("frame-pacing"),    QStringLiteral("Time sync, render, swap and jitter of every frame from launch, and write the last 1200 to CSV <file> on quit (see 'H' in main.qml)."),
+                       QStringLiteral("file") });
+    parser.addOption({ QStringLiteral("seek-mode"),       QStringLiteral("'exact', or 'fast': snapped to a 2s grid and done at the first frame shown (default exact)."),
+                       QStringLiteral("mode"), QStringLiteral("exact") });
+    parser.addOption({ QStringLiteral("local-server"),    QStringLiteral("Replace the sources with those of a qmlvideobug_server at <url>, e.g. http://127.0.0.1:8080 (see qmlvideobug_server.pro)."),
+                       QStringLiteral("url") });
+    parser.addOption({ QStringLiteral("no-resume"),       QStringLiteral("Start from the first source, rather than resuming the last session.") });
+    parser.addOption({ QStringLiteral("players"),         QStringLiteral("Stress test: play <n> sources at once, in a grid, tabulating frame rates, drops, threads, RSS and CPU (default 0, disabled)."),
+                       QStringLiteral("n"), QStringLiteral("0") });
+    parser.addOption({ QStringLiteral("stress-seconds"),  QStringLiteral("With --players, quit after <seconds> (default 0, run until closed)."),
+                       QStringLiteral("seconds"), QStringLiteral("0") });
+    parser.addOption({ QStringLiteral("stress-interval"), QStringLiteral("With --players, add a row to the table every <seconds> (default 5)."),
+                       QStringLiteral("seconds"), QStringLiteral("5") });
+    parser.addOption({ QStringLiteral("stress-output"),   QStringLiteral("With --players, write the table to <file> (default stdout)."),
+                       QStringLiteral("file"), QStringLiteral("-") });
+#ifndef QMLVIDEOBUG_BENCH
+    parser.addPositionalArgument(QStringLiteral("paths"), QStringLiteral("Media files, or directories, to add to the media library."), QStringLiteral("[paths...]"));
+#else
+    parser.setApplicationDescription(QStringLiteral("Measures time-to-first-frame, Loading->Buffered latency and position drift of main.qml's mediaPlayer."));
+    parser.addOption({ QStringLiteral("seconds"), QStringLiteral("Measure position drift over <n> seconds per file (default 10)."),
+                       QStringLiteral("n"), QStringLiteral("10") });
+    parser.addOption({ QStringLiteral("output"),  QStringLiteral("Write JSON results to <file> (default stdout)."),
+                       QStringLiteral("file"), QStringLiteral("-") });
+    parser.addOption({ QStringLiteral("utils"),   QStringLiteral("Instead, benchmark <n> calls of each Utils method against its former implementation, and exit."),
+                       QStringLiteral("n") });
+    parser.addPositionalArgument(QStringLiteral("files"), QStringLiteral("Local media files to play."), QStringLiteral("files..."));
+#endif /* QMLVIDEOBUG_BENCH */
+    parser.process(app);
+
+    // first, so that it sees everything that follows.
+    TraceLogger                                     traceLogger;
+    if (parser.isSet(QStringLiteral("convert-trace"))) {   // e.g. > trace.json
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        return ((TraceLogger::convertToChromeJson(parser.value(QStringLiteral("convert-trace")), &out)) ? 0 : 1);
+    }
+    if (parser.isSet(QStringLiteral("trace")))
+        traceLogger.start(parser.value(QStringLiteral("trace")));
+    qmlRegisterSingletonInstance("com.nielsmayer.TraceLogger", 1, 0,
+                                                   "TraceLogger",
+                                                   &traceLogger);
+
+    PlaylistResolver                                playlistResolver;
+    if (parser.isSet(QStringLiteral("resolve"))) {   // e.g. against local files, or a local stand-in HTTP server
+        const QUrl playlist = QUrl::fromUserInput(parser.value(QStringLiteral("resolve")),
+                                                  QDir::currentPath(), QUrl::AssumeLocalFile);
+        QObject::connect(&playlistResolver, &PlaylistResolver::resolved,
+            &app, [](const QUrl &, const QUrl &playable, const QString &error) {
+                QTextStream(stdout) << ((playable.isEmpty()) ? error : playable.toString()) << Qt::endl;
+                QCoreApplication::exit((playable.isEmpty()) ? 1 : 0);
+            });
+        if (!playlistResolver.resolve(playlist)) {
+            QTextStream(stdout) << playlist.toString() << Qt::endl;   // not a playlist: playable as is
+            return (0);
+        }
+        return (app.exec());
+    }
+    qmlRegisterSingletonInstance("com.nielsmayer.PlaylistResolver", 1, 0,
+                                                   "PlaylistResolver",
+                                                   &playlistResolver);
+
+    // read before main.qml loads, so Component.onCompleted can resume without waiting on the disk.
+    SessionJournal                                  sessionJournal;
+    sessionJournal.setResume(!parser.isSet(QStringLiteral("no-resume")));
+    qmlRegisterSingletonInstance("com.nielsmayer.SessionJournal", 1, 0,
+                                                   "SessionJournal",
+                                                   &sessionJournal);
+
+    CachingProxy                                    cachingProxy;
+    if (parser.value(QStringLiteral("cache-proxy")).toInt() > 0) {
+        cachingProxy.setBudgetMB(parser.value(QStringLiteral("cache-proxy")).toInt());
+        cachingProxy.listen(quint16(parser.value(QStringLiteral("cache-proxy-port")).toUInt()));
+    }
+    qmlRegisterSingletonInstance("com.nielsmayer.CachingProxy", 1, 0,
+                                                   "CachingProxy",
+                                                   &cachingProxy);
+
+    // declared ahead of 'engine', which destroys the pooled players (parented to main.qml's root) first.
+    PlayerPool                                      playerPool;
+    playerPool.setMaxStandby(    parser.value(QStringLiteral("standby-players")).toInt());
+    playerPool.setMemoryBudgetMB(parser.value(QStringLiteral("standby-memory")).toInt());
+    playerPool.setMaxConnections(parser.value(QStringLiteral("max-connections")).toInt());
+    playerPool.setIdleTimeout(   parser.value(QStringLiteral("standby-idle")).toInt());
+    qmlRegisterSingletonInstance("com.nielsmayer.PlayerPool", 1, 0,
+                                                   "PlayerPool",
+                                                   &playerPool);
+
+    FramePacing                                     framePacing;
+    framePacing.setOutput(parser.value(QStringLiteral("frame-pacing")));
+    qmlRegisterSingletonInstance("com.nielsmayer.FramePacing", 1, 0,
+                                                   "FramePacing",
+                                                   &framePacing);
 
     QQmlApplicationEngine engine;
     const QUrl url(QStringLiteral("qrc:/main.qml"));
@@ -25,13 +182,136 @@ int main(int argc, char *argv[])
                 QCoreApplication::exit(-1);
         }, Qt::QueuedConnection);
 
+    QObject::connect(&engine, &QQmlApplicationEngine::objectCreated,
+        &startupTracer, [url, &startupTracer](QObject *obj, const QUrl &objUrl) {
+            if (obj && url == objUrl)
+                startupTracer.start(obj);
+        });
+    QObject::connect(&engine, &QQmlApplicationEngine::objectCreated,
+        &framePacing, [url, &framePacing](QObject *obj, const QUrl &objUrl) {
+            if (obj && url == objUrl)
+                framePacing.setWindow(qobject_cast<QQuickWindow *>(obj));
+        });
+    qmlRegisterSingletonInstance("com.nielsmayer.StartupTracer", 1, 0,
+                                                   "StartupTracer",
+                                                   &startupTracer);
+
     Utils                                           utils;
     qmlRegisterSingletonInstance("com.nielsmayer.Utils", 1, 0,
                                                    "Utils",
                                                    &utils);
     _Utils.reset(                                  &utils,
                                                    &utilsDeleter);
+
+    // --players=N: the grid in main.qml plays the media files on the command line, else 'sourcesModel'.
+    StressMonitor                                   stressMonitor;
+    const int                                       stressPlayers = parser.value(QStringLiteral("players")).toInt();
+    QList<QUrl>                                     stressFiles;
+    if (stressPlayers > 0)      // probing every argument blocks the GUI thread: only for a stress test
+        for (const QUrl &file : utils.argv())
+            if (MediaProbe::isMedia(file.toLocalFile()))
+                stressFiles.append(file);
+    stressMonitor.configure(stressPlayers,
+                            stressFiles,
+                            parser.value(QStringLiteral("stress-seconds")).toInt(),
+                            parser.value(QStringLiteral("stress-interval")).toInt(),
+                            parser.value(QStringLiteral("stress-output")));
+    qmlRegisterSingletonInstance("com.nielsmayer.StressMonitor", 1, 0,
+                                                   "StressMonitor",
+                                                   &stressMonitor);
+#ifdef QMLVIDEOBUG_BENCH
+    if (parser.isSet(QStringLiteral("utils")))       // no media, nor QML, needed
+        return ((UtilsBench::run(utils,
+                                 parser.value(QStringLiteral("utils")).toInt(),
+                                 parser.value(QStringLiteral("output")))) ? 0 : 1);
+#endif /* QMLVIDEOBUG_BENCH */
+
+    PlaybackClock                                   playbackClock;
+    qmlRegisterSingletonInstance("com.nielsmayer.PlaybackClock", 1, 0,
+                                                   "PlaybackClock",
+                                                   &playbackClock);
+
+    FrameInspector                                  frameInspector;
+    qmlRegisterSingletonInstance("com.nielsmayer.FrameInspector", 1, 0,
+                                                   "FrameInspector",
+                                                   &frameInspector);
+
+    AudioAnalysis                                   audioAnalysis;
+    audioAnalysis.setRequested(parser.isSet(QStringLiteral("audio-analysis")));
+    qmlRegisterSingletonInstance("com.nielsmayer.AudioAnalysis", 1, 0,
+                                                   "AudioAnalysis",
+                                                   &audioAnalysis);
+
+    QoEMonitor                                      qoeMonitor;
+    if (parser.value(QStringLiteral("qoe-port")).toInt() > 0)
+        qoeMonitor.listen(quint16(parser.value(QStringLiteral("qoe-port")).toUInt()));
+    qmlRegisterSingletonInstance("com.nielsmayer.QoEMonitor", 1, 0,
+                                                   "QoEMonitor",
+                                                   &qoeMonitor);
+
+    CoverArtCache                                   coverArtCache;
+    qmlRegisterSingletonInstance("com.nielsmayer.CoverArtCache", 1, 0,
+                                                   "CoverArtCache",
+                                                   &coverArtCache);
+    engine.addImageProvider(QLatin1String(CoverArtCache::providerId()),
+                            new CoverArtImageProvider(&coverArtCache));   //engine takes ownership
+
+    SeekScheduler                                   seekScheduler;
+    seekScheduler.setMode((parser.value(QStringLiteral("seek-mode")) == QLatin1String("fast"))
+                          ? SeekScheduler::Fast : SeekScheduler::Exact);
+    qmlRegisterSingletonInstance("com.nielsmayer.SeekScheduler", 1, 0,
+                                                   "SeekScheduler",
+                                                   &seekScheduler);
+
+    Filmstrip                                       filmstrip;
+    filmstrip.setCachingProxy(&cachingProxy);
+    qmlRegisterSingletonInstance("com.nielsmayer.Filmstrip", 1, 0,
+                                                   "Filmstrip",
+                                                   &filmstrip);
+    engine.addImageProvider(QLatin1String(Filmstrip::providerId()),
+                            new FilmstripImageProvider(&filmstrip));      //engine takes ownership
+
+    // scanned on its own pool; paths from the command line are checked there too, rather than by Utils::argv().
+    MediaLibrary                                    mediaLibrary;
+    for (const QString &directory : parser.values(QStringLiteral("library")))
+        mediaLibrary.addRoot(directory);
+#ifndef QMLVIDEOBUG_BENCH
+    mediaLibrary.addPaths(parser.positionalArguments());
+#endif /* QMLVIDEOBUG_BENCH */
+    qmlRegisterSingletonInstance("com.nielsmayer.MediaLibrary", 1, 0,
+                                                   "MediaLibrary",
+                                                   &mediaLibrary);
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    qmlRegisterType<MediaMetadataModel>("com.nielsmayer.MediaMetadataModel", 1, 0,
+                                                   "MediaMetadataModel");
+#endif /* QT_VERSION... */
+
+    QVariantMap                                     initialProperties;   //of main.qml
+    initialProperties.insert(QStringLiteral("localServer"), parser.value(QStringLiteral("local-server")));
+
+#ifdef QMLVIDEOBUG_BENCH
+    const QList<QUrl> files = utils.argv();
+    if (files.isEmpty()) {
+        qWarning() << "qmlvideobug_bench: no local media files given.";
+        parser.showHelp(2);
+    }
+    BenchRunner bench(files,
+                      parser.value(QStringLiteral("seconds")).toInt(),
+                      parser.value(QStringLiteral("output")),
+                      launchTimer);
+    initialProperties.insert(QStringLiteral("autoPlayAtLaunch"), false);
+    QObject::connect(&engine, &QQmlApplicationEngine::objectCreated,
+        &bench, [url, &bench](QObject *obj, const QUrl &objUrl) {
+            if (obj && url == objUrl)
+                bench.start(obj);
+        }, Qt::QueuedConnection);
+#endif /* QMLVIDEOBUG_BENCH */
+
+    engine.setInitialProperties(initialProperties);
+    startupTracer.mark(QStringLiteral("engine.load() begin"));
     engine.load(url);
+    startupTracer.mark(QStringLiteral("engine.load() end"));
 
     return app.exec();
 }
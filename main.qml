@@ -17,9 +17,25 @@ import QtQuick 2.12;
 import QtQml.Models 2.12;      //ListModel, ListElement
 import QtQuick.Controls 2.12;  //ApplicationWindow, ToolBar, Button, Text, etc.
 import QtQuick.Layouts 1.12;   //RowLayout and Layout.fillWidth settings
+import QtQuick.Window 2.12;    //Window.Hidden, Window.Minimized for PlaybackClock.active
 //import QtMultimedia;      //MediaPlayer, VideoOutput, AudioOutput, etc.
 
 import com.nielsmayer.Utils       1.0;  //for Utils.getUiDuration(), Utils.formatDuration()
+import com.nielsmayer.PlaybackClock 1.0; //interpolated playback position, replaces 20ms Timer{} polling
+import com.nielsmayer.FrameInspector 1.0; //detects blank/corrupt decoded video frames
+import com.nielsmayer.PlayerPool 1.0;    //pre-rolled standby players, see --standby-players
+import com.nielsmayer.PlaylistResolver 1.0; //M3U/PLS/HLS-master playlists resolved before reaching the player
+import com.nielsmayer.CachingProxy 1.0;  //local range-caching http proxy, see --cache-proxy
+import com.nielsmayer.MediaLibrary 1.0;  //indexed local media, see --library
+import com.nielsmayer.AudioAnalysis 1.0; //spectral flux, onsets & power slope of the decoded audio, see --audio-analysis
+import com.nielsmayer.StressMonitor 1.0; //N players at once, see --players
+import com.nielsmayer.SessionJournal 1.0; //resumes the last session, and each source where it was left
+import com.nielsmayer.TraceLogger 1.0;   //binary tracing, see --trace
+import com.nielsmayer.FramePacing 1.0;  //sync/render/swap times and jitter of each frame, see --frame-pacing
+import com.nielsmayer.Filmstrip 1.0;    //seek-preview thumbnails, in a sprite sheet
+import com.nielsmayer.SeekScheduler 1.0; //coalesced seeks, one in flight, see --seek-mode
+import com.nielsmayer.QoEMonitor 1.0;    //startup latency, stalls and errors per source, see --qoe-port
+import com.nielsmayer.StartupTracer 1.0; //launch phases up to the first rendered frame
 
 ApplicationWindow {
     id:                              app;
@@ -62,10 +78,10 @@ ApplicationWindow {
             source: "https://worldwidefm.out.airtime.pro:8443/worldwidefm_a"}  //supplying this stream causes it to hang uninterruptibly.
         ListElement {
             title: "Media Monarchy M3U";
-            source: "https://www.mediamonarchy.com/mediamonarchy.m3u"} //--> "Error: 1... Internal data stream error." output to message area, stdout: 'qt.multimedia.player: Warning: "No decoder available for type 'text/uri-list'."'
+            source: "https://www.mediamonarchy.com/mediamonarchy.m3u"} //--> "Error: 1... Internal data stream error." output to message area, stdout: 'qt.multimedia.player: Warning: "No decoder available for type 'text/uri-list'."' -- now resolved by PlaylistResolver before reaching the player.
         ListElement {
             title: "Media Monarchy PLS";
-            source: "https<://www.mediamonarchy.com/mediamonarchy.pls"} //--> "MediaPlayer -- invalid media!" output to message area. Nothing to stdout.
+            source: "https://www.mediamonarchy.com/mediamonarchy.pls"} //--> was "MediaPlayer -- invalid media!" output to message area (with a typo'd "https<:" url). Now resolved by PlaylistResolver.
         ListElement {
             title: "BBC Radio One";
             source: "https://a.files.bbci.co.uk/media/live/manifesto/audio/simulcast/hls/nonuk/sbr_low/ak/bbc_radio_one.m3u8"}
@@ -92,14 +108,15 @@ ApplicationWindow {
             source: "https://a.files.bbci.co.uk/media/live/manifesto/audio/simulcast/hls/nonuk/sbr_low/ak/bbc_6music.m3u8"}
     }
 
-    //Depending on which version of Qt we run on, bind an instance of Qt MediaPlayer6 or MediaPlayer5 to 'mediaPlayer'
-    property var mediaPlayer: (Utils.qtVersionMajor() === 6)
-                              ? Qt.createQmlObject(
-                                    'import QtQuick; MediaPlayer6 { videoOutput: videoRender; }',
-                                    app)
-                              : Qt.createQmlObject(
-                                    'import QtQuick 2.2; MediaPlayer5 { }',
-                                    app);
+    //Depending on which version of Qt we run on, bind an instance of Qt MediaPlayer6 or MediaPlayer5 to 'mediaPlayer'.
+    //These are file-based components, so they are compiled ahead of time along with the rest of the
+    //qrc rather than parsed from a string by Qt.createQmlObject() on the critical path to first frame.
+    readonly property Component mediaPlayerComponent:
+        Qt.createComponent((Utils.qtVersionMajor() === 6) ? "MediaPlayer6.qml" : "MediaPlayer5.qml");
+    //The initially created player; adopted by PlayerPool, which thereafter provides 'mediaPlayer'
+    //and, for Qt6, assigns the active player's 'videoOutput'.
+    readonly property var primaryPlayer: mediaPlayerComponent.createObject(app);
+    property var mediaPlayer: PlayerPool.activePlayer || primaryPlayer;
 
     property string mediaFolder:    sourcesModel.get(sourceSelector.currentIndex).source;
     property string mediaBaseName: sourcesModel.get(sourceSelector.currentIndex).title;
@@ -134,11 +151,16 @@ ApplicationWindow {
                 textRole: "title";
                 model: sourcesModel;
                 Layout.fillWidth: true;
+                //pre-roll the highlighted (hovered or arrowed-to) entry in a standby player, if enabled and
+                //there's room; playlists are instead resolved ahead of time, into PlaylistResolver's cache.
+                onHighlighted: function (index) {
+                    const source = sourcesModel.get(index).source;
+                    if (PlayerPool.hasRoomFor(CachingProxy.proxied(source)) && !PlaylistResolver.resolve(source))
+                        PlayerPool.preload(CachingProxy.proxied(source));
+                }
                 onActivated: function (index) {
                     Qt.callLater(function () {
-                        mediaPlayer.reset();
-                        mediaPlayer.source = sourcesModel.get(index).source;
-                        mediaPlayer.play();
+                        openSource(sourcesModel.get(index).source);
                     });
                 }
               }
@@ -147,6 +169,7 @@ ApplicationWindow {
 
     footer: Label {
         id:                  messageArea;
+        text:                (PlaybackClock.label !== "") ? PlaybackClock.label : messageText;
         elide:               Label.ElideRight;
         horizontalAlignment: Qt.AlignHCenter;
         verticalAlignment:   Qt.AlignVCenter;
@@ -161,39 +184,245 @@ ApplicationWindow {
         implicitWidth:        app.width - Qt.application.font.pixelSize;
         implicitHeight:       app.height - Qt.application.font.pixelSize;
 
-//        Image {
-//            source:       mediaPlayer.metaDataCoverArtImage
-//            x:            Qt.application.font.pixelSize/2;
-//            y:            Qt.application.font.pixelSize/2;
-//            width:        app.width - Qt.application.font.pixelSize;
-//            height:       app.height - Qt.application.font.pixelSize;
-//            z:1
-//            onStatusChanged: console.log("image status=" + image.status)
-//        }
+        //cover art for audio-only media, decoded & downscaled to 'sourceSize' off the GUI thread (see coverartcache.h)
+        Image {
+            id:           coverArt;
+            source:       mediaPlayer.coverArtUrl;
+            anchors.fill: parent;
+            sourceSize:   Qt.size(width, height);
+            fillMode:     Image.PreserveAspectFit;
+            asynchronous: true;
+            visible:      !mediaPlayer.hasVideo && (status === Image.Ready);
+            z:            1;
+            scale:        1.0 + ((want_beat_animation) ? 0.04 * AudioAnalysis.beat : 0.0);
+            onStatusChanged: if (status === Image.Error)
+                                 TraceLogger.message("CoverArtCache", "image error, source=" + source);
+        }
+
+        Loader {
+            id:           videoLoader;
+            anchors.fill: parent;
+            source:       (Utils.qtVersionMajor() === 6) ? "VideoOutput6.qml" : "VideoOutput5.qml";
+        }
+
+        //--players=N: a grid of N players, each with its own VideoOutput, measured by StressMonitor.
+        //Local media files from the command line are played if given, else the entries of 'sourcesModel';
+        //each loops, and all but the first are muted.
+        Grid {
+            id:           stressGrid;
+            anchors.fill: parent;
+            visible:      StressMonitor.active;
+            z:            2;
+            columns:      StressMonitor.columns;
+
+            Repeater {
+                model: StressMonitor.players;
+
+                delegate: Item {
+                    id:     tile;
+                    width:  stressGrid.width / stressGrid.columns;
+                    height: stressGrid.height / Math.ceil(StressMonitor.players / stressGrid.columns);
+
+                    property var    player:  null;
+                    property string pending: "";        //the playlist being resolved for this tile, "" if none.
+
+                    Loader {
+                        id:           tileOutput;
+                        anchors.fill: parent;
+                        onLoaded:     if (Utils.qtVersionMajor() === 6)
+                                          tile.player.videoOutput = item;
+                    }
+
+                    Label {
+                        id:      tileLabel;
+                        anchors { left: parent.left; top: parent.top; margins: 2; }
+                        text:    "#" + index;
+                        color:   "white";
+                        style:   Text.Outline;
+                    }
+
+                    Connections {
+                        target: StressMonitor;
+                        function onSampled() {
+                            tileLabel.text = "#" + index + "  " + StressMonitor.fps(index).toFixed(1) + " fps";
+                        }
+                    }
+
+                    Connections {
+                        target: PlaylistResolver;
+                        function onResolved(url, playable, error) {
+                            if (("" + url) !== tile.pending)
+                                return;
+                            tile.pending = "";
+                            if (("" + playable) !== "")
+                                tile.play(playable);
+                        }
+                    }
+
+                    //Qt5's VideoOutput names its player 'source': passed as an initial property, so it's
+                    //never bound to app.mediaPlayer, even briefly.
+                    Component.onCompleted: {
+                        player = mediaPlayerComponent.createObject(tile);
+                        player.volume = (index === 0) ? 1.0 : 0.0;
+                        player.mediaEnded.connect(function () { player.stop(); player.play(); });
+                        if (Utils.qtVersionMajor() === 6)
+                            tileOutput.setSource("VideoOutput6.qml");
+                        else
+                            tileOutput.setSource("VideoOutput5.qml", { "source": player });
+                        Qt.callLater(open);     //after app's Component.onCompleted, which may swap 'sourcesModel' (see --local-server)
+                    }
+
+                    function open() {
+                        const local  = "" + StressMonitor.sourceFor(index);
+                        const source = (local !== "") ? local : sourcesModel.get(index % sourcesModel.count).source;
+                        StressMonitor.addPlayer(index, player, source);
+                        if (PlaylistResolver.resolve(source))
+                            pending = "" + source;
+                        else
+                            play(source);
+                    }
+
+                    function play(source) {
+                        player.source = CachingProxy.proxied(source);
+                        player.play();
+                    }
+                }
+            }
+        }
+
+        //frame pacing HUD, toggled by 'H': percentiles over the last 1200 frames, see framepacing.h.
+        Rectangle {
+            id:           pacingHud;
+            anchors { right: parent.right; top: parent.top; margins: 4; }
+            width:        pacingText.implicitWidth + 12;
+            height:       pacingText.implicitHeight + 8;
+            visible:      false;
+            z:            3;
+            color:        "#b0000000";
+            radius:       4;
+
+            Text {
+                id:               pacingText;
+                anchors.centerIn: parent;
+                color:            "white";
+                font.family:      "monospace";
+                text:             "frames  " + FramePacing.frames + "  " + FramePacing.fps.toFixed(1) + " fps"
+                                  + "  late " + FramePacing.lateFrames
+                                  + "\nsync    " + FramePacing.syncMs.toFixed(2)   + "  p99 " + FramePacing.syncP99Ms.toFixed(2) + " ms"
+                                  + "\nrender  " + FramePacing.renderMs.toFixed(2) + "  p99 " + FramePacing.renderP99Ms.toFixed(2) + " ms"
+                                  + "\nswap    " + FramePacing.swapMs.toFixed(2)   + "  p99 " + FramePacing.swapP99Ms.toFixed(2) + " ms"
+                                  + "\ninterval " + FramePacing.intervalMs.toFixed(2) + " p99 " + FramePacing.intervalP99Ms.toFixed(2) + " ms"
+                                  + "\njitter  p50 " + FramePacing.jitterP50Ms.toFixed(2) + "  p90 " + FramePacing.jitterP90Ms.toFixed(2)
+                                  + "  p99 " + FramePacing.jitterP99Ms.toFixed(2) + " ms"
+                                  + "\nvideo   " + FramePacing.videoFps.toFixed(1) + " fps  unshown " + FramePacing.videoUnshown
+                                  + "\n        to swap " + FramePacing.videoLatencyMs.toFixed(2) + "  p99 " + FramePacing.videoLatencyP99Ms.toFixed(2) + " ms";
+            }
+        }
+
+        //preview of where seekRelative() is headed: the thumbnail nearest it in Filmstrip's sprite sheet, which is a single
+        //texture scrolled within a thumbnail-sized clip, so moving between thumbnails loads nothing.
+        Item {
+            id:           seekPreview;
+            anchors { horizontalCenter: parent.horizontalCenter; bottom: parent.bottom; bottomMargin: 8; }
+            width:        Filmstrip.thumbnailSize.width;
+            height:       Filmstrip.thumbnailSize.height + previewTime.implicitHeight;
+            visible:      false;
+            z:            3;
+
+            property real position: 0;
+            readonly property rect frame: (Filmstrip.count >= 0) ? Filmstrip.rectFor(position) : Qt.rect(0, 0, 0, 0);
+
+            Item {
+                width:   parent.width;
+                height:  Filmstrip.thumbnailSize.height;
+                clip:    true;
+                visible: (seekPreview.frame.width > 0);
+                Image {
+                    source:       Filmstrip.sheetUrl;
+                    x:            - seekPreview.frame.x;
+                    y:            - seekPreview.frame.y;
+                    asynchronous: true;
+                    cache:        false;
+                }
+            }
+            Label {
+                id:      previewTime;
+                anchors { horizontalCenter: parent.horizontalCenter; bottom: parent.bottom; }
+                text:    Utils.formatDuration(seekPreview.position);
+                color:   "white";
+                style:   Text.Outline;
+            }
+            Timer {
+                id:          previewTimer;
+                interval:    1500;
+                onTriggered: seekPreview.visible = false;
+            }
+
+            function show(pos) {
+                position = pos;
+                visible  = true;
+                previewTimer.restart();
+            }
+        }
 
       focus:                       true;
 
       Keys.onSpacePressed:         play_pause();
-      Keys.onUpPressed:            seek(- 10000)
-      Keys.onDownPressed:          seek(10000);
-      Keys.onLeftPressed:          seek(- 1000);
-      Keys.onRightPressed:         seek(1000);
+      Keys.onUpPressed:            seekRelative(- 10000);
+      Keys.onDownPressed:          seekRelative(10000);
+      Keys.onLeftPressed:          seekRelative(- 1000);
+      Keys.onRightPressed:         seekRelative(1000);
+      Keys.onPressed: function (event) {
+          if ((event.key === Qt.Key_L) && (MediaLibrary.totalCount > 0)) {
+              libraryDrawer.open();
+              event.accepted = true;
+          }
+          else if (event.key === Qt.Key_H) {
+              pacingHud.visible = !pacingHud.visible;
+              event.accepted = true;
+          }
+      }
 
       TapHandler {  onTapped: { console.log("item tapped"); play_pause(); } }
     }
 
+    //local media indexed by MediaLibrary (--library=DIR, or paths on the command line), opened with 'L'.
+    //rows are fetched from the index lazily, as the list is scrolled.
+    Drawer {
+        id:          libraryDrawer;
+        edge:        Qt.LeftEdge;
+        width:       Math.min(app.width * 0.6, 420);
+        height:      app.height;
+        interactive: (MediaLibrary.totalCount > 0);
+        onClosed:    contentArea.forceActiveFocus();
+
+        ListView {
+            anchors.fill: parent;
+            clip:         true;
+            model:        MediaLibrary;
+            ScrollIndicator.vertical: ScrollIndicator { }
+            delegate: ItemDelegate {
+                width:     ListView.view.width;
+                text:      (model.duration > 0)
+                           ? model.name + "  " + Utils.formatDuration(model.duration)
+                           : model.name;
+                onClicked: {
+                    libraryDrawer.close();
+                    openSource(model.url);
+                }
+            }
+        }
+    }
+
     // For Qt6, due to gratuitous incompatible syntax and API changes,
-    // must dynamically load version-dependent VidepOutput
-    // (associated MediaPlayer is similarly dynloaded as topwin.mediaPlayer (see main_qqc2_sidepanel.qml)
-    property var videoRender: (Utils.qtVersionMajor() === 6)
-                ? Qt.createQmlObject(
-                      'import QtQuick; import QtMultimedia; VideoOutput { anchors.fill: contentArea; }',
-                      contentArea)
-                : Qt.createQmlObject(
-                      'import QtQuick 2.2; import QtMultimedia 5.6; VideoOutput { source:mediaPlayer; anchors.fill: contentArea; }',
-                      contentArea);
+    // must load version-dependent VideoOutput5.qml or VideoOutput6.qml (see 'videoLoader' in contentArea).
+    // The associated MediaPlayer is similarly loaded from a version-dependent component as 'mediaPlayer'.
+    readonly property var videoRender: videoLoader.item;
+    Binding { target: PlayerPool; property: "videoOutput"; value: videoRender; }
 
     onClosing: function(close) { 
+        recordSession();
+        SessionJournal.flush();
     	if (mediaPlayer.is_playing) {
             console.log("DEBUG: onClosing -- stopping media player & persisting current playback session...");
             mediaPlayer.stop();
@@ -207,53 +436,200 @@ ApplicationWindow {
     }
 
 
-    //Use Timer{} to substitute for missing/removed functionality from Qt5 MediaPlayer -- notifyInterval: 20
-    // Note when both timers are set we see that mediaplayer implicitly runs w/ notifyInterval at 100
-    // and there's about 5 timer notifies per property notity and it correctly seems to support a
-    // monotinically increasing position (.00 .02 .04 .06 .08, etc) at each subinterval....
-    //    qml: position = 11.2990 seconds
-    //    qml: tposition = 11.3000 seconds
-    //    qml: tposition = 11.3200 seconds
-    //    qml: tposition = 11.3400 seconds
-    //    qml: tposition = 11.3600 seconds
-    //    qml: tposition = 11.3800 seconds
-    //    qml: position = 11.4000 seconds
-    //    qml: tposition = 11.4010 seconds
-    //    qml: tposition = 11.4200 seconds
-    //    qml: tposition = 11.4410 seconds
-    //    qml: tposition = 11.4610 seconds
-    //    qml: tposition = 11.4810 seconds
-    //    qml: position = 11.5000 seconds
-
-    // works even for a 10ms timer:
-    //    qml: position = 3.9710 seconds
-    //    qml: tposition = 3.9740 seconds
-    //    qml: tposition = 3.9840 seconds
-    //    qml: tposition = 3.9940 seconds
-    //    qml: tposition = 4.0040 seconds
-    //    qml: tposition = 4.0140 seconds
-    //    qml: tposition = 4.0240 seconds
-    //    qml: tposition = 4.0340 seconds
-    //    qml: tposition = 4.0440 seconds
-    //    qml: tposition = 4.0530 seconds
-    //    qml: tposition = 4.0640 seconds
-    Timer {
-        interval:    20; //update at 50fps
-        repeat:      true;
-        running:     mediaPlayer.is_playing;
-        onTriggered: displayPlaybackInfo();
+    //PlaybackClock substitutes for missing/removed functionality from Qt5 MediaPlayer -- notifyInterval: 20
+    //Previously a 20ms Timer{} called displayPlaybackInfo() 50 times a second, rebuilding the footer
+    //even when nothing visible changed. MediaPlayer notifies 'position' about every 100ms; PlaybackClock
+    //interpolates between notifications with a monotonic clock (e.g. 11.2990 11.3200 11.3400 ... 11.4000)
+    //and only emits displayPositionChanged() when the displayed value changes. The footer binds to its
+    //'label', formatted in C++, so nothing is rebuilt in JavaScript as the position advances. It stops
+    //ticking entirely when paused, or when the window is hidden/minimized or the application is suspended.
+    Binding { target: PlaybackClock; property: "playerPosition"; value: mediaPlayer.position; }
+    Binding { target: PlaybackClock; property: "duration";       value: mediaPlayer.duration; }
+    Binding { target: PlaybackClock; property: "playing";        value: mediaPlayer.is_playing; }
+    Binding { target: PlaybackClock; property: "playbackRate";   value: mediaPlayer.playbackRate; }
+    Binding { target: PlaybackClock; property: "active";
+              value: (   (app.visibility !== Window.Hidden)
+                      && (app.visibility !== Window.Minimized)
+                      && (Qt.application.state !== Qt.ApplicationSuspended)
+                      && (Qt.application.state !== Qt.ApplicationHidden)); }
+
+    //analyses of the decoded audio; AudioAnalysis taps the player only while any of these is wanted.
+    property bool want_beat_animation:                    AudioAnalysis.requested;
+    property bool want_mzspectralflux_thresholdfunction:  AudioAnalysis.requested;
+    property bool want_mzspectralflux_spectralfluxonsets: AudioAnalysis.requested;
+    property bool want_mzpowercurve_smoothpowerslope:     AudioAnalysis.requested;
+    property bool want_mzpowercurve_powerslopeproduct:    AudioAnalysis.requested;
+    Binding {
+        target:   AudioAnalysis;
+        property: "enabled";
+        value:    (   want_beat_animation
+                   || want_mzspectralflux_thresholdfunction
+                   || want_mzspectralflux_spectralfluxonsets
+                   || want_mzpowercurve_smoothpowerslope
+                   || want_mzpowercurve_powerslopeproduct);
+    }
+
+    //false for the headless 'qmlvideobug_bench' target, which supplies its own media (see benchrunner.cpp)
+    //and in --players mode, which plays its own grid of players instead.
+    property bool autoPlayAtLaunch: !StressMonitor.active;
+
+    //--local-server=URL: the base url of a qmlvideobug_server (see qmlvideobug_server.pro), whose
+    //endpoints replace the entries of 'sourcesModel', so streams can be load-tested offline.
+    property string localServer: "";
+
+    function useLocalServer(base) {
+        if (base.endsWith("/"))
+            base = base.slice(0, -1);
+        sourcesModel.clear();
+        sourcesModel.append({ title: "Local MP4 (Range)",  source: base + "/media/default.mp4" });
+        sourcesModel.append({ title: "Local Icecast MP3",  source: base + "/stream/silence.mp3" });
+        sourcesModel.append({ title: "Local HLS Live",     source: base + "/hls/live.m3u8" });
+        sourcesModel.append({ title: "Local HLS Master",   source: base + "/hls/master.m3u8" });
+        sourcesModel.append({ title: "Local HLS VOD",      source: base + "/hls/vod.m3u8" });
+        sourcesModel.append({ title: "Local M3U",          source: base + "/playlist.m3u" });
+        sourcesModel.append({ title: "Local PLS",          source: base + "/playlist.pls" });
+        sourceSelector.currentIndex = 0;
     }
 
     //at start-up, automatically load and play the default selection in 'sourceSelector',
     //which is the first entry in 'sourcesModel'.
     Component.onCompleted: {
-        mediaPlayer.reset();
-        mediaPlayer.source = sourcesModel.get(sourceSelector.currentIndex).source;
-        mediaPlayer.play();
+        if (localServer !== "")
+            useLocalServer(localServer);
+        PlayerPool.component = mediaPlayerComponent;
+        PlayerPool.adopt(primaryPlayer);
+        if (autoPlayAtLaunch)
+            resumeSession();
         contentArea.forceActiveFocus();
+        FrameInspector.attach(mediaPlayer);
+        AudioAnalysis.attach(mediaPlayer);
+        QoEMonitor.attach(mediaPlayer);
+        FramePacing.attach(mediaPlayer);
+        Filmstrip.attach(mediaPlayer);
+        SeekScheduler.attach(mediaPlayer);
+    }
+
+    onMediaPlayerChanged: {
+        FrameInspector.attach(mediaPlayer);
+        AudioAnalysis.attach(mediaPlayer);
+        QoEMonitor.attach(mediaPlayer);
+        FramePacing.attach(mediaPlayer);
+        Filmstrip.attach(mediaPlayer);
+        SeekScheduler.attach(mediaPlayer);
     }
 
-    function message(txt)  { messageArea.text = txt }
+    //frames are timed while the HUD is shown, and throughout with --frame-pacing=FILE.
+    Binding { target: FramePacing; property: "enabled"; value: pacingHud.visible || (FramePacing.output !== ""); }
+
+    //the footer, unless PlaybackClock's 'label' shows the playback position (see displayPlaybackInfo()).
+    //a message shown once media has loaded gives way to the position again after messageTimer.interval.
+    property string messageText: "";
+    function message(txt) {
+        PlaybackClock.prefix = "";
+        PlaybackClock.suffix = "";
+        messageText = txt;
+        if (mediaPlayer.mediaInfo)
+            messageTimer.restart();
+    }
+    Timer {
+        id:          messageTimer;
+        interval:    4000;
+        onTriggered: displayPlaybackInfo();
+    }
+
+    //the source last passed to openSource(), as recorded in SessionJournal.
+    property string currentSource: "";
+    //the position to resume 'currentSource' at, until the player has loaded it.
+    property real   pendingResume: 0;
+
+    //open the source of the previous session (unless --no-resume, or it wasn't of --local-server), at its rate and volume, else 'sourcesModel' entry 0.
+    function resumeSession() {
+        const last = (SessionJournal.resume && SessionJournal.lastSource.startsWith(localServer)) ? SessionJournal.lastSource : "";
+        if (last === "") {
+            openSource(sourcesModel.get(sourceSelector.currentIndex).source);
+            return;
+        }
+        for (var i = 0; i < sourcesModel.count; i++) {
+            if (sourcesModel.get(i).source === last) {
+                sourceSelector.currentIndex = i;
+                break;
+            }
+        }
+        speedSlider.value  = SessionJournal.lastRate;
+        mediaPlayer.volume = SessionJournal.lastVolume;
+        openSource(last);
+    }
+
+    //note where 'currentSource' is at; cheap enough for every positionChanged, as SessionJournal writes
+    //in the background. Media played to the end is forgotten, so it starts over next time.
+    function recordSession() {
+        if (currentSource === "")
+            return;
+        if ((mediaPlayer.duration > 0) && (mediaPlayer.position >= mediaPlayer.duration - 1000))
+            SessionJournal.forget(currentSource);
+        else
+            SessionJournal.record(currentSource,
+                                  (pendingResume > 0)
+                                  ? pendingResume
+                                  : (mediaPlayer.duration > 0) ? mediaPlayer.position : 0,  //live streams have no position to resume
+                                  mediaPlayer.playbackRate,
+                                  mediaPlayer.volume);
+    }
+
+    //seek to the recorded position before play(); repeated once loaded, for backends that ignore seeks before then.
+    function resumePending() {
+        if (pendingResume > 0)
+            seek(pendingResume);
+    }
+
+    //the playlist being resolved for openSource(), "" if none.
+    property string pendingPlaylist: "";
+
+    //play 'source': swap in a pre-rolled standby player for it if there is one, otherwise load it, first
+    //resolving M3U/PLS playlists (which the backends can't play) to their first playable entry.
+    //http(s) media is played through CachingProxy when enabled (otherwise proxied() returns it unchanged).
+    function openSource(source) {
+        recordSession();
+        PlaybackClock.reset();
+        pendingPlaylist = "";
+        currentSource   = "" + source;
+        QoEMonitor.begin(currentSource);
+        Filmstrip.cancel();
+        pendingResume   = (SessionJournal.resume) ? SessionJournal.positionFor(currentSource) : 0;
+        if (PlayerPool.activate(CachingProxy.proxied(source))) {
+            resumePending();
+            mediaPlayer.play();
+            return;
+        }
+        mediaPlayer.reset();
+        if (PlaylistResolver.resolve(source)) {
+            pendingPlaylist = "" + source;
+            message(qsTr("... Resolving Playlist ..."));
+        }
+        else {
+            mediaPlayer.source = CachingProxy.proxied(source);
+            resumePending();
+            mediaPlayer.play();
+        }
+    }
+
+    Connections {
+        target: PlaylistResolver;
+
+        function onResolved(url, playable, error) {
+            if (("" + url) !== pendingPlaylist)        //superseded, or just prefetched by sourceSelector.onHighlighted
+                return;
+            pendingPlaylist = "";
+            if (("" + playable) === "") {
+                message(qsTr("Playlist -- %1").arg(error));
+                return;
+            }
+            TraceLogger.message("PlaylistResolver", url + " --> " + playable);
+            mediaPlayer.source = CachingProxy.proxied(playable);
+            resumePending();
+            mediaPlayer.play();
+        }
+    }
 
     function play_pause() {
         if (mediaPlayer.is_playing)
@@ -262,35 +638,32 @@ ApplicationWindow {
             mediaPlayer.play();
     }
 
+    //called as the playing state or media info changes; the position within the footer is updated by PlaybackClock.
     function displayPlaybackInfo() {
-        message((mediaPlayer.mediaInfo /*|| (mediaPlayer.is_playing && (mediaPlayer.position>0))*/) //replace initial "loading video" with metadata from media, once video loaded.
-                    ? ((mediaPlayer.is_playing)
-                       ? qsTr("Playing: ")
-                       : qsTr("Paused: "))
-                      + mediaPlayer.mediaInfo
-                      + " -- "
-                      + (mediaPlayer.position/1000).toLocaleString(locale, 'f', 4) + " seconds"
-                    : ((mediaPlayer.hasVideo)       //mediaPlayer.hasVideo isn't set during loading, so use file extension to determine if video
-                       ? qsTr("... Loading Video ...")
-                       : qsTr("... Loading Media ...")));
+        if (mediaPlayer.mediaInfo) { //replace initial "loading video" with metadata from media, once video loaded.
+            PlaybackClock.prefix = ((mediaPlayer.is_playing)
+                                    ? qsTr("Playing: ")
+                                    : qsTr("Paused: "))
+                                   + mediaPlayer.mediaInfo
+                                   + " -- ";
+            PlaybackClock.suffix = " seconds";
+        }
+        else
+            message((mediaPlayer.hasVideo)       //mediaPlayer.hasVideo isn't set during loading, so use file extension to determine if video
+                    ? qsTr("... Loading Video ...")
+                    : qsTr("... Loading Media ..."));
     }
 
-    //wrap/replace mediaPlayer.seek() which appears to be missing for Qt6. In addition to mediaPlayer.seek() functionality,
-    //app.seek() forces GUI qnanopainteritem elements such as 'title, 'details' and 'ruler' to update the displayed position.
-    property var seek: (Utils.qtVersionMajor() === 6)
-                       ? function (pos) {
-                           mediaPositionUpdate(pos);
-                           mediaPlayer.position = pos; //Qt6 MediaPlayer missing seek() but allows mediaPlayer.position to be set directly
-                       }
-                       : function (pos) {
-                           mediaPositionUpdate(pos);
-                           mediaPlayer.seek(pos);    //Qt5 mediaPlayer.position is readonly, but seek() allows setting the position.
-                       };
-
-
-//    readonly property int   _CURSOR_RESOLUTION_MILLISECONDS_:                   500; //update ruler cursor every 0.5seconds
-    function mediaPositionUpdate(pos) {
-//         ruler.position = _CURSOR_RESOLUTION_MILLISECONDS_ * Math.round(pos / _CURSOR_RESOLUTION_MILLISECONDS_); //unlike title.position, the position needs to update even if inactive, e.g. for auto-skip functionality, and logging stop-point if background playback terminated by system, etc.
+    //seeks go through SeekScheduler, which collapses bursts (e.g. auto-repeating arrow keys) into the latest
+    //target with at most one seek in flight, on Qt5 and Qt6 alike. 'pos' is absolute, in ms.
+    function seek(pos) {
+        SeekScheduler.seek(pos);
+    }
+
+    //seek 'delta' ms from where the last seek is headed, else from the position; previewed from Filmstrip.
+    function seekRelative(delta) {
+        SeekScheduler.seekRelative(delta);
+        seekPreview.show(SeekScheduler.target);
     }
 
 
@@ -298,37 +671,48 @@ ApplicationWindow {
         target: mediaPlayer;
 
         function onMediaInfoChanged() {
-            console.log("MediaPlayer -- mediaInfo='" + mediaPlayer.mediaInfo + "'");
+            TraceLogger.message("MediaPlayer.mediaInfo", mediaPlayer.mediaInfo);
             displayPlaybackInfo();
         }
 
         function onMediaPlaying(is_playing) {
             Utils.keepScreenOn(is_playing);
             displayPlaybackInfo();
+            recordSession();
+        }
+
+        function onPositionChanged() {
+            recordSession();
         }
 
         function onMediaCleared() {
-            console.log("MediaPlayer -- waiting for new media...");
+            TraceLogger.message("MediaPlayer", "waiting for new media...");
         }
 
         function onMediaLoading() {
-            console.log("MediaPlayer -- loading media ...");
+            StartupTracer.mark("first mediaLoading");  //only the first is kept; it precedes objectCreated
+            TraceLogger.message("MediaPlayer", "loading media ...");
         }
 
         function onMediaLoaded() {
-            console.log("MediaPlayer -- media loaded! " + mediaPlayer.mediaInfo);
+            TraceLogger.message("MediaPlayer", "media loaded!");
+            if ((pendingResume > 0) && (Math.abs(mediaPlayer.position - pendingResume) > 1000))
+                resumePending();
         }
 
         function onMediaBuffering() {
-            console.log("MediaPlayer -- media buffering...");
+            TraceLogger.message("MediaPlayer", "media buffering...");
         }
 
         function onMediaStalled() {
-            console.log("MediaPlayer -- stalled..." + mediaPlayer.mediaInfo);
+            TraceLogger.message("MediaPlayer", "stalled...");
         }
 
         function onMediaBuffered() {
-            console.log("MediaPlayer -- buffered..." + mediaPlayer.mediaInfo);
+            TraceLogger.message("MediaPlayer", "buffered...");
+            pendingResume = 0;
+            if (mediaPlayer.hasVideo && (mediaPlayer.duration > 0))
+                Filmstrip.generate(mediaPlayer.source);     //only if local, or cached by CachingProxy
             displayPlaybackInfo();
         }
 
@@ -346,4 +730,20 @@ ApplicationWindow {
         }
 
     } //end: Connections { target: mediaPlayer; ... }
+
+    Connections {
+        target: FrameInspector;
+
+        function onFrameAnomaly(kind, mean, stdDev, entropy) {
+            console.warn("FrameInspector -- "
+                         + ((kind === FrameInspector.Black)
+                            ? "black"
+                            : (kind === FrameInspector.Uniform)
+                              ? "uniform"
+                              : "garbage")
+                         + " frame: mean=" + mean.toFixed(1) + " stddev=" + stdDev.toFixed(1) + " entropy=" + entropy.toFixed(2)
+                         + " (" + FrameInspector.blackFrames + " black, " + FrameInspector.uniformFrames + " uniform, "
+                         + FrameInspector.garbageFrames + " garbage of " + FrameInspector.framesAnalyzed + " analyzed)");
+        }
+    }
 }
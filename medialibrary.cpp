@@ -0,0 +1,949 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "medialibrary.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+static const char    INDEX_MAGIC[8]     = { 'Q', 'V', 'B', 'L', 'I', 'B', 'I', 'X' };
+static const quint32 INDEX_VERSION      = 1;
+static const int     FETCH_BATCH        = 256;                // rows exposed per fetchMore()
+static const int     POST_BATCH         = 256;                // scan results per queued batch ...
+static const int     POST_INTERVAL_MS   = 250;                // ... or sooner
+static const int     MAX_WATCHED        = 512;                // directories; inotify watches are a per-user limit
+static const int     WATCH_SETTLE_MS    = 1000;               // coalesce bursts of directoryChanged()
+static const int     SAVE_DELAY_MS      = 3000;
+static const int     STARTUP_RESCAN_MS  = 2000;               // stay off the disk while the first frame is decoded
+static const int     HEADER_BYTES       = 64 * 1024;          // read to probe wav/flac/mp3, and the first box of mp4
+static const qint64  MAX_MOOV_BYTES     = 16 * 1024 * 1024;
+
+static const char *const MEDIA_SUFFIXES[] = {
+    ".mp4", ".m4v", ".m4a", ".mov", ".3gp", ".mkv", ".webm", ".avi", ".ts",
+    ".mp3", ".aac", ".flac", ".wav", ".ogg", ".oga", ".opus"
+};
+
+///
+/// \brief The IndexHeader struct -- followed by 'recordCount' records, the path pool, then '\n'-separated roots.
+///
+struct IndexHeader {
+    char    magic[8];
+    quint32 version;
+    quint32 recordSize;         // sizeof(MediaLibrary::Record), catches layout changes
+    quint32 recordCount;
+    quint32 pathsSize;
+    quint32 rootsSize;
+    quint32 reserved;
+};
+static_assert(sizeof(IndexHeader) == 32, "IndexHeader must keep the records 8-byte aligned");
+static_assert(sizeof(MediaLibrary::Record) == 48, "MediaLibrary::Record is stored as is in the index");
+
+static constexpr quint32 tag(const char a, const char b, const char c, const char d) {
+    return ((quint32(quint8(a)) << 24) | (quint32(quint8(b)) << 16) | (quint32(quint8(c)) << 8) | quint32(quint8(d)));
+}
+
+static quint32 be32(const uchar *p) { return (qFromBigEndian<quint32>(p)); }
+static quint64 be64(const uchar *p) { return (qFromBigEndian<quint64>(p)); }
+
+///
+/// \brief normalizedPath -- absolute, clean path of a path or "file:" url, without touching the file system.
+///
+static QString normalizedPath(const QString &path) {
+    const QString local = (path.startsWith(QLatin1String("file:"))) ? QUrl(path).toLocalFile() : path;
+    return ((local.isEmpty()) ? QString() : QDir::cleanPath(QDir::current().absoluteFilePath(local)));
+}
+
+///
+/// \brief forEachBox -- calls 'visit(type, payload, payloadSize)' for each ISO-BMFF box in [data, data + size).
+///
+static void forEachBox(const uchar *data, const qint64 size,
+                       const std::function<void (quint32, const uchar *, qint64)> &visit) {
+    qint64 position = 0;
+    while (position + 8 <= size) {
+        quint64       boxSize    = be32(data + position);
+        const quint32 type       = be32(data + position + 4);
+        qint64        headerSize = 8;
+        if (boxSize == 1) {                              // 64-bit 'largesize'
+            if (position + 16 > size)
+                return;
+            boxSize    = be64(data + position + 8);
+            headerSize = 16;
+        }
+        else if (boxSize == 0)                           // extends to the end
+            boxSize = quint64(size - position);
+        if ((boxSize < quint64(headerSize)) || (boxSize > quint64(size - position)))
+            return;
+        visit(type, data + position + headerSize, qint64(boxSize) - headerSize);
+        position += qint64(boxSize);
+    }
+}
+
+static qint64 toMs(const quint64 duration, const quint64 timescale) {
+    return ((timescale) ? qint64((duration / timescale) * 1000 + ((duration % timescale) * 1000) / timescale) : 0);
+}
+
+static void parseTrak(const uchar *trak, const qint64 size, MediaProbe::Info *info) {
+    quint32 handler = 0;
+    quint32 codec   = 0;
+    quint16 width   = 0;
+    quint16 height  = 0;
+    forEachBox(trak, size, [&](quint32 type, const uchar *box, qint64 boxSize) {
+        if ((type == tag('t', 'k', 'h', 'd')) && (boxSize >= 4)) {   // 16.16 fixed point width & height close the box
+            const qint64 at = (box[0] == 1) ? 88 : 76;
+            if (boxSize >= at + 8) {
+                width  = quint16(be32(box + at)     >> 16);
+                height = quint16(be32(box + at + 4) >> 16);
+            }
+        }
+        else if (type == tag('m', 'd', 'i', 'a')) {
+            forEachBox(box, boxSize, [&](quint32 type, const uchar *box, qint64 boxSize) {
+                if ((type == tag('h', 'd', 'l', 'r')) && (boxSize >= 12))
+                    handler = be32(box + 8);
+                else if (type == tag('m', 'i', 'n', 'f'))
+                    forEachBox(box, boxSize, [&](quint32 type, const uchar *box, qint64 boxSize) {
+                        if (type == tag('s', 't', 'b', 'l'))
+                            forEachBox(box, boxSize, [&](quint32 type, const uchar *box, qint64 boxSize) {
+                                if ((type == tag('s', 't', 's', 'd')) && (boxSize >= 16))
+                                    codec = be32(box + 12);     // the first sample entry's format
+                            });
+                    });
+            });
+        }
+    });
+
+    if (handler == tag('v', 'i', 'd', 'e')) {            // the video codec takes precedence
+        info->flags  |= MediaProbe::HasVideo;
+        info->codec   = codec;
+        info->width   = width;
+        info->height  = height;
+    }
+    else if (handler == tag('s', 'o', 'u', 'n')) {
+        info->flags  |= MediaProbe::HasAudio;
+        if (!(info->flags & MediaProbe::HasVideo))
+            info->codec = codec;
+    }
+}
+
+static void parseMoov(const uchar *moov, const qint64 size, MediaProbe::Info *info) {
+    forEachBox(moov, size, [info](quint32 type, const uchar *box, qint64 boxSize) {
+        if (type == tag('m', 'v', 'h', 'd')) {
+            if ((boxSize >= 20) && (box[0] == 0) && (be32(box + 16) != 0xFFFFFFFFu))
+                info->durationMs = toMs(be32(box + 16), be32(box + 12));
+            else if ((boxSize >= 32) && (box[0] == 1))
+                info->durationMs = toMs(be64(box + 24), be32(box + 20));
+        }
+        else if (type == tag('t', 'r', 'a', 'k'))
+            parseTrak(box, boxSize, info);
+    });
+}
+
+///
+/// \brief probeIsoBmff -- walk the top-level boxes to 'moov' (which may follow 'mdat', at the end), and parse it.
+///
+static bool probeIsoBmff(QFile &file, MediaProbe::Info *info) {
+    const qint64 end      = file.size();
+    qint64       position = 0;
+    while (position + 8 <= end) {
+        if (!file.seek(position))
+            return (false);
+        const QByteArray header = file.read(16);
+        if (header.size() < 8)
+            return (false);
+        const uchar  *p          = reinterpret_cast<const uchar *>(header.constData());
+        quint64       size       = be32(p);
+        const quint32 type       = be32(p + 4);
+        qint64        headerSize = 8;
+        if (size == 1) {
+            if (header.size() < 16)
+                return (false);
+            size       = be64(p + 8);
+            headerSize = 16;
+        }
+        else if (size == 0)
+            size = quint64(end - position);
+        if ((size < quint64(headerSize)) || (size > quint64(end - position)))
+            return (false);
+
+        if (type == tag('m', 'o', 'o', 'v')) {
+            if (size > quint64(MAX_MOOV_BYTES))
+                return (false);
+            const QByteArray moov = (file.seek(position + headerSize))
+                                    ? file.read(qint64(size) - headerSize)
+                                    : QByteArray();
+            if (moov.size() != qint64(size) - headerSize)
+                return (false);
+            parseMoov(reinterpret_cast<const uchar *>(moov.constData()), moov.size(), info);
+            return (true);
+        }
+        position += qint64(size);
+    }
+    return (false);
+}
+
+static bool probeWave(const QByteArray &head, MediaProbe::Info *info) {
+    const uchar *p          = reinterpret_cast<const uchar *>(head.constData());
+    qint64       position   = 12;
+    quint16      formatTag  = 0;
+    quint32      byteRate   = 0;
+    while (position + 8 <= head.size()) {
+        const quint32 id        = be32(p + position);
+        const quint32 chunkSize = qFromLittleEndian<quint32>(p + position + 4);
+        if ((id == tag('f', 'm', 't', ' ')) && (chunkSize >= 16) && (position + 24 <= head.size())) {
+            formatTag = qFromLittleEndian<quint16>(p + position + 8);
+            byteRate  = qFromLittleEndian<quint32>(p + position + 16);
+        }
+        else if (id == tag('d', 'a', 't', 'a')) {
+            if (byteRate && (chunkSize != 0xFFFFFFFFu))  // unknown length, when written as a stream
+                info->durationMs = qint64(chunkSize) * 1000 / byteRate;
+            break;
+        }
+        position += 8 + qint64(chunkSize) + (chunkSize & 1);
+    }
+    info->flags |= MediaProbe::HasAudio;
+    info->codec  = ((formatTag == 1) || (formatTag == 0xFFFE)) ? tag('l', 'p', 'c', 'm')
+                 : (formatTag == 3)                            ? tag('f', 'l', '3', '2')
+                                                               : tag('w', 'a', 'v', ' ');
+    return (byteRate != 0);
+}
+
+static bool probeFlac(const QByteArray &head, MediaProbe::Info *info) {
+    const uchar *block = reinterpret_cast<const uchar *>(head.constData()) + 4;
+    if ((head.size() < 4 + 4 + 34) || ((block[0] & 0x7F) != 0))   // STREAMINFO is always first
+        return (false);
+    const quint64 bits         = be64(block + 4 + 10);  // sample rate:20, channels:3, bits per sample:5, total samples:36
+    const quint64 sampleRate   = bits >> 44;
+    const quint64 totalSamples = bits & Q_UINT64_C(0xFFFFFFFFF);
+    info->durationMs = toMs(totalSamples, sampleRate);
+    info->flags     |= MediaProbe::HasAudio;
+    info->codec      = tag('f', 'L', 'a', 'C');
+    return (sampleRate != 0);
+}
+
+///
+/// \brief probeMpegAudio -- MPEG-1/2/2.5 layer III: frame count from a Xing/Info header, else estimated as CBR.
+///
+static bool probeMpegAudio(QFile &file, const QByteArray &head, MediaProbe::Info *info) {
+    static const int KBPS_MPEG1[16] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 };
+    static const int KBPS_MPEG2[16] = { 0,  8, 16, 24, 32, 40, 48, 56,  64,  80,  96, 112, 128, 144, 160, 0 };
+    static const int RATES_MPEG1[3] = { 44100, 48000, 32000 };
+
+    const uchar *h     = reinterpret_cast<const uchar *>(head.constData());
+    qint64       start = 0;
+    if (head.startsWith("ID3") && (head.size() >= 10))  // skip the ID3v2 tag, 'syncsafe' size, maybe a footer
+        start = 10 + ((qint64(h[6] & 0x7F) << 21) | (qint64(h[7] & 0x7F) << 14) | (qint64(h[8] & 0x7F) << 7) | qint64(h[9] & 0x7F))
+                   + ((h[5] & 0x10) ? 10 : 0);
+    const QByteArray frames = (start + 4096 <= head.size())
+                              ? head.mid(int(start))
+                              : ((file.seek(start)) ? file.read(HEADER_BYTES) : QByteArray());
+    const uchar *q = reinterpret_cast<const uchar *>(frames.constData());
+
+    for (int i = 0; i + 4 <= frames.size(); i++) {
+        if ((q[i] != 0xFF) || ((q[i + 1] & 0xE0) != 0xE0))
+            continue;
+        const int version      = (q[i + 1] >> 3) & 3;   // 3: MPEG-1, 2: MPEG-2, 0: MPEG-2.5
+        const int layer        = (q[i + 1] >> 1) & 3;   // 1: layer III
+        const int bitrateIndex = q[i + 2] >> 4;
+        const int rateIndex    = (q[i + 2] >> 2) & 3;
+        if ((version == 1) || (layer != 1) || (bitrateIndex == 0) || (bitrateIndex == 15) || (rateIndex == 3))
+            continue;
+        const bool mpeg1       = (version == 3);
+        const int  kbps        = (mpeg1) ? KBPS_MPEG1[bitrateIndex] : KBPS_MPEG2[bitrateIndex];
+        const int  sampleRate  = RATES_MPEG1[rateIndex] >> ((mpeg1) ? 0 : (version == 2) ? 1 : 2);
+        const int  frameLength = ((mpeg1) ? 144 : 72) * kbps * 1000 / sampleRate + ((q[i + 2] >> 1) & 1);
+        if ((i + frameLength + 2 <= frames.size())                       // the next frame must follow, else a false sync
+            && ((q[i + frameLength] != 0xFF) || ((q[i + frameLength + 1] & 0xE0) != 0xE0)))
+            continue;
+
+        const bool mono = ((q[i + 3] >> 6) == 3);
+        const int  xing = i + 4 + ((mpeg1) ? ((mono) ? 17 : 32) : ((mono) ? 9 : 17));
+        if (   (xing + 12 <= frames.size())
+            && ((std::memcmp(q + xing, "Xing", 4) == 0) || (std::memcmp(q + xing, "Info", 4) == 0))
+            && (be32(q + xing + 4) & 1))                                 // frame count present
+            info->durationMs = toMs(quint64(be32(q + xing + 8)) * ((mpeg1) ? 1152 : 576), quint64(sampleRate));
+        else
+            info->durationMs = (file.size() - start - i) * 8 / kbps;      // kbps == bits per ms
+        info->flags |= MediaProbe::HasAudio;
+        info->codec  = tag('m', 'p', '3', ' ');
+        return (true);
+    }
+    return (false);
+}
+
+bool MediaProbe::isMedia(const QString &fileName) {
+    for (const char *suffix : MEDIA_SUFFIXES)
+        if (fileName.endsWith(QLatin1String(suffix), Qt::CaseInsensitive))
+            return (true);
+    return (false);
+}
+
+///
+/// \brief MediaProbe::probe
+/// \param path -- a local file
+/// \param info -- flags has Probed set if the headers were understood
+/// \return false if not, e.g. for mkv, or a truncated file.
+///
+bool MediaProbe::probe(const QString &path, Info *info) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return (false);
+    const QByteArray head = file.read(HEADER_BYTES);
+    if (head.size() < 12)
+        return (false);
+
+    const quint32 box = be32(reinterpret_cast<const uchar *>(head.constData()) + 4);
+    bool ok = false;
+    if (head.startsWith("RIFF") && (head.mid(8, 4) == "WAVE"))
+        ok = probeWave(head, info);
+    else if (head.startsWith("fLaC"))
+        ok = probeFlac(head, info);
+    else if (   (box == tag('f', 't', 'y', 'p')) || (box == tag('m', 'o', 'o', 'v')) || (box == tag('m', 'd', 'a', 't'))
+             || (box == tag('f', 'r', 'e', 'e')) || (box == tag('w', 'i', 'd', 'e')) || (box == tag('s', 'k', 'i', 'p')))
+        ok = probeIsoBmff(file, info);
+    else if (head.startsWith("ID3") || path.endsWith(QLatin1String(".mp3"), Qt::CaseInsensitive))
+        ok = probeMpegAudio(file, head, info);
+    if (ok)
+        info->flags |= Probed;
+    return (ok);
+}
+
+QString MediaProbe::codecName(const quint32 fourcc) {
+    if (!fourcc)
+        return (QString());
+    const char name[4] = { char(fourcc >> 24), char(fourcc >> 16), char(fourcc >> 8), char(fourcc) };
+    return (QString::fromLatin1(name, 4).trimmed());
+}
+
+///
+/// \brief writeIndex -- runs on the pool; the path pool is compacted, dropping the paths of replaced and removed records.
+///
+static bool writeIndex(const QString &fileName, QVector<MediaLibrary::Record> records,
+                       const QByteArray &paths, const QStringList &roots) {
+    QByteArray compacted;
+    compacted.reserve(paths.size());
+    for (MediaLibrary::Record &record : records) {
+        const quint32 offset = quint32(compacted.size());
+        compacted.append(paths.constData() + record.pathOffset, int(record.pathLength));
+        record.pathOffset = offset;
+    }
+    const QByteArray rootBytes = roots.join(QLatin1Char('\n')).toUtf8();
+
+    IndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version     = INDEX_VERSION;
+    header.recordSize  = sizeof(MediaLibrary::Record);
+    header.recordCount = quint32(records.size());
+    header.pathsSize   = quint32(compacted.size());
+    header.rootsSize   = quint32(rootBytes.size());
+
+    const qint64 recordBytes = qint64(records.size()) * qint64(sizeof(MediaLibrary::Record));
+    QSaveFile out(fileName);
+    if (!(   out.open(QIODevice::WriteOnly)
+          && (out.write(reinterpret_cast<const char *>(&header), sizeof(header)) == qint64(sizeof(header)))
+          && (out.write(reinterpret_cast<const char *>(records.constData()), recordBytes) == recordBytes)
+          && (out.write(compacted) == compacted.size())
+          && (out.write(rootBytes) == rootBytes.size())
+          && out.commit())) {
+        qWarning() << Q_FUNC_INFO << ": unable to write" << fileName << out.errorString();
+        return (false);
+    }
+    return (true);
+}
+
+MediaLibrary::MediaLibrary(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 2));
+
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (QDir().mkpath(directory))
+        m_indexPath = directory + QStringLiteral("/medialibrary.idx");
+    else
+        qWarning() << Q_FUNC_INFO << ": unable to create" << directory << ", the library won't persist.";
+    loadIndex();
+    m_visible = qMin(FETCH_BATCH, recordCount());
+
+    m_watchTimer.setSingleShot(true);
+    m_watchTimer.setInterval(WATCH_SETTLE_MS);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &directory) {
+        m_changedDirectories.insert(directory);
+        m_watchTimer.start();
+    });
+    connect(&m_watchTimer, &QTimer::timeout, this, [this]() {
+        const QSet<QString> changed = m_changedDirectories;
+        m_changedDirectories.clear();
+        for (const QString &directory : changed)
+            scan(directory, false);
+    });
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &MediaLibrary::saveIndex);
+
+    if (!m_roots.isEmpty())    // catch up on changes made while not running, by mtime
+        QTimer::singleShot(STARTUP_RESCAN_MS, this, &MediaLibrary::rescan);
+}
+
+MediaLibrary::~MediaLibrary() {
+    m_generation++;             // abandon running scans
+    m_pool.waitForDone();
+    if (m_dirty && !m_indexPath.isEmpty()) {
+        detach();
+        writeIndex(m_indexPath, m_records, m_paths, m_roots);
+    }
+    unmapIndex();
+}
+
+///
+/// \brief MediaLibrary::loadIndex -- map the index and read it in place; a stale or damaged index is ignored.
+///
+void MediaLibrary::loadIndex() {
+    if (m_indexPath.isEmpty())
+        return;
+    m_indexFile.setFileName(m_indexPath);
+    if (!m_indexFile.open(QIODevice::ReadOnly))
+        return;                                          // first run
+    const qint64 size = m_indexFile.size();
+    m_map = (size >= qint64(sizeof(IndexHeader))) ? m_indexFile.map(0, size) : nullptr;
+    if (!m_map) {
+        m_indexFile.close();
+        return;
+    }
+
+    IndexHeader header;
+    std::memcpy(&header, m_map, sizeof(header));
+    const qint64 pathsOffset = qint64(sizeof(IndexHeader)) + qint64(header.recordCount) * qint64(sizeof(Record));
+    if (   (std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0)
+        || (header.version    != INDEX_VERSION)
+        || (header.recordSize != sizeof(Record))
+        || (pathsOffset + header.pathsSize + header.rootsSize != size)) {
+        qWarning() << Q_FUNC_INFO << ": ignoring incompatible or damaged" << m_indexPath;
+        unmapIndex();
+        return;
+    }
+
+    m_mappedRecords   = reinterpret_cast<const Record *>(m_map + sizeof(IndexHeader));
+    m_mappedPaths     = reinterpret_cast<const char *>(m_map + pathsOffset);
+    m_mappedCount     = int(header.recordCount);
+    m_mappedPathsSize = header.pathsSize;
+    m_roots = QString::fromUtf8(m_mappedPaths + header.pathsSize, int(header.rootsSize))
+                  .split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+}
+
+void MediaLibrary::unmapIndex() {
+    if (m_map)
+        m_indexFile.unmap(m_map);
+    m_map             = nullptr;
+    m_mappedRecords   = nullptr;
+    m_mappedPaths     = nullptr;
+    m_mappedCount     = 0;
+    m_mappedPathsSize = 0;
+    m_indexFile.close();
+}
+
+///
+/// \brief MediaLibrary::detach -- copy the mapped index into memory, before its first modification.
+///
+void MediaLibrary::detach() {
+    if (m_detached)
+        return;
+    m_records.resize(m_mappedCount);
+    if (m_mappedCount)
+        std::memcpy(m_records.data(), m_mappedRecords, size_t(m_mappedCount) * sizeof(Record));
+    m_paths    = QByteArray(m_mappedPaths, int(m_mappedPathsSize));
+    m_detached = true;
+    if (m_activeScans > 0)                               // they read it in place; unmapped once they finish
+        m_unmapPending = true;
+    else
+        unmapIndex();                                    // also lets QSaveFile replace it, on Windows
+}
+
+///
+/// \brief MediaLibrary::saveIndex -- write a snapshot (implicitly shared, so not copied here) on the pool.
+///
+void MediaLibrary::saveIndex() {
+    if (!m_dirty || m_indexPath.isEmpty())
+        return;
+    if (m_saving || (m_activeScans > 0)) {               // one writer at a time, and not while scanning
+        m_saveTimer.start();
+        return;
+    }
+    detach();
+    m_dirty  = false;
+    m_saving = true;
+    const QString           fileName = m_indexPath;
+    const QVector<Record>   records  = m_records;
+    const QByteArray        paths    = m_paths;
+    const QStringList       roots    = m_roots;
+    m_pool.start([this, fileName, records, paths, roots]() {
+        writeIndex(fileName, records, paths, roots);
+        QMetaObject::invokeMethod(this, [this]() { m_saving = false; }, Qt::QueuedConnection);
+    });
+}
+
+int MediaLibrary::recordCount() const {
+    return ((m_detached) ? m_records.size() : m_mappedCount);
+}
+
+const MediaLibrary::Record &MediaLibrary::recordAt(const int row) const {
+    return ((m_detached) ? m_records.at(row) : m_mappedRecords[row]);
+}
+
+QString MediaLibrary::pathAt(const int row) const {
+    const Record  &record   = recordAt(row);
+    const char    *pool     = (m_detached) ? m_paths.constData()    : m_mappedPaths;
+    const quint64  poolSize = (m_detached) ? quint64(m_paths.size()) : m_mappedPathsSize;
+    if (quint64(record.pathOffset) + record.pathLength > poolSize)
+        return (QString());
+    return (QString::fromUtf8(pool + record.pathOffset, int(record.pathLength)));
+}
+
+void MediaLibrary::ensurePathHash() const {
+    if (m_pathHashValid)
+        return;
+    const int total = recordCount();
+    m_rowByPath.clear();
+    m_rowByPath.reserve(total);
+    for (int row = 0; row < total; row++)
+        m_rowByPath.insert(pathAt(row), row);
+    m_pathHashValid = true;
+}
+
+int MediaLibrary::rowCount(const QModelIndex &parent) const {
+    return ((parent.isValid()) ? 0 : m_visible);
+}
+
+QVariant MediaLibrary::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || (index.row() >= m_visible))
+        return (QVariant());
+
+    const Record &record = recordAt(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole: {
+        const QString path = pathAt(index.row());
+        return (path.mid(path.lastIndexOf(QLatin1Char('/')) + 1));
+    }
+    case PathRole:
+        return (pathAt(index.row()));
+    case UrlRole:
+        return (QUrl::fromLocalFile(pathAt(index.row())));
+    case SizeRole:
+        return (record.size);
+    case ModifiedRole:
+        return (QDateTime::fromMSecsSinceEpoch(record.modified));
+    case DurationRole:
+        return (record.durationMs);
+    case CodecRole:
+        return (MediaProbe::codecName(record.codec));
+    case WidthRole:
+        return (int(record.width));
+    case HeightRole:
+        return (int(record.height));
+    case HasVideoRole:
+        return (bool(record.flags & MediaProbe::HasVideo));
+    default:
+        return (QVariant());
+    }
+}
+
+QHash<int, QByteArray> MediaLibrary::roleNames() const {
+    return ({ { PathRole,     "path"        },
+              { UrlRole,      "url"         },
+              { NameRole,     "name"        },
+              { SizeRole,     "size"        },
+              { ModifiedRole, "modified"    },
+              { DurationRole, "duration"    },
+              { CodecRole,    "codec"       },
+              { WidthRole,    "videoWidth"  },    // not "width", which a delegate would shadow
+              { HeightRole,   "videoHeight" },
+              { HasVideoRole, "hasVideo"    } });
+}
+
+bool MediaLibrary::canFetchMore(const QModelIndex &parent) const {
+    return (!parent.isValid() && (m_visible < recordCount()));
+}
+
+void MediaLibrary::fetchMore(const QModelIndex &parent) {
+    const int more = (parent.isValid()) ? 0 : qMin(FETCH_BATCH, recordCount() - m_visible);
+    if (more <= 0)
+        return;
+    beginInsertRows(QModelIndex(), m_visible, m_visible + more - 1);
+    m_visible += more;
+    endInsertRows();
+    Q_EMIT countChanged();
+}
+
+QVariantMap MediaLibrary::get(const int row) const {
+    QVariantMap result;
+    if ((row < 0) || (row >= m_visible))
+        return (result);
+    const QHash<int, QByteArray> names = roleNames();
+    for (auto it = names.cbegin(); it != names.cend(); ++it)
+        result.insert(QString::fromLatin1(it.value()), data(index(row), it.key()));
+    return (result);
+}
+
+bool MediaLibrary::contains(const QString &path) const {
+    ensurePathHash();
+    return (m_rowByPath.contains(normalizedPath(path)));
+}
+
+void MediaLibrary::addRoot(const QString &directory) {
+    const QString root = normalizedPath(directory);
+    if (root.isEmpty() || m_roots.contains(root))
+        return;
+    m_roots.append(root);
+    m_dirty = true;
+    Q_EMIT rootsChanged();
+    scan(root, true);
+}
+
+void MediaLibrary::removeRoot(const QString &directory) {
+    const QString root = normalizedPath(directory);
+    if (!m_roots.removeOne(root))
+        return;
+    m_generation++;                                      // its scan, if running, mustn't add rows back
+    const QString prefix = (root.endsWith(QLatin1Char('/'))) ? root : root + QLatin1Char('/');
+
+    ensurePathHash();
+    QVector<int> rows;
+    for (auto it = m_rowByPath.cbegin(); it != m_rowByPath.cend(); ++it)
+        if (it.key().startsWith(prefix))
+            rows.append(it.value());
+    if (!rows.isEmpty()) {
+        detach();
+        removeRows(rows);
+        Q_EMIT countChanged();
+    }
+
+    QStringList unwatch;
+    for (auto it = m_knownDirectories.begin(); it != m_knownDirectories.end(); ) {
+        if ((*it == root) || it->startsWith(prefix)) {
+            unwatch.append(*it);
+            it = m_knownDirectories.erase(it);
+        }
+        else
+            ++it;
+    }
+    const QStringList watched = m_watcher.directories();
+    for (const QString &path : qAsConst(unwatch))
+        if (watched.contains(path))
+            m_watcher.removePath(path);
+
+    m_dirty = true;
+    m_saveTimer.start();
+    Q_EMIT rootsChanged();
+    if (scanning())                                      // the other roots' scans were abandoned too
+        rescan();
+}
+
+void MediaLibrary::addPaths(const QStringList &paths) {
+    if (paths.isEmpty())                                 // the usual launch, without arguments
+        return;
+    ScanRequest request;
+    request.generation = m_generation.load();
+    request.recursive  = false;
+    for (const QString &path : paths) {
+        const QString file = normalizedPath(path);
+        if (!file.isEmpty())
+            request.files.append(file);
+    }
+    if (!request.files.isEmpty())
+        startScan(request);
+}
+
+void MediaLibrary::rescan() {
+    for (const QString &root : qAsConst(m_roots))
+        scan(root, true);
+}
+
+void MediaLibrary::scan(const QString &directory, const bool recursive) {
+    ScanRequest request;
+    request.generation = m_generation.load();
+    request.directory  = directory;
+    request.recursive  = recursive;
+    startScan(request);
+}
+
+///
+/// \brief MediaLibrary::startScan -- with the index as it stands (implicitly shared, or the map itself), so
+/// what's already known of the request is looked up on the pool rather than the GUI thread.
+///
+void MediaLibrary::startScan(ScanRequest request) {
+    if (m_detached) {
+        request.records = m_records;
+        request.paths   = m_paths;
+    }
+    else {
+        request.mapped  = m_mappedRecords;
+        request.paths   = QByteArray::fromRawData(m_mappedPaths, int(m_mappedPathsSize));
+    }
+    request.recordCount = recordCount();
+    if (m_activeScans++ == 0)
+        Q_EMIT scanningChanged();
+    m_pool.start([this, request]() { runScan(request); });
+}
+
+///
+/// \brief MediaLibrary::knownEntries -- the request's indexed files, compared as UTF-8 so only matches become QStrings.
+///
+QHash<QString, MediaLibrary::Known> MediaLibrary::knownEntries(const ScanRequest &request) {
+    const Record *records = (request.mapped) ? request.mapped : request.records.constData();
+    QByteArray    prefix  = request.directory.toUtf8();
+    if (!prefix.isEmpty() && !prefix.endsWith('/'))
+        prefix.append('/');
+    QSet<QByteArray> files;
+    for (const QString &file : request.files)
+        files.insert(file.toUtf8());
+
+    QHash<QString, Known> known;
+    for (int row = 0; row < request.recordCount; row++) {
+        const Record &record = records[row];
+        if (quint64(record.pathOffset) + record.pathLength > quint64(request.paths.size()))
+            continue;
+        const QByteArray path = QByteArray::fromRawData(request.paths.constData() + record.pathOffset,
+                                                        int(record.pathLength));
+        const bool wanted = (!prefix.isEmpty() && path.startsWith(prefix))
+                          ? (request.recursive || (path.indexOf('/', prefix.size()) < 0))
+                          : files.contains(path);
+        if (wanted)
+            known.insert(QString::fromUtf8(path), Known{ record.modified, record.size });
+    }
+    return (known);
+}
+
+///
+/// \brief MediaLibrary::runScan -- on the pool: stat everything, probe what's new or changed, post results in batches.
+///
+void MediaLibrary::runScan(const ScanRequest &request) {
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+
+    QHash<QString, Known> remaining = knownEntries(request);    // what's left over was removed
+    QSharedPointer<Batch> batch(new Batch);
+    batch->generation = request.generation;
+    batch->recursive  = request.recursive;
+    QElapsedTimer sincePost;
+    sincePost.start();
+
+    const auto cancelled = [this, &request]() {
+        return (request.generation != m_generation.load());
+    };
+    const auto flush = [&]() {
+        if ((batch->records.size() < POST_BATCH) && (sincePost.elapsed() < POST_INTERVAL_MS))
+            return;
+        post(batch);
+        batch.reset(new Batch);
+        batch->generation = request.generation;
+        batch->recursive  = request.recursive;
+        sincePost.restart();
+    };
+    const auto consider = [&](const QFileInfo &info) {
+        batch->scanned++;
+        const QString path     = info.absoluteFilePath();
+        const qint64  modified = info.lastModified().toMSecsSinceEpoch();
+        const auto    known    = remaining.find(path);
+        if (known != remaining.end()) {
+            const bool unchanged = ((known->modified == modified) && (known->size == info.size()));
+            remaining.erase(known);
+            if (unchanged)
+                return;
+        }
+
+        MediaProbe::Info probed;
+        MediaProbe::probe(path, &probed);
+        batch->probed++;
+        const QByteArray utf8 = path.toUtf8();
+        Record record{};
+        record.modified   = modified;
+        record.size       = info.size();
+        record.durationMs = probed.durationMs;
+        record.pathOffset = quint32(batch->paths.size());
+        record.pathLength = quint32(utf8.size());
+        record.codec      = probed.codec;
+        record.width      = probed.width;
+        record.height     = probed.height;
+        record.flags      = probed.flags;
+        batch->paths.append(utf8);
+        batch->records.append(record);
+    };
+
+    bool present = true;
+    if (!request.directory.isEmpty()) {
+        present = QFileInfo(request.directory).isDir();
+        batch->directories.append(request.directory);
+        QDirIterator it(request.directory, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot,
+                        (request.recursive) ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext() && !cancelled()) {
+            it.next();
+            const QFileInfo info = it.fileInfo();
+            if (info.isDir())
+                batch->directories.append(info.absoluteFilePath());
+            else if (MediaProbe::isMedia(info.fileName()))
+                consider(info);
+            flush();
+        }
+    }
+    for (const QString &path : request.files) {
+        if (cancelled())
+            break;
+        const QFileInfo info(path);
+        if (info.isDir())
+            batch->newRoots.append(path);
+        else if (info.isFile() && MediaProbe::isMedia(info.fileName()))
+            consider(info);
+        flush();
+    }
+
+    // a missing root is more likely an unmounted volume than deleted media: keep its entries.
+    if (!cancelled() && (present || !request.recursive))
+        batch->removed = remaining.keys();
+    batch->last = true;
+    post(batch);
+}
+
+void MediaLibrary::post(const QSharedPointer<Batch> &batch) {
+    QMetaObject::invokeMethod(this, [this, batch]() { applyBatch(*batch); }, Qt::QueuedConnection);
+}
+
+///
+/// \brief MediaLibrary::applyBatch -- on the GUI thread: update, append or remove records, signalling only visible rows.
+///
+void MediaLibrary::applyBatch(const Batch &batch) {
+    if (batch.generation == m_generation.load()) {
+        if (!batch.records.isEmpty() || !batch.removed.isEmpty()) {
+            detach();
+            ensurePathHash();
+            const int oldTotal     = m_records.size();
+            int       firstChanged = m_visible;
+            int       lastChanged  = -1;
+            for (const Record &incoming : batch.records) {
+                const QByteArray utf8 = batch.paths.mid(int(incoming.pathOffset), int(incoming.pathLength));
+                const QString    path = QString::fromUtf8(utf8);
+                Record           record = incoming;
+                const auto       existing = m_rowByPath.constFind(path);
+                if (existing != m_rowByPath.constEnd()) {
+                    const int row = *existing;
+                    record.pathOffset = m_records.at(row).pathOffset;
+                    m_records[row]    = record;
+                    if (row < m_visible) {
+                        firstChanged = qMin(firstChanged, row);
+                        lastChanged  = qMax(lastChanged,  row);
+                    }
+                }
+                else {
+                    record.pathOffset = quint32(m_paths.size());
+                    m_paths.append(utf8);
+                    m_rowByPath.insert(path, m_records.size());
+                    m_records.append(record);
+                }
+            }
+            if (lastChanged >= 0)
+                Q_EMIT dataChanged(index(firstChanged), index(lastChanged));
+            // while the view is still short of a page, show new rows right away, else they're fetched as it scrolls.
+            if ((m_visible == oldTotal) && (m_visible < FETCH_BATCH) && (m_records.size() > m_visible)) {
+                const int shown = qMin(FETCH_BATCH, m_records.size());
+                beginInsertRows(QModelIndex(), m_visible, shown - 1);
+                m_visible = shown;
+                endInsertRows();
+            }
+
+            QVector<int> rows;
+            for (const QString &path : batch.removed) {
+                const int row = m_rowByPath.value(path, -1);
+                if (row >= 0)
+                    rows.append(row);
+            }
+            if (!rows.isEmpty())
+                removeRows(rows);
+            m_dirty = true;
+            Q_EMIT countChanged();
+        }
+        watch(batch.directories, batch.recursive);
+        for (const QString &root : batch.newRoots)
+            addRoot(root);
+    }
+
+    if (batch.scanned || batch.probed) {
+        m_filesScanned += batch.scanned;
+        m_filesProbed  += batch.probed;
+        Q_EMIT progressChanged();
+    }
+    if (batch.last && (--m_activeScans == 0)) {
+        if (m_unmapPending) {
+            m_unmapPending = false;
+            unmapIndex();
+        }
+        Q_EMIT scanningChanged();
+        if (m_dirty)
+            m_saveTimer.start();
+    }
+}
+
+///
+/// \brief MediaLibrary::removeRows -- in runs of adjacent rows, since a root's files were mostly appended together.
+///
+void MediaLibrary::removeRows(QVector<int> rows) {
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    int i = 0;
+    while (i < rows.size()) {
+        const int last  = rows.at(i);
+        int       first = last;
+        while ((++i < rows.size()) && (rows.at(i) == first - 1))
+            first--;
+        const int lastVisible = qMin(last, m_visible - 1);
+        if (first <= lastVisible) {
+            beginRemoveRows(QModelIndex(), first, lastVisible);
+            m_records.remove(first, last - first + 1);
+            m_visible -= lastVisible - first + 1;
+            endRemoveRows();
+        }
+        else
+            m_records.remove(first, last - first + 1);
+    }
+    m_pathHashValid = false;                             // rows shifted; rebuilt on next use
+}
+
+///
+/// \brief MediaLibrary::watch -- up to MAX_WATCHED directories. Subdirectories first seen by a
+/// non-recursive (watcher-triggered) scan were created since, and are scanned in full.
+///
+void MediaLibrary::watch(const QStringList &directories, const bool recursive) {
+    int         watched = m_watcher.directories().size();
+    QStringList add;
+    for (const QString &directory : directories) {
+        if (m_knownDirectories.contains(directory))
+            continue;
+        m_knownDirectories.insert(directory);
+        if (watched + add.size() < MAX_WATCHED)
+            add.append(directory);
+        if (!recursive)
+            scan(directory, true);
+    }
+    if (!add.isEmpty())
+        m_watcher.addPaths(add);
+}
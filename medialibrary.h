@@ -0,0 +1,230 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef MEDIALIBRARY_H
+#define MEDIALIBRARY_H
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+#include <atomic>
+
+///
+/// \brief The MediaProbe class -- duration, codec and resolution from a media file's headers.
+///
+/// Reads only container headers, never decodes: ISO-BMFF (mp4/m4a/m4v/mov/3gp 'moov'),
+/// RIFF WAVE, FLAC STREAMINFO and MPEG audio layer III (Xing/Info frame count, else
+/// the CBR estimate). Other recognized media (mkv/webm/ogg/...) is listed without metadata.
+///
+class MediaProbe
+{
+public:
+    enum Flags : quint32 {
+        HasVideo = 0x1,
+        HasAudio = 0x2,
+        Probed   = 0x4      // the headers were understood
+    };
+    struct Info {
+        qint64  durationMs  = 0;
+        quint32 codec       = 0;     // fourcc, e.g. 'avc1', 'mp4a', 'mp3 '; the video codec if any
+        quint16 width       = 0;
+        quint16 height      = 0;
+        quint32 flags       = 0;
+    };
+
+    static bool    isMedia(const QString &fileName);       // by extension
+    static bool    probe(const QString &path, Info *info);
+    static QString codecName(const quint32 fourcc);        // 'avc1' --> "avc1"
+};
+
+///
+/// \brief The MediaLibrary class
+///
+/// Indexes local media so it needn't enter the app one blocking QFile::exists() at a
+/// time through Utils::argv(). Root directories are scanned recursively on a worker
+/// pool; only files whose size or mtime differ from the index are probed (MediaProbe),
+/// and results are applied on the GUI thread in batches.
+///
+/// The index is a compact binary file of fixed-size records plus a UTF-8 path pool,
+/// memory-mapped at startup and read in place, so launching with tens of thousands of
+/// entries costs one mmap(); it's copied into memory only when first modified, and
+/// rewritten (compacted) with QSaveFile after scans settle. Directories are watched
+/// with QFileSystemWatcher (up to a limit) and changed ones are rescanned, otherwise
+/// the roots are rescanned by mtime at startup and by rescan().
+///
+/// As a model, rows are exposed lazily: 'count' grows by fetchMore() as a view scrolls,
+/// towards 'totalCount'.
+///
+class MediaLibrary : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int          count         READ count         NOTIFY countChanged)      // rows fetched so far
+    Q_PROPERTY(int          totalCount    READ totalCount    NOTIFY countChanged)
+    Q_PROPERTY(QStringList  roots         READ roots         NOTIFY rootsChanged)
+    Q_PROPERTY(bool         scanning      READ scanning      NOTIFY scanningChanged)
+    Q_PROPERTY(int          filesScanned  READ filesScanned  NOTIFY progressChanged)
+    Q_PROPERTY(int          filesProbed   READ filesProbed   NOTIFY progressChanged)
+    Q_PROPERTY(QString      indexPath     READ indexPath     CONSTANT)
+
+public:
+    enum Roles {
+        PathRole = Qt::UserRole + 1,
+        UrlRole,
+        NameRole,
+        SizeRole,
+        ModifiedRole,       // QDateTime
+        DurationRole,       // ms
+        CodecRole,
+        WidthRole,
+        HeightRole,
+        HasVideoRole
+    };
+
+    ///
+    /// \brief The Record struct -- one index entry, identical in memory and on disk.
+    ///
+    struct Record {
+        qint64  modified;       // ms since epoch
+        qint64  size;
+        qint64  durationMs;
+        quint32 pathOffset;     // into the path pool
+        quint32 pathLength;     // UTF-8 bytes
+        quint32 codec;
+        quint16 width;
+        quint16 height;
+        quint32 flags;          // MediaProbe::Flags
+        quint32 reserved;
+    };
+
+    explicit MediaLibrary(QObject *parent = nullptr);
+    ~MediaLibrary() override;
+
+    int      rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    bool     canFetchMore(const QModelIndex &parent) const override;
+    void     fetchMore(const QModelIndex &parent) override;
+
+    Q_INVOKABLE void        addRoot(const QString &directory);
+    Q_INVOKABLE void        removeRoot(const QString &directory);
+    // directories become roots, media files are indexed; checked on the pool, not the GUI thread.
+    Q_INVOKABLE void        addPaths(const QStringList &paths);
+    Q_INVOKABLE void        rescan();
+    // answered from the index, without touching the file system.
+    Q_INVOKABLE bool        contains(const QString &path) const;
+    Q_INVOKABLE QVariantMap get(const int row) const;
+
+    int         count() const { return (m_visible); }
+    int         totalCount() const { return (recordCount()); }
+    QStringList roots() const { return (m_roots); }
+    bool        scanning() const { return (m_activeScans > 0); }
+    int         filesScanned() const { return (m_filesScanned); }
+    int         filesProbed() const { return (m_filesProbed); }
+    QString     indexPath() const { return (m_indexPath); }
+
+Q_SIGNALS:
+    void countChanged();
+    void rootsChanged();
+    void scanningChanged();
+    void progressChanged();
+
+private:
+    struct Known {
+        qint64  modified;
+        qint64  size;
+    };
+    struct ScanRequest {
+        int                     generation;
+        QString                 directory;      // empty for 'files'
+        bool                    recursive;
+        QStringList             files;
+        // the index as of the request, searched on the pool for what's known of 'directory' or 'files'
+        const Record           *mapped      = nullptr;  // while not detached; the map outlives running scans
+        QVector<Record>         records;                // once detached
+        QByteArray              paths;
+        int                     recordCount = 0;
+    };
+    struct Batch {
+        int                     generation = 0;
+        QVector<Record>         records;        // pathOffset into 'paths'
+        QByteArray              paths;
+        QStringList             removed;
+        QStringList             directories;    // for the watcher
+        QStringList             newRoots;       // directories given to addPaths()
+        int                     scanned = 0;
+        int                     probed  = 0;
+        bool                    recursive = true;       // else unknown subdirectories are new, and scanned
+        bool                    last    = false;
+    };
+
+    void            loadIndex();
+    void            saveIndex();
+    void            unmapIndex();
+    void            detach();
+    void            ensurePathHash() const;
+    int             recordCount() const;
+    const Record   &recordAt(const int row) const;
+    QString         pathAt(const int row) const;
+
+    void            scan(const QString &directory, const bool recursive);
+    void            startScan(ScanRequest request);
+    static QHash<QString, Known> knownEntries(const ScanRequest &request);
+    void            runScan(const ScanRequest &request);
+    void            post(const QSharedPointer<Batch> &batch);
+    void            applyBatch(const Batch &batch);
+    void            removeRows(QVector<int> rows);
+    void            watch(const QStringList &directories, const bool recursive);
+
+    QString                     m_indexPath;
+    QFile                       m_indexFile;
+    uchar                      *m_map           = nullptr;
+    const Record               *m_mappedRecords = nullptr;  // while not detached
+    const char                 *m_mappedPaths   = nullptr;
+    int                         m_mappedCount   = 0;
+    quint32                     m_mappedPathsSize = 0;
+    bool                        m_detached      = false;
+    bool                        m_unmapPending  = false;    // detached while scans read the map
+    QVector<Record>             m_records;                  // once detached
+    QByteArray                  m_paths;
+    mutable QHash<QString, int> m_rowByPath;                // built on first use
+    mutable bool                m_pathHashValid = false;
+    int                         m_visible       = 0;
+    QStringList                 m_roots;
+    bool                        m_dirty         = false;
+    bool                        m_saving        = false;
+
+    QThreadPool                 m_pool;
+    std::atomic<int>            m_generation{0};            // bumped by removeRoot(), obsoletes running scans
+    int                         m_activeScans   = 0;
+    int                         m_filesScanned  = 0;
+    int                         m_filesProbed   = 0;
+    QFileSystemWatcher          m_watcher;
+    QSet<QString>               m_knownDirectories;
+    QSet<QString>               m_changedDirectories;
+    QTimer                      m_watchTimer;               // debounces directoryChanged()
+    QTimer                      m_saveTimer;
+};
+
+#endif // MEDIALIBRARY_H
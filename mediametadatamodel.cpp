@@ -0,0 +1,288 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mediametadatamodel.h"
+#include "coverartcache.h"
+#include <QImage>
+#include <QDebug>
+#include <algorithm>
+
+///
+/// \brief sameValue -- QVariant::operator== on QImage compares every pixel, so compare images by identity.
+///
+static bool sameValue(const QVariant &a, const QVariant &b) {
+    if ((a.metaType().id() == QMetaType::QImage) && (b.metaType().id() == QMetaType::QImage))
+        return (a.value<QImage>().cacheKey() == b.value<QImage>().cacheKey());
+    return (a == b);
+}
+
+///
+/// \brief firstOf
+/// \return the first non-empty string in 'list', or "".
+///
+static QString firstOf(std::initializer_list<QString> list) {
+    for (const QString &s : list)
+        if (!s.isEmpty())
+            return (s);
+    return (QString());
+}
+
+MediaMetadataModel::MediaMetadataModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int MediaMetadataModel::rowCount(const QModelIndex &parent) const {
+    return ((parent.isValid()) ? 0 : m_entries.size());
+}
+
+QVariant MediaMetadataModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || (index.row() >= m_entries.size()))
+        return (QVariant());
+
+    const Entry &entry = m_entries.at(index.row());
+    switch (role) {
+    case KeyIdRole:
+        return (int(entry.key));
+    case KeyStrRole:
+        return (QMediaMetaData::metaDataKeyToString(entry.key));
+    case Qt::DisplayRole:
+    case ValueRole:
+        return (entry.value);
+    default:
+        return (QVariant());
+    }
+}
+
+QHash<int, QByteArray> MediaMetadataModel::roleNames() const {
+    return ({ { KeyIdRole,  "keyid"  },
+              { KeyStrRole, "keystr" },
+              { ValueRole,  "value"  } });
+}
+
+///
+/// \brief MediaMetadataModel::setPlayer
+/// \param player -- the MediaPlayer6.qml instance (a QMediaPlayer) whose metaData is modelled.
+///
+void MediaMetadataModel::setPlayer(QObject *player) {
+    QMediaPlayer *mediaPlayer = qobject_cast<QMediaPlayer *>(player);
+    if (mediaPlayer == m_player)
+        return;
+    if (m_player)
+        disconnect(m_player, nullptr, this, nullptr);
+    m_player = mediaPlayer;
+    if (m_player) {
+        connect(m_player, &QMediaPlayer::metaDataChanged, this, [this]() {
+            update(m_player->metaData());
+        });
+        connect(m_player, &QMediaPlayer::hasVideoChanged, this, &MediaMetadataModel::updateDerived);
+        update(m_player->metaData());
+    }
+    Q_EMIT playerChanged();
+}
+
+void MediaMetadataModel::setFallbackTitle(const QString &title) {
+    if (m_fallbackTitle == title)
+        return;
+    m_fallbackTitle = title;
+    Q_EMIT fallbackTitleChanged();
+    updateDerived();
+}
+
+void MediaMetadataModel::setFallbackArtist(const QString &artist) {
+    if (m_fallbackArtist == artist)
+        return;
+    m_fallbackArtist = artist;
+    Q_EMIT fallbackArtistChanged();
+    updateDerived();
+}
+
+///
+/// \brief MediaMetadataModel::update -- merge 'metaData' into the model, signalling only rows that differ.
+/// \param metaData
+///
+void MediaMetadataModel::update(const QMediaMetaData &metaData) {
+    const QVariant oldCoverArt  = coverArtImage();
+    const QVariant oldThumbnail = thumbnailImage();
+    const int      oldCount     = m_entries.size();
+
+    QList<QMediaMetaData::Key> keys = metaData.keys();
+    std::sort(keys.begin(), keys.end());
+    m_metaData = metaData;
+
+    int row = 0;
+    int k   = 0;
+    while ((row < m_entries.size()) || (k < keys.size())) {
+        if (   (k >= keys.size())
+            || ((row < m_entries.size()) && (m_entries.at(row).key < keys.at(k)))) {   // key went away
+            beginRemoveRows(QModelIndex(), row, row);
+            m_entries.remove(row);
+            endRemoveRows();
+        }
+        else if (   (row >= m_entries.size())
+                 || (keys.at(k) < m_entries.at(row).key)) {                             // new key
+            beginInsertRows(QModelIndex(), row, row);
+            m_entries.insert(row, Entry{ keys.at(k), metaData.value(keys.at(k)) });
+            endInsertRows();
+            row++; k++;
+        }
+        else {                                                                          // same key
+            const QVariant value = metaData.value(keys.at(k));
+            if (!sameValue(m_entries.at(row).value, value)) {
+                m_entries[row].value = value;
+                const QModelIndex changed = index(row);
+                Q_EMIT dataChanged(changed, changed, { ValueRole, Qt::DisplayRole });
+            }
+            row++; k++;
+        }
+    }
+
+    if (m_entries.size() != oldCount)
+        Q_EMIT countChanged();
+    const bool coverArtChanged  = !sameValue(oldCoverArt,  coverArtImage());
+    const bool thumbnailChanged = !sameValue(oldThumbnail, thumbnailImage());
+    if (coverArtChanged)
+        Q_EMIT coverArtImageChanged();
+    if (thumbnailChanged)
+        Q_EMIT thumbnailImageChanged();
+    if (coverArtChanged || thumbnailChanged)
+        updateCoverArtUrl();
+    updateDerived();
+}
+
+///
+/// \brief MediaMetadataModel::updateCoverArtUrl -- publish the artwork (cover art, else thumbnail) for async scaling.
+///
+void MediaMetadataModel::updateCoverArtUrl() {
+    QImage  artwork = coverArtImage().value<QImage>();
+    QString kind    = QStringLiteral("#cover");
+    if (artwork.isNull()) {
+        artwork = thumbnailImage().value<QImage>();
+        kind    = QStringLiteral("#thumbnail");
+    }
+
+    QString origin;     // names the artwork across launches, for CoverArtCache's disk cache
+    if (m_player && !artwork.isNull())
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+        origin = m_player->media().request().url().toString() + kind;
+#else                                           //Qt6
+        origin = m_player->source().toString() + kind;
+#endif /* (QT_VERSION < QT_VERSION_CHECK(6, 0, 0)) */
+    const QUrl url = (CoverArtCache::instance())
+                     ? CoverArtCache::instance()->publish(artwork, origin)
+                     : QUrl();
+    if (m_coverArtUrl == url)
+        return;
+    m_coverArtUrl = url;
+    Q_EMIT coverArtUrlChanged();
+}
+
+///
+/// \brief MediaMetadataModel::clear -- called out of mediaPlayer.reset()
+///
+void MediaMetadataModel::clear() {
+    update(QMediaMetaData());
+}
+
+int MediaMetadataModel::indexOf(const QMediaMetaData::Key key) const {
+    const auto it = std::lower_bound(m_entries.cbegin(), m_entries.cend(), key,
+                                     [](const Entry &e, QMediaMetaData::Key k) { return (e.key < k); });
+    return (((it != m_entries.cend()) && (it->key == key)) ? int(it - m_entries.cbegin()) : -1);
+}
+
+QVariant MediaMetadataModel::value(const int key) const {
+    const int row = indexOf(QMediaMetaData::Key(key));
+    return ((row < 0) ? QVariant() : m_entries.at(row).value);
+}
+
+QString MediaMetadataModel::stringValue(const int key) const {
+    return (m_metaData.stringValue(QMediaMetaData::Key(key)));
+}
+
+///
+/// \brief MediaMetadataModel::updateDerived -- title/artist/mediaInfo, as formerly bound in MediaPlayer6.qml.
+///
+void MediaMetadataModel::updateDerived() {
+    const QString mdTitle              = stringValue(QMediaMetaData::Title);
+    const QString mdAlbumTitle         = stringValue(QMediaMetaData::AlbumTitle);
+    const QString mdAuthor             = stringValue(QMediaMetaData::Author);
+    const QString mdContributingArtist = stringValue(QMediaMetaData::ContributingArtist);
+    const QString mdAlbumArtist        = stringValue(QMediaMetaData::AlbumArtist);
+    const QString mdLeadPerformer      = stringValue(QMediaMetaData::LeadPerformer);
+    const QString mdMediaType          = stringValue(QMediaMetaData::MediaType);
+    const QString mdResolution         = stringValue(QMediaMetaData::Resolution);
+    const QString mdVideoCodec         = stringValue(QMediaMetaData::VideoCodec);
+    const QString mdAudioCodec         = stringValue(QMediaMetaData::AudioCodec);
+    const int     mdVideoBitRate       = value(QMediaMetaData::VideoBitRate).toInt();
+    const int     mdAudioBitRate       = value(QMediaMetaData::AudioBitRate).toInt();
+    const qreal   mdVideoFrameRate     = value(QMediaMetaData::VideoFrameRate).toReal();
+
+    const QString someArtist = firstOf({ mdAuthor, mdAlbumArtist, mdLeadPerformer, mdAlbumTitle, mdContributingArtist });
+    const QString someTitle  = firstOf({ mdTitle, mdAlbumTitle });
+
+    const QString artist = (!someArtist.isEmpty()) ? someArtist : m_fallbackArtist;
+
+    QString title;
+    if (!someArtist.isEmpty() && !someTitle.isEmpty())
+        title = tr("%1 - %2").arg(someArtist).arg(someTitle);
+    else
+        title = firstOf({ mdTitle, mdAlbumTitle, mdAuthor, mdAlbumArtist, mdLeadPerformer, mdContributingArtist, m_fallbackTitle });
+
+    const auto kbps = [](const int bitRate) { return (QString::number(qRound(bitRate / 1000.0))); };
+    QString mediaInfo;
+    if (m_player && m_player->hasVideo()) {   // video case
+        if (!mdVideoCodec.isEmpty() && mdVideoBitRate)
+            mediaInfo = tr("%L2kbps - %1").arg(mdVideoCodec).arg(kbps(mdVideoBitRate));
+        else if (!mdVideoCodec.isEmpty() && !mdResolution.isEmpty() && (mdVideoFrameRate > 0.0))
+            mediaInfo = tr("%2 @ %L3fps - %1").arg(mdVideoCodec).arg(mdResolution).arg(QString::number(qRound(mdVideoFrameRate)));
+        else if (!mdVideoCodec.isEmpty() && !mdResolution.isEmpty())
+            mediaInfo = tr("%2 - %1").arg(mdVideoCodec).arg(mdResolution);
+        else if (!mdMediaType.isEmpty() && !mdResolution.isEmpty())
+            mediaInfo = tr("%2 - %1").arg(mdMediaType).arg(mdResolution);
+        else if (!mdResolution.isEmpty())
+            mediaInfo = mdResolution;
+        else if (mdVideoBitRate)
+            mediaInfo = tr("%L1kbps").arg(kbps(mdVideoBitRate));
+        else if (!mdVideoCodec.isEmpty() && (mdVideoCodec != QLatin1String("Invalid"))) //don't display when videoCodec returns "Invalid" (e.g. Odysee/Lbry stream).
+            mediaInfo = mdVideoCodec;
+        else
+            mediaInfo = mdMediaType;
+    }
+    else {                                    // audio case
+        if (!mdAudioCodec.isEmpty() && mdAudioBitRate)
+            mediaInfo = tr("%L2kbps - %1").arg(mdAudioCodec).arg(kbps(mdAudioBitRate));
+        else if (!mdMediaType.isEmpty() && mdAudioBitRate)
+            mediaInfo = tr("%L2kbps - %1").arg(mdMediaType).arg(kbps(mdAudioBitRate));
+        else if (mdAudioBitRate)
+            mediaInfo = tr("%L1kbps").arg(kbps(mdAudioBitRate));
+        else if (!mdMediaType.isEmpty())
+            mediaInfo = mdMediaType;
+        else if (!mdAudioCodec.isEmpty() && (mdAudioCodec != QLatin1String("Invalid"))) //don't display when audioCodec returns "Invalid" (e.g. Mixcloud HQ extracted MPD stream).
+            mediaInfo = mdAudioCodec;
+    }
+
+    if (m_title != title) {
+        m_title = title;
+        Q_EMIT titleChanged();
+    }
+    if (m_artist != artist) {
+        m_artist = artist;
+        Q_EMIT artistChanged();
+    }
+    if (m_mediaInfo != mediaInfo) {
+        m_mediaInfo = mediaInfo;
+        Q_EMIT mediaInfoChanged();
+    }
+}
@@ -0,0 +1,119 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MEDIAMETADATAMODEL_H
+#define MEDIAMETADATAMODEL_H
+
+#include <QAbstractListModel>
+#include <QMediaMetaData>   //Qt6 only, see qmlvideobug.pro
+#include <QMediaPlayer>
+#include <QPointer>
+#include <QUrl>
+#include <QVector>
+
+///
+/// \brief The MediaMetadataModel class
+///
+/// Replaces the JavaScript onMetaDataChanged loop and 'ListModel { dynamicRoles: true }'
+/// of MediaPlayer6.qml. Rows are keyed by QMediaMetaData::Key (sorted), with the same
+/// 'keyid', 'keystr' and 'value' roles as the ListModel it replaces. On each
+/// QMediaPlayer::metaDataChanged only the rows that were inserted, removed or changed
+/// are signalled. Cover-art and thumbnail QImages are implicitly shared with the
+/// player's QMediaMetaData, never copied.
+///
+/// The derived 'title', 'artist' and 'mediaInfo' strings formerly computed by
+/// MediaPlayer6.qml bindings over ~20 '_metadata_*' properties are computed here.
+///
+class MediaMetadataModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QObject *player          READ player         WRITE setPlayer         NOTIFY playerChanged)
+    Q_PROPERTY(QString  fallbackTitle   READ fallbackTitle  WRITE setFallbackTitle  NOTIFY fallbackTitleChanged)
+    Q_PROPERTY(QString  fallbackArtist  READ fallbackArtist WRITE setFallbackArtist NOTIFY fallbackArtistChanged)
+    Q_PROPERTY(int      count           READ count          NOTIFY countChanged)
+    Q_PROPERTY(QString  title           READ title          NOTIFY titleChanged)
+    Q_PROPERTY(QString  artist          READ artist         NOTIFY artistChanged)
+    Q_PROPERTY(QString  mediaInfo       READ mediaInfo      NOTIFY mediaInfoChanged)
+    Q_PROPERTY(QVariant coverArtImage   READ coverArtImage  NOTIFY coverArtImageChanged)
+    Q_PROPERTY(QVariant thumbnailImage  READ thumbnailImage NOTIFY thumbnailImageChanged)
+    Q_PROPERTY(QUrl     coverArtUrl     READ coverArtUrl    NOTIFY coverArtUrlChanged)    // "image://coverart/...", see coverartcache.h
+
+public:
+    enum Roles {
+        KeyIdRole = Qt::UserRole + 1,   // QMediaMetaData::Key
+        KeyStrRole,                     // QMediaMetaData::metaDataKeyToString()
+        ValueRole
+    };
+
+    explicit MediaMetadataModel(QObject *parent = nullptr);
+
+    int      rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    Q_INVOKABLE void     update(const QMediaMetaData &metaData);
+    Q_INVOKABLE void     clear();
+    Q_INVOKABLE QVariant value(const int key) const;       // by QMediaMetaData::Key
+    Q_INVOKABLE QString  stringValue(const int key) const;
+
+    QObject *player() const { return (m_player); }
+    void     setPlayer(QObject *player);
+    QString  fallbackTitle() const { return (m_fallbackTitle); }
+    void     setFallbackTitle(const QString &title);
+    QString  fallbackArtist() const { return (m_fallbackArtist); }
+    void     setFallbackArtist(const QString &artist);
+
+    int      count() const { return (m_entries.size()); }
+    QString  title() const { return (m_title); }
+    QString  artist() const { return (m_artist); }
+    QString  mediaInfo() const { return (m_mediaInfo); }
+    QVariant coverArtImage() const { return (value(QMediaMetaData::CoverArtImage)); }
+    QVariant thumbnailImage() const { return (value(QMediaMetaData::ThumbnailImage)); }
+    QUrl     coverArtUrl() const { return (m_coverArtUrl); }
+
+Q_SIGNALS:
+    void playerChanged();
+    void fallbackTitleChanged();
+    void fallbackArtistChanged();
+    void countChanged();
+    void titleChanged();
+    void artistChanged();
+    void mediaInfoChanged();
+    void coverArtImageChanged();
+    void thumbnailImageChanged();
+    void coverArtUrlChanged();
+
+private:
+    struct Entry {
+        QMediaMetaData::Key key;
+        QVariant            value;
+    };
+
+    int  indexOf(const QMediaMetaData::Key key) const;
+    void updateDerived();
+    void updateCoverArtUrl();
+
+    QVector<Entry>          m_entries;          // sorted by key
+    QMediaMetaData          m_metaData;         // implicitly shared with the player's
+    QPointer<QMediaPlayer>  m_player;
+    QString                 m_fallbackTitle;
+    QString                 m_fallbackArtist;
+    QString                 m_title;
+    QString                 m_artist;
+    QString                 m_mediaInfo;
+    QUrl                    m_coverArtUrl;
+};
+
+#endif // MEDIAMETADATAMODEL_H
@@ -0,0 +1,527 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mediaserver.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QTcpSocket>
+#include <QUrl>
+#include <QtMath>
+#include <QDebug>
+
+static const int     TICK_MS             = 10;
+static const int     REPORT_INTERVAL_MS  = 10000;
+static const int     MAX_REQUEST_BYTES   = 16 * 1024;
+static const qint64  HIGH_WATER_BYTES    = 64 * 1024;          // unsent in a socket, beyond which nothing more is written
+static const qint64  BUCKET_TICKS        = 10;                 // token bucket depth, in ticks of bandwidth
+
+// MPEG-1 Layer III, 128kbps, 44.1kHz, mono, no CRC: frames of 1152 samples in 417 bytes.
+static const int     MP3_KBPS            = 128;
+static const int     MP3_SAMPLE_RATE     = 44100;
+static const int     MP3_FRAME_SAMPLES   = 1152;
+static const int     MP3_FRAME_BYTES     = 144 * MP3_KBPS * 1000 / MP3_SAMPLE_RATE;
+static const qint64  ICY_BURST_BYTES     = 64 * 1024;          // sent on connect, as Icecast does, before pacing in real time
+static const int     ICY_METAINT         = 16000;
+static const int     HLS_SEGMENT_FRAMES  = 230;                // 6.008s
+static const int     HLS_WINDOW          = 5;                  // segments in the live playlist
+static const int     HLS_VOD_SEGMENTS    = 20;
+
+///
+/// \brief silentFrame -- an MPEG-1 Layer III frame whose side info is all zero: no main data, so it decodes to silence.
+///
+static QByteArray silentFrame() {
+    QByteArray frame(MP3_FRAME_BYTES, '\0');
+    frame[0] = char(0xFF);     // sync
+    frame[1] = char(0xFB);     // sync, MPEG-1, Layer III, no CRC
+    frame[2] = char(0x90);     // 128kbps, 44.1kHz, no padding
+    frame[3] = char(0xC4);     // mono, original
+    return (frame);
+}
+
+///
+/// \brief mp3Audio -- 'data' without a leading ID3v2 tag, and its bitrate from the first frame header (128kbps if there's none).
+///
+static QByteArray mp3Audio(const QByteArray &data, int *kbps) {
+    static const int BITRATES[16] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 };   // MPEG-1 Layer III
+    int start = 0;
+    if (data.startsWith("ID3") && (data.size() >= 10))
+        start = 10 + (  ((data.at(6) & 0x7f) << 21) | ((data.at(7) & 0x7f) << 14)
+                      | ((data.at(8) & 0x7f) << 7)  |  (data.at(9) & 0x7f));
+    *kbps = MP3_KBPS;
+    for (int i = start; i + 2 < data.size(); i++)
+        if ((uchar(data.at(i)) == 0xFF) && ((uchar(data.at(i + 1)) & 0xFE) == 0xFA)) {   // MPEG-1 Layer III sync
+            const int bitrate = BITRATES[uchar(data.at(i + 2)) >> 4];
+            if (bitrate > 0)
+                *kbps = bitrate;
+            return (data.mid(i));
+        }
+    return (data.mid(start));
+}
+
+///
+/// \brief hlsSegment -- packed audio: an ID3 PRIV transportStreamTimestamp of its start (90kHz), then silent frames.
+///
+static QByteArray hlsSegment(const qint64 index) {
+    static const QByteArray OWNER("com.apple.streaming.transportStreamTimestamp", 45);   // including the NUL
+    const quint64 pts = (quint64(index) * HLS_SEGMENT_FRAMES * MP3_FRAME_SAMPLES * 90000 / MP3_SAMPLE_RATE) & 0x1FFFFFFFFull;
+    QByteArray priv = OWNER;
+    for (int shift = 56; shift >= 0; shift -= 8)
+        priv.append(char((pts >> shift) & 0xFF));
+    QByteArray segment("ID3\x04\x00\x00", 6);
+    const int tagSize = 10 + priv.size();         // < 128, so syncsafe sizes are plain bytes
+    segment.append(QByteArray(3, '\0')).append(char(tagSize));
+    segment.append("PRIV").append(QByteArray(3, '\0')).append(char(priv.size())).append(QByteArray(2, '\0'));
+    segment.append(priv);
+    const QByteArray frame = silentFrame();
+    segment.reserve(segment.size() + HLS_SEGMENT_FRAMES * frame.size());
+    for (int i = 0; i < HLS_SEGMENT_FRAMES; i++)
+        segment.append(frame);
+    return (segment);
+}
+
+static qreal hlsSegmentSeconds() {
+    return (qreal(HLS_SEGMENT_FRAMES) * MP3_FRAME_SAMPLES / MP3_SAMPLE_RATE);
+}
+
+///
+/// \brief The BufferBody class -- a response held in memory, e.g. a playlist or an HLS segment.
+///
+class BufferBody : public ResponseBody
+{
+public:
+    explicit BufferBody(const QByteArray &data) : m_data(data) {}
+    QByteArray read(const qint64 max) override {
+        const QByteArray result = m_data.mid(int(m_offset), int(max));
+        m_offset += result.size();
+        return (result);
+    }
+    bool atEnd() const override { return (m_offset >= m_data.size()); }
+
+private:
+    QByteArray  m_data;
+    qint64      m_offset = 0;
+};
+
+///
+/// \brief The FileBody class -- 'length' bytes of a file from 'offset', i.e. a Range.
+///
+class FileBody : public ResponseBody
+{
+public:
+    FileBody(const QString &fileName, const qint64 offset, const qint64 length)
+        : m_file(fileName), m_remaining(length) {
+        if (!m_file.open(QIODevice::ReadOnly) || !m_file.seek(offset))
+            m_remaining = 0;
+    }
+    QByteArray read(const qint64 max) override {
+        const QByteArray result = m_file.read(qMin(max, m_remaining));
+        m_remaining = (result.isEmpty()) ? 0 : m_remaining - result.size();
+        return (result);
+    }
+    bool atEnd() const override { return (m_remaining <= 0); }
+
+private:
+    QFile       m_file;
+    qint64      m_remaining;
+};
+
+///
+/// \brief The IcyBody class -- 'audio' looped endlessly at 'kbps' in real time, after a burst; with ICY metadata every 'metaInt' bytes if non-zero.
+///
+class IcyBody : public ResponseBody
+{
+public:
+    IcyBody(const QByteArray &audio, const int kbps, const int metaInt, const QString &title)
+        : m_audio(audio), m_bytesPerSecond(qint64(kbps) * 1000 / 8), m_metaInt(metaInt), m_untilMeta(metaInt) {
+        QByteArray text = "StreamTitle='" + title.toUtf8().replace('\'', ' ') + "';";
+        text.append(QByteArray((16 - text.size() % 16) % 16, '\0'));
+        m_metadata = char(text.size() / 16) + text;
+        m_clock.start();
+    }
+    QByteArray read(const qint64 max) override {
+        qint64 allowed = qMin(max, ICY_BURST_BYTES + m_bytesPerSecond * m_clock.elapsed() / 1000 - m_sent);
+        QByteArray result;
+        while ((allowed > 0) && !m_audio.isEmpty()) {
+            qint64 n = qMin(allowed, qint64(m_audio.size()) - m_offset);
+            if (m_metaInt > 0)
+                n = qMin(n, m_untilMeta);
+            result.append(m_audio.constData() + m_offset, int(n));
+            m_offset     = (m_offset + n) % m_audio.size();
+            m_sent      += n;
+            allowed     -= n;
+            m_untilMeta -= n;
+            if ((m_metaInt > 0) && (m_untilMeta == 0)) {
+                result.append(m_metadata);
+                m_metadata  = QByteArray(1, '\0');      // unchanged, from now on
+                m_untilMeta = m_metaInt;
+            }
+        }
+        return (result);
+    }
+    bool atEnd() const override { return (false); }
+
+private:
+    QByteArray      m_audio;
+    qint64          m_bytesPerSecond;
+    qint64          m_metaInt;
+    qint64          m_untilMeta;
+    QByteArray      m_metadata;
+    QElapsedTimer   m_clock;
+    qint64          m_offset = 0;
+    qint64          m_sent   = 0;       // audio bytes
+};
+
+bool NetworkProfile::byName(const QString &name, NetworkProfile *profile) {
+    NetworkProfile p;
+    if (name == QLatin1String("none"))
+        ;
+    else if (name == QLatin1String("lan"))
+        { p.bandwidthKBps = 12500; p.latencyMs = 1;   p.jitterMs = 1; }
+    else if (name == QLatin1String("dsl"))
+        { p.bandwidthKBps = 1000;  p.latencyMs = 30;  p.jitterMs = 10; }
+    else if (name == QLatin1String("3g"))
+        { p.bandwidthKBps = 100;   p.latencyMs = 150; p.jitterMs = 50; }
+    else if (name == QLatin1String("2g"))
+        { p.bandwidthKBps = 20;    p.latencyMs = 500; p.jitterMs = 200; }
+    else if (name == QLatin1String("flaky"))
+        { p.bandwidthKBps = 100;   p.latencyMs = 150; p.jitterMs = 50; p.stallEverySeconds = 20; p.stallMs = 2000; }
+    else
+        return (false);
+    *profile = p;
+    return (true);
+}
+
+QStringList NetworkProfile::names() {
+    return ({ QStringLiteral("none"), QStringLiteral("lan"), QStringLiteral("dsl"),
+              QStringLiteral("3g"), QStringLiteral("2g"), QStringLiteral("flaky") });
+}
+
+MediaServer::MediaServer(const QString &mediaDirectory, const NetworkProfile &profile, const quint32 seed, QObject *parent)
+    : QObject(parent),
+      m_mediaDirectory(mediaDirectory),
+      m_profile(profile),
+      m_random(seed)
+{
+    m_clock.start();
+    m_tick.setInterval(TICK_MS);
+    m_tick.setTimerType(Qt::PreciseTimer);
+    connect(&m_tick, &QTimer::timeout, this, &MediaServer::onTick);
+    m_report.setInterval(REPORT_INTERVAL_MS);
+    connect(&m_report, &QTimer::timeout, this, &MediaServer::report);
+    connect(&m_server, &QTcpServer::newConnection, this, &MediaServer::onNewConnection);
+}
+
+MediaServer::~MediaServer() {
+    m_server.close();
+    for (Connection *connection : qAsConst(m_connections)) {
+        if (connection->socket)
+            connection->socket->disconnect(this);
+        delete connection;
+    }
+}
+
+bool MediaServer::listen(const QHostAddress &address, const quint16 port) {
+    if (!m_server.listen(address, port)) {
+        qWarning() << Q_FUNC_INFO << ": unable to listen on port" << port << m_server.errorString();
+        return (false);
+    }
+    m_tick.start();
+    m_report.start();
+    return (true);
+}
+
+void MediaServer::onNewConnection() {
+    while (m_server.hasPendingConnections()) {
+        QTcpSocket *socket = m_server.nextPendingConnection();
+        Connection *connection = new Connection;
+        connection->socket = socket;
+        m_connections.insert(socket, connection);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            delete m_connections.take(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MediaServer::onReadyRead(QTcpSocket *socket) {
+    Connection *connection = m_connections.value(socket);
+    if (!connection || connection->responding) {
+        socket->readAll();
+        return;
+    }
+    connection->request.append(socket->readAll());
+    if (connection->request.size() > MAX_REQUEST_BYTES) {
+        socket->abort();
+        return;
+    }
+    if (connection->request.contains("\r\n\r\n"))
+        respond(connection);
+}
+
+///
+/// \brief MediaServer::respond -- route the request; it's sent from onTick(), after the profile's latency.
+///
+void MediaServer::respond(Connection *connection) {
+    const QList<QByteArray> lines = connection->request.left(connection->request.indexOf("\r\n\r\n")).split('\n');
+    const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');   // "GET /path HTTP/1.1"
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.size(); i++) {
+        const int colon = lines.at(i).indexOf(':');
+        if (colon > 0)
+            headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+    }
+    connection->responding     = true;
+    connection->startAtMs      = m_clock.elapsed() + jittered(m_profile.latencyMs);
+    connection->nextStallAtMs  = qint64(m_profile.stallEverySeconds) * 1000;
+    connection->tokens         = 0;
+
+    if ((m_profile.maxConnections > 0) && (m_connections.size() > m_profile.maxConnections)) {
+        m_refused++;
+        connection->startAtMs = m_clock.elapsed();
+        reply(connection, "503 Service Unavailable", "text/plain", "too many connections\n", "Retry-After: 1\r\n");
+        return;
+    }
+    m_served++;
+    route(connection, requestLine.value(0), requestLine.value(1), headers);
+}
+
+void MediaServer::route(Connection *connection, const QByteArray &method, const QByteArray &target,
+                        const QHash<QByteArray, QByteArray> &headers) {
+    const bool head = (method == "HEAD");
+    if (!head && (method != "GET")) {
+        reply(connection, "405 Method Not Allowed", "text/plain", "GET or HEAD only\n");
+        return;
+    }
+    const QString    path = QUrl::fromPercentEncoding(target.left(target.indexOf('?')));
+    const QByteArray base = "http://" + headers.value("host", "127.0.0.1:" + QByteArray::number(port()));
+
+    if (path == QLatin1String("/")) {
+        QByteArray index = "qmlvideobug_server\n\n";
+        for (const char *endpoint : { "/media/default.mp4", "/stream/silence.mp3", "/hls/master.m3u8", "/hls/live.m3u8",
+                                      "/hls/vod.m3u8", "/playlist.m3u", "/playlist.pls" })
+            index += base + endpoint + '\n';
+        const QStringList files = QDir(m_mediaDirectory).entryList(QDir::Files, QDir::Name);
+        for (const QString &file : files)
+            index += base + "/media/" + QUrl::toPercentEncoding(file) + '\n';
+        reply(connection, "200 OK", "text/plain; charset=utf-8", index);
+    }
+    else if (path.startsWith(QLatin1String("/media/"))) {
+        const QString file = mediaFile(path.mid(7));
+        if (file.isEmpty())
+            reply(connection, "404 Not Found", "text/plain", "no such media\n");
+        else
+            replyFile(connection, file, headers.value("range"), head);
+    }
+    else if (path.startsWith(QLatin1String("/stream/"))) {
+        QByteArray audio;
+        int        kbps  = MP3_KBPS;
+        QString    title = path.mid(8);
+        if (title == QLatin1String("silence.mp3"))
+            audio = silentFrame();
+        else {
+            QFile file(mediaFile(title));
+            if (title.endsWith(QLatin1String(".mp3"), Qt::CaseInsensitive) && file.open(QIODevice::ReadOnly))
+                audio = mp3Audio(file.readAll(), &kbps);
+        }
+        if (audio.isEmpty()) {
+            reply(connection, "404 Not Found", "text/plain", "no such stream\n");
+            return;
+        }
+        const int metaInt = (headers.value("icy-metadata") == "1") ? ICY_METAINT : 0;
+        connection->head = "HTTP/1.0 200 OK\r\n"
+                           "Server: qmlvideobug_server\r\n"
+                           "Content-Type: audio/mpeg\r\n"
+                           "Cache-Control: no-cache\r\n"
+                           "icy-name: qmlvideobug_server " + title.toUtf8() + "\r\n"
+                           "icy-br: " + QByteArray::number(kbps) + "\r\n";
+        if (metaInt > 0)
+            connection->head += "icy-metaint: " + QByteArray::number(metaInt) + "\r\n";
+        connection->head += "\r\n";
+        if (!head)
+            connection->body.reset(new IcyBody(audio, kbps, metaInt, title));
+    }
+    else if (path == QLatin1String("/hls/master.m3u8"))
+        reply(connection, "200 OK", "application/vnd.apple.mpegurl",
+              "#EXTM3U\n"
+              "#EXT-X-STREAM-INF:BANDWIDTH=" + QByteArray::number(MP3_KBPS * 1000) + ",CODECS=\"mp4a.40.34\"\n"
+              "live.m3u8\n");
+    else if ((path == QLatin1String("/hls/live.m3u8")) || (path == QLatin1String("/hls/vod.m3u8")))
+        reply(connection, "200 OK", "application/vnd.apple.mpegurl", hlsPlaylist(path == QLatin1String("/hls/live.m3u8")));
+    else if (path.startsWith(QLatin1String("/hls/")) && path.endsWith(QLatin1String(".mp3"))) {
+        bool ok = false;
+        const qint64 index = path.mid(5, path.size() - 9).toLongLong(&ok);
+        if (ok && (index >= 0))
+            reply(connection, "200 OK", "audio/mpeg", hlsSegment(index));
+        else
+            reply(connection, "404 Not Found", "text/plain", "no such segment\n");
+    }
+    else if (path == QLatin1String("/playlist.m3u"))
+        reply(connection, "200 OK", "audio/x-mpegurl",
+              "#EXTM3U\n#EXTINF:-1,qmlvideobug_server silence\n" + base + "/stream/silence.mp3\n");
+    else if (path == QLatin1String("/playlist.pls"))
+        reply(connection, "200 OK", "audio/x-scpls",
+              "[playlist]\nFile1=" + base + "/stream/silence.mp3\nTitle1=qmlvideobug_server silence\nLength1=-1\n"
+              "NumberOfEntries=1\nVersion=2\n");
+    else
+        reply(connection, "404 Not Found", "text/plain", "not found\n");
+
+    if (head)
+        connection->body.reset();
+}
+
+void MediaServer::reply(Connection *connection, const QByteArray &status, const QByteArray &contentType,
+                        const QByteArray &body, const QByteArray &extraHeaders) {
+    connection->head = "HTTP/1.1 " + status + "\r\n"
+                       "Server: qmlvideobug_server\r\n"
+                       "Content-Type: " + contentType + "\r\n"
+                       "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                       + extraHeaders +
+                       "Connection: close\r\n\r\n";
+    connection->body.reset(new BufferBody(body));
+}
+
+///
+/// \brief MediaServer::replyFile -- with a single "bytes=first-last", "bytes=first-" or "bytes=-suffix" Range, if given.
+///
+void MediaServer::replyFile(Connection *connection, const QString &fileName, const QByteArray &range, const bool head) {
+    const qint64 size  = QFileInfo(fileName).size();
+    qint64       first = 0;
+    qint64       last  = size - 1;
+    const bool   ranged = range.startsWith("bytes=") && !range.contains(',');
+    if (ranged) {
+        const QByteArray spec = range.mid(6);
+        const int        dash = spec.indexOf('-');
+        bool okFirst = true, okLast = true;
+        if (dash == 0)
+            first = size - spec.mid(1).toLongLong(&okLast);
+        else {
+            first = spec.left(dash).toLongLong(&okFirst);
+            if (dash + 1 < spec.size())
+                last = qMin(last, spec.mid(dash + 1).toLongLong(&okLast));
+        }
+        first = qMax(qint64(0), first);
+        if ((dash < 0) || !okFirst || !okLast || (first > last)) {
+            reply(connection, "416 Range Not Satisfiable", "text/plain", QByteArray(),
+                  "Content-Range: bytes */" + QByteArray::number(size) + "\r\n");
+            return;
+        }
+    }
+    const QByteArray contentType = QMimeDatabase().mimeTypeForFile(fileName, QMimeDatabase::MatchExtension).name().toLatin1();
+    connection->head = QByteArray("HTTP/1.1 ") + ((ranged) ? "206 Partial Content" : "200 OK") + "\r\n"
+                       "Server: qmlvideobug_server\r\n"
+                       "Content-Type: " + contentType + "\r\n"
+                       "Content-Length: " + QByteArray::number(last - first + 1) + "\r\n"
+                       "Accept-Ranges: bytes\r\n";
+    if (ranged)
+        connection->head += "Content-Range: bytes " + QByteArray::number(first) + '-' + QByteArray::number(last)
+                            + '/' + QByteArray::number(size) + "\r\n";
+    connection->head += "Connection: close\r\n\r\n";
+    if (!head)
+        connection->body.reset(new FileBody(fileName, first, last - first + 1));
+}
+
+///
+/// \brief MediaServer::mediaFile -- 'name' in the media directory, "default.mp4" for its first .mp4; "" if there's none.
+///
+QString MediaServer::mediaFile(const QString &name) const {
+    if (m_mediaDirectory.isEmpty() || name.isEmpty() || name.contains(QLatin1Char('/')) || name.startsWith(QLatin1Char('.')))
+        return (QString());
+    QDir directory(m_mediaDirectory);
+    if (name == QLatin1String("default.mp4")) {
+        const QStringList mp4s = directory.entryList({ QStringLiteral("*.mp4") }, QDir::Files, QDir::Name);
+        return ((mp4s.isEmpty()) ? QString() : directory.absoluteFilePath(mp4s.first()));
+    }
+    return ((directory.exists(name)) ? directory.absoluteFilePath(name) : QString());
+}
+
+///
+/// \brief MediaServer::hlsPlaylist -- live: the last HLS_WINDOW segments of a timeline that began at startup; else HLS_VOD_SEGMENTS.
+///
+QByteArray MediaServer::hlsPlaylist(const bool live) const {
+    const qreal  seconds = hlsSegmentSeconds();
+    const qint64 first   = (live) ? qint64(m_clock.elapsed() / (seconds * 1000)) : 0;
+    const int    count   = (live) ? HLS_WINDOW : HLS_VOD_SEGMENTS;
+    QByteArray playlist = "#EXTM3U\n"
+                          "#EXT-X-VERSION:3\n"
+                          "#EXT-X-TARGETDURATION:" + QByteArray::number(qCeil(seconds)) + "\n"
+                          "#EXT-X-MEDIA-SEQUENCE:" + QByteArray::number(first) + "\n";
+    if (!live)
+        playlist += "#EXT-X-PLAYLIST-TYPE:VOD\n";
+    for (qint64 index = first; index < first + count; index++)
+        playlist += "#EXTINF:" + QByteArray::number(seconds, 'f', 3) + ",\n" + QByteArray::number(index) + ".mp3\n";
+    if (!live)
+        playlist += "#EXT-X-ENDLIST\n";
+    return (playlist);
+}
+
+qint64 MediaServer::jittered(const int ms) {
+    if ((ms <= 0) || (m_profile.jitterMs <= 0))
+        return (qMax(0, ms));
+    return (qMax(0, ms + int(m_random.bounded(-m_profile.jitterMs, m_profile.jitterMs + 1))));
+}
+
+///
+/// \brief MediaServer::onTick -- send what each connection's latency, stalls, token bucket and socket buffer allow.
+///
+void MediaServer::onTick() {
+    const qint64 now     = m_clock.elapsed();
+    const qint64 elapsed = qMax(qint64(1), now - m_lastTickMs);
+    m_lastTickMs = now;
+    const qint64 bytesPerSecond = qint64(m_profile.bandwidthKBps) * 1024;
+
+    const QList<QTcpSocket *> sockets = m_connections.keys();
+    for (QTcpSocket *socket : sockets) {
+        Connection *connection = m_connections.value(socket);
+        if (!connection || !connection->responding || (now < connection->startAtMs) || (now < connection->stalledUntilMs))
+            continue;
+        if (!connection->head.isEmpty()) {
+            socket->write(connection->head);
+            connection->head.clear();
+        }
+        if (connection->body) {
+            qint64 budget = HIGH_WATER_BYTES - socket->bytesToWrite();
+            if (bytesPerSecond > 0) {
+                connection->tokens = qMin(connection->tokens + bytesPerSecond * elapsed / 1000,
+                                          qMax(qint64(4096), bytesPerSecond * TICK_MS * BUCKET_TICKS / 1000));
+                budget = qMin(budget, connection->tokens);
+            }
+            if (budget > 0) {
+                const QByteArray data = connection->body->read(budget);
+                socket->write(data);
+                connection->tokens -= data.size();
+                connection->sent   += data.size();
+                m_bytes            += data.size();
+            }
+            if (m_profile.stallEverySeconds > 0) {
+                connection->sendingMs += elapsed;
+                if (connection->sendingMs >= connection->nextStallAtMs) {
+                    connection->stalledUntilMs = now + jittered(m_profile.stallMs);
+                    connection->nextStallAtMs += qint64(m_profile.stallEverySeconds) * 1000;
+                }
+            }
+        }
+        if ((!connection->body || connection->body->atEnd()) && (socket->bytesToWrite() == 0))
+            socket->disconnectFromHost();   // may delete 'connection', via disconnected()
+    }
+}
+
+void MediaServer::report() {
+    qInfo().noquote() << QStringLiteral("connections %1  served %2  refused %3  %4 KB/s")
+                         .arg(m_connections.size()).arg(m_served).arg(m_refused)
+                         .arg(m_bytes * 1000 / REPORT_INTERVAL_MS / 1024);
+    m_bytes = 0;
+}
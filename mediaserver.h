@@ -0,0 +1,132 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MEDIASERVER_H
+#define MEDIASERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QHostAddress>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QScopedPointer>
+#include <QTcpServer>
+#include <QTimer>
+
+class QTcpSocket;
+
+///
+/// \brief The NetworkProfile struct -- how MediaServer shapes each connection.
+///
+struct NetworkProfile {
+    int     bandwidthKBps       = 0;    // per connection, token bucket; 0 for unlimited
+    int     latencyMs           = 0;    // before the response headers
+    int     jitterMs            = 0;    // +/- on the latency and on each stall
+    int     stallEverySeconds   = 0;    // of sending; 0 for never
+    int     stallMs             = 0;
+    int     maxConnections      = 0;    // beyond which requests get "503 Service Unavailable"; 0 for unlimited
+
+    // presets: "none", "lan", "dsl", "3g", "2g" and "flaky" (3g with a 2s stall every 20s).
+    static bool        byName(const QString &name, NetworkProfile *profile);
+    static QStringList names();
+};
+
+///
+/// \brief The ResponseBody class -- what a connection sends after its headers, pulled as the shaping allows.
+///
+class ResponseBody
+{
+public:
+    virtual ~ResponseBody() {}
+    // up to 'max' bytes now; may return 0 until later, e.g. a real-time stream.
+    virtual QByteArray read(qint64 max) = 0;
+    virtual bool       atEnd() const = 0;
+};
+
+///
+/// \brief The MediaServer class
+///
+/// A local HTTP server for load-testing qmlvideobug offline, under controlled network conditions
+/// (see qmlvideobug_server.pro, and --local-server in main.cpp). It serves:
+///  - /media/<file>          files of the media directory, with Range requests (progressive MP4);
+///                           /media/default.mp4 is the first .mp4 there,
+///  - /stream/silence.mp3    an endless Icecast-style MP3 stream of synthesized silence, paced in
+///                           real time after a burst on connect, with ICY metadata on request,
+///  - /stream/<file>.mp3     a local MP3 file, likewise looped endlessly,
+///  - /hls/live.m3u8         live HLS packed audio (MP3 segments with ID3 timestamps), a sliding window,
+///  - /hls/vod.m3u8          the same, as a fixed-length playlist,
+///  - /hls/master.m3u8       a master playlist of live.m3u8,
+///  - /playlist.m3u, .pls    playlists of /stream/silence.mp3,
+/// each connection shaped by a NetworkProfile. All connections are serviced from one timer on one
+/// thread, every TICK_MS, so hundreds of clients cost little more than their bytes.
+///
+class MediaServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    MediaServer(const QString &mediaDirectory, const NetworkProfile &profile, const quint32 seed, QObject *parent = nullptr);
+    ~MediaServer() override;
+
+    bool    listen(const QHostAddress &address, const quint16 port);
+    quint16 port() const { return (m_server.serverPort()); }
+
+private:
+    struct Connection {
+        QPointer<QTcpSocket>        socket;
+        QByteArray                  request;        // until the headers are complete
+        QByteArray                  head;           // status line and headers to send
+        QScopedPointer<ResponseBody> body;
+        bool                        responding  = false;
+        qint64                      startAtMs   = 0;    // after the latency
+        qint64                      tokens      = 0;    // bytes
+        qint64                      sendingMs   = 0;    // time spent sending, towards the next stall
+        qint64                      stalledUntilMs = 0;
+        qint64                      nextStallAtMs  = 0; // of sendingMs
+        qint64                      sent        = 0;
+    };
+
+    void    onNewConnection();
+    void    onReadyRead(QTcpSocket *socket);
+    void    onTick();
+    void    respond(Connection *connection);
+    void    route(Connection *connection, const QByteArray &method, const QByteArray &path,
+                  const QHash<QByteArray, QByteArray> &headers);
+    void    reply(Connection *connection, const QByteArray &status, const QByteArray &contentType,
+                  const QByteArray &body, const QByteArray &extraHeaders = QByteArray());
+    void    replyFile(Connection *connection, const QString &fileName, const QByteArray &range, const bool head);
+    qint64  jittered(const int ms);
+    QString mediaFile(const QString &name) const;
+    QByteArray hlsPlaylist(const bool live) const;
+    void    report();
+
+    QTcpServer                      m_server;
+    QString                         m_mediaDirectory;
+    NetworkProfile                  m_profile;
+    QRandomGenerator                m_random;
+    QElapsedTimer                   m_clock;        // also the live HLS timeline
+    QTimer                          m_tick;
+    QTimer                          m_report;
+    QHash<QTcpSocket *, Connection *> m_connections;
+    qint64                          m_served    = 0;
+    qint64                          m_refused   = 0;
+    qint64                          m_bytes     = 0;    // since the last report
+    qint64                          m_lastTickMs = 0;
+};
+
+#endif // MEDIASERVER_H
@@ -0,0 +1,180 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "playbackclock.h"
+
+// when a new MediaPlayer position notification lands slightly behind what has already
+// been displayed, hold the displayed value rather than stepping backwards. Larger jumps
+// are treated as seeks and displayed immediately.
+static const qint64 MAX_BACKSTEP_MS = 250;
+
+PlaybackClock::PlaybackClock(QObject *parent)
+    : QObject(parent)
+{
+    m_ticker.setTimerType(Qt::PreciseTimer);
+    m_ticker.setInterval(20); //same 50fps as the QML Timer{} this replaces.
+    connect(&m_ticker, &QTimer::timeout, this, &PlaybackClock::tick);
+    m_sinceNotify.start();
+}
+
+///
+/// \brief PlaybackClock::setPlayerPosition
+/// \param position -- bound to mediaPlayer.position, which only updates every ~100ms.
+///
+void PlaybackClock::setPlayerPosition(const qint64 position) {
+    m_sinceNotify.restart();
+    if (m_playerPosition == position)
+        return;
+    m_playerPosition = position;
+    Q_EMIT playerPositionChanged();
+    publish(interpolated());
+}
+
+void PlaybackClock::setDuration(const qint64 duration) {
+    if (m_duration == duration)
+        return;
+    m_duration = duration;
+    Q_EMIT durationChanged();
+}
+
+void PlaybackClock::setPlaying(const bool playing) {
+    if (m_playing == playing)
+        return;
+    m_playing = playing;
+    m_sinceNotify.restart(); //don't extrapolate across the time spent paused.
+    Q_EMIT playingChanged();
+    updateRunning();
+}
+
+void PlaybackClock::setPlaybackRate(const qreal rate) {
+    if (qFuzzyCompare(m_playbackRate, rate))
+        return;
+    m_playbackRate = rate;
+    Q_EMIT playbackRateChanged();
+}
+
+void PlaybackClock::setActive(const bool active) {
+    if (m_active == active)
+        return;
+    m_active = active;
+    Q_EMIT activeChanged();
+    updateRunning();
+}
+
+void PlaybackClock::setInterval(const int milliseconds) {
+    if (m_ticker.interval() == milliseconds)
+        return;
+    m_ticker.setInterval(qMax(1, milliseconds));
+    Q_EMIT intervalChanged();
+}
+
+void PlaybackClock::setResolution(const int milliseconds) {
+    if (m_resolution == milliseconds)
+        return;
+    m_resolution = qMax(1, milliseconds);
+    Q_EMIT resolutionChanged();
+}
+
+void PlaybackClock::setPrefix(const QString &prefix) {
+    if (m_prefix == prefix)
+        return;
+    m_prefix = prefix;
+    Q_EMIT labelChanged();
+}
+
+void PlaybackClock::setSuffix(const QString &suffix) {
+    if (m_suffix == suffix)
+        return;
+    m_suffix = suffix;
+    Q_EMIT labelChanged();
+}
+
+///
+/// \brief PlaybackClock::positionText
+/// \return displayed position in seconds, to 4 decimals, as was done in main.qml
+///         via "(mediaPlayer.position/1000).toLocaleString(locale, 'f', 4)"
+///
+QString PlaybackClock::positionText() const {
+    return (m_locale.toString(m_displayPosition / 1000.0, 'f', 4));
+}
+
+QString PlaybackClock::label() const {
+    if (m_prefix.isEmpty() && m_suffix.isEmpty())
+        return (QString());
+    return (m_prefix + positionText() + m_suffix);
+}
+
+///
+/// \brief PlaybackClock::reset -- called when the media source changes.
+///
+void PlaybackClock::reset() {
+    m_playerPosition = 0;
+    m_duration       = 0;
+    m_sinceNotify.restart();
+    Q_EMIT playerPositionChanged();
+    Q_EMIT durationChanged();
+    if (m_displayPosition != 0) {
+        m_displayPosition = 0;
+        Q_EMIT displayPositionChanged();
+        Q_EMIT labelChanged();
+    }
+}
+
+void PlaybackClock::updateRunning() {
+    const bool run = (m_playing && m_active);
+    if (run == m_ticker.isActive())
+        return;
+    if (run)
+        m_ticker.start();
+    else {
+        m_ticker.stop();
+        publish(m_playerPosition); //settle on the actual reported position when stopping.
+    }
+    Q_EMIT runningChanged();
+}
+
+void PlaybackClock::tick() {
+    publish(interpolated());
+}
+
+qint64 PlaybackClock::interpolated() const {
+    if (!m_playing)
+        return (m_playerPosition);
+
+    qint64 result = m_playerPosition
+                  + qRound64(m_sinceNotify.elapsed() * m_playbackRate);
+    if (m_duration > 0)
+        result = qMin(result, m_duration);
+    return (result);
+}
+
+///
+/// \brief PlaybackClock::publish -- quantize and emit only if the displayed value changed.
+///
+void PlaybackClock::publish(qint64 position) {
+    position -= position % m_resolution;
+
+    if (   m_playing && (m_playbackRate > 0.0)
+        && (position < m_displayPosition)
+        && (m_displayPosition - position) < MAX_BACKSTEP_MS)
+        return;  //keep the display monotonic across small notification jitter.
+
+    if (position == m_displayPosition)
+        return;
+    m_displayPosition = position;
+    Q_EMIT displayPositionChanged();
+    if (!m_prefix.isEmpty() || !m_suffix.isEmpty())
+        Q_EMIT labelChanged();
+}
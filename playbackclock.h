@@ -0,0 +1,116 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PLAYBACKCLOCK_H
+#define PLAYBACKCLOCK_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <qplatformdefs.h> // defines QT_VERSION, etc
+
+///
+/// \brief The PlaybackClock class
+///
+/// Replaces the 20ms QML Timer{} that used to poll mediaPlayer.position and rebuild
+/// the footer string 50 times a second. MediaPlayer only notifies 'position' every
+/// ~100ms, so the clock interpolates between notifications using a monotonic clock,
+/// and only emits displayPositionChanged() when the (quantized) displayed value
+/// actually changes. The ticker is stopped entirely when paused or when the window
+/// is hidden/minimized/suspended ('active' false). The footer binds to 'label', which
+/// is formatted here rather than concatenated in JavaScript on every change.
+///
+class PlaybackClock : public QObject
+{
+    Q_OBJECT
+    // inputs, bound from main.qml to the current mediaPlayer and window state
+    Q_PROPERTY(qint64 playerPosition READ playerPosition WRITE setPlayerPosition NOTIFY playerPositionChanged)
+    Q_PROPERTY(qint64 duration       READ duration       WRITE setDuration       NOTIFY durationChanged)
+    Q_PROPERTY(bool   playing        READ playing        WRITE setPlaying        NOTIFY playingChanged)
+    Q_PROPERTY(qreal  playbackRate   READ playbackRate   WRITE setPlaybackRate   NOTIFY playbackRateChanged)
+    Q_PROPERTY(bool   active         READ active         WRITE setActive         NOTIFY activeChanged)
+    Q_PROPERTY(int    interval       READ interval       WRITE setInterval       NOTIFY intervalChanged)
+    Q_PROPERTY(int    resolution     READ resolution     WRITE setResolution     NOTIFY resolutionChanged)
+    Q_PROPERTY(QString prefix        READ prefix         WRITE setPrefix         NOTIFY labelChanged)
+    Q_PROPERTY(QString suffix        READ suffix         WRITE setSuffix         NOTIFY labelChanged)
+    // outputs
+    Q_PROPERTY(qint64  displayPosition READ displayPosition NOTIFY displayPositionChanged)
+    Q_PROPERTY(QString positionText    READ positionText    NOTIFY displayPositionChanged)
+    Q_PROPERTY(QString label           READ label           NOTIFY labelChanged)    // prefix + positionText + suffix; "" without either
+    Q_PROPERTY(bool    running         READ running         NOTIFY runningChanged)
+
+public:
+    explicit PlaybackClock(QObject *parent = nullptr);
+
+    qint64 playerPosition() const { return (m_playerPosition); }
+    void   setPlayerPosition(const qint64 position);
+    qint64 duration() const { return (m_duration); }
+    void   setDuration(const qint64 duration);
+    bool   playing() const { return (m_playing); }
+    void   setPlaying(const bool playing);
+    qreal  playbackRate() const { return (m_playbackRate); }
+    void   setPlaybackRate(const qreal rate);
+    bool   active() const { return (m_active); }
+    void   setActive(const bool active);
+    int    interval() const { return (m_ticker.interval()); }
+    void   setInterval(const int milliseconds);
+    int    resolution() const { return (m_resolution); }
+    void   setResolution(const int milliseconds);
+    QString prefix() const { return (m_prefix); }
+    void    setPrefix(const QString &prefix);
+    QString suffix() const { return (m_suffix); }
+    void    setSuffix(const QString &suffix);
+
+    qint64  displayPosition() const { return (m_displayPosition); }
+    QString positionText() const;
+    QString label() const;
+    bool    running() const { return (m_ticker.isActive()); }
+
+    Q_INVOKABLE void reset();
+
+Q_SIGNALS:
+    void playerPositionChanged();
+    void durationChanged();
+    void playingChanged();
+    void playbackRateChanged();
+    void activeChanged();
+    void intervalChanged();
+    void resolutionChanged();
+    void displayPositionChanged();
+    void labelChanged();
+    void runningChanged();
+
+private:
+    void   updateRunning();
+    void   tick();
+    qint64 interpolated() const;
+    void   publish(qint64 position);
+
+    QTimer          m_ticker;
+    QElapsedTimer   m_sinceNotify;              //monotonic time since last 'playerPosition' notification
+    QLocale         m_locale;                   //cached, QLocale() construction isn't free
+    QString         m_prefix;
+    QString         m_suffix;
+    qint64          m_playerPosition  = 0;
+    qint64          m_duration        = 0;
+    qint64          m_displayPosition = 0;
+    qreal           m_playbackRate    = 1.0;
+    int             m_resolution      = 1;      //quantize displayed position to this many ms
+    bool            m_playing         = false;
+    bool            m_active          = true;
+};
+
+#endif // PLAYBACKCLOCK_H
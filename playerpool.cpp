@@ -0,0 +1,261 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "playerpool.h"
+#include <QDateTime>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QDebug>
+
+static const int IDLE_CHECK_MS = 5000;
+
+PlayerPool::PlayerPool(QObject *parent)
+    : QObject(parent)
+{
+    m_idleTimer.setInterval(IDLE_CHECK_MS);
+    connect(&m_idleTimer, &QTimer::timeout, this, &PlayerPool::evictIdle);
+}
+
+void PlayerPool::setComponent(QQmlComponent *component) {
+    if (m_component == component)
+        return;
+    clear();
+    m_component = component;
+    Q_EMIT componentChanged();
+}
+
+///
+/// \brief PlayerPool::setVideoOutput -- for Qt6 the MediaPlayer names its VideoOutput; for Qt5 VideoOutput5.qml follows 'mediaPlayer'.
+///
+void PlayerPool::setVideoOutput(QObject *videoOutput) {
+    if (m_videoOutput == videoOutput)
+        return;
+    m_videoOutput = videoOutput;
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    if (m_active)
+        m_active->setProperty("videoOutput", QVariant::fromValue(videoOutput));
+#endif /* QT_VERSION... */
+    Q_EMIT videoOutputChanged();
+}
+
+void PlayerPool::setMaxStandby(const int count) {
+    if (m_maxStandby == qMax(0, count))
+        return;
+    m_maxStandby = qMax(0, count);
+    if (enabled())
+        m_idleTimer.start();
+    else
+        m_idleTimer.stop();
+    enforceLimits();
+    Q_EMIT limitsChanged();
+}
+
+void PlayerPool::setMaxConnections(const int count) {
+    if (m_maxConnections == qMax(1, count))
+        return;
+    m_maxConnections = qMax(1, count);
+    enforceLimits();
+    Q_EMIT limitsChanged();
+}
+
+void PlayerPool::setMemoryBudgetMB(const int mb) {
+    if (m_memoryBudgetMB == qMax(0, mb))
+        return;
+    m_memoryBudgetMB = qMax(0, mb);
+    enforceLimits();
+    Q_EMIT limitsChanged();
+}
+
+void PlayerPool::setPlayerMemoryMB(const int mb) {
+    if (m_playerMemoryMB == qMax(1, mb))
+        return;
+    m_playerMemoryMB = qMax(1, mb);
+    enforceLimits();
+    Q_EMIT limitsChanged();
+}
+
+void PlayerPool::setIdleTimeout(const int seconds) {
+    if (m_idleTimeout == qMax(1, seconds))
+        return;
+    m_idleTimeout = qMax(1, seconds);
+    Q_EMIT limitsChanged();
+}
+
+void PlayerPool::adopt(QObject *player) {
+    if (!player || (player == m_active))
+        return;
+    QQmlEngine::setObjectOwnership(player, QQmlEngine::CppOwnership);
+    setActive(player);
+}
+
+///
+/// \brief PlayerPool::isNetworkSource -- whether a player with this source holds a connection open.
+///
+bool PlayerPool::isNetworkSource(const QUrl &source) {
+    return (   !source.isEmpty()
+            && !source.isLocalFile()
+            && (source.scheme() != QLatin1String("qrc"))
+            && (source.scheme() != QLatin1String("content"))); //Android content:// uri
+}
+
+QUrl PlayerPool::sourceOf(QObject *player) {
+    return ((player) ? player->property("source").toUrl() : QUrl());
+}
+
+int PlayerPool::connectionCount() const {
+    int count = (isNetworkSource(sourceOf(m_active))) ? 1 : 0;
+    for (const Standby &s : m_standby)
+        if (isNetworkSource(s.source))
+            count++;
+    return (count);
+}
+
+///
+/// \brief PlayerPool::fits -- whether one more standby player for 'source' is within all limits.
+///
+bool PlayerPool::fits(const QUrl &source) const {
+    const int players = m_standby.size() + 1;                   // standby players after adding one
+    return (   (players <= m_maxStandby)
+            && ((players + 1) * m_playerMemoryMB <= m_memoryBudgetMB)   // ... plus the active player
+            && (!isNetworkSource(source) || (connectionCount() < m_maxConnections)));
+}
+
+///
+/// \brief PlayerPool::hasRoomFor -- whether 'source' fits alongside the active player alone, i.e. once preload() has evicted the rest.
+///
+bool PlayerPool::hasRoomFor(const QUrl &source) const {
+    if (!enabled() || !m_component || source.isEmpty() || (sourceOf(m_active) == source))
+        return (false);
+    const int activeConnections = (isNetworkSource(sourceOf(m_active))) ? 1 : 0;
+    return (   (2 * m_playerMemoryMB <= m_memoryBudgetMB)          // one standby plus the active player
+            && (!isNetworkSource(source) || (activeConnections < m_maxConnections)));
+}
+
+bool PlayerPool::preload(const QUrl &source) {
+    if (!hasRoomFor(source))
+        return (false);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (Standby &s : m_standby)
+        if (s.source == source) {
+            s.lastUsed = now;
+            return (true);
+        }
+
+    while (!fits(source))
+        if (!evictLeastRecentlyUsed())
+            return (false);      // nothing left to evict, and still over budget
+
+    QObject *player = m_component->beginCreate(m_component->creationContext());
+    if (!player) {
+        qWarning() << Q_FUNC_INFO << ": unable to create standby player:" << m_component->errorString();
+        return (false);
+    }
+    // parented like 'primaryPlayer' to main.qml's root, so that the engine destroys them together.
+    QQmlContext *context = m_component->creationContext();
+    player->setParent((context && context->contextObject()) ? context->contextObject() : this);
+    m_component->completeCreate();
+    QQmlEngine::setObjectOwnership(player, QQmlEngine::CppOwnership);
+
+    player->setProperty("source", source);
+    QMetaObject::invokeMethod(player, "pause");   // pre-roll: connect, probe and buffer, without playing
+    m_standby.append(Standby{ player, source, now });
+    Q_EMIT standbyCountChanged();
+    return (true);
+}
+
+bool PlayerPool::activate(const QUrl &source) {
+    int index = -1;
+    for (int i = 0; i < m_standby.size(); i++)
+        if ((m_standby.at(i).source == source) && m_standby.at(i).player) {
+            index = i;
+            break;
+        }
+    if (index < 0)
+        return (false);
+
+    QObject *player   = m_standby.takeAt(index).player;
+    QObject *previous = m_active;
+    if (previous) {
+        QMetaObject::invokeMethod(previous, "pause");
+        m_standby.append(Standby{ previous, sourceOf(previous), QDateTime::currentMSecsSinceEpoch() });
+    }
+    setActive(player);
+    enforceLimits();                                // previous may not fit
+    Q_EMIT standbyCountChanged();
+    return (true);
+}
+
+void PlayerPool::setActive(QObject *player) {
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    // a VideoOutput's sink can only be fed by one player at a time: detach the old one first.
+    if (m_active)
+        m_active->setProperty("videoOutput", QVariant::fromValue<QObject *>(nullptr));
+    if (player)
+        player->setProperty("videoOutput", QVariant::fromValue<QObject *>(m_videoOutput));
+#endif /* QT_VERSION... */
+    m_active = player;
+    Q_EMIT activePlayerChanged();
+}
+
+bool PlayerPool::evictLeastRecentlyUsed() {
+    if (m_standby.isEmpty())
+        return (false);
+    int oldest = 0;
+    for (int i = 1; i < m_standby.size(); i++)
+        if (m_standby.at(i).lastUsed < m_standby.at(oldest).lastUsed)
+            oldest = i;
+    destroyPlayer(m_standby.takeAt(oldest).player);
+    Q_EMIT standbyCountChanged();
+    return (true);
+}
+
+void PlayerPool::destroyPlayer(QObject *player) {
+    if (!player)
+        return;
+    QMetaObject::invokeMethod(player, "reset");   // stop() and release the source, see MediaPlayer[56].qml
+    player->deleteLater();
+}
+
+void PlayerPool::evictIdle() {
+    const qint64 cutoff = QDateTime::currentMSecsSinceEpoch() - (qint64(m_idleTimeout) * 1000);
+    bool changed = false;
+    for (int i = m_standby.size() - 1; i >= 0; i--)
+        if (!m_standby.at(i).player || (m_standby.at(i).lastUsed < cutoff)) {
+            destroyPlayer(m_standby.takeAt(i).player);
+            changed = true;
+        }
+    if (changed)
+        Q_EMIT standbyCountChanged();
+}
+
+///
+/// \brief PlayerPool::enforceLimits -- evict least recently used standby players until within all limits.
+///
+void PlayerPool::enforceLimits() {
+    while (   (m_standby.size() > m_maxStandby)
+           || ((m_standby.size() + 1) * m_playerMemoryMB > m_memoryBudgetMB)
+           || (connectionCount() > m_maxConnections))
+        if (!evictLeastRecentlyUsed())
+            break;
+}
+
+void PlayerPool::clear() {
+    if (m_standby.isEmpty())
+        return;
+    while (!m_standby.isEmpty())
+        destroyPlayer(m_standby.takeLast().player);
+    Q_EMIT standbyCountChanged();
+}
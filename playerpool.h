@@ -0,0 +1,125 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PLAYERPOOL_H
+#define PLAYERPOOL_H
+
+#include <QObject>
+#include <QPointer>
+#include <QQmlComponent>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+///
+/// \brief The PlayerPool class
+///
+/// Optional pool of pre-rolled standby media players for near-instant source switching.
+/// When an entry of main.qml's 'sourcesModel' is highlighted, preload() has a standby
+/// instance of 'component' (MediaPlayer5.qml or MediaPlayer6.qml) set that source and
+/// pause(), which pays the connect/probe/buffer cost ahead of time. activate() then
+/// only swaps the standby player in as 'activePlayer' (and, for Qt6, into the
+/// VideoOutput), and the previously active player is paused and kept as a standby,
+/// so flipping back is equally fast.
+///
+/// Standby players are limited by 'maxStandby', by 'maxConnections' (active plus standby
+/// players with a network source), and by 'memoryBudgetMB' at an estimated
+/// 'playerMemoryMB' each; the least recently used standby is evicted to make room.
+/// Standby players unused for 'idleTimeout' seconds are destroyed.
+/// With maxStandby 0 (the default) the pool is disabled and activate() always fails.
+///
+class PlayerPool : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQmlComponent *component   READ component      WRITE setComponent      NOTIFY componentChanged)
+    Q_PROPERTY(QObject *videoOutput       READ videoOutput    WRITE setVideoOutput    NOTIFY videoOutputChanged)
+    Q_PROPERTY(QObject *activePlayer      READ activePlayer   NOTIFY activePlayerChanged)
+    Q_PROPERTY(int   maxStandby           READ maxStandby     WRITE setMaxStandby     NOTIFY limitsChanged)
+    Q_PROPERTY(int   maxConnections       READ maxConnections WRITE setMaxConnections NOTIFY limitsChanged)
+    Q_PROPERTY(int   memoryBudgetMB       READ memoryBudgetMB WRITE setMemoryBudgetMB NOTIFY limitsChanged)
+    Q_PROPERTY(int   playerMemoryMB       READ playerMemoryMB WRITE setPlayerMemoryMB NOTIFY limitsChanged)
+    Q_PROPERTY(int   idleTimeout          READ idleTimeout    WRITE setIdleTimeout    NOTIFY limitsChanged)   // seconds
+    Q_PROPERTY(bool  enabled              READ enabled        NOTIFY limitsChanged)
+    Q_PROPERTY(int   standbyCount         READ standbyCount   NOTIFY standbyCountChanged)
+
+public:
+    explicit PlayerPool(QObject *parent = nullptr);
+
+    // take over main.qml's initially created player as 'activePlayer'.
+    Q_INVOKABLE void adopt(QObject *player);
+    // whether the limits allow a standby player for 'source' at all, evicting the others if need be.
+    Q_INVOKABLE bool hasRoomFor(const QUrl &source) const;
+    // pre-roll 'source' in a standby player, if the limits allow.
+    Q_INVOKABLE bool preload(const QUrl &source);
+    // make the standby player for 'source' active; false if there is none (then load it into activePlayer as usual).
+    Q_INVOKABLE bool activate(const QUrl &source);
+    Q_INVOKABLE void clear();
+
+    QQmlComponent *component() const { return (m_component); }
+    void     setComponent(QQmlComponent *component);
+    QObject *videoOutput() const { return (m_videoOutput); }
+    void     setVideoOutput(QObject *videoOutput);
+    QObject *activePlayer() const { return (m_active); }
+
+    int  maxStandby() const { return (m_maxStandby); }
+    void setMaxStandby(const int count);
+    int  maxConnections() const { return (m_maxConnections); }
+    void setMaxConnections(const int count);
+    int  memoryBudgetMB() const { return (m_memoryBudgetMB); }
+    void setMemoryBudgetMB(const int mb);
+    int  playerMemoryMB() const { return (m_playerMemoryMB); }
+    void setPlayerMemoryMB(const int mb);
+    int  idleTimeout() const { return (m_idleTimeout); }
+    void setIdleTimeout(const int seconds);
+    bool enabled() const { return (m_maxStandby > 0); }
+    int  standbyCount() const { return (m_standby.size()); }
+
+Q_SIGNALS:
+    void componentChanged();
+    void videoOutputChanged();
+    void activePlayerChanged();
+    void limitsChanged();
+    void standbyCountChanged();
+
+private:
+    struct Standby {
+        QPointer<QObject>   player;
+        QUrl                source;
+        qint64              lastUsed;   // QDateTime::currentMSecsSinceEpoch()
+    };
+
+    static bool isNetworkSource(const QUrl &source);
+    static QUrl sourceOf(QObject *player);
+    int     connectionCount() const;
+    bool    fits(const QUrl &source) const;
+    bool    evictLeastRecentlyUsed();
+    void    destroyPlayer(QObject *player);
+    void    evictIdle();
+    void    enforceLimits();
+    void    setActive(QObject *player);
+
+    QPointer<QQmlComponent> m_component;
+    QPointer<QObject>       m_videoOutput;
+    QPointer<QObject>       m_active;
+    QVector<Standby>        m_standby;
+    QTimer                  m_idleTimer;
+    int                     m_maxStandby     = 0;
+    int                     m_maxConnections = 4;
+    int                     m_memoryBudgetMB = 256;
+    int                     m_playerMemoryMB = 48;    // decoder, demuxer and network buffers of one pre-rolled player
+    int                     m_idleTimeout    = 120;
+};
+
+#endif // PLAYERPOOL_H
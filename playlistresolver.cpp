@@ -0,0 +1,334 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "playlistresolver.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QDebug>
+
+static const int    MAX_DEPTH           = 4;            // playlist of playlists of ...
+static const qint64 MAX_PLAYLIST_BYTES  = 256 * 1024;   // give up on anything bigger
+static const int    TRANSFER_TIMEOUT_MS = 10000;
+static const int    LOCAL_CHUNK_BYTES   = 4096;
+
+///
+/// \brief attributeValue -- e.g. "BANDWIDTH" of '#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=96000,CODECS="mp4a.40.5"'
+///
+static QByteArray attributeValue(const QByteArray &line, const QByteArray &name) {
+    const QByteArray key = name + '=';
+    int at = line.indexOf(key);
+    while ((at > 0) && (line.at(at - 1) != ':') && (line.at(at - 1) != ','))   // not e.g. "AVERAGE-BANDWIDTH="
+        at = line.indexOf(key, at + 1);
+    if (at < 0)
+        return (QByteArray());
+    const int begin = at + key.size();
+    const int end   = line.indexOf(',', begin);
+    return (line.mid(begin, (end < 0) ? -1 : (end - begin)));
+}
+
+PlaylistParser::Result PlaylistParser::feedLine(const QByteArray &rawLine) {
+    QByteArray line = rawLine.trimmed();
+    if (m_firstLine && line.startsWith("\xEF\xBB\xBF"))   // UTF-8 BOM
+        line = line.mid(3).trimmed();
+    if (line.isEmpty())
+        return (Result());
+
+    if (m_firstLine) {
+        m_firstLine = false;
+        if (line.toLower() == "[playlist]") {
+            m_format = PLS;
+            return (Result());
+        }
+        m_format = M3U;           // extended ('#EXTM3U') or plain, one URI per line
+    }
+
+    if (m_format == PLS) {        // File1=http://...
+        const int equals = line.indexOf('=');
+        if (   (equals > 4)
+            && line.left(4).toLower() == "file") {
+            bool numbered = false;
+            line.mid(4, equals - 4).toInt(&numbered);
+            if (numbered)
+                return (Result{ Entry, QString::fromUtf8(line.mid(equals + 1).trimmed()) });
+        }
+        return (Result());
+    }
+
+    if (line.startsWith('#')) {
+        if (line.startsWith("#EXT-X-STREAM-INF:")) {
+            m_streamInf = true;
+            m_bandwidth = attributeValue(line, "BANDWIDTH").toLongLong();
+        }
+        // tags only an HLS media playlist has: '#EXTINF' titles the next entry of any extended M3U, and
+        // '#EXT-X-VERSION' also heads master playlists, whose '#EXT-X-STREAM-INF' variants are resolved.
+        else if (   line.startsWith("#EXT-X-TARGETDURATION:")
+                 || line.startsWith("#EXT-X-MEDIA-SEQUENCE:")
+                 || line.startsWith("#EXT-X-PLAYLIST-TYPE:")
+                 || line.startsWith("#EXT-X-ENDLIST")) {
+            if (!m_streamInf && m_lowestVariant.isEmpty())  // HLS media playlist: hand the backend the playlist
+                return (Result{ Self, QString() });
+        }
+        return (Result());
+    }
+
+    const QString uri = QString::fromUtf8(line);
+    if (!m_streamInf)
+        return (Result{ Entry, uri });
+
+    m_streamInf = false;
+    if ((m_maxBandwidth <= 0) || ((m_bandwidth > 0) && (m_bandwidth <= m_maxBandwidth)))
+        return (Result{ Variant, uri });
+    if ((m_lowestBandwidth < 0) || (m_bandwidth < m_lowestBandwidth)) {
+        m_lowestBandwidth = m_bandwidth;
+        m_lowestVariant   = uri;
+    }
+    return (Result());
+}
+
+PlaylistParser::Result PlaylistParser::finish() {
+    if (!m_lowestVariant.isEmpty())
+        return (Result{ Variant, m_lowestVariant });
+    return (Result());
+}
+
+PlaylistResolver::PlaylistResolver(QObject *parent)
+    : QObject(parent)
+{
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))   //the default for Qt6
+    m_network.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+#endif /* QT_VERSION... */
+}
+
+bool PlaylistResolver::isPlaylist(const QUrl &url) {
+    if (!url.isValid())
+        return (false);
+    const QString suffix = QFileInfo(url.path()).suffix().toLower();
+    return (   (suffix == QLatin1String("m3u"))
+            || (suffix == QLatin1String("m3u8"))
+            || (suffix == QLatin1String("pls")));
+}
+
+void PlaylistResolver::setMaxBandwidth(const qint64 bitsPerSecond) {
+    if (m_maxBandwidth == bitsPerSecond)
+        return;
+    m_maxBandwidth = bitsPerSecond;
+    clearCache();
+    Q_EMIT maxBandwidthChanged();
+}
+
+void PlaylistResolver::setCacheTtl(const int seconds) {
+    if (m_cacheTtl == seconds)
+        return;
+    m_cacheTtl = seconds;
+    Q_EMIT cacheTtlChanged();
+}
+
+void PlaylistResolver::setNegativeCacheTtl(const int seconds) {
+    if (m_negativeCacheTtl == seconds)
+        return;
+    m_negativeCacheTtl = seconds;
+    Q_EMIT cacheTtlChanged();
+}
+
+void PlaylistResolver::clearCache() {
+    m_cache.clear();
+}
+
+bool PlaylistResolver::resolve(const QUrl &url) {
+    if (!isPlaylist(url))
+        return (false);
+
+    const auto cached = m_cache.constFind(url);
+    if (cached != m_cache.constEnd()) {
+        if (cached->expires > QDateTime::currentMSecsSinceEpoch()) {
+            const CacheEntry entry = *cached;
+            QMetaObject::invokeMethod(this, [this, url, entry]() {
+                Q_EMIT resolved(url, entry.playable, entry.error);
+            }, Qt::QueuedConnection);
+            return (true);
+        }
+        m_cache.erase(cached);
+    }
+
+    if (m_jobs.contains(url))      // already in progress: resolved() will follow
+        return (true);
+
+    Job *job = new Job;
+    job->requested = url;
+    job->current   = url;
+    m_jobs.insert(url, job);
+    fetch(job);
+    return (true);
+}
+
+void PlaylistResolver::cancel(const QUrl &url) {
+    Job *job = m_jobs.take(url);
+    if (!job)
+        return;
+    if (job->reply) {
+        job->reply->disconnect(this);
+        job->reply->abort();
+        job->reply->deleteLater();
+    }
+    delete job;
+}
+
+void PlaylistResolver::fetch(Job *job) {
+    job->received = 0;
+    job->pending.clear();
+    job->parser   = PlaylistParser(m_maxBandwidth);
+
+    if (job->current.isLocalFile()) {
+        const QUrl requested = job->requested;
+        QMetaObject::invokeMethod(this, [this, requested, job]() {
+            if (m_jobs.value(requested) == job)   // not cancelled meanwhile
+                readLocal(job);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    QNetworkRequest request(job->current);
+    request.setTransferTimeout(TRANSFER_TIMEOUT_MS);
+    QNetworkReply *reply = m_network.get(request);
+    job->reply = reply;
+    connect(reply, &QNetworkReply::readyRead, this, [this, job]() { onReadyRead(job); });
+    connect(reply, &QNetworkReply::finished,  this, [this, job]() { onFinished(job); });
+}
+
+void PlaylistResolver::readLocal(Job *job) {
+    QFile file(job->current.toLocalFile());
+    if (!file.open(QIODevice::ReadOnly)) {
+        finish(job, QUrl(), file.errorString());
+        return;
+    }
+    while (!file.atEnd())
+        if (consume(job, file.read(LOCAL_CHUNK_BYTES), false))
+            return;
+    consume(job, QByteArray(), true);
+}
+
+void PlaylistResolver::onReadyRead(Job *job) {
+    QNetworkReply *reply = job->reply;
+    if (job->received == 0) {
+        // a playlist-like url that actually serves media (e.g. some Icecast '.m3u' mounts) is playable as is.
+        const QString type = reply->header(QNetworkRequest::ContentTypeHeader).toString().toLower();
+        if (   (type.startsWith(QLatin1String("audio/")) || type.startsWith(QLatin1String("video/")))
+            && !type.contains(QLatin1String("mpegurl"))
+            && !type.contains(QLatin1String("scpls"))) {
+            finish(job, reply->url());
+            return;
+        }
+    }
+    consume(job, reply->readAll(), false);
+}
+
+void PlaylistResolver::onFinished(Job *job) {
+    QNetworkReply *reply = job->reply;
+    if (reply->error() != QNetworkReply::NoError) {
+        finish(job, QUrl(), reply->errorString());
+        return;
+    }
+    consume(job, reply->readAll(), true);
+}
+
+///
+/// \brief PlaylistResolver::consume -- parse the complete lines in 'bytes'.
+/// \return true once 'job' is finished (and deleted), or recursed into a nested playlist.
+///
+bool PlaylistResolver::consume(Job *job, const QByteArray &bytes, const bool atEnd) {
+    job->received += bytes.size();
+    if (job->received > MAX_PLAYLIST_BYTES) {
+        finish(job, QUrl(), tr("playlist larger than %1 bytes").arg(MAX_PLAYLIST_BYTES));
+        return (true);
+    }
+
+    job->pending.append(bytes);
+    int begin = 0;
+    for (int end = job->pending.indexOf('\n'); end >= 0; end = job->pending.indexOf('\n', begin)) {
+        if (accept(job, job->parser.feedLine(job->pending.mid(begin, end - begin))))
+            return (true);
+        begin = end + 1;
+    }
+    job->pending.remove(0, begin);
+
+    if (!atEnd)
+        return (false);
+    if (   accept(job, job->parser.feedLine(job->pending))
+        || accept(job, job->parser.finish()))
+        return (true);
+    finish(job, QUrl(), tr("no playable entry in playlist"));
+    return (true);
+}
+
+///
+/// \brief PlaylistResolver::accept -- act on a parser result.
+/// \return true if 'job' is finished, or now fetching a nested playlist.
+///
+bool PlaylistResolver::accept(Job *job, const PlaylistParser::Result &result) {
+    const QUrl base = (job->reply) ? job->reply->url() : job->current;   // after redirects
+    switch (result.kind) {
+    case PlaylistParser::None:
+        return (false);
+    case PlaylistParser::Self:
+        finish(job, base);
+        return (true);
+    case PlaylistParser::Variant:
+        finish(job, base.resolved(QUrl(result.uri, QUrl::TolerantMode)));
+        return (true);
+    case PlaylistParser::Entry:
+        break;
+    }
+
+    const QUrl entry = base.resolved(QUrl(result.uri, QUrl::TolerantMode));
+    if (!entry.isValid())
+        return (false);                                     // skip, try the next entry
+    if (!isPlaylist(entry) || (job->depth >= MAX_DEPTH)) {
+        finish(job, entry);
+        return (true);
+    }
+
+    if (job->reply) {                                       // follow the nested playlist
+        job->reply->disconnect(this);
+        job->reply->abort();
+        job->reply->deleteLater();
+        job->reply = nullptr;
+    }
+    job->current = entry;
+    job->depth++;
+    fetch(job);
+    return (true);
+}
+
+void PlaylistResolver::finish(Job *job, const QUrl &playable, const QString &error) {
+    if (job->reply) {
+        job->reply->disconnect(this);
+        job->reply->abort();       // no need for the rest of the document
+        job->reply->deleteLater();
+    }
+    m_jobs.remove(job->requested);
+
+    const int ttl = (playable.isEmpty()) ? m_negativeCacheTtl : m_cacheTtl;
+    m_cache.insert(job->requested, CacheEntry{ playable, error,
+                                               QDateTime::currentMSecsSinceEpoch() + (qint64(ttl) * 1000) });
+    if (!error.isEmpty())
+        qWarning() << Q_FUNC_INFO << ":" << job->requested << "--" << error;
+
+    const QUrl requested = job->requested;
+    delete job;
+    Q_EMIT resolved(requested, playable, error);
+}
@@ -0,0 +1,145 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PLAYLISTRESOLVER_H
+#define PLAYLISTRESOLVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QPointer>
+#include <QUrl>
+
+class QNetworkReply;
+
+///
+/// \brief The PlaylistParser class -- incremental, line at a time, M3U/M3U8/PLS parser.
+///
+/// Feed it lines as they arrive; it answers as soon as the first playable entry is seen:
+///  - the first 'FileN=' entry of a PLS '[playlist]',
+///  - the first URI line of a plain or extended M3U,
+///  - for an HLS master playlist, the first '#EXT-X-STREAM-INF' variant within
+///    'maxBandwidth' (or the first variant, the spec's default, with maxBandwidth 0),
+///    otherwise, once the document is finished, the lowest bandwidth variant,
+///  - for an HLS media playlist ('#EXT-X-TARGETDURATION' etc.), the playlist itself, which backends play.
+///
+class PlaylistParser
+{
+public:
+    enum Kind {
+        None,       // need more lines
+        Entry,      // a playlist entry, which may itself be a playlist
+        Variant,    // an HLS variant (media playlist), playable as is
+        Self        // the document is itself playable (HLS media playlist)
+    };
+    struct Result {
+        Kind    kind = None;
+        QString uri;          // unresolved, for Entry and Variant
+    };
+
+    explicit PlaylistParser(const qint64 maxBandwidth = 0) : m_maxBandwidth(maxBandwidth) {}
+
+    Result feedLine(const QByteArray &line);
+    Result finish();          // end of document
+
+private:
+    enum Format { Unknown, M3U, PLS };
+
+    Format  m_format        = Unknown;
+    bool    m_firstLine     = true;
+    bool    m_streamInf     = false;   // the next URI line is a variant
+    qint64  m_bandwidth     = 0;       // of that variant
+    qint64  m_maxBandwidth;
+    QString m_lowestVariant;
+    qint64  m_lowestBandwidth = -1;
+};
+
+///
+/// \brief The PlaylistResolver class
+///
+/// Resolves M3U/M3U8/PLS playlist URLs -- which the multimedia backends either
+/// can't decode ("No decoder available for type 'text/uri-list'") or report as
+/// invalid media -- to the first playable URL, before handing it to the player.
+/// The playlist is parsed incrementally as bytes arrive and the download is aborted
+/// as soon as a playable entry is found. Relative entries are resolved against the
+/// playlist's (post-redirect) URL; nested playlists are followed to a limited depth.
+/// Works for http(s) and local files alike.
+///
+/// Results are cached: successes for 'cacheTtl' seconds, failures for 'negativeCacheTtl'.
+///
+class PlaylistResolver : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(qint64 maxBandwidth      READ maxBandwidth     WRITE setMaxBandwidth     NOTIFY maxBandwidthChanged)   // bits/s, 0 for HLS' default variant
+    Q_PROPERTY(int    cacheTtl          READ cacheTtl         WRITE setCacheTtl         NOTIFY cacheTtlChanged)
+    Q_PROPERTY(int    negativeCacheTtl  READ negativeCacheTtl WRITE setNegativeCacheTtl NOTIFY cacheTtlChanged)
+
+public:
+    explicit PlaylistResolver(QObject *parent = nullptr);
+
+    // true if 'url' looks like a playlist (by extension), i.e. resolve() would fetch it.
+    Q_INVOKABLE static bool isPlaylist(const QUrl &url);
+    // false if 'url' isn't a playlist: play it as is. Otherwise resolved() follows, always asynchronously.
+    Q_INVOKABLE bool resolve(const QUrl &url);
+    Q_INVOKABLE void cancel(const QUrl &url);
+    Q_INVOKABLE void clearCache();
+
+    qint64 maxBandwidth() const { return (m_maxBandwidth); }
+    void   setMaxBandwidth(const qint64 bitsPerSecond);
+    int    cacheTtl() const { return (m_cacheTtl); }
+    void   setCacheTtl(const int seconds);
+    int    negativeCacheTtl() const { return (m_negativeCacheTtl); }
+    void   setNegativeCacheTtl(const int seconds);
+
+Q_SIGNALS:
+    // 'playable' is empty on failure, with 'error' set.
+    void resolved(const QUrl &url, const QUrl &playable, const QString &error);
+    void maxBandwidthChanged();
+    void cacheTtlChanged();
+
+private:
+    struct Job {
+        QUrl                    requested;
+        QUrl                    current;        // the playlist being fetched, maybe nested
+        int                     depth   = 0;
+        qint64                  received = 0;
+        QByteArray              pending;        // incomplete last line
+        PlaylistParser          parser;
+        QPointer<QNetworkReply> reply;
+    };
+    struct CacheEntry {
+        QUrl    playable;
+        QString error;
+        qint64  expires;                        // QDateTime::currentMSecsSinceEpoch()
+    };
+
+    void fetch(Job *job);
+    void readLocal(Job *job);
+    void onReadyRead(Job *job);
+    void onFinished(Job *job);
+    bool consume(Job *job, const QByteArray &bytes, const bool atEnd);
+    bool accept(Job *job, const PlaylistParser::Result &result);
+    void finish(Job *job, const QUrl &playable, const QString &error = QString());
+
+    QNetworkAccessManager       m_network;
+    QHash<QUrl, Job *>          m_jobs;         // by requested url
+    QHash<QUrl, CacheEntry>     m_cache;
+    qint64                      m_maxBandwidth      = 0;
+    int                         m_cacheTtl          = 300;
+    int                         m_negativeCacheTtl  = 30;
+};
+
+#endif // PLAYLISTRESOLVER_H
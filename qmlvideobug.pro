@@ -1,4 +1,4 @@
-QT += quick quickcontrols2 multimedia
+QT += quick quickcontrols2 multimedia network
 
 
 equals(QT_MAJOR_VERSION, 5):android {
@@ -7,13 +7,16 @@ equals(QT_MAJOR_VERSION, 5):android {
 
 
 CONFIG += c++11
+CONFIG += qtquickcompiler   ## compile the qrc QML (incl. MediaPlayer[56].qml, VideoOutput[56].qml) ahead of time
 DEFINES += QT_DEPRECATED_WARNINGS
-SOURCES += main.cpp utils.cpp
-HEADERS += utils.h
+SOURCES += main.cpp utils.cpp playbackclock.cpp videoframesource.cpp frameinspector.cpp coverartcache.cpp startuptracer.cpp playerpool.cpp playlistresolver.cpp cachingproxy.cpp medialibrary.cpp audioanalysis.cpp stressmonitor.cpp sessionjournal.cpp tracelogger.cpp latencyhistogram.cpp qoemonitor.cpp framepacing.cpp filmstrip.cpp seekscheduler.cpp
+HEADERS += utils.h playbackclock.h videoframesource.h frameinspector.h coverartcache.h startuptracer.h playerpool.h playlistresolver.h cachingproxy.h medialibrary.h audioanalysis.h spscring.h stressmonitor.h sessionjournal.h tracelogger.h latencyhistogram.h qoemonitor.h framepacing.h filmstrip.h seekscheduler.h
 RESOURCES += qml.qrc
 
 equals(QT_MAJOR_VERSION, 6) { ## for Qt6 use MediaPlayer6.qml
     RESOURCES += qml6.qrc
+    SOURCES += mediametadatamodel.cpp   ## QMediaMetaData::Key is Qt6-only
+    HEADERS += mediametadatamodel.h
 }
 else {                        ## for Qt5 use MediaPlayer5.qml
     RESOURCES += qml5.qrc
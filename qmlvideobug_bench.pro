@@ -0,0 +1,15 @@
+## Headless benchmark variant of qmlvideobug: loads the same main.qml under the
+## offscreen platform & software Qt Quick backend, plays the local media files given
+## on the command line, and writes JSON results (see benchrunner.h). e.g.
+##      qmlvideobug_bench --seconds=30 --output=results-qt$$QT_VERSION.json bbb.mp4 sample.m4a
+## or benchmarks the Utils formatters against their former implementations (see utilsbench.h):
+##      qmlvideobug_bench --utils=1000000 --output=utils-qt$$QT_VERSION.json
+## (allocations per call are counted by qmlvideobug_utilsbench.pro only).
+
+TARGET = qmlvideobug_bench
+include(qmlvideobug.pro)
+
+CONFIG += console
+DEFINES += QMLVIDEOBUG_BENCH
+SOURCES += benchrunner.cpp utilsbench.cpp
+HEADERS += benchrunner.h utilsbench.h
@@ -0,0 +1,14 @@
+## Local shaped-network media server for load-testing qmlvideobug offline (see mediaserver.h):
+## progressive MP4 with Range requests, endless Icecast-style MP3, HLS packed audio and
+## M3U/PLS playlists, each connection shaped by a bandwidth/latency/jitter/stall profile. e.g.
+##      qmlvideobug_server --port=8080 --media=$$HOME/Videos --profile=3g
+##      qmlvideobug --local-server=http://127.0.0.1:8080 --players=100 --qoe-port=9100
+
+TARGET = qmlvideobug_server
+QT = core network
+CONFIG += console c++11
+CONFIG -= app_bundle
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += servermain.cpp mediaserver.cpp
+HEADERS += mediaserver.h
@@ -0,0 +1,10 @@
+## qmlvideobug_bench, counting heap allocations per call in its --utils benchmark (see allocationcounter.h).
+## Every allocation of every thread is counted, so use qmlvideobug_bench for the playback benchmarks. e.g.
+##      qmlvideobug_utilsbench --utils=1000000 --output=utils-qt$$QT_VERSION.json
+
+include(qmlvideobug_bench.pro)
+TARGET = qmlvideobug_utilsbench
+
+DEFINES += QMLVIDEOBUG_ALLOCATION_COUNTER
+SOURCES += allocationcounter.cpp
+HEADERS += allocationcounter.h
@@ -0,0 +1,374 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "qoemonitor.h"
+#include "tracelogger.h"
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QDebug>
+
+static const int     MAX_REQUEST_BYTES  = 8 * 1024;   // of a scrape's request line and headers
+static const int     BUCKET_POWERS      = 21;         // histogram 'le' bounds exposed: 1ms .. 2^20ms (~17 minutes)
+
+QoEMonitor::QoEMonitor(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+    // frameArrived() is emitted on the decoder/render thread: note only the first of a session, on the GUI thread.
+    connect(&m_frames, &VideoFrameSource::frameArrived, this, [this](const QVideoFrame &) {
+        if (!m_awaitingFrame.exchange(false))
+            return;
+        QMetaObject::invokeMethod(this, [this]() { onFirstFrame(); }, Qt::QueuedConnection);
+    }, Qt::DirectConnection);
+    connect(&m_server, &QTcpServer::newConnection, this, &QoEMonitor::onNewConnection);
+}
+
+QoEMonitor::~QoEMonitor() {
+    m_server.close();
+    m_frames.detach();
+}
+
+bool QoEMonitor::listen(const quint16 port) {
+    if (!m_server.listen(QHostAddress::LocalHost, port)) {
+        qWarning() << Q_FUNC_INFO << ": unable to listen on port" << port << m_server.errorString();
+        return (false);
+    }
+    Q_EMIT listeningChanged();
+    return (true);
+}
+
+///
+/// \brief QoEMonitor::attach
+/// \param qmlPlayer -- main.qml's 'mediaPlayer'; follows PlayerPool's active player.
+/// \return false if 'qmlPlayer' isn't backed by a QMediaPlayer.
+///
+bool QoEMonitor::attach(QObject *qmlPlayer) {
+    if (qmlPlayer == m_qmlPlayer)
+        return (m_player != nullptr);
+    if (m_qmlPlayer)
+        disconnect(m_qmlPlayer, nullptr, this, nullptr);
+    if (m_player)
+        disconnect(m_player, nullptr, this, nullptr);
+    m_frames.detach();
+    m_qmlPlayer = qmlPlayer;
+    m_player    = VideoFrameSource::mediaPlayerFor(qmlPlayer);
+    if (!m_player)
+        return (false);
+
+    connect(qmlPlayer, SIGNAL(mediaLoading()),  this, SLOT(onMediaLoading()));
+    connect(qmlPlayer, SIGNAL(mediaStalled()),  this, SLOT(onMediaStalled()));
+    connect(qmlPlayer, SIGNAL(mediaBuffered()), this, SLOT(onMediaBuffered()));
+    connect(qmlPlayer, SIGNAL(mediaEnded()),    this, SLOT(onMediaEnded()));
+    connect(qmlPlayer, SIGNAL(mediaInvalid()),  this, SLOT(onMediaInvalid()));
+    connect(m_player, &QMediaPlayer::positionChanged, this, &QoEMonitor::onPositionChanged);
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    connect(m_player, static_cast<void (QMediaPlayer::*)(QMediaPlayer::Error)>(&QMediaPlayer::error),
+            this, [this](QMediaPlayer::Error) { onError(); });
+    connect(m_player, &QMediaPlayer::stateChanged, this, [this](QMediaPlayer::State state) {
+        onPlaying(state == QMediaPlayer::PlayingState);
+    });
+#else                                           //Qt6
+    connect(m_player, &QMediaPlayer::errorOccurred, this, [this]() { onError(); });
+    connect(m_player, &QMediaPlayer::playbackStateChanged, this, [this](QMediaPlayer::PlaybackState state) {
+        onPlaying(state == QMediaPlayer::PlayingState);
+    });
+#endif /* QT_VERSION... */
+    onPlaying(playing());
+    m_frames.attach(qmlPlayer);
+    return (true);
+}
+
+bool QoEMonitor::playing() const {
+    if (!m_player)
+        return (false);
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    return (m_player->state() == QMediaPlayer::PlayingState);
+#else                                           //Qt6
+    return (m_player->playbackState() == QMediaPlayer::PlayingState);
+#endif /* QT_VERSION... */
+}
+
+void QoEMonitor::begin(const QString &source) {
+    endSession();
+    startSession(source);
+}
+
+QoEMonitor::Stats *QoEMonitor::statsFor(const QString &source) {
+    m_order.removeOne(source);
+    m_order.append(source);
+    while (m_order.size() > MAX_SOURCES)
+        m_stats.remove(m_order.takeFirst());
+    return (&m_stats[source]);
+}
+
+void QoEMonitor::startSession(const QString &source) {
+    m_session = Session();
+    m_session.source    = source;
+    m_session.startedMs = m_clock.elapsed();
+    if (playing())
+        m_session.playingSinceMs = m_session.startedMs;
+    statsFor(source)->sessions++;
+    m_sessions++;
+    m_awaitingFrame = true;
+    TRACE_INSTANT("QoEMonitor::begin", m_sessions);
+    Q_EMIT sessionChanged();
+}
+
+///
+/// \brief QoEMonitor::endSession -- close the open stall and playing intervals of the session, if any.
+///
+void QoEMonitor::endSession() {
+    if (m_session.source.isEmpty())
+        return;
+    endStall();
+    onPlaying(false);
+    m_awaitingFrame = false;
+    m_session = Session();
+    Q_EMIT sessionChanged();
+}
+
+///
+/// \brief QoEMonitor::onMediaLoading -- a session for media not loaded through openSource(), e.g. a StressMonitor tile.
+///
+void QoEMonitor::onMediaLoading() {
+    if (!m_session.source.isEmpty() || !m_qmlPlayer)
+        return;
+    startSession(m_qmlPlayer->property("source").toUrl().toString());
+}
+
+void QoEMonitor::onFirstFrame() {
+    if (m_session.source.isEmpty() || (m_session.firstFrameMs >= 0))
+        return;
+    m_awaitingFrame = false;
+    m_session.firstFrameMs = m_clock.elapsed();
+    statsFor(m_session.source)->timeToFirstFrame.record(timeToFirstFrameMs());
+    TRACE_COUNTER("QoEMonitor::timeToFirstFrameMs", timeToFirstFrameMs());
+    Q_EMIT sessionChanged();
+}
+
+///
+/// \brief QoEMonitor::onPositionChanged -- audio-only media has no frames; its first is when the position first advances.
+///
+void QoEMonitor::onPositionChanged(const qint64 position) {
+    if (   m_session.source.isEmpty() || (m_session.firstFrameMs >= 0)
+        || !m_qmlPlayer || m_qmlPlayer->property("hasVideo").toBool())
+        return;
+    if (m_session.firstPosition < 0)
+        m_session.firstPosition = position;     // e.g. the resume seek
+    else if (position > m_session.firstPosition)
+        onFirstFrame();
+}
+
+///
+/// \brief QoEMonitor::onPlaying -- watch time is time in PlayingState, stalls included (the player stays 'playing' through them).
+///
+void QoEMonitor::onPlaying(const bool playingNow) {
+    if (m_session.source.isEmpty())
+        return;
+    const qint64 now = m_clock.elapsed();
+    if (playingNow && (m_session.playingSinceMs < 0))
+        m_session.playingSinceMs = now;
+    else if (!playingNow && (m_session.playingSinceMs >= 0)) {
+        endStall();     // paused or stopped while stalled: the rest isn't waiting on the network
+        statsFor(m_session.source)->watchMs += now - m_session.playingSinceMs;
+        m_session.playingSinceMs = -1;
+    }
+}
+
+///
+/// \brief QoEMonitor::onMediaStalled -- a stall is playback interrupted after the first frame; before it, it's startup.
+///
+void QoEMonitor::onMediaStalled() {
+    if (   m_session.source.isEmpty() || (m_session.firstFrameMs < 0)
+        || (m_session.playingSinceMs < 0) || (m_session.stallStartedMs >= 0))
+        return;
+    m_session.stallStartedMs = m_clock.elapsed();
+    m_session.stalls++;
+    statsFor(m_session.source)->stalls++;
+    TRACE_BEGIN("QoEMonitor::stall");
+    Q_EMIT sessionChanged();
+}
+
+void QoEMonitor::onMediaBuffered() {
+    endStall();
+}
+
+void QoEMonitor::endStall() {
+    if (m_session.stallStartedMs < 0)
+        return;
+    const qint64 duration = m_clock.elapsed() - m_session.stallStartedMs;
+    Stats *stats = statsFor(m_session.source);
+    stats->stallDuration.record(duration);
+    stats->stallMs += duration;
+    m_session.stallMs += duration;
+    m_session.stallStartedMs = -1;
+    TRACE_END("QoEMonitor::stall");
+    Q_EMIT sessionChanged();
+}
+
+void QoEMonitor::onMediaEnded() {
+    endSession();
+}
+
+void QoEMonitor::onMediaInvalid() {
+    onError();
+}
+
+///
+/// \brief QoEMonitor::onError -- counted per error, and once per session for the error rate.
+///
+void QoEMonitor::onError() {
+    if (m_session.source.isEmpty())
+        return;
+    Stats *stats = statsFor(m_session.source);
+    stats->errors++;
+    if (!m_session.error) {
+        m_session.error = true;
+        stats->errorSessions++;
+    }
+    TRACE_INSTANT("QoEMonitor::error", stats->errors);
+}
+
+qint64 QoEMonitor::stallTimeMs() const {
+    return (m_session.stallMs + (stalled() ? m_clock.elapsed() - m_session.stallStartedMs : 0));
+}
+
+///
+/// \brief QoEMonitor::labelled -- 'source' as a Prometheus label value: backslash, double-quote and newline escaped.
+///
+QString QoEMonitor::labelled(const QString &source) {
+    QString result = source;
+    result.replace(QLatin1Char('\\'), QLatin1String("\\\\"))
+          .replace(QLatin1Char('"'),  QLatin1String("\\\""))
+          .replace(QLatin1Char('\n'), QLatin1String("\\n"));
+    return (QStringLiteral("source=\"%1\"").arg(result));
+}
+
+///
+/// \brief QoEMonitor::snapshot -- counters include the open session's stall and watch time so far.
+///
+QString QoEMonitor::snapshot() const {
+    const qint64 now = m_clock.elapsed();
+    QString text;
+    QTextStream out(&text);
+    const auto header = [&out](const char *name, const char *type, const char *help) {
+        out << "# HELP qmlvideobug_" << name << ' ' << help << '\n'
+            << "# TYPE qmlvideobug_" << name << ' ' << type << '\n';
+    };
+    const auto seconds = [](const qint64 ms) { return (QString::number(ms / 1000.0, 'g', 10)); };
+
+    header("build_info", "gauge", "Qt version built against and running, for comparing upgrades.");
+    out << "qmlvideobug_build_info{qt_version=\"" << QT_VERSION_STR << "\",qt_runtime=\"" << qVersion() << "\"} 1\n";
+
+    // counters, and the ratios derived from them
+    struct Counter { const char *name; const char *type; const char *help; };
+    static const Counter COUNTERS[] = {
+        { "sessions_total",             "counter", "Playback sessions begun." },
+        { "error_sessions_total",       "counter", "Sessions with at least one error." },
+        { "errors_total",               "counter", "Player errors, and invalid media." },
+        { "stalls_total",               "counter", "Playback stalls after the first frame." },
+        { "stall_seconds_total",        "counter", "Time stalled." },
+        { "watch_seconds_total",        "counter", "Time playing, stalls included." },
+        { "rebuffer_ratio",             "gauge",   "Stall time / watch time." },
+        { "error_rate",                 "gauge",   "Sessions with errors / sessions." },
+    };
+    for (int c = 0; c < int(sizeof(COUNTERS) / sizeof(COUNTERS[0])); c++) {
+        header(COUNTERS[c].name, COUNTERS[c].type, COUNTERS[c].help);
+        for (const QString &source : m_order) {
+            const Stats &stats   = *m_stats.constFind(source);
+            const bool   current = (source == m_session.source);
+            const qint64 stallMs = stats.stallMs + ((current && stalled()) ? now - m_session.stallStartedMs : 0);
+            const qint64 watchMs = stats.watchMs + ((current && (m_session.playingSinceMs >= 0)) ? now - m_session.playingSinceMs : 0);
+            QString value;
+            switch (c) {
+            case 0: value = QString::number(stats.sessions);       break;
+            case 1: value = QString::number(stats.errorSessions);  break;
+            case 2: value = QString::number(stats.errors);         break;
+            case 3: value = QString::number(stats.stalls);         break;
+            case 4: value = seconds(stallMs);                      break;
+            case 5: value = seconds(watchMs);                      break;
+            case 6: value = QString::number((watchMs > 0) ? qreal(stallMs) / watchMs : 0.0, 'g', 6); break;
+            case 7: value = QString::number((stats.sessions > 0) ? qreal(stats.errorSessions) / stats.sessions : 0.0, 'g', 6); break;
+            }
+            out << "qmlvideobug_" << COUNTERS[c].name << '{' << labelled(source) << "} " << value << '\n';
+        }
+    }
+
+    // histograms, exposed at power-of-two 'le' bounds, plus quantiles at the full log-linear resolution
+    const auto histogram = [&](const char *name, const char *help, const LatencyHistogram Stats::*member) {
+        header(name, "histogram", help);
+        for (const QString &source : m_order) {
+            const LatencyHistogram &h     = (*m_stats.constFind(source)).*member;
+            const QString           label = labelled(source);
+            for (int power = 0; power < BUCKET_POWERS; power++)
+                out << "qmlvideobug_" << name << "_bucket{" << label << ",le=\"" << seconds(qint64(1) << power) << "\"} "
+                    << h.countAtOrBelow(qint64(1) << power) << '\n';
+            out << "qmlvideobug_" << name << "_bucket{" << label << ",le=\"+Inf\"} " << h.count() << '\n'
+                << "qmlvideobug_" << name << "_sum{"    << label << "} " << seconds(h.sumMs()) << '\n'
+                << "qmlvideobug_" << name << "_count{"  << label << "} " << h.count() << '\n';
+        }
+        const QString quantiles = QLatin1String(name) + QLatin1String("_quantile");
+        header(quantiles.toLatin1().constData(), "gauge", help);
+        for (const QString &source : m_order) {
+            const LatencyHistogram &h = (*m_stats.constFind(source)).*member;
+            for (const qreal q : { 0.5, 0.9, 0.99, 1.0 })
+                out << "qmlvideobug_" << quantiles << '{' << labelled(source) << ",quantile=\"" << q << "\"} "
+                    << seconds(h.quantileMs(q)) << '\n';
+        }
+    };
+    histogram("time_to_first_frame_seconds", "From begin() to the first decoded video frame, or audio position advancing.",
+              &Stats::timeToFirstFrame);
+    histogram("stall_duration_seconds",      "From mediaStalled() to mediaBuffered(), or pause.",
+              &Stats::stallDuration);
+
+    out.flush();
+    return (text);
+}
+
+///
+/// \brief QoEMonitor::onNewConnection -- answer each request with a snapshot; scrapes are tiny, so no keep-alive.
+///
+void QoEMonitor::onNewConnection() {
+    while (m_server.hasPendingConnections()) {
+        QTcpSocket *socket = m_server.nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            if (socket->bytesAvailable() > MAX_REQUEST_BYTES) {
+                socket->abort();
+                return;
+            }
+            if (!socket->canReadLine())
+                return;
+            const QList<QByteArray> request = socket->readLine().trimmed().split(' ');   // "GET /metrics HTTP/1.1"
+            socket->readAll();
+            const QByteArray path = (request.size() >= 2) ? request.at(1) : QByteArray();
+            QByteArray status = "200 OK";
+            QByteArray body;
+            if ((request.value(0) != "GET") && (request.value(0) != "HEAD"))
+                status = "405 Method Not Allowed";
+            else if ((path == "/metrics") || (path == "/"))
+                body = snapshot().toUtf8();
+            else
+                status = "404 Not Found";
+            socket->write("HTTP/1.0 " + status + "\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n");
+            if (request.value(0) == "GET")
+                socket->write(body);
+            socket->disconnectFromHost();
+        });
+    }
+}
@@ -0,0 +1,147 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef QOEMONITOR_H
+#define QOEMONITOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMediaPlayer>
+#include <QPointer>
+#include <QStringList>
+#include <QTcpServer>
+#include <atomic>
+#include <qplatformdefs.h> // defines QT_VERSION, etc
+
+#include "latencyhistogram.h"
+#include "videoframesource.h"
+
+///
+/// \brief The QoEMonitor class
+///
+/// Quality-of-experience metrics of playback sessions, per source: a session starts when
+/// main.qml's openSource() calls begin() (else at mediaLoading()), and ends at mediaEnded(),
+/// or when the next one begins. Following the QML mediaPlayer's mediaLoading(), mediaStalled(),
+/// mediaBuffered(), mediaEnded() and mediaInvalid() signals, and its QMediaPlayer's error and
+/// playback state, it keeps:
+///  - a histogram of time to first frame: from begin() to the first decoded video frame or,
+///    for audio-only media, to the position first advancing,
+///  - a histogram of stall durations, from mediaStalled() to mediaBuffered() while playing,
+///  - counts of sessions, sessions with errors, and stalls; total stall and watch (playing) time,
+///    and from those the rebuffer ratio (stall time / watch time) and error rate.
+/// Sources are labelled by the url passed to begin(), at most MAX_SOURCES of them, least recently
+/// used dropped first.
+///
+/// With listen(), snapshots are served over loopback HTTP ("GET /metrics") in the Prometheus text
+/// exposition format, e.g. 'curl http://127.0.0.1:<port>/metrics', so that a Qt upgrade or a change
+/// of source can be compared across machines by whatever scrapes them.
+///
+class QoEMonitor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool    listening          READ listening          NOTIFY listeningChanged)
+    Q_PROPERTY(int     port               READ port               NOTIFY listeningChanged)
+    Q_PROPERTY(QString source             READ source             NOTIFY sessionChanged)
+    Q_PROPERTY(qint64  timeToFirstFrameMs READ timeToFirstFrameMs NOTIFY sessionChanged)   // -1 until the first frame
+    Q_PROPERTY(int     stallCount         READ stallCount         NOTIFY sessionChanged)
+    Q_PROPERTY(qint64  stallTimeMs        READ stallTimeMs        NOTIFY sessionChanged)
+    Q_PROPERTY(bool    stalled            READ stalled            NOTIFY sessionChanged)
+    Q_PROPERTY(qint64  sessions           READ sessions           NOTIFY sessionChanged)   // all sources
+
+public:
+    explicit QoEMonitor(QObject *parent = nullptr);
+    ~QoEMonitor() override;
+
+    bool listen(const quint16 port = 0);
+    bool listening() const { return (m_server.isListening()); }
+    int  port() const      { return (m_server.serverPort()); }
+
+    // follow main.qml's 'mediaPlayer' (PlayerPool's active player); the session carries over.
+    Q_INVOKABLE bool attach(QObject *qmlPlayer);
+    // a playback session of 'source' starts now, ending the previous one.
+    Q_INVOKABLE void begin(const QString &source);
+    // the metrics, in the Prometheus text exposition format.
+    Q_INVOKABLE QString snapshot() const;
+
+    QString source() const              { return (m_session.source); }
+    qint64  timeToFirstFrameMs() const  { return ((m_session.firstFrameMs < 0) ? -1 : m_session.firstFrameMs - m_session.startedMs); }
+    int     stallCount() const          { return (m_session.stalls); }
+    qint64  stallTimeMs() const;
+    bool    stalled() const             { return (m_session.stallStartedMs >= 0); }
+    qint64  sessions() const            { return (m_sessions); }
+
+Q_SIGNALS:
+    void listeningChanged();
+    void sessionChanged();
+
+private Q_SLOTS:
+    // QML-declared signals of MediaPlayer5.qml/MediaPlayer6.qml, hence slots for string-based connect.
+    void onMediaLoading();
+    void onMediaStalled();
+    void onMediaBuffered();
+    void onMediaEnded();
+    void onMediaInvalid();
+
+private:
+    struct Stats {
+        LatencyHistogram    timeToFirstFrame;
+        LatencyHistogram    stallDuration;
+        quint64             sessions      = 0;
+        quint64             errorSessions = 0;
+        quint64             errors        = 0;
+        quint64             stalls        = 0;
+        qint64              stallMs       = 0;
+        qint64              watchMs       = 0;
+    };
+    struct Session {
+        QString source;                 // "" when no session is open
+        qint64  startedMs       = -1;   // of m_clock
+        qint64  firstFrameMs    = -1;
+        qint64  firstPosition   = -1;   // audio-only: the position before it first advanced
+        qint64  playingSinceMs  = -1;
+        qint64  stallStartedMs  = -1;
+        qint64  stallMs         = 0;
+        int     stalls          = 0;
+        bool    error           = false;
+    };
+
+    Stats  *statsFor(const QString &source);
+    void    startSession(const QString &source);
+    void    endSession();
+    void    onFirstFrame();
+    void    onPositionChanged(qint64 position);
+    bool    playing() const;
+    void    onPlaying(bool playingNow);
+    void    onError();
+    void    endStall();
+    void    onNewConnection();
+    static QString labelled(const QString &source);
+
+    static const int MAX_SOURCES = 64;
+
+    QElapsedTimer           m_clock;
+    QPointer<QObject>       m_qmlPlayer;
+    QPointer<QMediaPlayer>  m_player;
+    VideoFrameSource        m_frames;
+    std::atomic<bool>       m_awaitingFrame{false};
+    Session                 m_session;
+    QHash<QString, Stats>   m_stats;        // by source
+    QStringList             m_order;        // least recently begun first
+    qint64                  m_sessions = 0;
+    QTcpServer              m_server;
+};
+
+#endif // QOEMONITOR_H
@@ -0,0 +1,211 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "seekscheduler.h"
+#include "tracelogger.h"
+#include <QDebug>
+
+static const int     SEEK_TIMEOUT_MS     = 1000;   // for a seek to show a frame, before the next is issued anyway
+static const qint64  EXACT_TOLERANCE_MS  = 250;
+static const qint64  FAST_GRID_MS        = 2000;
+
+SeekScheduler::SeekScheduler(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+    m_timeout.setSingleShot(true);
+    m_timeout.setInterval(SEEK_TIMEOUT_MS);
+    connect(&m_timeout, &QTimer::timeout, this, [this]() { complete(true); });
+
+    // frameArrived() is emitted on the decoder/render thread: forward the timestamp, one frame at a time, while a seek is in flight.
+    connect(&m_frames, &VideoFrameSource::frameArrived, this, [this](const QVideoFrame &frame) {
+        if (!m_awaitingFrame || m_frameQueued.exchange(true))
+            return;
+        const qint64 startTime = frame.startTime();
+        QMetaObject::invokeMethod(this, [this, startTime]() { onFrame(startTime); }, Qt::QueuedConnection);
+    }, Qt::DirectConnection);
+}
+
+///
+/// \brief SeekScheduler::attach
+/// \param qmlPlayer -- main.qml's 'mediaPlayer'; follows PlayerPool's active player, forgetting seeks to the previous one.
+/// \return false if 'qmlPlayer' isn't backed by a QMediaPlayer.
+///
+bool SeekScheduler::attach(QObject *qmlPlayer) {
+    QMediaPlayer *player = VideoFrameSource::mediaPlayerFor(qmlPlayer);
+    if (player == m_player)
+        return (player != nullptr);
+    if (m_player)
+        disconnect(m_player, nullptr, this, nullptr);
+    m_frames.detach();
+    m_timeout.stop();
+    m_awaitingFrame = false;
+    m_inFlight      = -1;
+    m_pending       = -1;
+    m_qmlPlayer     = qmlPlayer;
+    m_player        = player;
+    if (m_player) {
+        connect(m_player, &QMediaPlayer::positionChanged,    this, &SeekScheduler::onPositionChanged);
+        connect(m_player, &QMediaPlayer::seekableChanged,    this, &SeekScheduler::onReady);
+        connect(m_player, &QMediaPlayer::mediaStatusChanged, this, &SeekScheduler::onReady);
+        m_frames.attach(qmlPlayer);
+    }
+    Q_EMIT targetChanged();
+    return (player != nullptr);
+}
+
+void SeekScheduler::setMode(const Mode mode) {
+    if (m_mode == mode)
+        return;
+    m_mode = mode;
+    Q_EMIT modeChanged();
+}
+
+///
+/// \brief SeekScheduler::clamped -- to the media, once its duration is known; in Fast mode, snapped to FAST_GRID_MS.
+///
+qint64 SeekScheduler::clamped(qint64 position) const {
+    if (m_mode == Fast)
+        position = ((position + FAST_GRID_MS / 2) / FAST_GRID_MS) * FAST_GRID_MS;
+    const qint64 duration = (m_player) ? m_player->duration() : 0;
+    if (duration > 0)
+        position = qMin(position, duration - 1);
+    return (qMax(qint64(0), position));
+}
+
+void SeekScheduler::seek(const qint64 position) {
+    if (!m_player)
+        return;
+    const qint64 target = clamped(position);
+    m_requested++;
+    if ((m_inFlight < 0) && ready()) {
+        m_inFlightSince = m_clock.elapsed();
+        issue(target);
+    }
+    else {
+        if (m_pending >= 0)
+            m_coalesced++;
+        else
+            m_pendingSince = m_clock.elapsed();
+        m_pending = target;
+    }
+    Q_EMIT targetChanged();
+    Q_EMIT statisticsChanged();
+}
+
+///
+/// \brief SeekScheduler::seekRelative -- from the latest target, so a burst of key presses adds up, though the player lags behind.
+///
+void SeekScheduler::seekRelative(const qint64 delta) {
+    if (!m_player)
+        return;
+    seek(((target() >= 0) ? target() : m_player->position()) + delta);
+}
+
+void SeekScheduler::issue(const qint64 position) {
+    m_inFlight   = position;
+    m_issuedFrom = m_player->position();
+    m_issued++;
+    m_frameQueued   = false;
+    m_awaitingFrame = true;
+    TRACE_BEGIN("SeekScheduler::seek");
+    m_player->setPosition(position);
+    m_timeout.start();
+}
+
+///
+/// \brief SeekScheduler::ready -- whether the backend will act on setPosition() now, rather than ignore it.
+///
+bool SeekScheduler::ready() const {
+    if (!m_player)
+        return (false);
+    const QMediaPlayer::MediaStatus status = m_player->mediaStatus();
+    return (   m_player->isSeekable()
+            || (status == QMediaPlayer::LoadedMedia)
+            || (status == QMediaPlayer::BufferingMedia)
+            || (status == QMediaPlayer::BufferedMedia));
+}
+
+///
+/// \brief SeekScheduler::onReady -- issue the target held pending while the media wasn't seekable.
+///
+void SeekScheduler::onReady() {
+    if ((m_inFlight >= 0) || (m_pending < 0) || !ready())
+        return;
+    const qint64 next = m_pending;
+    m_pending = -1;
+    m_inFlightSince = m_pendingSince;
+    issue(next);
+    Q_EMIT targetChanged();
+}
+
+///
+/// \brief SeekScheduler::reached -- whether a frame (or position) at 'position' is the in-flight seek's result.
+///
+bool SeekScheduler::reached(const qint64 position) const {
+    const qint64 distance = qAbs(position - m_inFlight);
+    if (m_mode == Exact)
+        return (distance <= EXACT_TOLERANCE_MS);
+    return ((distance <= FAST_GRID_MS) && (distance < qAbs(position - m_issuedFrom)));
+}
+
+///
+/// \brief SeekScheduler::onFrame
+/// \param startTime -- of a decoded video frame, in microseconds; -1 if the backend doesn't say.
+///
+void SeekScheduler::onFrame(const qint64 startTime) {
+    m_frameQueued = false;
+    if ((m_inFlight >= 0) && ((startTime < 0) || reached(startTime / 1000)))
+        complete(false);
+}
+
+///
+/// \brief SeekScheduler::onPositionChanged -- audio-only media has no frames; its seek completes when the position gets there.
+///
+void SeekScheduler::onPositionChanged(const qint64 position) {
+    if (   (m_inFlight >= 0) && reached(position)
+        && m_qmlPlayer && !m_qmlPlayer->property("hasVideo").toBool())
+        complete(false);
+}
+
+///
+/// \brief SeekScheduler::complete -- record the in-flight seek's latency, and issue the latest pending one, if any.
+///
+void SeekScheduler::complete(const bool timedOut) {
+    m_timeout.stop();
+    m_awaitingFrame = false;
+    TRACE_END("SeekScheduler::seek");
+    const qint64 now = m_clock.elapsed();
+    if (timedOut)
+        m_timeouts++;
+    else {
+        m_latencyMs = now - m_inFlightSince;
+        m_latency.record(m_latencyMs);
+        TRACE_COUNTER("SeekScheduler::latencyMs", m_latencyMs);
+    }
+    const qint64 completed = m_inFlight;
+    m_inFlight = -1;
+    if ((m_pending >= 0) && ready()) {
+        const qint64 next = m_pending;
+        m_pending = -1;
+        m_inFlightSince = m_pendingSince;
+        if ((next != completed) || timedOut)   // a timed-out seek may have been ignored, e.g. before the media was seekable
+            issue(next);
+        else
+            m_coalesced++;      // e.g. snapped to the grid cell already sought
+    }
+    Q_EMIT targetChanged();
+    Q_EMIT statisticsChanged();
+}
@@ -0,0 +1,125 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SEEKSCHEDULER_H
+#define SEEKSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMediaPlayer>
+#include <QPointer>
+#include <QTimer>
+#include <atomic>
+
+#include "latencyhistogram.h"
+#include "videoframesource.h"
+
+///
+/// \brief The SeekScheduler class
+///
+/// Seeks main.qml's mediaPlayer with at most one seek in flight: targets requested while one is
+/// in flight are collapsed into the latest, which is issued when it completes. A seek completes at
+/// the first decoded video frame from its target (or, for audio-only media, the first position
+/// reported there), or after SEEK_TIMEOUT_MS, e.g. for a paused Qt5 player that decodes nothing.
+/// Until the media is seekable (or loaded), seeks are held pending, as backends ignore them before.
+///
+/// In Exact mode, a frame (or position) counts only if it's within EXACT_TOLERANCE_MS of the target.
+/// In Fast mode, targets are snapped to a FAST_GRID_MS grid -- the keyframe interval of typical
+/// streaming encodes, so the backend seldom decodes far past a keyframe -- and a frame completes the
+/// seek once it's within FAST_GRID_MS of the target (the keyframe it landed on) and nearer to it
+/// than the position the seek left, so frames still in the pipeline from before don't count.
+/// Auto-repeating keys thus advance as fast as the backend can show frames.
+///
+/// Latency from request to the completing frame is kept in a histogram (see latencyhistogram.h).
+///
+class SeekScheduler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(Mode    mode           READ mode           WRITE setMode   NOTIFY modeChanged)
+    Q_PROPERTY(qint64  target         READ target         NOTIFY targetChanged)     // latest requested, -1 once it's shown
+    Q_PROPERTY(bool    busy           READ busy           NOTIFY targetChanged)     // a seek in flight
+    Q_PROPERTY(qint64  requested      READ requested      NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  issued         READ issued         NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  coalesced      READ coalesced      NOTIFY statisticsChanged) // superseded before being issued
+    Q_PROPERTY(qint64  timeouts       READ timeouts       NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  latencyMs      READ latencyMs      NOTIFY statisticsChanged) // of the last completed seek
+    Q_PROPERTY(qint64  latencyP50Ms   READ latencyP50Ms   NOTIFY statisticsChanged)
+    Q_PROPERTY(qint64  latencyP99Ms   READ latencyP99Ms   NOTIFY statisticsChanged)
+
+public:
+    enum Mode {
+        Exact,
+        Fast
+    };
+    Q_ENUM(Mode)
+
+    explicit SeekScheduler(QObject *parent = nullptr);
+
+    // follow main.qml's 'mediaPlayer' (PlayerPool's active player).
+    Q_INVOKABLE bool attach(QObject *qmlPlayer);
+    // seek to 'position' (ms), clamped to the media.
+    Q_INVOKABLE void seek(qint64 position);
+    // seek 'delta' (ms) from the latest target if a seek is pending or in flight, else from the position.
+    Q_INVOKABLE void seekRelative(qint64 delta);
+
+    Mode    mode() const            { return (m_mode); }
+    void    setMode(const Mode mode);
+    qint64  target() const          { return ((m_pending >= 0) ? m_pending : m_inFlight); }
+    bool    busy() const            { return (m_inFlight >= 0); }
+    qint64  requested() const       { return (m_requested); }
+    qint64  issued() const          { return (m_issued); }
+    qint64  coalesced() const       { return (m_coalesced); }
+    qint64  timeouts() const        { return (m_timeouts); }
+    qint64  latencyMs() const       { return (m_latencyMs); }
+    qint64  latencyP50Ms() const    { return (m_latency.quantileMs(0.50)); }
+    qint64  latencyP99Ms() const    { return (m_latency.quantileMs(0.99)); }
+
+Q_SIGNALS:
+    void modeChanged();
+    void targetChanged();
+    void statisticsChanged();
+
+private:
+    qint64  clamped(qint64 position) const;
+    void    issue(qint64 position);
+    void    onFrame(qint64 startTime);
+    void    onPositionChanged(qint64 position);
+    void    complete(bool timedOut);
+    bool    reached(qint64 position) const;
+    bool    ready() const;
+    void    onReady();
+
+    QPointer<QObject>       m_qmlPlayer;
+    QPointer<QMediaPlayer>  m_player;
+    VideoFrameSource        m_frames;
+    std::atomic<bool>       m_awaitingFrame{false};
+    std::atomic<bool>       m_frameQueued{false};
+    QElapsedTimer           m_clock;
+    QTimer                  m_timeout;
+    Mode                    m_mode          = Exact;
+    qint64                  m_inFlight      = -1;   // target of the seek in flight, -1 if none
+    qint64                  m_pending       = -1;   // latest target requested since, -1 if none
+    qint64                  m_issuedFrom    = 0;    // the player's position when the in-flight seek was issued
+    qint64                  m_inFlightSince = 0;    // of m_clock, when the in-flight target was first requested
+    qint64                  m_pendingSince  = 0;    // of m_clock, when a target was first pending
+    qint64                  m_requested     = 0;
+    qint64                  m_issued        = 0;
+    qint64                  m_coalesced     = 0;
+    qint64                  m_timeouts      = 0;
+    qint64                  m_latencyMs     = 0;
+    LatencyHistogram        m_latency;
+};
+
+#endif // SEEKSCHEDULER_H
@@ -0,0 +1,81 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "mediaserver.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QTextStream>
+#include <QDebug>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("qmlvideobug_server"));
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.setApplicationDescription(QStringLiteral("Serves local media, Icecast-style MP3 streams, HLS and playlists over shaped HTTP, for load-testing qmlvideobug offline."));
+    parser.addOption({ QStringLiteral("port"),            QStringLiteral("Listen on <port> (default 8080)."),
+                       QStringLiteral("port"), QStringLiteral("8080") });
+    parser.addOption({ QStringLiteral("address"),         QStringLiteral("Listen on <address> (default 127.0.0.1)."),
+                       QStringLiteral("address"), QStringLiteral("127.0.0.1") });
+    parser.addOption({ QStringLiteral("media"),           QStringLiteral("Serve the files of <dir> under /media/ (default the current directory)."),
+                       QStringLiteral("dir"), QStringLiteral(".") });
+    parser.addOption({ QStringLiteral("profile"),         QStringLiteral("Network profile <name>: %1 (default none).")
+                                                              .arg(NetworkProfile::names().join(QStringLiteral(", "))),
+                       QStringLiteral("name"), QStringLiteral("none") });
+    parser.addOption({ QStringLiteral("bandwidth"),       QStringLiteral("Override the profile's bandwidth per connection, in <KBps> (0 unlimited)."),
+                       QStringLiteral("KBps") });
+    parser.addOption({ QStringLiteral("latency"),         QStringLiteral("Override the profile's latency before each response, in <ms>."),
+                       QStringLiteral("ms") });
+    parser.addOption({ QStringLiteral("jitter"),          QStringLiteral("Override the profile's +/- jitter on latency and stalls, in <ms>."),
+                       QStringLiteral("ms") });
+    parser.addOption({ QStringLiteral("stall-every"),     QStringLiteral("Override the profile: stall each connection every <seconds> of sending (0 never)."),
+                       QStringLiteral("seconds") });
+    parser.addOption({ QStringLiteral("stall-ms"),        QStringLiteral("Override the profile's stall duration, in <ms>."),
+                       QStringLiteral("ms") });
+    parser.addOption({ QStringLiteral("max-connections"), QStringLiteral("Answer \"503 Service Unavailable\" beyond <n> connections (default 0, unlimited)."),
+                       QStringLiteral("n"), QStringLiteral("0") });
+    parser.addOption({ QStringLiteral("seed"),            QStringLiteral("Seed the jitter with <n>, for repeatable runs (default 1)."),
+                       QStringLiteral("n"), QStringLiteral("1") });
+    parser.process(app);
+
+    NetworkProfile profile;
+    if (!NetworkProfile::byName(parser.value(QStringLiteral("profile")), &profile)) {
+        qWarning().noquote() << "unknown --profile" << parser.value(QStringLiteral("profile"));
+        return (1);
+    }
+    const auto overridden = [&parser](const char *name, int *value) {
+        if (parser.isSet(QLatin1String(name)))
+            *value = parser.value(QLatin1String(name)).toInt();
+    };
+    overridden("bandwidth",   &profile.bandwidthKBps);
+    overridden("latency",     &profile.latencyMs);
+    overridden("jitter",      &profile.jitterMs);
+    overridden("stall-every", &profile.stallEverySeconds);
+    overridden("stall-ms",    &profile.stallMs);
+    profile.maxConnections = parser.value(QStringLiteral("max-connections")).toInt();
+
+    const QString media = QDir(parser.value(QStringLiteral("media"))).absolutePath();
+    MediaServer server(media, profile, parser.value(QStringLiteral("seed")).toUInt());
+    if (!server.listen(QHostAddress(parser.value(QStringLiteral("address"))),
+                       quint16(parser.value(QStringLiteral("port")).toUInt())))
+        return (1);
+    QTextStream(stdout) << QStringLiteral("serving %1 at http://%2:%3/ (%4KBps, %5+/-%6ms latency)")
+                           .arg(media, parser.value(QStringLiteral("address"))).arg(server.port())
+                           .arg(profile.bandwidthKBps).arg(profile.latencyMs).arg(profile.jitterMs) << Qt::endl;
+    return (app.exec());
+}
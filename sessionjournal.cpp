@@ -0,0 +1,347 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "sessionjournal.h"
+#include <QDateTime>
+#include <QDir>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <unistd.h>   //fsync()
+#elif defined(Q_OS_WIN)
+#include <io.h>       //_commit()
+#endif /* Q_OS_UNIX */
+
+static const char   JOURNAL_MAGIC[8]    = { 'Q', 'V', 'B', 'J', 1, 0, 0, 0 };  // format version 1
+static const int    RECORD_HEADER       = 8;                // quint32 payload length, quint32 CRC-32 of payload
+static const int    RECORD_FIXED        = 32;               // position, rate, volume, updated; then the UTF-8 source
+static const int    MAX_PAYLOAD         = 64 * 1024;        // longer is taken for a torn or garbled length
+static const int    FLUSH_INTERVAL_MS   = 2000;             // records are coalesced this long before a write + fsync
+static const qint64 COMPACT_BYTES       = 64 * 1024;
+static const int    MAX_ENTRIES         = 1000;             // most recently updated sources kept by compaction
+
+///
+/// \brief crc32 -- CRC-32 (IEEE 802.3, as zlib), table driven.
+///
+static quint32 crc32(const char *data, const int size) {
+    static quint32 table[256];
+    static const bool initialized = []() {
+        for (quint32 i = 0; i < 256; i++) {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        return (true);
+    }();
+    Q_UNUSED(initialized)
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (int i = 0; i < size; i++)
+        crc = table[(crc ^ quint8(data[i])) & 0xFF] ^ (crc >> 8);
+    return (crc ^ 0xFFFFFFFFu);
+}
+
+static void putDouble(const double value, char *dst) {
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint64>(bits, dst);
+}
+
+static double getDouble(const char *src) {
+    const quint64 bits = qFromLittleEndian<quint64>(src);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return (value);
+}
+
+static void syncToDisk(QFileDevice &file) {
+    file.flush();
+#ifdef Q_OS_UNIX
+    ::fsync(file.handle());
+#elif defined(Q_OS_WIN)
+    ::_commit(file.handle());
+#endif /* Q_OS_UNIX */
+}
+
+SessionJournal::SessionJournal(QObject *parent)
+    : QObject(parent)
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (QDir().mkpath(directory))
+        m_path = directory + QStringLiteral("/session.journal");
+    else
+        qWarning() << Q_FUNC_INFO << ": unable to create" << directory << ", the session won't persist.";
+    load();
+
+    m_worker = QThread::create([this]() { run(); });
+    m_worker->setObjectName(QStringLiteral("SessionJournal"));
+    m_worker->start(QThread::LowPriority);
+}
+
+SessionJournal::~SessionJournal() {
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stop = true;
+        m_wake.wakeAll();
+    }
+    m_worker->wait();                               // writes whatever is still pending
+    delete m_worker;
+}
+
+qreal SessionJournal::lastPosition() const {
+    return (qreal(m_entries.value(m_lastSource, Entry{ 0, 1.0, 1.0, 0 }).position));
+}
+
+qreal SessionJournal::lastRate() const {
+    return (m_entries.value(m_lastSource, Entry{ 0, 1.0, 1.0, 0 }).rate);
+}
+
+qreal SessionJournal::lastVolume() const {
+    return (m_entries.value(m_lastSource, Entry{ 0, 1.0, 1.0, 0 }).volume);
+}
+
+qreal SessionJournal::positionFor(const QString &source) const {
+    const auto it = m_entries.constFind(source);
+    return (((it == m_entries.constEnd()) || (it->position < 0)) ? 0.0 : qreal(it->position));
+}
+
+///
+/// \brief SessionJournal::record -- never blocks on I/O: the worker writes the latest record per source later.
+///
+void SessionJournal::record(const QString &source, const qreal position, const qreal rate, const qreal volume) {
+    if (source.isEmpty() || m_path.isEmpty())
+        return;
+    m_lastUpdated = qMax(QDateTime::currentMSecsSinceEpoch(), m_lastUpdated + 1);
+    const Entry entry = { qMax<qint64>(0, qint64(position)), double(rate), double(volume), m_lastUpdated };
+    const int count = m_entries.size();
+    m_entries.insert(source, entry);
+    if (m_entries.size() != count)
+        Q_EMIT countChanged();
+
+    QMutexLocker lock(&m_mutex);
+    const bool wake = m_pending.isEmpty();
+    m_pending.insert(source, entry);
+    if (wake)
+        m_wake.wakeAll();
+}
+
+///
+/// \brief SessionJournal::forget -- e.g. at the end of media, so it's started from the beginning next time.
+///
+void SessionJournal::forget(const QString &source) {
+    if (!m_entries.remove(source) || m_path.isEmpty())
+        return;
+    Q_EMIT countChanged();
+    m_lastUpdated = qMax(QDateTime::currentMSecsSinceEpoch(), m_lastUpdated + 1);
+    const Entry entry = { -1, 1.0, 1.0, m_lastUpdated };
+    QMutexLocker lock(&m_mutex);
+    const bool wake = m_pending.isEmpty();
+    m_pending.insert(source, entry);
+    if (wake)
+        m_wake.wakeAll();
+}
+
+void SessionJournal::flush() {
+    QMutexLocker lock(&m_mutex);
+    m_flushNow = true;
+    m_wake.wakeAll();
+}
+
+QByteArray SessionJournal::encode(const QString &source, const Entry &entry) {
+    const QByteArray utf8 = source.toUtf8();
+    QByteArray record(RECORD_HEADER + RECORD_FIXED + utf8.size(), Qt::Uninitialized);
+    char *payload = record.data() + RECORD_HEADER;
+    qToLittleEndian<qint64>(entry.position,  payload);
+    putDouble(entry.rate,                    payload + 8);
+    putDouble(entry.volume,                  payload + 16);
+    qToLittleEndian<qint64>(entry.updated,   payload + 24);
+    std::memcpy(payload + RECORD_FIXED, utf8.constData(), size_t(utf8.size()));
+    qToLittleEndian<quint32>(quint32(RECORD_FIXED + utf8.size()), record.data());
+    qToLittleEndian<quint32>(crc32(payload, RECORD_FIXED + utf8.size()), record.data() + 4);
+    return (record);
+}
+
+///
+/// \brief SessionJournal::load -- read the journal up to its first torn or corrupt record, at construction.
+///
+void SessionJournal::load() {
+    QFile file(m_path);
+    if (m_path.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return;
+    const QByteArray data = file.readAll();
+    m_fileBytes = data.size();
+    if ((data.size() < int(sizeof(JOURNAL_MAGIC))) || std::memcmp(data.constData(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC))) {
+        qWarning() << Q_FUNC_INFO << ": ignoring unrecognized journal" << m_path;
+        return;
+    }
+
+    int offset = int(sizeof(JOURNAL_MAGIC));
+    while (offset + RECORD_HEADER <= data.size()) {
+        const char   *header = data.constData() + offset;
+        const quint32 length = qFromLittleEndian<quint32>(header);
+        const quint32 crc    = qFromLittleEndian<quint32>(header + 4);
+        if (   (length < quint32(RECORD_FIXED)) || (length > quint32(MAX_PAYLOAD))
+            || (offset + RECORD_HEADER + int(length) > data.size()))
+            break;                                  // torn tail
+        const char *payload = header + RECORD_HEADER;
+        if (crc32(payload, int(length)) != crc)
+            break;                                  // torn or corrupt: nothing after it can be trusted
+        const Entry entry = { qFromLittleEndian<qint64>(payload),
+                              getDouble(payload + 8),
+                              getDouble(payload + 16),
+                              qFromLittleEndian<qint64>(payload + 24) };
+        const QString source = QString::fromUtf8(payload + RECORD_FIXED, int(length) - RECORD_FIXED);
+        if (entry.position < 0)
+            m_persisted.remove(source);
+        else {
+            m_persisted.insert(source, entry);
+            if (entry.updated >= m_lastUpdated)    // not file order: a batch may be written in any order
+                m_lastSource = source;
+        }
+        m_lastUpdated = qMax(m_lastUpdated, entry.updated);
+        offset += RECORD_HEADER + int(length);
+    }
+    m_validBytes = offset;
+    if (m_validBytes < m_fileBytes)
+        qWarning() << Q_FUNC_INFO << ": dropping" << (m_fileBytes - m_validBytes) << "bytes of torn or corrupt journal.";
+    m_entries = m_persisted;
+    if (!m_entries.contains(m_lastSource))
+        m_lastSource.clear();
+}
+
+///
+/// \brief SessionJournal::run -- the worker: coalesce pending records for FLUSH_INTERVAL_MS, then append them.
+///
+void SessionJournal::run() {
+    if (m_path.isEmpty())
+        return;
+    // a torn tail is cut off (or the journal rewritten) before anything is appended after it.
+    if ((m_validBytes != m_fileBytes) || (m_fileBytes > COMPACT_BYTES))
+        compact();
+    else if (!openForAppend())
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    for (;;) {
+        while (!m_stop && !m_flushNow && m_pending.isEmpty())
+            m_wake.wait(&m_mutex);
+        if (!m_stop && !m_flushNow)
+            m_wake.wait(&m_mutex, FLUSH_INTERVAL_MS);   // until the interval ends, or flush()
+        QHash<QString, Entry> batch;
+        batch.swap(m_pending);
+        m_flushNow = false;
+        const bool stop = m_stop;
+
+        lock.unlock();
+        if (!batch.isEmpty())
+            append(batch);
+        lock.relock();
+        if (stop && m_pending.isEmpty())
+            break;
+    }
+    m_file.close();
+}
+
+bool SessionJournal::openForAppend() {
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qWarning() << Q_FUNC_INFO << ": unable to write" << m_path << ":" << m_file.errorString();
+        return (false);
+    }
+    if (m_validBytes < qint64(sizeof(JOURNAL_MAGIC))) {    // new (or unrecognized) journal
+        m_file.resize(0);
+        m_file.write(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        syncToDisk(m_file);
+        m_validBytes = sizeof(JOURNAL_MAGIC);
+    }
+    else if (m_file.size() > m_validBytes)                  // a torn tail that compaction failed to drop
+        m_file.resize(m_validBytes);
+    m_fileBytes = m_validBytes;
+    m_file.seek(m_fileBytes);
+    return (true);
+}
+
+void SessionJournal::append(const QHash<QString, Entry> &batch) {
+    if (!m_file.isOpen())
+        return;
+    QVector<QPair<qint64, QString>> byAge;          // in the order recorded, as load() reads them
+    byAge.reserve(batch.size());
+    for (auto it = batch.cbegin(); it != batch.cend(); ++it)
+        byAge.append(qMakePair(it->updated, it.key()));
+    std::sort(byAge.begin(), byAge.end());
+
+    QByteArray records;
+    for (const auto &aged : qAsConst(byAge)) {
+        const Entry &entry = *batch.constFind(aged.second);
+        if (aged.second.toUtf8().size() > MAX_PAYLOAD - RECORD_FIXED) {    // load() would take it for a torn tail
+            qWarning() << Q_FUNC_INFO << ": not recording a source of" << aged.second.size() << "characters.";
+            continue;
+        }
+        records += encode(aged.second, entry);
+        if (entry.position < 0)
+            m_persisted.remove(aged.second);
+        else
+            m_persisted.insert(aged.second, entry);
+    }
+    if (records.isEmpty())
+        return;
+    if (m_file.write(records) != records.size()) {
+        qWarning() << Q_FUNC_INFO << ": unable to write" << m_path << ":" << m_file.errorString();
+        m_file.close();                             // the next openForAppend() cuts off the partial write
+        openForAppend();
+        return;
+    }
+    syncToDisk(m_file);
+    m_fileBytes += records.size();
+    m_validBytes = m_fileBytes;
+    if (m_fileBytes > COMPACT_BYTES)
+        compact();
+}
+
+///
+/// \brief SessionJournal::compact -- rewrite the journal as the latest record per source, oldest first, via QSaveFile.
+///
+void SessionJournal::compact() {
+    m_file.close();
+
+    QVector<QPair<qint64, QString>> byAge;
+    byAge.reserve(m_persisted.size());
+    for (auto it = m_persisted.cbegin(); it != m_persisted.cend(); ++it)
+        byAge.append(qMakePair(it->updated, it.key()));
+    std::sort(byAge.begin(), byAge.end());
+    if (byAge.size() > MAX_ENTRIES) {
+        for (int i = 0; i < byAge.size() - MAX_ENTRIES; i++)
+            m_persisted.remove(byAge.at(i).second);
+        byAge.erase(byAge.begin(), byAge.end() - MAX_ENTRIES);
+    }
+
+    QSaveFile out(m_path);
+    QByteArray data(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    for (const auto &aged : qAsConst(byAge))
+        data += encode(aged.second, m_persisted.value(aged.second));
+    if (out.open(QIODevice::WriteOnly) && (out.write(data) == data.size()) && out.commit())
+        m_validBytes = data.size();
+    else
+        qWarning() << Q_FUNC_INFO << ": unable to compact" << m_path << ":" << out.errorString();
+    openForAppend();
+}
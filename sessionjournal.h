@@ -0,0 +1,117 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef SESSIONJOURNAL_H
+#define SESSIONJOURNAL_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+///
+/// \brief The SessionJournal class
+///
+/// Persists the playback session -- per source, the last position, playback rate and
+/// volume -- so that the next launch resumes where this one left off, and re-opening
+/// a source resumes it too.
+///
+/// The journal ('AppDataLocation/session.journal') is append-only: each record carries
+/// its length and a CRC-32 of its contents, so a record torn by a crash or power loss is
+/// detected, and dropped, at the next launch without affecting the records before it.
+/// record() only updates an in-memory table on the GUI thread; a worker thread coalesces
+/// the records of each FLUSH_INTERVAL_MS to the latest per source, and appends them with
+/// a single write and fsync. Once the journal outgrows COMPACT_BYTES it is rewritten,
+/// latest record per source only, through a QSaveFile, so the previous journal stays
+/// intact until the new one is complete.
+///
+/// The journal is read once, at construction, into a hash: lookups such as
+/// positionFor() are O(1) and never touch the disk.
+///
+class SessionJournal : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool     resume          READ resume         CONSTANT)   // false with --no-resume
+    Q_PROPERTY(QString  lastSource      READ lastSource     CONSTANT)   // as of launch
+    Q_PROPERTY(qreal    lastPosition    READ lastPosition   CONSTANT)   // ms
+    Q_PROPERTY(qreal    lastRate        READ lastRate       CONSTANT)
+    Q_PROPERTY(qreal    lastVolume      READ lastVolume     CONSTANT)
+    Q_PROPERTY(int      count           READ count          NOTIFY countChanged)
+
+public:
+    explicit SessionJournal(QObject *parent = nullptr);
+    ~SessionJournal() override;
+
+    bool    resume() const { return (m_resume); }
+    void    setResume(const bool resume) { m_resume = resume; }
+    QString lastSource() const { return (m_lastSource); }
+    qreal   lastPosition() const;
+    qreal   lastRate() const;
+    qreal   lastVolume() const;
+    int     count() const { return (m_entries.size()); }
+
+    // the position (ms) at which 'source' was last recorded, or 0.
+    Q_INVOKABLE qreal positionFor(const QString &source) const;
+    Q_INVOKABLE void  record(const QString &source, const qreal position, const qreal rate, const qreal volume);
+    Q_INVOKABLE void  forget(const QString &source);
+    // write what's pending now, rather than at the end of the flush interval. Doesn't wait.
+    Q_INVOKABLE void  flush();
+
+Q_SIGNALS:
+    void countChanged();
+
+private:
+    struct Entry {
+        qint64  position;       // ms; < 0 for a forgotten source
+        double  rate;
+        double  volume;
+        qint64  updated;        // ms since epoch, strictly increasing: the order records were made
+    };
+
+    static QByteArray encode(const QString &source, const Entry &entry);
+    void load();
+    void run();                                         // the worker
+    bool openForAppend();
+    void append(const QHash<QString, Entry> &batch);
+    void compact();
+
+    // GUI thread
+    QHash<QString, Entry>   m_entries;
+    QString                 m_lastSource;
+    qint64                  m_lastUpdated   = 0;
+    bool                    m_resume        = true;
+
+    // shared, guarded by m_mutex
+    QMutex                  m_mutex;
+    QWaitCondition          m_wake;
+    QHash<QString, Entry>   m_pending;                  // latest per source, not yet written
+    bool                    m_flushNow      = false;
+    bool                    m_stop          = false;
+
+    // worker thread only, after construction
+    QThread                *m_worker        = nullptr;
+    QString                 m_path;
+    QFile                   m_file;
+    QHash<QString, Entry>   m_persisted;                // latest per source in the journal
+    qint64                  m_validBytes    = 0;        // up to the last intact record
+    qint64                  m_fileBytes     = 0;
+};
+
+#endif // SESSIONJOURNAL_H
@@ -0,0 +1,102 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+///
+/// \brief The SpscRing class -- bounded, lock-free, single producer/single consumer ring of trivially copyable T.
+///
+/// The storage is allocated once, by the constructor (capacity rounded up to a power of two).
+/// write() and read() never block nor allocate: a full ring drops what doesn't fit, and
+/// write() returns how much was accepted. Each index is only stored by its own side
+/// (release) and loaded by the other (acquire); they're kept a cache line apart so the
+/// producer and consumer don't contend for it.
+///
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(const size_t capacity)
+        : m_buffer(roundUp(capacity)),
+          m_mask(m_buffer.size() - 1)
+    {}
+
+    size_t capacity() const { return (m_buffer.size()); }
+
+    // producer only.
+    size_t write(const T *data, const size_t count) {
+        const size_t head  = m_head.load(std::memory_order_relaxed);
+        const size_t tail  = m_tail.load(std::memory_order_acquire);
+        const size_t n     = (count < capacity() - (head - tail)) ? count : capacity() - (head - tail);
+        const size_t start = head & m_mask;
+        const size_t first = (n < capacity() - start) ? n : capacity() - start;
+        std::memcpy(&m_buffer[start], data,         first       * sizeof(T));
+        std::memcpy(&m_buffer[0],     data + first, (n - first) * sizeof(T));
+        m_head.store(head + n, std::memory_order_release);
+        return (n);
+    }
+
+    // consumer only.
+    size_t read(T *data, const size_t count) {
+        const size_t tail  = m_tail.load(std::memory_order_relaxed);
+        const size_t head  = m_head.load(std::memory_order_acquire);
+        const size_t n     = (count < head - tail) ? count : head - tail;
+        const size_t start = tail & m_mask;
+        const size_t first = (n < capacity() - start) ? n : capacity() - start;
+        std::memcpy(data,         &m_buffer[start], first       * sizeof(T));
+        std::memcpy(data + first, &m_buffer[0],     (n - first) * sizeof(T));
+        m_tail.store(tail + n, std::memory_order_release);
+        return (n);
+    }
+
+    // producer only: how much write() would accept now (at least; the consumer may free more meanwhile).
+    size_t writeAvailable() const {
+        return (capacity() - (m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire)));
+    }
+
+    // consumer only: discard everything written so far.
+    void clear() {
+        m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // consumer only.
+    size_t readAvailable() const {
+        return (m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed));
+    }
+
+private:
+    static size_t roundUp(const size_t capacity) {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return (size);
+    }
+
+    std::vector<T>          m_buffer;
+    const size_t            m_mask;
+    char                    m_padding0[64];
+    std::atomic<size_t>     m_head{0};      // written by the producer
+    char                    m_padding1[64];
+    std::atomic<size_t>     m_tail{0};      // written by the consumer
+};
+
+#endif // SPSCRING_H
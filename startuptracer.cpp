@@ -0,0 +1,142 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "startuptracer.h"
+#include <QElapsedTimer>
+#include <QQuickWindow>
+#include <QFile>
+#include <QDebug>
+#include <algorithm>
+#ifdef Q_OS_LINUX
+#include <unistd.h>   //sysconf(_SC_CLK_TCK)
+#endif /* Q_OS_LINUX */
+
+static const int REPORT_TIMEOUT_MS = 20000;   // give up waiting for a video frame (e.g. audio-only media)
+
+///
+/// \brief s_staticInit -- started during static initialization, before main(); the origin of all marks.
+///
+static const struct StaticInitClock : QElapsedTimer {
+    StaticInitClock() { start(); }
+} s_staticInit;
+
+///
+/// \brief processAgeNs -- how long ago the process was exec'd, or -1 where unknown.
+///
+static qint64 processAgeNs() {
+#ifdef Q_OS_LINUX
+    QFile stat(QStringLiteral("/proc/self/stat"));
+    QFile uptime(QStringLiteral("/proc/uptime"));
+    if (!stat.open(QIODevice::ReadOnly) || !uptime.open(QIODevice::ReadOnly))
+        return (-1);
+    // skip "pid (comm)", comm may contain spaces; starttime is field 22, the 20th after ')'.
+    const QByteArray        line       = stat.readAll();
+    const QList<QByteArray> fields     = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    const double            uptimeSecs = uptime.readAll().split(' ').value(0).toDouble();
+    if (fields.size() < 20)
+        return (-1);
+    const double startSecs = fields.at(19).toDouble() / double(sysconf(_SC_CLK_TCK));
+    return (qint64((uptimeSecs - startSecs) * 1.0e9));
+#else
+    return (-1);
+#endif /* Q_OS_LINUX */
+}
+
+StartupTracer::StartupTracer(QObject *parent)
+    : QObject(parent)
+{
+    const qint64 age = processAgeNs();
+    if (age >= 0)
+        m_marks.append(Mark{ QStringLiteral("process exec"), s_staticInit.nsecsElapsed() - age });
+    m_marks.append(Mark{ QStringLiteral("static initialization"), 0 });
+
+    m_timeout.setSingleShot(true);
+    m_timeout.setInterval(REPORT_TIMEOUT_MS);
+    connect(&m_timeout, &QTimer::timeout, this, &StartupTracer::report);
+
+    // frameArrived() is emitted on the decoder/render thread: note only the first, marked on the GUI thread.
+    connect(&m_frames, &VideoFrameSource::frameArrived, this, [this](const QVideoFrame &) {
+        if (m_frameDecoded.exchange(true))
+            return;
+        QMetaObject::invokeMethod(this, [this]() {
+            mark(QStringLiteral("first video frame decoded"));
+            m_frames.detach();
+        }, Qt::QueuedConnection);
+    }, Qt::DirectConnection);
+}
+
+void StartupTracer::mark(const QString &phase) {
+    if (m_reported)
+        return;
+    for (const Mark &m : qAsConst(m_marks))
+        if (m.phase == phase)
+            return;
+    m_marks.append(Mark{ phase, s_staticInit.nsecsElapsed() });
+}
+
+void StartupTracer::start(QObject *rootObject) {
+    mark(QStringLiteral("QQmlApplicationEngine::objectCreated"));
+    m_window = qobject_cast<QQuickWindow *>(rootObject);
+    if (m_window)
+        m_swapConnection = connect(m_window, &QQuickWindow::frameSwapped,
+                                   this, &StartupTracer::onFrameSwapped);
+
+    // main.qml's Component.onCompleted has already opened the first source by now: its
+    // mediaLoading() is marked from QML, this only follows the frames that result.
+    QObject *player = (rootObject) ? rootObject->property("mediaPlayer").value<QObject *>() : nullptr;
+    if (player)
+        m_frames.attach(player);
+    m_timeout.start();
+}
+
+///
+/// \brief StartupTracer::onFrameSwapped -- the first swap is the first window frame; the first after a decoded video frame completes the trace.
+///
+void StartupTracer::onFrameSwapped() {
+    mark(QStringLiteral("first window frame swapped"));
+    if (m_frameDecoded) {
+        // the queued "first video frame decoded" mark may not have been delivered yet.
+        mark(QStringLiteral("first video frame decoded"));
+        mark(QStringLiteral("first video frame rendered"));
+        report();
+    }
+}
+
+///
+/// \brief StartupTracer::report -- print the phase breakdown, once.
+///
+void StartupTracer::report() {
+    if (m_reported)
+        return;
+    m_reported = true;
+    m_timeout.stop();
+    disconnect(m_swapConnection);
+    m_frames.detach();
+
+    QVector<Mark> marks = m_marks;
+    std::stable_sort(marks.begin(), marks.end(),
+                     [](const Mark &a, const Mark &b) { return (a.nsecs < b.nsecs); });
+    qWarning().noquote() << "StartupTracer -- phase breakdown (ms since static initialization, ms since previous phase):";
+    qint64 previous = marks.isEmpty() ? 0 : marks.first().nsecs;
+    for (const Mark &m : qAsConst(marks)) {
+        qWarning().noquote() << QStringLiteral("  %1 %2  %3")
+                                .arg(m.nsecs / 1.0e6, 10, 'f', 1)
+                                .arg((m.nsecs - previous) / 1.0e6, 9, 'f', 1)
+                                .arg(m.phase);
+        previous = m.nsecs;
+    }
+    if (!m_frameDecoded)
+        qWarning().noquote() << QStringLiteral("  (no video frame within %1ms)").arg(REPORT_TIMEOUT_MS);
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef STARTUPTRACER_H
+#define STARTUPTRACER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+
+#include "videoframesource.h"
+
+class QQuickWindow;
+
+///
+/// \brief The StartupTracer class
+///
+/// Timestamps the phases of launch on the path to the first rendered video frame --
+/// the path on which QTBUG-109731 manifests -- relative to static initialization:
+///  - process exec (Linux, from /proc/self/stat, 10ms resolution),
+///  - QGuiApplication constructed,
+///  - engine.load() begin/end, and QQmlApplicationEngine::objectCreated,
+///  - the first mediaLoading() from main.qml's mediaPlayer, marked from QML since it
+///    precedes objectCreated,
+///  - the first decoded video frame, and the next frameSwapped() of the window,
+///    i.e. the first rendered frame,
+/// and then prints a phase breakdown with the delta from each phase to the next.
+/// For audio-only media, or if no frame arrives, the breakdown is printed after a timeout.
+///
+class StartupTracer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StartupTracer(QObject *parent = nullptr);
+
+    // record 'phase' once, the first time it is reached; later calls are ignored.
+    Q_INVOKABLE void mark(const QString &phase);
+    // follow main.qml's root window and its 'mediaPlayer' until the first frame is rendered.
+    void start(QObject *rootObject);
+    Q_INVOKABLE void report();
+
+private:
+    void onFrameSwapped();
+
+    struct Mark {
+        QString phase;
+        qint64  nsecs;      // since static initialization
+    };
+
+    QVector<Mark>           m_marks;
+    QPointer<QQuickWindow>  m_window;
+    VideoFrameSource        m_frames;
+    std::atomic<bool>       m_frameDecoded{false};
+    QMetaObject::Connection m_swapConnection;
+    QTimer                  m_timeout;
+    bool                    m_reported = false;
+};
+
+#endif // STARTUPTRACER_H
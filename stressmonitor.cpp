@@ -0,0 +1,326 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "stressmonitor.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QThread>
+#include <QDebug>
+#include <cmath>
+#ifdef Q_OS_LINUX
+#include <unistd.h>   //sysconf(_SC_CLK_TCK), sysconf(_SC_PAGESIZE)
+#endif /* Q_OS_LINUX */
+
+static const int    DEFAULT_INTERVAL_S      = 5;
+static const qint64 MAX_FRAME_GAP_US        = 1000000;    // longer gaps are seeks, loops or stalls, not drops
+static const qint64 MIN_FRAME_INTERVAL_US   = 2000;       // ignore duplicate/bogus timestamps
+
+///
+/// \brief DECODE_THREAD_NAMES -- thread names of decoding/demuxing in the various backends: gstreamer
+/// ("multiqueue0:src", "avdec_h264-0", "vaapi..."), FFmpeg ("av:h264:df0", Qt6 "Demuxer", "VideoDecoder"),
+/// Android MediaCodec ("CodecLooper") and the like.
+///
+static const QRegularExpression DECODE_THREAD_NAMES(
+    QStringLiteral("dec|demux|queue|codec|vaapi|v4l2|omx|ffmpeg|^av:|h26[45]|hevc|vp[89]|av1"),
+    QRegularExpression::CaseInsensitiveOption);
+
+StressMonitor::StressMonitor(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_sampler, &QTimer::timeout, this, &StressMonitor::sample);
+    m_deadline.setSingleShot(true);
+    connect(&m_deadline, &QTimer::timeout, this, [this]() {
+        finish();
+        QCoreApplication::quit();
+    });
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+            this,                         &StressMonitor::finish);
+}
+
+StressMonitor::~StressMonitor() {
+    finish();
+    for (Instance *instance : m_instances)
+        if (instance) {
+            instance->frames.detach();
+            delete instance;
+        }
+}
+
+///
+/// \brief StressMonitor::configure -- from main(); 'players' <= 0 leaves the monitor inactive.
+/// \param files -- local media files from the command line, assigned to the grid cyclically.
+/// \param seconds -- quit after this long, or 0 to run until closed.
+///
+void StressMonitor::configure(const int players,
+                              const QList<QUrl> &files,
+                              const int seconds,
+                              const int intervalSeconds,
+                              const QString &outputPath) {
+    m_players = qMax(0, players);
+    if (!m_players)
+        return;
+    m_files = files;
+    m_instances.assign(size_t(m_players), nullptr);
+
+    const bool toStdout = (outputPath.isEmpty() || (outputPath == QLatin1String("-")));
+    if (!toStdout)
+        m_output.setFileName(outputPath);
+    if (!((toStdout) ? m_output.open(stdout, QIODevice::WriteOnly | QIODevice::Text)
+                     : m_output.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)))
+        qWarning() << Q_FUNC_INFO << ": unable to write" << outputPath;
+
+    writeLine(QStringLiteral("# qmlvideobug --players=%1: Qt %2 (built with %3), %4 %5, %6 cores")
+              .arg(m_players)
+              .arg(QLatin1String(qVersion()), QLatin1String(QT_VERSION_STR),
+                   QSysInfo::prettyProductName(), QSysInfo::currentCpuArchitecture())
+              .arg(QThread::idealThreadCount()));
+    writeLine(QStringLiteral("# %1 %2 %3 %4 %5 %6 %7 %8 %9 %10")
+              .arg(QStringLiteral("time(s)"),   7)
+              .arg(QStringLiteral("playing"),   8)
+              .arg(QStringLiteral("fps:total"), 10)
+              .arg(QStringLiteral("fps:min"),   8)
+              .arg(QStringLiteral("fps:max"),   8)
+              .arg(QStringLiteral("dropped"),   8)
+              .arg(QStringLiteral("threads"),   8)
+              .arg(QStringLiteral("decode"),    7)
+              .arg(QStringLiteral("rss(MB)"),   8)
+              .arg(QStringLiteral("cpu(%)"),    7));
+
+    m_clock.start();
+    m_lastCpuTicks = m_firstCpuTicks = sampleProcess().cpuTicks;
+    m_sampler.start(1000 * ((intervalSeconds > 0) ? intervalSeconds : DEFAULT_INTERVAL_S));
+    if (seconds > 0)
+        m_deadline.start(1000 * seconds);
+}
+
+int StressMonitor::columns() const {
+    return (qMax(1, int(std::ceil(std::sqrt(double(m_players))))));
+}
+
+QUrl StressMonitor::sourceFor(const int index) const {
+    return ((m_files.isEmpty() || (index < 0)) ? QUrl() : m_files.at(index % m_files.size()));
+}
+
+///
+/// \brief StressMonitor::addPlayer -- count the frames of grid tile 'index'.
+/// \param qmlPlayer -- an instance of MediaPlayer5.qml or MediaPlayer6.qml, with its VideoOutput already set.
+///
+void StressMonitor::addPlayer(const int index, QObject *qmlPlayer, const QString &source) {
+    if ((index < 0) || (index >= m_players) || m_instances[size_t(index)])
+        return;
+    Instance *instance = new Instance;
+    instance->source = source;
+    m_instances[size_t(index)] = instance;
+
+    // on the decoder/render thread: count, and look for gaps in the timestamps.
+    connect(&instance->frames, &VideoFrameSource::frameArrived, this, [instance](const QVideoFrame &frame) {
+        if (!frame.isValid())
+            return;
+        instance->frameCount.fetch_add(1, std::memory_order_relaxed);
+        const qint64 start = frame.startTime();
+        if (start < 0)
+            return;
+        const qint64 delta = start - instance->lastStartUs;
+        instance->lastStartUs = start;
+        if ((delta < MIN_FRAME_INTERVAL_US) || (delta > MAX_FRAME_GAP_US))
+            return;
+        if ((instance->intervalUs == 0) || (delta < instance->intervalUs))
+            instance->intervalUs = delta;
+        else if (2 * delta > 3 * instance->intervalUs)
+            instance->dropped.fetch_add(quint64(std::llround(double(delta) / instance->intervalUs) - 1),
+                                        std::memory_order_relaxed);
+    }, Qt::DirectConnection);
+    instance->frames.attach(qmlPlayer);
+}
+
+qreal StressMonitor::fps(const int index) const {
+    return (((index >= 0) && (index < int(m_instances.size())) && m_instances[size_t(index)])
+            ? m_instances[size_t(index)]->fps
+            : 0.0);
+}
+
+///
+/// \brief StressMonitor::sampleProcess -- RSS, CPU ticks and threads of this process, from /proc; -1 where unknown.
+///
+StressMonitor::ProcessSample StressMonitor::sampleProcess() {
+    ProcessSample result;
+#ifdef Q_OS_LINUX
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (statm.open(QIODevice::ReadOnly))
+        result.rssBytes = statm.readAll().split(' ').value(1).toLongLong() * sysconf(_SC_PAGESIZE);
+
+    // skip "pid (comm)", comm may contain spaces; utime and stime are fields 14 and 15, the 12th and 13th after ')'.
+    QFile stat(QStringLiteral("/proc/self/stat"));
+    if (stat.open(QIODevice::ReadOnly)) {
+        const QByteArray        line   = stat.readAll();
+        const QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+        if (fields.size() > 12)
+            result.cpuTicks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+    }
+
+    const QDir tasks(QStringLiteral("/proc/self/task"));
+    if (tasks.exists()) {
+        static const QRegularExpression digits(QStringLiteral("\\d+"));
+        result.threads       = 0;
+        result.decodeThreads = 0;
+        for (const QString &tid : tasks.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            QFile comm(tasks.filePath(tid + QStringLiteral("/comm")));
+            if (!comm.open(QIODevice::ReadOnly))
+                continue;                           // exited meanwhile
+            const QString name = QString::fromUtf8(comm.readAll()).trimmed();
+            result.threads++;
+            if (DECODE_THREAD_NAMES.match(name).hasMatch())
+                result.decodeThreads++;
+            result.threadNames[QString(name).remove(digits)]++;
+        }
+    }
+#endif /* Q_OS_LINUX */
+    return (result);
+}
+
+///
+/// \brief StressMonitor::sample -- append a row to the table.
+///
+void StressMonitor::sample() {
+    const qint64 nowMs   = m_clock.elapsed();
+    const qreal  seconds = qMax<qint64>(1, nowMs - m_lastSampleMs) / 1000.0;
+    m_lastSampleMs = nowMs;
+
+    int     playing = 0;
+    qreal   total   = 0.0;
+    qreal   lowest  = -1.0;
+    qreal   highest = 0.0;
+    quint64 dropped = 0;
+    for (Instance *instance : m_instances) {
+        if (!instance)
+            continue;
+        const quint64 frames = instance->frameCount.load(std::memory_order_relaxed);
+        instance->fps           = (frames - instance->sampledFrames) / seconds;
+        instance->sampledFrames = frames;
+        dropped += instance->dropped.load(std::memory_order_relaxed);
+        if (instance->firstFrameMs < 0) {           // not started yet: exclude from min/mean
+            if (frames > 0) {
+                instance->firstFrameMs = nowMs;
+                instance->firstFrames  = frames;
+            }
+            continue;
+        }
+        playing++;
+        total  += instance->fps;
+        lowest  = (lowest < 0.0) ? instance->fps : qMin(lowest, instance->fps);
+        highest = qMax(highest, instance->fps);
+        instance->minFps = (instance->minFps < 0.0) ? instance->fps : qMin(instance->minFps, instance->fps);
+    }
+
+    const ProcessSample process = sampleProcess();
+    const qreal cpu = ((process.cpuTicks >= 0) && (m_lastCpuTicks >= 0))
+#ifdef Q_OS_LINUX
+                      ? 100.0 * (process.cpuTicks - m_lastCpuTicks) / double(sysconf(_SC_CLK_TCK)) / seconds
+#else
+                      ? 0.0
+#endif /* Q_OS_LINUX */
+                      : -1.0;
+    m_lastCpuTicks = process.cpuTicks;
+    m_peakRssBytes = qMax(m_peakRssBytes, process.rssBytes);
+    m_maxDecode    = qMax(m_maxDecode, process.decodeThreads);
+    if (process.threads > m_maxThreads) {
+        m_maxThreads  = process.threads;
+        m_threadNames = process.threadNames;
+    }
+
+    const auto orNa = [](const qreal value, const int width, const int precision) {
+        return ((value < 0.0) ? QStringLiteral("n/a").rightJustified(width)
+                              : QStringLiteral("%1").arg(value, width, 'f', precision));
+    };
+    writeLine(QStringLiteral("  %1 %2 %3 %4 %5 %6 %7 %8 %9 %10")
+              .arg(nowMs / 1000.0, 7, 'f', 1)
+              .arg(playing, 8)
+              .arg(total, 10, 'f', 1)
+              .arg(orNa(lowest, 8, 1))
+              .arg(highest, 8, 'f', 1)
+              .arg(dropped, 8)
+              .arg(orNa(process.threads, 8, 0))
+              .arg(orNa(process.decodeThreads, 7, 0))
+              .arg(orNa((process.rssBytes < 0) ? -1.0 : process.rssBytes / (1024.0 * 1024.0), 8, 1))
+              .arg(orNa(cpu, 7, 1)));
+    Q_EMIT sampled();
+}
+
+///
+/// \brief StressMonitor::finish -- per-player totals, and process peaks; once.
+///
+void StressMonitor::finish() {
+    if (!m_players || m_finished)
+        return;
+    m_finished = true;
+    m_sampler.stop();
+    m_deadline.stop();
+    sample();
+
+    const qint64 nowMs = m_clock.elapsed();
+    writeLine(QStringLiteral("# %1 %2 %3 %4 %5  %6")
+              .arg(QStringLiteral("player"),   7)
+              .arg(QStringLiteral("fps:mean"), 8)
+              .arg(QStringLiteral("fps:min"),  8)
+              .arg(QStringLiteral("frames"),   8)
+              .arg(QStringLiteral("dropped"),  8)
+              .arg(QStringLiteral("source")));
+    for (size_t i = 0; i < m_instances.size(); i++) {
+        const Instance *instance = m_instances[i];
+        if (!instance)
+            continue;
+        const quint64 frames = instance->frameCount.load();
+        const qreal   mean   = (instance->firstFrameMs < 0) || (nowMs <= instance->firstFrameMs)
+                               ? 0.0
+                               : (frames - instance->firstFrames) * 1000.0 / (nowMs - instance->firstFrameMs);
+        writeLine(QStringLiteral("  %1 %2 %3 %4 %5  %6")
+                  .arg(int(i), 7)
+                  .arg(mean, 8, 'f', 1)
+                  .arg(qMax(0.0, instance->minFps), 8, 'f', 1)
+                  .arg(frames, 8)
+                  .arg(instance->dropped.load(), 8)
+                  .arg(instance->source));
+    }
+
+    const qint64 elapsedMs = qMax<qint64>(1, nowMs);
+    QString cpu = QStringLiteral("n/a");
+#ifdef Q_OS_LINUX
+    if ((m_firstCpuTicks >= 0) && (m_lastCpuTicks >= 0))
+        cpu = QString::number(100.0 * (m_lastCpuTicks - m_firstCpuTicks) / double(sysconf(_SC_CLK_TCK))
+                              / (elapsedMs / 1000.0), 'f', 1);
+#endif /* Q_OS_LINUX */
+    writeLine(QStringLiteral("# process: peak rss %1MB, mean cpu %2%, peak threads %3 (%4 decode)")
+              .arg((m_peakRssBytes < 0) ? QStringLiteral("n/a") : QString::number(m_peakRssBytes / (1024.0 * 1024.0), 'f', 1),
+                   cpu)
+              .arg(m_maxThreads)
+              .arg(m_maxDecode));
+    QStringList names;
+    for (auto it = m_threadNames.cbegin(); it != m_threadNames.cend(); ++it)
+        names.append(QStringLiteral("%1 x%2").arg(it.key()).arg(it.value()));
+    names.sort();
+    if (!names.isEmpty())
+        writeLine(QStringLiteral("# threads: ") + names.join(QStringLiteral(", ")));
+}
+
+void StressMonitor::writeLine(const QString &line) {
+    if (!m_output.isOpen())
+        return;
+    m_output.write(line.toUtf8());
+    m_output.write("\n");
+    m_output.flush();                               // keep what was measured if killed
+}
@@ -0,0 +1,124 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef STRESSMONITOR_H
+#define STRESSMONITOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QUrl>
+#include <atomic>
+#include <vector>
+
+#include "videoframesource.h"
+
+///
+/// \brief The StressMonitor class
+///
+/// Measures how the multimedia stack scales with concurrent players: with '--players=N'
+/// main.qml lays out a grid of N MediaPlayer/VideoOutput pairs, each fed one of the local
+/// media files on the command line (cycling), or else one of 'sourcesModel', and adds
+/// each player here. Every '--stress-interval' seconds a row is appended to a text table
+/// ('--stress-output', default stdout) with
+///  - the total, lowest and highest frame rate across the players,
+///  - frames dropped, i.e. gaps in the frame timestamps of a player larger than 1.5x its
+///    usual frame interval,
+///  - threads in the process, and how many of those are named like decoder, demuxer or
+///    queue threads of the backend (gstreamer, FFmpeg, MediaCodec, ...),
+///  - resident memory, and CPU time as a percentage of one core (Linux/Android, /proc),
+/// and, on quitting (or after '--stress-seconds'), per-player totals and the threads by
+/// name. The header records the Qt version, so tables from different Qt builds can be
+/// compared to find where scaling falls off.
+///
+class StressMonitor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int  players READ players CONSTANT)   // --players
+    Q_PROPERTY(bool active  READ active  CONSTANT)
+    Q_PROPERTY(int  columns READ columns CONSTANT)   // of main.qml's grid
+
+public:
+    explicit StressMonitor(QObject *parent = nullptr);
+    ~StressMonitor() override;
+
+    void configure(const int players,
+                   const QList<QUrl> &files,
+                   const int seconds,
+                   const int intervalSeconds,
+                   const QString &outputPath);
+
+    int  players() const { return (m_players); }
+    bool active() const  { return (m_players > 0); }
+    int  columns() const;
+
+    // the local file for grid tile 'index', or an empty url to use 'sourcesModel'.
+    Q_INVOKABLE QUrl  sourceFor(const int index) const;
+    Q_INVOKABLE void  addPlayer(const int index, QObject *qmlPlayer, const QString &source);
+    Q_INVOKABLE qreal fps(const int index) const;
+
+Q_SIGNALS:
+    void sampled();
+
+private:
+    struct Instance {
+        VideoFrameSource        frames;
+        QString                 source;
+        std::atomic<quint64>    frameCount{0};
+        std::atomic<quint64>    dropped{0};
+        qint64                  lastStartUs     = -1;   // frame thread only
+        qint64                  intervalUs      = 0;    // frame thread only: shortest seen
+        quint64                 sampledFrames   = 0;    // GUI thread, below
+        qreal                   fps             = 0.0;
+        qreal                   minFps          = -1.0;
+        qint64                  firstFrameMs    = -1;
+        quint64                 firstFrames     = 0;
+    };
+
+    struct ProcessSample {
+        qint64              rssBytes        = -1;
+        qint64              cpuTicks        = -1;
+        int                 threads         = -1;
+        int                 decodeThreads   = -1;
+        QHash<QString, int> threadNames;            // digits removed, e.g. "multiqueue:src_"
+    };
+
+    static ProcessSample sampleProcess();
+    void sample();
+    void finish();
+    void writeLine(const QString &line);
+
+    int                                 m_players       = 0;
+    QList<QUrl>                         m_files;
+    std::vector<Instance *>             m_instances;    // by grid index, owned
+    QTimer                              m_sampler;
+    QTimer                              m_deadline;
+    QElapsedTimer                       m_clock;
+    QFile                               m_output;
+    qint64                              m_lastSampleMs  = 0;
+    qint64                              m_lastCpuTicks  = -1;
+    qint64                              m_firstCpuTicks = -1;
+    qint64                              m_peakRssBytes  = -1;
+    int                                 m_maxThreads    = -1;
+    int                                 m_maxDecode     = -1;
+    QHash<QString, int>                 m_threadNames;  // at the peak thread count
+    bool                                m_finished      = false;
+};
+
+#endif // STRESSMONITOR_H
@@ -0,0 +1,490 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "tracelogger.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include <cstdio>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <sys/prctl.h>   //prctl(PR_GET_NAME)
+#endif /* Q_OS_LINUX */
+
+static const size_t RING_EVENTS         = 2048;     // per thread, 128KB
+static const int    FLUSH_INTERVAL_MS   = 50;
+static const int    DRAIN_CHUNK         = 256;      // events
+static const int    MAX_TEXT_EVENTS     = 8;        // messages are cut at 8 * 40 bytes
+static const int    TEXT_BYTES          = int(sizeof(TraceLogger::Event::text));
+static const char   TRACE_MAGIC[8]      = { 'Q', 'V', 'B', 'T', 'R', 'A', 'C', 'E' };
+static const quint8 TRACE_VERSION       = 1;
+
+static_assert(sizeof(TraceLogger::Event) == 64, "trace events are written to the file as is");
+
+TraceLogger       *TraceLogger::s_instance = nullptr;
+std::atomic<bool>  TraceLogger::s_enabled{false};
+
+struct TraceLogger::ThreadBuffer {
+    explicit ThreadBuffer(const quint32 id) : ring(RING_EVENTS), thread(id) {}
+
+    SpscRing<Event>         ring;               // this thread produces, the flusher consumes
+    quint32                 thread;
+    QByteArray              name;
+    bool                    announced = false;  // ThreadDefinition written; drain() only
+    std::atomic<quint64>    dropped{0};
+    std::atomic<bool>       retired{false};     // the thread has exited: drain, then delete
+};
+
+///
+/// \brief The ThreadBufferHolder struct -- marks the thread's buffer retired when the thread exits.
+///
+struct ThreadBufferHolder {
+    void               *buffer  = nullptr;
+    std::atomic<bool>  *retired = nullptr;
+    ~ThreadBufferHolder() {
+        if (retired)
+            retired->store(true, std::memory_order_release);
+    }
+};
+static thread_local ThreadBufferHolder t_holder;
+
+static QByteArray currentThreadName() {
+    const QThread *thread = QThread::currentThread();
+    if (thread && !thread->objectName().isEmpty())
+        return (thread->objectName().toUtf8());
+#ifdef Q_OS_LINUX
+    char name[17] = { 0 };
+    if (prctl(PR_GET_NAME, name) == 0)
+        return (QByteArray(name));
+#endif /* Q_OS_LINUX */
+    return (QByteArray());
+}
+
+///
+/// \brief fillText -- 'text' into 'events' (up to 'max'), the first with 'phase', the rest as Continuation.
+/// \return the number of events filled.
+///
+static int fillText(TraceLogger::Event *events, const int max, const TraceLogger::Event &first, const QByteArray &text) {
+    const int count = qBound(1, (text.size() + TEXT_BYTES - 1) / TEXT_BYTES, max);
+    for (int i = 0; i < count; i++) {
+        events[i] = first;
+        if (i > 0)
+            events[i].phase = TraceLogger::Continuation;
+        const int offset = i * TEXT_BYTES;
+        const int length = qBound(0, text.size() - offset, TEXT_BYTES);
+        std::memset(events[i].text, 0, TEXT_BYTES);
+        std::memcpy(events[i].text, text.constData() + offset, size_t(length));
+    }
+    return (count);
+}
+
+static QByteArray textOf(const TraceLogger::Event &event) {
+    return (QByteArray(event.text, int(qstrnlen(event.text, TEXT_BYTES))));
+}
+
+TraceLogger::TraceLogger(QObject *parent)
+    : QObject(parent)
+{
+    s_instance = this;
+    m_names.append(QByteArray());               // id 0
+}
+
+TraceLogger::~TraceLogger() {
+    stop();
+    s_instance = nullptr;
+    // buffers of threads still running stay allocated: they may yet write to them.
+}
+
+TraceLogger *TraceLogger::instance() {
+    return (s_instance);
+}
+
+///
+/// \brief TraceLogger::start -- trace to 'path' from now on, including Qt's messages.
+///
+bool TraceLogger::start(const QString &path) {
+    if (m_flusher)
+        return (false);
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        qWarning() << Q_FUNC_INFO << ": unable to write" << path << ":" << m_file.errorString();
+        return (false);
+    }
+    m_clock.start();
+    Event header;
+    std::memset(&header, 0, sizeof(header));
+    header.phase  = Header;
+    header.flags  = TRACE_VERSION;
+    header.name   = quint16(sizeof(Event));
+    header.thread = quint32(QCoreApplication::applicationPid());
+    header.value  = double(QDateTime::currentMSecsSinceEpoch());
+    std::memcpy(header.text, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_droppedName = internName(QByteArrayLiteral("trace.dropped"));
+
+    s_enabled = true;
+    m_previousHandler = qInstallMessageHandler(&TraceLogger::messageHandler);
+    m_stop    = false;
+    m_flusher = QThread::create([this]() { run(); });
+    m_flusher->setObjectName(QStringLiteral("TraceLogger"));
+    m_flusher->start(QThread::LowPriority);
+    return (true);
+}
+
+void TraceLogger::stop() {
+    if (!m_flusher)
+        return;
+    qInstallMessageHandler(m_previousHandler);
+    s_enabled = false;
+    {
+        QMutexLocker lock(&m_stateMutex);
+        m_stop = true;
+        m_wake.wakeAll();
+    }
+    m_flusher->wait();
+    delete m_flusher;
+    m_flusher = nullptr;
+    drain();                                    // what was recorded meanwhile
+    m_file.close();
+}
+
+quint16 TraceLogger::intern(const char *name) {
+    return ((s_instance) ? s_instance->internName(QByteArray(name)) : 0);
+}
+
+quint16 TraceLogger::internName(const QByteArray &name) {
+    {
+        QReadLocker lock(&m_namesLock);
+        const auto it = m_nameIds.constFind(name);
+        if (it != m_nameIds.constEnd())
+            return (it.value());
+    }
+    QWriteLocker lock(&m_namesLock);
+    const auto it = m_nameIds.constFind(name);
+    if (it != m_nameIds.constEnd())
+        return (it.value());
+    if (m_names.size() > 0xFFFF)
+        return (0);                             // out of ids: unnamed
+    const quint16 id = quint16(m_names.size());
+    m_names.append(name);
+    m_nameIds.insert(name, id);
+    return (id);
+}
+
+quint16 TraceLogger::internQmlName(const QString &name) {
+    {
+        QReadLocker lock(&m_namesLock);
+        const auto it = m_qmlNameIds.constFind(name);
+        if (it != m_qmlNameIds.constEnd())
+            return (it.value());
+    }
+    const quint16 id = internName(name.toUtf8());
+    QWriteLocker lock(&m_namesLock);
+    m_qmlNameIds.insert(name, id);
+    return (id);
+}
+
+///
+/// \brief TraceLogger::threadBuffer -- the calling thread's ring, created (and registered with the flusher) on first use.
+///
+TraceLogger::ThreadBuffer *TraceLogger::threadBuffer() {
+    if (t_holder.buffer)
+        return (static_cast<ThreadBuffer *>(t_holder.buffer));
+    ThreadBuffer *buffer = new ThreadBuffer(m_nextThread++);
+    buffer->name = currentThreadName();
+    if (buffer->name.isEmpty())
+        buffer->name = QByteArrayLiteral("thread ") + QByteArray::number(buffer->thread);
+    {
+        QMutexLocker lock(&m_threadsMutex);
+        m_threads.append(buffer);
+    }
+    t_holder.buffer  = buffer;
+    t_holder.retired = &buffer->retired;
+    return (buffer);
+}
+
+///
+/// \brief TraceLogger::record -- on any thread: one event into the thread's ring; never blocks.
+///
+void TraceLogger::record(const Phase phase, const quint16 name, const double value) {
+    TraceLogger *self = s_instance;
+    if (!self || !isEnabled())
+        return;
+    ThreadBuffer *buffer = self->threadBuffer();
+    Event event;
+    event.timestampNs = self->m_clock.nsecsElapsed();
+    event.value       = value;
+    event.thread      = buffer->thread;
+    event.name        = name;
+    event.phase       = phase;
+    event.flags       = 0;
+    std::memset(event.text, 0, sizeof(event.text));
+    if (!buffer->ring.write(&event, 1))
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+///
+/// \brief TraceLogger::recordText -- on any thread: an event with 'text', in as many events as it takes; all or none.
+///
+void TraceLogger::recordText(const Phase phase, const quint16 name, const quint8 flags, const QByteArray &text) {
+    TraceLogger *self = s_instance;
+    if (!self || !isEnabled())
+        return;
+    ThreadBuffer *buffer = self->threadBuffer();
+    Event first;
+    first.timestampNs = self->m_clock.nsecsElapsed();
+    first.value       = double(text.size());
+    first.thread      = buffer->thread;
+    first.name        = name;
+    first.phase       = phase;
+    first.flags       = flags;
+    Event events[MAX_TEXT_EVENTS];
+    const int count = fillText(events, MAX_TEXT_EVENTS, first, text);
+    if (buffer->ring.writeAvailable() < size_t(count))
+        buffer->dropped.fetch_add(quint64(count), std::memory_order_relaxed);
+    else
+        buffer->ring.write(events, size_t(count));
+}
+
+///
+/// \brief TraceLogger::messageHandler -- Qt's messages into the rings; warnings and worse also to the previous handler.
+///
+void TraceLogger::messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message) {
+    TraceLogger *self    = s_instance;
+    const bool   tracing = (self && isEnabled());
+    if (tracing) {
+        recordText(Message, self->internName(QByteArray((context.category) ? context.category : "default")),
+                   quint8(type), message.toUtf8());
+        if (type == QtFatalMsg)
+            self->drain();                      // about to abort
+    }
+    if (tracing && ((type == QtDebugMsg) || (type == QtInfoMsg)))
+        return;
+    if (self && self->m_previousHandler)
+        self->m_previousHandler(type, context, message);
+    else {
+        std::fprintf(stderr, "%s\n", qPrintable(qFormatLogMessage(type, context, message)));
+        std::fflush(stderr);
+    }
+}
+
+void TraceLogger::instant(const QString &name, const qreal value) {
+    if (isEnabled())
+        record(Instant, internQmlName(name), value);
+}
+
+void TraceLogger::begin(const QString &name) {
+    if (isEnabled())
+        record(Begin, internQmlName(name));
+}
+
+void TraceLogger::end(const QString &name) {
+    if (isEnabled())
+        record(End, internQmlName(name));
+}
+
+void TraceLogger::counter(const QString &name, const qreal value) {
+    if (isEnabled())
+        record(Counter, internQmlName(name), value);
+}
+
+void TraceLogger::message(const QString &name, const QString &text) {
+    if (isEnabled())
+        recordText(Message, internQmlName(name), quint8(QtDebugMsg), text.toUtf8());
+    else
+        qDebug().noquote() << name << text;
+}
+
+void TraceLogger::run() {
+    QMutexLocker lock(&m_stateMutex);
+    while (!m_stop) {
+        m_wake.wait(&m_stateMutex, FLUSH_INTERVAL_MS);
+        lock.unlock();
+        drain();
+        lock.relock();
+    }
+}
+
+///
+/// \brief TraceLogger::drain -- new name and thread definitions, then every ring's events, appended to the file.
+///
+void TraceLogger::drain() {
+    QMutexLocker lock(&m_drainMutex);
+    if (!m_file.isOpen())
+        return;
+
+    QByteArray out;
+    Event      events[DRAIN_CHUNK];
+    Event      definition;
+    std::memset(&definition, 0, sizeof(definition));
+    {
+        QReadLocker names(&m_namesLock);
+        for (; m_namesWritten < m_names.size(); m_namesWritten++) {
+            definition.phase = NameDefinition;
+            definition.name  = quint16(m_namesWritten);
+            const int count = fillText(events, MAX_TEXT_EVENTS, definition, m_names.at(m_namesWritten));
+            out.append(reinterpret_cast<const char *>(events), count * int(sizeof(Event)));
+        }
+    }
+
+    QList<ThreadBuffer *> buffers;
+    {
+        QMutexLocker threads(&m_threadsMutex);
+        buffers = m_threads;
+    }
+    for (ThreadBuffer *buffer : qAsConst(buffers)) {
+        if (!buffer->announced) {
+            definition.phase  = ThreadDefinition;
+            definition.name   = 0;
+            definition.thread = buffer->thread;
+            const int count = fillText(events, MAX_TEXT_EVENTS, definition, buffer->name);
+            out.append(reinterpret_cast<const char *>(events), count * int(sizeof(Event)));
+            buffer->announced = true;
+        }
+        const bool retired = buffer->retired.load(std::memory_order_acquire);
+        size_t count;
+        while ((count = buffer->ring.read(events, DRAIN_CHUNK)) > 0)
+            out.append(reinterpret_cast<const char *>(events), int(count * sizeof(Event)));
+        const quint64 dropped = buffer->dropped.exchange(0);
+        if (dropped) {
+            Event event;
+            std::memset(&event, 0, sizeof(event));
+            event.timestampNs = m_clock.nsecsElapsed();
+            event.value       = double(dropped);
+            event.thread      = buffer->thread;
+            event.name        = m_droppedName;
+            event.phase       = Counter;
+            out.append(reinterpret_cast<const char *>(&event), int(sizeof(event)));
+        }
+        if (retired) {
+            QMutexLocker threads(&m_threadsMutex);
+            m_threads.removeOne(buffer);
+            delete buffer;
+        }
+    }
+    if (!out.isEmpty() && (m_file.write(out) != out.size()))
+        std::fprintf(stderr, "TraceLogger: unable to write %s\n", qPrintable(m_file.fileName()));
+}
+
+///
+/// \brief TraceLogger::convertToChromeJson -- two passes: names and threads may be defined after their first use.
+///
+bool TraceLogger::convertToChromeJson(const QString &tracePath, QIODevice *out) {
+    QFile file(tracePath);
+    Event header;
+    if (   !file.open(QIODevice::ReadOnly)
+        || (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header)))
+        || (header.phase != Header) || (header.name != sizeof(Event))
+        || std::memcmp(header.text, TRACE_MAGIC, sizeof(TRACE_MAGIC))) {
+        qWarning() << Q_FUNC_INFO << ": not a trace:" << tracePath;
+        return (false);
+    }
+    const qint64 pid = header.thread;
+
+    QHash<quint16, QByteArray> names;
+    QHash<quint32, QByteArray> threads;
+    Event       event;
+    QByteArray *definition = nullptr;           // being continued
+    while (file.read(reinterpret_cast<char *>(&event), sizeof(event)) == qint64(sizeof(event))) {
+        if (event.phase == NameDefinition) {
+            definition  = &names[event.name];
+            *definition = textOf(event);
+        }
+        else if (event.phase == ThreadDefinition) {
+            definition  = &threads[event.thread];
+            *definition = textOf(event);
+        }
+        else if ((event.phase == Continuation) && definition)
+            definition->append(textOf(event));
+        else
+            definition = nullptr;
+    }
+
+    static const char *const LEVELS[] = { "debug", "warning", "critical", "fatal", "info" };
+    out->write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    const auto emitEvent = [out, &first](const QJsonObject &object) {
+        if (!first)
+            out->write(",\n");
+        first = false;
+        out->write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    };
+    for (auto it = threads.cbegin(); it != threads.cend(); ++it)
+        emitEvent(QJsonObject{ { QStringLiteral("name"), QStringLiteral("thread_name") },
+                               { QStringLiteral("ph"),   QStringLiteral("M") },
+                               { QStringLiteral("pid"),  pid },
+                               { QStringLiteral("tid"),  qint64(it.key()) },
+                               { QStringLiteral("args"), QJsonObject{ { QStringLiteral("name"), QString::fromUtf8(it.value()) } } } });
+
+    file.seek(sizeof(header));
+    QJsonObject message;                        // being continued
+    QByteArray  text;
+    const auto flushMessage = [&]() {
+        if (message.isEmpty())
+            return;
+        message.insert(QStringLiteral("args"), QJsonObject{ { QStringLiteral("message"), QString::fromUtf8(text) } });
+        emitEvent(message);
+        message = QJsonObject();
+    };
+    while (file.read(reinterpret_cast<char *>(&event), sizeof(event)) == qint64(sizeof(event))) {
+        if (event.phase == Continuation) {
+            if (!message.isEmpty())
+                text.append(textOf(event));
+            continue;
+        }
+        flushMessage();
+        if ((event.phase == NameDefinition) || (event.phase == ThreadDefinition))
+            continue;
+
+        const QString name = QString::fromUtf8(names.value(event.name));
+        QJsonObject object{ { QStringLiteral("name"), name },
+                            { QStringLiteral("ts"),   event.timestampNs / 1000.0 },
+                            { QStringLiteral("pid"),  pid },
+                            { QStringLiteral("tid"),  qint64(event.thread) } };
+        switch (event.phase) {
+        case Instant:
+            object.insert(QStringLiteral("ph"),   QStringLiteral("i"));
+            object.insert(QStringLiteral("s"),    QStringLiteral("t"));
+            object.insert(QStringLiteral("args"), QJsonObject{ { QStringLiteral("value"), event.value } });
+            emitEvent(object);
+            break;
+        case Begin:
+        case End:
+            object.insert(QStringLiteral("ph"), QString(QLatin1Char(char(event.phase))));
+            emitEvent(object);
+            break;
+        case Counter:
+            object.insert(QStringLiteral("ph"),   QStringLiteral("C"));
+            object.insert(QStringLiteral("args"), QJsonObject{ { name, event.value } });
+            emitEvent(object);
+            break;
+        case Message:
+            object.insert(QStringLiteral("ph"),  QStringLiteral("i"));
+            object.insert(QStringLiteral("s"),   QStringLiteral("t"));
+            object.insert(QStringLiteral("cat"), QLatin1String(LEVELS[qMin<int>(event.flags, 4)]));
+            message = object;
+            text    = textOf(event);
+            break;
+        default:
+            break;
+        }
+    }
+    flushMessage();
+    out->write("\n]}\n");
+    return (true);
+}
@@ -0,0 +1,148 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef TRACELOGGER_H
+#define TRACELOGGER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+
+#include "spscring.h"
+
+class QIODevice;
+
+///
+/// \brief The TraceLogger class
+///
+/// Low-overhead tracing, for leaving on in production without disturbing the timing being
+/// investigated. Each thread records fixed-size (64 byte) binary events -- instants,
+/// begin/end pairs, counters and log messages -- into its own lock-free SpscRing, with no
+/// formatting, allocation or locking; names are interned to 16-bit ids, once per call site
+/// from C++ (TRACE_* macros). A background flusher drains the rings every FLUSH_INTERVAL_MS
+/// and appends them to the '--trace' file, preceded by the definitions of new names and
+/// threads. A full ring drops events rather than block, and the drops are traced too.
+///
+/// start() also installs a message handler, so qDebug()/qWarning() and QML console.log()
+/// are recorded into the same rings, in 40-byte pieces; warnings and worse are still
+/// passed on to the previous handler. '--convert-trace' turns a trace into Chrome trace
+/// JSON, for chrome://tracing or https://ui.perfetto.dev.
+///
+/// QML emits events through the 'TraceLogger' singleton; message() there falls back to
+/// console output while tracing is off, so it can replace console.log() on hot paths.
+///
+class TraceLogger : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool    enabled READ enabled CONSTANT)
+    Q_PROPERTY(QString path    READ path    CONSTANT)
+
+public:
+    enum Phase : quint8 {
+        Instant         = 'i',
+        Begin           = 'B',
+        End             = 'E',
+        Counter         = 'C',
+        Message         = 'm',      // 'flags' is the QtMsgType
+        Continuation    = '+',      // more text of the preceding event, same thread
+        NameDefinition  = 'N',      // in the file only: 'name' is the id, 'text' the name
+        ThreadDefinition= 'T',      // in the file only: 'thread' is the id, 'text' the name
+        Header          = 'H'       // in the file only, first
+    };
+
+    struct Event {
+        qint64  timestampNs;        // since the trace started
+        double  value;
+        quint32 thread;
+        quint16 name;
+        quint8  phase;
+        quint8  flags;
+        char    text[40];           // UTF-8, NUL-padded
+    };
+
+    explicit TraceLogger(QObject *parent = nullptr);
+    ~TraceLogger() override;
+
+    static TraceLogger *instance();                 // nullptr until constructed in main()
+    static bool isEnabled() { return (s_enabled.load(std::memory_order_relaxed)); }
+
+    bool    start(const QString &path);
+    void    stop();
+    bool    enabled() const { return (isEnabled()); }
+    QString path() const { return (m_file.fileName()); }
+
+    static quint16 intern(const char *name);
+    static void    record(const Phase phase, const quint16 name, const double value = 0.0);
+    static void    recordText(const Phase phase, const quint16 name, const quint8 flags, const QByteArray &text);
+    // '--convert-trace': the trace at 'tracePath' as Chrome trace JSON.
+    static bool    convertToChromeJson(const QString &tracePath, QIODevice *out);
+
+    Q_INVOKABLE void instant(const QString &name, const qreal value = 0.0);
+    Q_INVOKABLE void begin(const QString &name);
+    Q_INVOKABLE void end(const QString &name);
+    Q_INVOKABLE void counter(const QString &name, const qreal value);
+    // like console.log(name + ": " + text), formatted only if tracing is off.
+    Q_INVOKABLE void message(const QString &name, const QString &text);
+
+private:
+    struct ThreadBuffer;
+
+    quint16       internName(const QByteArray &name);
+    quint16       internQmlName(const QString &name);
+    ThreadBuffer *threadBuffer();
+    void          run();                            // the flusher
+    void          drain();
+    static void   messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message);
+
+    static TraceLogger             *s_instance;
+    static std::atomic<bool>        s_enabled;
+
+    QReadWriteLock                  m_namesLock;
+    QHash<QByteArray, quint16>      m_nameIds;
+    QHash<QString, quint16>         m_qmlNameIds;   // the same, without converting QML's strings each call
+    QVector<QByteArray>             m_names;        // by id; 0 is unnamed
+    QMutex                          m_threadsMutex;
+    QList<ThreadBuffer *>           m_threads;
+    std::atomic<quint32>            m_nextThread{1};
+    QElapsedTimer                   m_clock;        // timestamps, from start()
+    quint16                         m_droppedName   = 0;
+
+    QMutex                          m_drainMutex;   // one consumer of the rings at a time, and guards below
+    QFile                           m_file;
+    int                             m_namesWritten  = 0;
+    QMutex                          m_stateMutex;
+    QWaitCondition                  m_wake;
+    bool                            m_stop          = false;
+    QThread                        *m_flusher       = nullptr;
+    QtMessageHandler                m_previousHandler = nullptr;
+};
+
+#define TRACE_NAME_(name)   ([]() { static const quint16 id = TraceLogger::intern(name); return (id); }())
+#define TRACE_INSTANT(name, value)  do { if (TraceLogger::isEnabled()) TraceLogger::record(TraceLogger::Instant, TRACE_NAME_(name), (value)); } while (0)
+#define TRACE_BEGIN(name)           do { if (TraceLogger::isEnabled()) TraceLogger::record(TraceLogger::Begin,   TRACE_NAME_(name)); } while (0)
+#define TRACE_END(name)             do { if (TraceLogger::isEnabled()) TraceLogger::record(TraceLogger::End,     TRACE_NAME_(name)); } while (0)
+#define TRACE_COUNTER(name, value)  do { if (TraceLogger::isEnabled()) TraceLogger::record(TraceLogger::Counter, TRACE_NAME_(name), (value)); } while (0)
+
+#endif // TRACELOGGER_H
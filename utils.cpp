@@ -14,12 +14,16 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "utils.h"
+#include "tracelogger.h"    //for TRACE_INSTANT() in Utils::keepScreenOn()
 #include <QSslSocket>       //for Utils::supportsSSL()
 #include <QCoreApplication> //for Utils::argv()
 #include <QUrl>             //for Utils::argv()
 #include <QDir>             //for Utils::argv()
 #include <QDebug>           //for Utils::argv()
 #include <QLocale>
+#include <QElapsedTimer>    //for Utils::deleteFiles(), touchFiles()
+#include <QMutex>
+#include <atomic>
 
 //#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
 //#include <QtMultimedia/QAudio>
@@ -37,9 +41,19 @@
 #endif /* (QT_VERSION < QT_VERSION_CHECK(6, 0, 0)) */
 #endif /* Q_OS_ANDROID */
 
+static const int FILE_OPERATION_THREADS     = 2;    //SD cards & eMMC gain little from more, and playback shares the same I/O
+static const int FILE_PROGRESS_INTERVAL_MS  = 100;  //fileOperationProgress() at most this often
 
-QString Utils::toHtmlEscaped(const QString str) const {
-    return (str.toHtmlEscaped());
+///
+/// \brief Utils::toHtmlEscaped
+/// \param str
+/// \return 'str' itself (shared, not copied) when there's nothing to escape, e.g. most titles.
+///
+QString Utils::toHtmlEscaped(const QString &str) const {
+    for (const QChar c : str)
+        if ((c == QLatin1Char('<')) || (c == QLatin1Char('>')) || (c == QLatin1Char('&')) || (c == QLatin1Char('"')))
+            return (str.toHtmlEscaped());
+    return (str);
 }
 
 ///
@@ -68,6 +82,8 @@ QList<QUrl> Utils::argv() const
         return result;
 
     for (const QString &arg : qAsConst(args)) {
+        if (arg.startsWith(QLatin1Char('-')))   //command-line options, e.g. "--seconds=10", aren't files.
+            continue;
         const QString fp = arg.toLocal8Bit();
         if (QFile::exists(fp))
             result.append(QUrl::fromLocalFile((fp[0] == QDir::separator())
@@ -87,16 +103,57 @@ QList<QUrl> Utils::argv() const
 /// \return
 ///
 QString Utils::formattedDataSize(const qint64 sizeValue, const int precision) const {
-    return (QLocale::system().formattedDataSize(sizeValue,
-                                                precision,
-                                                QLocale::DataSizeTraditionalFormat)); //use regular stuff not default 'DataSizeelecFormat' bullshit that prints KiB MiB etc.
+    return (m_locale.formattedDataSize(sizeValue,               //cached: QLocale::system() is costly per call.
+                                       precision,
+                                       QLocale::DataSizeTraditionalFormat)); //use regular stuff not default 'DataSizeelecFormat' bullshit that prints KiB MiB etc.
 }
 #endif /* end: QT_VERSION... */
 
+// "00".."99": zero-padded minutes and seconds for formatDuration(), two characters per value.
+static const char DIGIT_PAIRS[] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+///
+/// \brief writeNumber -- as QString::number(value), into 'out'.
+/// \return the end of what was written.
+///
+static QChar *writeNumber(QChar *out, const long value) {
+    char          digits[24];
+    int           count     = 0;
+    unsigned long magnitude = (value < 0) ? (0ul - (unsigned long) value) : (unsigned long) value;
+    do {
+        digits[count++] = char('0' + (magnitude % 10ul));
+        magnitude /= 10ul;
+    } while (magnitude);
+    if (value < 0)
+        *out++ = QLatin1Char('-');
+    while (count)
+        *out++ = QLatin1Char(digits[--count]);
+    return (out);
+}
+
+///
+/// \brief writeField -- as ((value < 10) ? ":0" : ":") + QString::number(value), into 'out'.
+/// \return the end of what was written.
+///
+static QChar *writeField(QChar *out, const long value) {
+    *out++ = QLatin1Char(':');
+    if ((value >= 0l) && (value < 100l)) {
+        *out++ = QLatin1Char(DIGIT_PAIRS[2 * value]);
+        *out++ = QLatin1Char(DIGIT_PAIRS[2 * value + 1]);
+        return (out);
+    }
+    if (value < 10l)        //negative
+        *out++ = QLatin1Char('0');
+    return (writeNumber(out, value));
+}
+
 ///
 /// \brief Utils::formatDuration
 /// \param duration
-/// \return
+/// \return "M:SS" under an hour, else "H:MM:SS". Written into a stack buffer, so the result is
+/// the only allocation (formerly ~6 QString temporaries per call, from per-tick bindings).
 ///
 QString Utils::formatDuration(const double duration /*, bool milliminutesP */ ) const {
     long hours{}, minutes{}, seconds{};
@@ -115,12 +172,11 @@ QString Utils::formatDuration(const double duration /*, bool milliminutesP */ )
             minutes = 0l;
         }
 
-        if (hours == 0l)
-            return (QString::number(minutes)             //      return (QString::number(minutes) + ((seconds < 10) ? "'0" : "'") + QString::number(seconds)) + '"';
-                    + ((seconds < 10l)
-                           ? ":0"
-                           : ":")
-                    + QString::number(seconds));
+        if (hours == 0l) {
+            QChar  buffer[48];
+            QChar *end = writeField(writeNumber(buffer, minutes), seconds);
+            return (QString(buffer, int(end - buffer)));
+        }
     }
     else {
         hours   = (long) (duration / (60.0*60000.0));      //more than 60 mins --> HH:MM:SS
@@ -138,15 +194,9 @@ QString Utils::formatDuration(const double duration /*, bool milliminutesP */ )
         }
     }
 
-    return (QString::number(hours)
-            + ((minutes < 10l)
-                   ? ":0"
-                   : ":")
-            + QString::number(minutes)
-            + ((seconds < 10l)
-                   ? ":0"
-                   : ":")
-            + QString::number(seconds));
+    QChar  buffer[72];
+    QChar *end = writeField(writeField(writeNumber(buffer, hours), minutes), seconds);
+    return (QString(buffer, int(end - buffer)));
 }
 
 ///
@@ -206,8 +256,7 @@ void Utils::vibrate(const int milliseconds)
 /// \param on
 ///
 void Utils::keepScreenOn(const bool on) {
-    qWarning() << Q_FUNC_INFO
-               << "screen on=" << on;
+    TRACE_INSTANT("Utils::keepScreenOn", on);
 #ifdef Q_OS_ANDROID
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
     /// FROM https://stackoverflow.com/questions/27758499/how-to-keep-the-screen-on-in-qt-for-android
@@ -268,8 +317,11 @@ void Utils::keepScreenOn(const bool on) {
 #include <QProcess>
 
 Utils::Utils(QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      m_locale(QLocale::system())
 {
+    m_filePool.setMaxThreadCount(FILE_OPERATION_THREADS);
+
     // per https://www.vladest.org/qttipsandtricks/how-to-vibrate-with-qtqml-on-android.html
     // init m_vibratorService
 #ifdef Q_OS_ANDROID
@@ -364,30 +416,156 @@ QString Utils::osName() const
     return (QOperatingSystemVersion::current().name());
 }
 
+///
+/// \brief The FileOperation struct -- a deleteFiles()/touchFiles() batch, shared by its workers on Utils::m_filePool.
+///
+struct FileOperation {
+    enum Kind { Delete, Touch };
+
+    int                 id      = 0;
+    int                 kind    = Delete;
+    QStringList         paths;
+    QElapsedTimer       clock;
+    std::atomic<int>    next{0};            //index of the next path to claim
+    std::atomic<int>    done{0};
+    std::atomic<int>    succeeded{0};
+    std::atomic<int>    notFound{0};
+    std::atomic<int>    workers{0};         //the last one out posts finishFileOperation()
+    std::atomic<bool>   cancelled{false};
+    std::atomic<qint64> reportedAt{0};      //clock.elapsed() of the last progress report
+    QMutex              mutex;
+    QVariantList        failures;           //guarded by 'mutex'
+};
+
+///
+/// \brief deletePath
+/// \return "" on success, else why not.
+///
+static QString deletePath(const QString &path, bool *notFound) {
+    QFile file(path);
+    if (file.remove())
+        return (QString());
+    *notFound = !QFile::exists(path);       //only stat() again on failure
+    return ((*notFound) ? Utils::tr("File not found") : file.errorString());
+}
+
+static QString touchPath(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::Unbuffered|QIODevice::WriteOnly|QIODevice::Truncate))
+        return (file.errorString());
+    file.close();
+    return (QString());
+}
+
+Utils::~Utils() {
+    for (const QSharedPointer<FileOperation> &operation : qAsConst(m_fileOperations))
+        operation->cancelled = true;
+    m_filePool.waitForDone();
+}
+
 void Utils::deleteFile(const QString &path) {
-    if (QFile::exists(path)) {
-        if (QFile::remove(path)) {
-            Q_EMIT alert(tr("File(s) deleted from device"));
-        }
-        else {
-            Q_EMIT alert(tr("Unable to delete file(s) from device"));
-        }
-    }
-    else {
-        Q_EMIT alert(tr("File not found"));
-    }
+    deleteFiles(QStringList{ path });
 }
 
 void Utils::touchFile(const QString &path) {
-        QFile qf(path);
-        if (qf.open(QIODevice::Unbuffered|QIODevice::WriteOnly|QIODevice::Truncate)) {
-            qf.close();
-            qf.flush();
-            Q_EMIT alert(tr("File(s) touched on device"));
-        }
+    touchFiles(QStringList{ path });
+}
+
+int Utils::deleteFiles(const QStringList &paths) {
+    return (startFileOperation(FileOperation::Delete, paths));
+}
+
+int Utils::touchFiles(const QStringList &paths) {
+    return (startFileOperation(FileOperation::Touch, paths));
+}
+
+void Utils::cancelFileOperation(const int id) {
+    const auto it = m_fileOperations.constFind(id);
+    if (it != m_fileOperations.constEnd())
+        (*it)->cancelled = true;
+}
+
+///
+/// \brief Utils::startFileOperation -- up to FILE_OPERATION_THREADS workers claim paths in turn, so a batch of 500
+/// costs no more threads than a batch of 2, and concurrent batches share the same bound.
+///
+int Utils::startFileOperation(const int kind, const QStringList &paths) {
+    QSharedPointer<FileOperation> operation(new FileOperation);
+    operation->id    = m_nextFileOperation++;
+    operation->kind  = kind;
+    operation->paths = paths;
+    operation->clock.start();
+    m_fileOperations.insert(operation->id, operation);
+
+    const int workers = qMin(m_filePool.maxThreadCount(), paths.size());
+    operation->workers = workers;
+    if (workers == 0)                       //results are always asynchronous, after the caller has the id
+        QMetaObject::invokeMethod(this, [this, operation]() { finishFileOperation(operation); }, Qt::QueuedConnection);
+    for (int i = 0; i < workers; i++)
+        m_filePool.start([this, operation]() { runFileOperation(operation); });
+    return (operation->id);
+}
+
+///
+/// \brief Utils::runFileOperation -- on m_filePool.
+///
+void Utils::runFileOperation(const QSharedPointer<FileOperation> &operation) {
+    const int total = operation->paths.size();
+    int       index = 0;
+    while (!operation->cancelled && ((index = operation->next++) < total)) {
+        const QString &path     = operation->paths.at(index);
+        bool           notFound = false;
+        const QString  error    = (operation->kind == FileOperation::Delete)
+                                  ? deletePath(path, &notFound)
+                                  : touchPath(path);
+        if (error.isEmpty())
+            operation->succeeded++;
         else {
-            Q_EMIT alert(tr("Unable to open file(s) from device"));
+            QMutexLocker lock(&operation->mutex);
+            operation->failures.append(QVariantMap{ { QStringLiteral("path"),  path  },
+                                                    { QStringLiteral("error"), error } });
+            if (notFound)
+                operation->notFound++;
+        }
+
+        const int done       = ++operation->done;
+        const qint64 now     = operation->clock.elapsed();
+        qint64    reportedAt = operation->reportedAt;
+        if (   (done < total)
+            && (now - reportedAt >= FILE_PROGRESS_INTERVAL_MS)
+            && operation->reportedAt.compare_exchange_strong(reportedAt, now)) {   //one worker reports per interval
+            const int id = operation->id;
+            QMetaObject::invokeMethod(this, [this, id, done, total]() {
+                Q_EMIT fileOperationProgress(id, done, total);
+            }, Qt::QueuedConnection);
         }
+    }
+    if (--operation->workers == 0)
+        QMetaObject::invokeMethod(this, [this, operation]() { finishFileOperation(operation); }, Qt::QueuedConnection);
+}
+
+///
+/// \brief Utils::finishFileOperation -- on the GUI thread: the final progress, the aggregated result, and one alert().
+///
+void Utils::finishFileOperation(const QSharedPointer<FileOperation> &operation) {
+    m_fileOperations.remove(operation->id);
+    const int          total     = operation->paths.size();
+    const bool         cancelled = operation->cancelled;
+    const QVariantList failures  = operation->failures;   //the workers are done with it
+    Q_EMIT fileOperationProgress(operation->id, operation->done, total);
+    Q_EMIT fileOperationFinished(operation->id, operation->succeeded, failures, cancelled);
+
+    if (total == 0)
+        return;
+    const bool isDelete = (operation->kind == FileOperation::Delete);
+    if (cancelled)
+        Q_EMIT alert(tr("Cancelled after %1 of %2 file(s)").arg(operation->done.load()).arg(total));
+    else if (failures.isEmpty())
+        Q_EMIT alert((isDelete) ? tr("File(s) deleted from device") : tr("File(s) touched on device"));
+    else if (isDelete && (operation->notFound == total))
+        Q_EMIT alert(tr("File not found"));
+    else
+        Q_EMIT alert((isDelete) ? tr("Unable to delete file(s) from device") : tr("Unable to open file(s) from device"));
 }
 
 bool Utils::pathExists(const QString &path) const {
@@ -18,6 +18,12 @@
 
 #include <QObject>
 #include <QUrl>             //for Utils::argv()
+#include <QLocale>
+#include <QHash>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVariant>
 #include <qplatformdefs.h> // defines QT_VERSION, etc
 #include <QDebug>
 
@@ -33,6 +39,8 @@
 #endif /* (QT_VERSION < QT_VERSION_CHECK(6, 0, 0)) */
 #endif /* Q_OS_ANDROID */
 
+struct FileOperation;      //see utils.cpp
+
 #define UTILS_PROP(type,name) QNANO_PROPERTY(type, m_##name, name, set##name)
 
 class Utils : public QObject
@@ -41,6 +49,7 @@ class Utils : public QObject
 
 public:
     explicit Utils(QObject *parent = nullptr);
+    ~Utils() override;
   
     //convenience for missing QML QAudio::convertVolume(linear_value, QAudio::LinearVolumeScale, QAudio::LogarithmicVolumeScale);
     Q_INVOKABLE qreal linearToLog(qreal linear_value) const;
@@ -61,7 +70,7 @@ public:
     Q_INVOKABLE inline int qtVersionPatch() const //was: //{"_QT_VERSION_PATCH_", QVariant::fromValue(QT_VERSION_PATCH)}          //was: engine.rootContext()->setContextProperty("_QT_VERSION_PATCH_", QT_VERSION_PATCH);
     {return QT_VERSION_PATCH;}
   
-    Q_INVOKABLE QString toHtmlEscaped(const QString str) const;
+    Q_INVOKABLE QString toHtmlEscaped(const QString &str) const;
     Q_INVOKABLE bool supportsSSL() const;
     Q_INVOKABLE QList<QUrl> argv() const;
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
@@ -78,13 +87,27 @@ public:
 
     Q_INVOKABLE void keepScreenOn(const bool on);
 
-    Q_INVOKABLE void deleteFile(const QString &path);
-    Q_INVOKABLE void touchFile(const QString &path);
+    Q_INVOKABLE void deleteFile(const QString &path);    //now deleteFiles({ path })
+    Q_INVOKABLE void touchFile(const QString &path);     //now touchFiles({ path })
+
+    // off the GUI thread, on a pool of FILE_OPERATION_THREADS. Emit throttled fileOperationProgress(),
+    // then one fileOperationFinished() and one alert() for the whole batch. Return the operation's id.
+    Q_INVOKABLE int  deleteFiles(const QStringList &paths);
+    Q_INVOKABLE int  touchFiles(const QStringList &paths);
+    Q_INVOKABLE void cancelFileOperation(const int id);  //paths not yet started are skipped
 
     Q_INVOKABLE bool pathExists(const QString &path) const;
     Q_INVOKABLE bool fileExists(const QString &path) const;
 
 private:
+    int  startFileOperation(const int kind, const QStringList &paths);
+    void runFileOperation(const QSharedPointer<FileOperation> &operation);
+    void finishFileOperation(const QSharedPointer<FileOperation> &operation);
+
+    QThreadPool                                 m_filePool;
+    QHash<int, QSharedPointer<FileOperation>>   m_fileOperations;     //running, by id
+    int                                         m_nextFileOperation = 1;
+    QLocale           m_locale;              //QLocale::system(), for formattedDataSize()
     bool              m_hasVibrator = false; //only set to true if android, VIBRATION permission set, and service started successfully in initializer.
 #ifdef Q_OS_ANDROID
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
@@ -98,6 +121,9 @@ private:
     
 Q_SIGNALS:
     void alert(const QString &message);
+    void fileOperationProgress(int id, int done, int total);
+    // 'failures' lists { "path", "error" } maps; 'cancelled' if cancelFileOperation() cut it short.
+    void fileOperationFinished(int id, int succeeded, const QVariantList &failures, bool cancelled);
 };
 
 extern QSharedPointer<Utils> _Utils;                       //global pointer to shared data
@@ -0,0 +1,205 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "utilsbench.h"
+#include "utils.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <QStringList>
+#include <cstdio>   //stdout
+#include <functional>
+
+#ifdef QMLVIDEOBUG_ALLOCATION_COUNTER   //the 'qmlvideobug_utilsbench' target, see qmlvideobug_utilsbench.pro
+#include "allocationcounter.h"
+static qint64 allocations() { return (allocationCount()); }
+#else
+static qint64 allocations() { return (-1); }
+#endif /* QMLVIDEOBUG_ALLOCATION_COUNTER */
+
+// the implementations replaced by the fast paths in utils.cpp, kept verbatim for comparison.
+static QString legacyToHtmlEscaped(const QString str) {
+    return (str.toHtmlEscaped());
+}
+
+static QString legacyFormattedDataSize(const qint64 sizeValue, const int precision) {
+    return (QLocale::system().formattedDataSize(sizeValue,
+                                                precision,
+                                                QLocale::DataSizeTraditionalFormat));
+}
+
+static QString legacyFormatDuration(const double duration) {
+    long hours{}, minutes{}, seconds{};
+    if (duration <= 3600000.0) {
+        hours   = 0l;
+        minutes = (long) (duration / 60000.0);
+        seconds = (long) ((duration - (((double) minutes * 60000.0))) / 1000.0);
+        if (seconds == 60l) {
+            minutes++;
+            seconds = 0l;
+        }
+        if (minutes == 60l) {
+            hours++;
+            minutes = 0l;
+        }
+        if (hours == 0l)
+            return (QString::number(minutes)
+                    + ((seconds < 10l) ? ":0" : ":")
+                    + QString::number(seconds));
+    }
+    else {
+        hours   = (long) (duration / (60.0*60000.0));
+        minutes = (long) ((duration - ((double) hours * 60.0 * 60000.0))/60000.0);
+        seconds = (long) ((duration - (((double) minutes * 60000.0))
+                               - ((double) hours * 60.0 * 60000.0)) / 1000.0);
+        if (seconds == 60l) {
+            minutes++;
+            seconds = 0l;
+        }
+        if (minutes == 60l) {
+            hours++;
+            minutes = 0l;
+        }
+    }
+    return (QString::number(hours)
+            + ((minutes < 10l) ? ":0" : ":")
+            + QString::number(minutes)
+            + ((seconds < 10l) ? ":0" : ":")
+            + QString::number(seconds));
+}
+
+///
+/// \brief measure -- 'iterations' calls of 'call(i)', cycling through the inputs.
+/// \return { "nsPerCall", "allocationsPerCall" }
+///
+static QJsonObject measure(const int iterations, const std::function<int (int)> &call) {
+    volatile int sink = 0;                  // keep the results observable
+    for (int i = 0; i < qMin(iterations, 64); i++)
+        sink = sink + call(i);              // warm up caches & lazily initialized statics
+
+    const qint64  allocated = allocations();
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+        sink = sink + call(i);
+    const qint64  elapsed   = timer.nsecsElapsed();
+    const qint64  allocs    = allocations();
+    Q_UNUSED(sink);
+    return (QJsonObject{
+        { QStringLiteral("nsPerCall"),          qreal(elapsed) / iterations },
+        { QStringLiteral("allocationsPerCall"), (allocated < 0) ? -1.0 : qreal(allocs - allocated) / iterations },
+    });
+}
+
+///
+/// \brief compare -- a fast path against its former implementation, over all of 'count' inputs, then timed.
+///
+static QJsonObject compare(const QString &method, const int iterations, const int count,
+                           const std::function<QString (int)> &current,
+                           const std::function<QString (int)> &legacy,
+                           bool *identical) {
+    QJsonArray mismatches;
+    for (int i = 0; i < count; i++)
+        if (current(i) != legacy(i))
+            mismatches.append(QJsonObject{ { QStringLiteral("input"),   i },
+                                           { QStringLiteral("current"), current(i) },
+                                           { QStringLiteral("legacy"),  legacy(i) } });
+    *identical = *identical && mismatches.isEmpty();
+
+    const QJsonObject now    = measure(iterations, [&](int i) { return (current(i % count).size()); });
+    const QJsonObject before = measure(iterations, [&](int i) { return (legacy(i % count).size()); });
+    const qreal       nowNs  = now.value(QStringLiteral("nsPerCall")).toDouble();
+    return (QJsonObject{
+        { QStringLiteral("method"),                   method },
+        { QStringLiteral("inputs"),                   count },
+        { QStringLiteral("identical"),                mismatches.isEmpty() },
+        { QStringLiteral("mismatches"),               mismatches },
+        { QStringLiteral("nsPerCall"),                nowNs },
+        { QStringLiteral("allocationsPerCall"),       now.value(QStringLiteral("allocationsPerCall")) },
+        { QStringLiteral("legacyNsPerCall"),          before.value(QStringLiteral("nsPerCall")) },
+        { QStringLiteral("legacyAllocationsPerCall"), before.value(QStringLiteral("allocationsPerCall")) },
+        { QStringLiteral("speedup"),                  (nowNs > 0.0) ? before.value(QStringLiteral("nsPerCall")).toDouble() / nowNs : 0.0 },
+    });
+}
+
+static QJsonObject single(const QString &method, const int iterations, const std::function<int (int)> &call) {
+    QJsonObject result = measure(iterations, call);
+    result.insert(QStringLiteral("method"), method);
+    return (result);
+}
+
+bool UtilsBench::run(const Utils &utils, const int iterations, const QString &outputPath) {
+    const int n = qMax(1, iterations);
+
+    // position ticks under and over an hour, the 00:60 and 1:60:00 carries, and out of range values.
+    const QList<double> durations = { 0.0, 999.0, 9999.0, 59999.0, 59999.9, 61000.0, 599999.0, 3599999.0,
+                                      3599999.9, 3600000.0, 3600001.0, 7322000.0, 86399999.0, 360000000.0,
+                                      12345.678, -1500.0, -3600001.0 };
+    const QList<qint64> sizes     = { 0, 1, 1023, 1024, 1536, 1048575, 1048576, 123456789,
+                                      Q_INT64_C(5368709120), Q_INT64_C(1099511627776), -4096 };
+    const QStringList   titles    = { QStringLiteral("Big Buck Bunny"),
+                                      QStringLiteral("BBC Radio Four Extra - The Archers"),
+                                      QStringLiteral("Tom & Jerry <live> \"remastered\""),
+                                      QString(),
+                                      QStringLiteral("Café del Mar — Ólafur Arnalds") };
+
+    bool        identical = true;
+    QJsonArray  results;
+    results.append(compare(QStringLiteral("formatDuration"), n, durations.size(),
+                           [&](int i) { return (utils.formatDuration(durations.at(i))); },
+                           [&](int i) { return (legacyFormatDuration(durations.at(i))); },
+                           &identical));
+    results.append(compare(QStringLiteral("formattedDataSize"), n, sizes.size(),
+                           [&](int i) { return (utils.formattedDataSize(sizes.at(i), 2)); },
+                           [&](int i) { return (legacyFormattedDataSize(sizes.at(i), 2)); },
+                           &identical));
+    results.append(compare(QStringLiteral("toHtmlEscaped"), n, titles.size(),
+                           [&](int i) { return (utils.toHtmlEscaped(titles.at(i))); },
+                           [&](int i) { return (legacyToHtmlEscaped(titles.at(i))); },
+                           &identical));
+
+    const QString directory = QDir::tempPath();
+    const QString file      = QDir(directory).filePath(QStringLiteral("qmlvideobug-utilsbench-missing"));
+    results.append(single(QStringLiteral("linearToLog"),     n, [&](int i) { return (int(1000.0 * utils.linearToLog((i % 101) / 100.0))); }));
+    results.append(single(QStringLiteral("qtVersion"),       n, [&](int)   { return (utils.qtVersion().size()); }));
+    results.append(single(QStringLiteral("osName"),          n, [&](int)   { return (utils.osName().size()); }));
+    results.append(single(QStringLiteral("osBinaryVersion"), n, [&](int)   { return (utils.osBinaryVersion()); }));
+    results.append(single(QStringLiteral("supportsSSL"),     n, [&](int)   { return (int(utils.supportsSSL())); }));
+    results.append(single(QStringLiteral("pathExists"),      n, [&](int)   { return (int(utils.pathExists(directory))); }));
+    results.append(single(QStringLiteral("fileExists"),      n, [&](int)   { return (int(utils.fileExists(file))); }));
+
+    const QJsonObject root {
+        { QStringLiteral("qtVersion"),   QStringLiteral(QT_VERSION_STR) },
+        { QStringLiteral("iterations"),  n },
+        { QStringLiteral("identical"),   identical },
+        { QStringLiteral("results"),     results },
+    };
+    const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+
+    QFile out;
+    const bool opened = (outputPath.isEmpty() || outputPath == QLatin1String("-"))
+                        ? out.open(stdout, QIODevice::WriteOnly)
+                        : (out.setFileName(outputPath), out.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    if (!opened)
+        qWarning() << Q_FUNC_INFO << ": unable to write results to" << outputPath;
+    else
+        out.write(json);
+    return (identical);
+}
@@ -0,0 +1,43 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef UTILSBENCH_H
+#define UTILSBENCH_H
+
+#include <QString>
+
+class Utils;
+
+///
+/// \brief The UtilsBench class
+///
+/// 'qmlvideobug_bench --utils=N' (see qmlvideobug_bench.pro): times N calls of each Utils
+/// method that QML calls from per-tick bindings, and counts heap allocations per call,
+/// writing JSON like BenchRunner. The formatters are also run through copies of their
+/// former implementations, over the same inputs, to show the outputs are identical and
+/// by how much the fast paths are faster.
+///
+/// Allocations are counted only by the 'qmlvideobug_utilsbench' target, which links
+/// allocationcounter.cpp (glibc only); elsewhere, including 'qmlvideobug_bench', they're -1.
+///
+class UtilsBench
+{
+public:
+    // false if a fast path's output differed from its former implementation's.
+    static bool run(const Utils &utils, const int iterations, const QString &outputPath);
+};
+
+#endif // UTILSBENCH_H
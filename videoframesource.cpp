@@ -0,0 +1,98 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "videoframesource.h"
+#include <QDebug>
+
+VideoFrameSource::VideoFrameSource(QObject *parent)
+    : QObject(parent)
+{
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    connect(&m_probe, &QVideoProbe::videoFrameProbed,
+            this,     &VideoFrameSource::frameArrived,
+            Qt::DirectConnection);
+#endif /* QT_VERSION... */
+}
+
+///
+/// \brief VideoFrameSource::mediaPlayerFor
+/// \param qmlPlayer -- an instance of MediaPlayer5.qml or MediaPlayer6.qml
+/// \return the underlying QMediaPlayer, or nullptr.
+///
+QMediaPlayer *VideoFrameSource::mediaPlayerFor(QObject *qmlPlayer) {
+    if (!qmlPlayer)
+        return (nullptr);
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5 QML MediaPlayer wraps QMediaPlayer as 'mediaObject'
+    return (qobject_cast<QMediaPlayer *>(qvariant_cast<QObject *>(qmlPlayer->property("mediaObject"))));
+#else                                           //Qt6 QML MediaPlayer is-a QMediaPlayer
+    return (qobject_cast<QMediaPlayer *>(qmlPlayer));
+#endif /* QT_VERSION... */
+}
+
+///
+/// \brief VideoFrameSource::attach
+/// \param qmlPlayer
+/// \return false if 'qmlPlayer' isn't backed by a QMediaPlayer.
+///
+bool VideoFrameSource::attach(QObject *qmlPlayer) {
+    QMediaPlayer *player = mediaPlayerFor(qmlPlayer);
+    if (player == m_player)
+        return (player != nullptr);
+
+    detach();
+    if (!player) {
+        qWarning() << Q_FUNC_INFO << ": not a MediaPlayer:" << qmlPlayer;
+        return (false);
+    }
+    m_player = player;
+
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    if (!m_probe.setSource(player))
+        qWarning() << Q_FUNC_INFO << ": QVideoProbe unsupported by this media backend.";
+#else                                           //Qt6
+    m_outputConnection = connect(player, &QMediaPlayer::videoOutputChanged,
+                                 this,   &VideoFrameSource::resolveSink);
+    resolveSink();
+#endif /* QT_VERSION... */
+    return (true);
+}
+
+void VideoFrameSource::detach() {
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    m_probe.setSource(static_cast<QMediaObject *>(nullptr));
+#else                                           //Qt6
+    disconnect(m_outputConnection);
+    disconnect(m_sinkConnection);
+    m_sink.clear();
+#endif /* QT_VERSION... */
+    m_player.clear();
+}
+
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))   //Qt6
+///
+/// \brief VideoFrameSource::resolveSink -- follow the player's VideoOutput, which may be (re)assigned at any time.
+///
+void VideoFrameSource::resolveSink() {
+    QVideoSink *sink = (m_player) ? m_player->videoSink() : nullptr;
+    if (sink == m_sink)
+        return;
+    disconnect(m_sinkConnection);
+    m_sink = sink;
+    if (sink)
+        m_sinkConnection = connect(sink, &QVideoSink::videoFrameChanged,
+                                   this, &VideoFrameSource::frameArrived,
+                                   Qt::DirectConnection);
+}
+#endif /* QT_VERSION... */
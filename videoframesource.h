@@ -0,0 +1,73 @@
+// Copyright (C) 2022 Niels P. Mayer (http://nielsmayer.com)
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VIDEOFRAMESOURCE_H
+#define VIDEOFRAMESOURCE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QMediaPlayer>
+#include <QVideoFrame>
+#include <qplatformdefs.h> // defines QT_VERSION, etc
+
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+#include <QVideoProbe>
+#else                                           //Qt6
+#include <QVideoSink>
+#endif /* QT_VERSION... */
+
+///
+/// \brief The VideoFrameSource class
+///
+/// Version-independent tap on the video frames decoded for a QML MediaPlayer
+/// (MediaPlayer5.qml or MediaPlayer6.qml). For Qt6 the QML MediaPlayer is a
+/// QMediaPlayer, and frames are taken from the QVideoSink of its VideoOutput.
+/// For Qt5 the QML MediaPlayer wraps a QMediaPlayer ('mediaObject') which is
+/// observed by a QVideoProbe.
+///
+/// NB: frameArrived() is emitted on whichever thread the backend delivers frames on,
+/// which is frequently not the GUI thread. Receivers must connect with
+/// Qt::DirectConnection, do as little as possible, and be thread-safe.
+///
+class VideoFrameSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VideoFrameSource(QObject *parent = nullptr);
+
+    // the QMediaPlayer underlying a QML MediaPlayer, or nullptr.
+    static QMediaPlayer *mediaPlayerFor(QObject *qmlPlayer);
+
+    bool attach(QObject *qmlPlayer);
+    void detach();
+    QMediaPlayer *mediaPlayer() const { return (m_player); }
+
+Q_SIGNALS:
+    void frameArrived(const QVideoFrame &frame);
+
+private:
+    QPointer<QMediaPlayer>      m_player;
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))    //Qt5
+    QVideoProbe                 m_probe;
+#else                                           //Qt6
+    void resolveSink();
+    QPointer<QVideoSink>        m_sink;
+    QMetaObject::Connection     m_sinkConnection;
+    QMetaObject::Connection     m_outputConnection;
+#endif /* QT_VERSION... */
+};
+
+#endif // VIDEOFRAMESOURCE_H